@@ -0,0 +1,55 @@
+/*
+ * Timing and JSON output shared by the benchmarks, so the results of
+ * each can be collected and compared between builds the same way:
+ *
+ *   {"benchmark": name, "params": {...}, "results": {what: {"secs": secs, unit: val}, ...}}
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include "bench.h"
+
+static int first = 1;
+
+double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double fastest(double best, double secs)
+{
+	return best < 0 || secs < best ? secs : best;
+}
+
+void report_begin(const char *name, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("{\n  \"benchmark\": \"%s\",\n  \"params\": {", name);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("},\n  \"results\": {");
+}
+
+void report(const char *what, double secs, const char *unit, double val)
+{
+	printf("%s\n    \"%s\": {\"secs\": %.6f, \"%s\": %.2f}",
+	       first ? "" : ",", what, secs, unit, val);
+	first = 0;
+}
+
+void report_end(void)
+{
+	printf("\n  }\n}\n");
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
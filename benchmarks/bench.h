@@ -0,0 +1,29 @@
+/*
+ * Timing and JSON output shared by the benchmarks, see bench.c
+ */
+#ifndef BENCH_H_
+#define BENCH_H_
+
+/* Seconds on a monotonic clock */
+double now(void);
+
+/* The fastest of a few runs, best is negative before the first */
+double fastest(double best, double secs);
+
+/*
+ * Results are written to stdout as one JSON object: report_begin()
+ * with the name and the "params" members, formatted by fmt like
+ * printf(), then report() for each result and report_end().
+ */
+void report_begin(const char *name, const char *fmt, ...);
+void report(const char *what, double secs, const char *unit, double val);
+void report_end(void);
+
+#endif /* BENCH_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,98 @@
+/*
+ * cfg_diff() on a configuration with 40k titled sections and a single
+ * change: the first diff of two freshly parsed trees has to hash both,
+ * after that only the sections on the path of a change are rehashed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "confuse.h"
+#include "bench.h"
+
+#define NUM_SECTIONS 40000
+
+static int count(void *arg, cfg_diff_kind_t kind, const char *path,
+		 cfg_opt_t *oldopt, cfg_opt_t *newopt, cfg_t *oldsec, cfg_t *newsec)
+{
+	(*(int *)arg)++;
+	return 0;
+}
+
+static cfg_t *create(const char *buf)
+{
+	static cfg_opt_t backend_opts[] = {
+		CFG_STR("host", NULL, CFGF_NONE),
+		CFG_INT("port", 80, CFGF_NONE),
+		CFG_INT("weight", 1, CFGF_NONE),
+		CFG_END()
+	};
+	static cfg_opt_t opts[] = {
+		CFG_SEC("backend", backend_opts, CFGF_MULTI | CFGF_TITLE),
+		CFG_END()
+	};
+	cfg_t *cfg;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	if (!cfg || cfg_parse_buf(cfg, buf) != CFG_SUCCESS)
+		exit(1);
+
+	return cfg;
+}
+
+int main(void)
+{
+	cfg_t *oldcfg, *newcfg;
+	char *buf, *ptr;
+	double start, secs;
+	int i, changes;
+
+	buf = malloc(NUM_SECTIONS * 64);
+	if (!buf)
+		return 1;
+
+	for (i = 0, ptr = buf; i < NUM_SECTIONS; i++)
+		ptr += sprintf(ptr, "backend b%d { host = \"10.%d.%d.1\" port = %d }\n",
+			       i, i / 256 % 256, i % 256, 1024 + i % 1000);
+
+	oldcfg = create(buf);
+	newcfg = create(buf);
+	free(buf);
+
+	if (cfg_setint(cfg_gettsec(newcfg, "backend", "b20000"), "port", 1))
+		return 1;
+
+	report_begin("diff", "\"sections\": %d", NUM_SECTIONS);
+	changes = 0;
+	start = now();
+	cfg_diff(oldcfg, newcfg, count, &changes);
+	secs = now() - start;
+	report("first", secs, "ms_per_diff", secs * 1e3);
+
+	changes = 0;
+	start = now();
+	cfg_diff(oldcfg, newcfg, count, &changes);
+	secs = now() - start;
+	report("cached", secs, "ms_per_diff", secs * 1e3);
+
+	if (cfg_setint(cfg_gettsec(newcfg, "backend", "b30000"), "weight", 2))
+		return 1;
+
+	changes = 0;
+	start = now();
+	cfg_diff(oldcfg, newcfg, count, &changes);
+	secs = now() - start;
+	report("after_change", secs, "ms_per_diff", secs * 1e3);
+
+	cfg_free(oldcfg);
+	cfg_free(newcfg);
+	report_end();
+
+	return changes != 4;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
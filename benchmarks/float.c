@@ -0,0 +1,93 @@
+/*
+ * Throughput of float printing and parsing, cfg_print_to_buffer() and
+ * cfg_parse_buf() on a large list, compared with the printf("%.17g")
+ * and strtod() round-trip that is the usual alternative.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "confuse.h"
+#include "bench.h"
+
+#define NUM_VALUES 1000000
+
+int main(void)
+{
+	cfg_opt_t opts[] = {
+		CFG_FLOAT_LIST("list", NULL, CFGF_NONE),
+		CFG_END()
+	};
+	uint64_t state = 88172645463325252ULL;
+	double *values, start, secs, sum = 0;
+	char *buf, *ptr, num[32];
+	cfg_t *cfg;
+	size_t len;
+	int i;
+
+	values = malloc(NUM_VALUES * sizeof(double));
+	if (!values)
+		return 1;
+
+	/* Mix of "human" thresholds and full precision values */
+	for (i = 0; i < NUM_VALUES; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		if (i % 2)
+			values[i] = (double)(state % 100000) / 1000;
+		else
+			values[i] = (double)(state >> 11) / (double)(UINT64_C(1) << 53) * 1e6;
+	}
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	if (!cfg)
+		return 1;
+	for (i = 0; i < NUM_VALUES; i++)
+		cfg_setnfloat(cfg, "list", values[i], i);
+
+	report_begin("float", "\"values\": %d", NUM_VALUES);
+	start = now();
+	if (cfg_print_to_buffer(cfg, &buf, &len))
+		return 1;
+	secs = now() - start;
+	report("print_to_buffer", secs, "mvalues_per_sec", NUM_VALUES / secs / 1e6);
+	cfg_free(cfg);
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	start = now();
+	if (cfg_parse_buf(cfg, buf))
+		return 1;
+	secs = now() - start;
+	report("parse_buf", secs, "mvalues_per_sec", NUM_VALUES / secs / 1e6);
+	if (cfg_size(cfg, "list") != NUM_VALUES || cfg_getnfloat(cfg, "list", 0) != values[0])
+		return 1;
+	cfg_free(cfg);
+	free(buf);
+
+	start = now();
+	for (i = 0; i < NUM_VALUES; i++)
+		sum += snprintf(num, sizeof(num), "%.17g", values[i]);
+	secs = now() - start;
+	report("snprintf", secs, "mvalues_per_sec", NUM_VALUES / secs / 1e6);
+
+	start = now();
+	for (i = 0; i < NUM_VALUES; i++) {
+		snprintf(num, sizeof(num), "%.17g", values[i]);
+		sum += strtod(num, &ptr);
+	}
+	secs = now() - start;
+	report("snprintf_strtod", secs, "mvalues_per_sec", NUM_VALUES / secs / 1e6);
+
+	free(values);
+	report_end();
+
+	return sum == 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,60 @@
+/*
+ * Writes the synthetic configuration used by the benchmark suite, to
+ * stdout or as main.conf and its included files in a directory, for
+ * profiling a parse outside of the suite.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "synth.h"
+
+static int usage(int code)
+{
+	fprintf(stderr, "Usage: gen [-o DIR] [OPTIONS]\n"
+		"  -o DIR   Write main.conf and inc*.conf to DIR instead of stdout\n");
+	synth_usage();
+
+	return code;
+}
+
+int main(int argc, char *argv[])
+{
+	struct synth s;
+	const char *dir = NULL;
+	char *buf;
+	size_t len;
+	int c;
+
+	synth_init(&s);
+	while ((c = getopt(argc, argv, "ho:" SYNTH_OPTS)) != EOF) {
+		switch (c) {
+		case 'h':
+			return usage(0);
+		case 'o':
+			dir = optarg;
+			break;
+		default:
+			if (synth_option(&s, c, optarg))
+				return usage(1);
+			break;
+		}
+	}
+
+	if (dir)
+		return synth_files(&s, dir) ? 0 : 1;
+
+	buf = synth_buf(&s, &len, NULL);
+	if (fwrite(buf, len, 1, stdout) != 1)
+		return 1;
+	free(buf);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,121 @@
+/*
+ * Integer parsing throughput: cfg_setmulti() on a large list, which
+ * parses each value in a single pass, compared with the radix prefix
+ * detection plus strtol() that cfg_setopt() used to do per value.  The
+ * reference also allocates a value cell per entry, like cfg_setopt().
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "confuse.h"
+#include "bench.h"
+
+#define NUM_VALUES 1000000
+
+/* The old per-value path, for reference */
+static long int strtol_radix(const char *value, int *err)
+{
+	const char *str = value;
+	char *endptr;
+	int radix = 0;
+	long int i;
+
+	if (value[0] == '0') {
+		switch (value[1]) {
+		case 'b':
+			radix = 2;
+			str = &value[2];
+			break;
+
+		case 'x':
+			radix = 16;
+			str = &value[2];
+			break;
+
+		default:
+			radix = 8;
+			str = &value[1];
+		}
+	}
+
+	i = strtol(str, &endptr, radix);
+	*err |= *endptr != '\0';
+
+	return i;
+}
+
+int main(void)
+{
+	cfg_opt_t opts[] = {
+		CFG_INT_LIST("ports", NULL, CFGF_NONE),
+		CFG_UINT16_LIST("weights", NULL, CFGF_NONE),
+		CFG_END()
+	};
+	char **values, buf[32];
+	long int **cells, sum = 0;
+	double start, secs;
+	int i, err = 0;
+	cfg_t *cfg;
+
+	values = malloc(NUM_VALUES * sizeof(char *));
+	if (!values)
+		return 1;
+
+	for (i = 0; i < NUM_VALUES; i++) {
+		snprintf(buf, sizeof(buf), i % 8 ? "%d" : "0x%x", (unsigned int)i * 7919 % 65536);
+		values[i] = strdup(buf);
+		if (!values[i])
+			return 1;
+	}
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	if (!cfg)
+		return 1;
+
+	report_begin("intparse", "\"values\": %d", NUM_VALUES);
+	start = now();
+	if (cfg_setmulti(cfg, "ports", NUM_VALUES, values))
+		return 1;
+	secs = now() - start;
+	report("setmulti_int", secs, "mvalues_per_sec", NUM_VALUES / secs / 1e6);
+
+	start = now();
+	if (cfg_setmulti(cfg, "weights", NUM_VALUES, values))
+		return 1;
+	secs = now() - start;
+	report("setmulti_uint16", secs, "mvalues_per_sec", NUM_VALUES / secs / 1e6);
+	cfg_free(cfg);
+
+	cells = malloc(NUM_VALUES * sizeof(long int *));
+	if (!cells)
+		return 1;
+
+	start = now();
+	for (i = 0; i < NUM_VALUES; i++) {
+		cells[i] = calloc(1, sizeof(uint64_t));
+		if (!cells[i])
+			return 1;
+		*cells[i] = strtol_radix(values[i], &err);
+	}
+	secs = now() - start;
+	report("strtol_radix", secs, "mvalues_per_sec", NUM_VALUES / secs / 1e6);
+
+	for (i = 0; i < NUM_VALUES; i++) {
+		sum += *cells[i];
+		free(cells[i]);
+		free(values[i]);
+	}
+	free(cells);
+	free(values);
+	report_end();
+
+	return err || sum == 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
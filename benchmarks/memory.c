@@ -0,0 +1,225 @@
+/*
+ * Memory held per titled section and per option, for trees of 1k to 1M
+ * sections of a typical schema: strings, numbers and lists with
+ * defaults, left at their defaults, eagerly or with CFGF_LAZY, all
+ * set, and all set with a comment kept by CFGF_COMMENTS.  Both the bytes the library counts,
+ * see cfg_memory_stats(), and the growth of the heap including the
+ * overhead of malloc(3) are reported as JSON.  Fails if a section
+ * needs more than the budget, so growth shows up in `make bench`.
+ *
+ * Sections are grouped by a thousand, because a titled section is
+ * looked up among its siblings when it is added.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "confuse.h"
+
+#define NUM_GROUP    1000
+#define NUM_MAX      1000000
+#define NUM_OPTIONS  7
+
+/* Heap per section, in bytes, checked at every size */
+static const struct {
+	const char *name;
+	int         flags;
+	int         values;
+	size_t      budget;
+} schemas[] = {
+	{ "defaults", CFGF_NONE,     0, 2900 },
+	{ "lazy",     CFGF_LAZY,     0, 2100 },
+	{ "values",   CFGF_NONE,     1, 2900 },
+	{ "comments", CFGF_COMMENTS, 1, 3150 },
+};
+
+static size_t budget_all;
+
+static cfg_opt_t node_opts[] = {
+	CFG_STR("host", "localhost", CFGF_NONE),
+	CFG_INT("port", 80, CFGF_NONE),
+	CFG_FLOAT("weight", 1.0, CFGF_NONE),
+	CFG_BOOL("enabled", cfg_true, CFGF_NONE),
+	CFG_STR("description", "A backend server", CFGF_NONE),
+	CFG_STR_LIST("tags", "{web, eu, prod}", CFGF_NONE),
+	CFG_INT_LIST("ports", "{80, 443}", CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t group_opts[] = {
+	CFG_SEC("node", node_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_SEC("group", group_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+/* Bytes in use on the heap, 0 if not known */
+static size_t heap(void)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+static char *option(char *ptr, int comment, unsigned int i, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (comment)
+		ptr += sprintf(ptr, "/* Option of node %u */\n", i);
+
+	va_start(ap, fmt);
+	ptr += vsprintf(ptr, fmt, ap);
+	va_end(ap);
+	*ptr++ = '\n';
+
+	return ptr;
+}
+
+static void group(char *buf, int schema, unsigned int g, unsigned int num)
+{
+	int comment = schemas[schema].flags & CFGF_COMMENTS;
+	char *ptr = buf;
+	unsigned int i;
+
+	ptr += sprintf(ptr, "group g%u {\n", g);
+	for (i = 0; i < num; i++) {
+		if (!schemas[schema].values) {
+			ptr += sprintf(ptr, "node n%u {}\n", i);
+			continue;
+		}
+
+		ptr += sprintf(ptr, "node n%u {\n", i);
+		ptr = option(ptr, comment, i, "host = \"host-%u.example.com\"", g * NUM_GROUP + i);
+		ptr = option(ptr, comment, i, "port = %u", 1024 + i);
+		ptr = option(ptr, comment, i, "weight = %u.5", i % 10);
+		ptr = option(ptr, comment, i, "enabled = %s", i % 2 ? "true" : "false");
+		ptr = option(ptr, comment, i, "description = \"Node %u of group %u\"", i, g);
+		ptr = option(ptr, comment, i, "tags = {\"t%u\", \"t%u\"}", i % 10, i % 7);
+		ptr = option(ptr, comment, i, "ports = {%u, %u, %u}", i, i + 1, i + 2);
+		ptr += sprintf(ptr, "}\n");
+	}
+	sprintf(ptr, "}\n");
+}
+
+static int measure(int schema, unsigned int sections, char *buf, int first)
+{
+	size_t before, after, bytes, allocs, budget;
+	cfg_memory_stats_t stats;
+	double per_section;
+	unsigned int g, num;
+	cfg_t *cfg;
+
+	cfg = cfg_init(opts, schemas[schema].flags);
+	if (!cfg || cfg_memory_stats(cfg, &stats))
+		exit(1);
+
+	/* Only what the sections add */
+	before = heap();
+	bytes  = stats.total.bytes;
+	allocs = stats.total.allocs;
+	for (g = 0; g * NUM_GROUP < sections; g++) {
+		num = sections - g * NUM_GROUP;
+		if (num > NUM_GROUP)
+			num = NUM_GROUP;
+
+		group(buf, schema, g, num);
+		if (cfg_parse_buf(cfg, buf) != CFG_SUCCESS)
+			exit(1);
+	}
+	after = heap();
+
+	if (cfg_memory_stats(cfg, &stats))
+		exit(1);
+	bytes  = stats.total.bytes - bytes;
+	allocs = stats.total.allocs - allocs;
+	cfg_free(cfg);
+
+	/* Without a heap size, the bytes counted by the library */
+	if (after)
+		per_section = (double)(after - before) / sections;
+	else
+		per_section = (double)bytes / sections;
+
+	budget = budget_all ? budget_all : schemas[schema].budget;
+	printf("%s\n    {\"schema\": \"%s\", \"sections\": %u, \"bytes\": %lu, \"allocs\": %lu, "
+	       "\"heap\": %lu, \"per_section\": %.1f, \"per_option\": %.1f, \"budget\": %lu}",
+	       first ? "" : ",", schemas[schema].name, sections,
+	       (unsigned long)bytes, (unsigned long)allocs,
+	       (unsigned long)(after ? after - before : 0), per_section,
+	       per_section / NUM_OPTIONS, (unsigned long)budget);
+
+	if (per_section > budget) {
+		fprintf(stderr, "memory: %s uses %.1f bytes per section with %u sections, budget %lu\n",
+			schemas[schema].name, per_section, sections, (unsigned long)budget);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int usage(int code)
+{
+	fprintf(stderr, "Usage: memory [-m NUM] [-b BYTES]\n"
+		"  -m NUM    Largest tree, in sections, default %d\n"
+		"  -b BYTES  Budget per section for all schemas, instead of the defaults\n",
+		NUM_MAX);
+
+	return code;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int max = NUM_MAX, sections;
+	int c, i, rc = 0, first = 1;
+	char *buf;
+
+	while ((c = getopt(argc, argv, "hm:b:")) != EOF) {
+		switch (c) {
+		case 'h':
+			return usage(0);
+		case 'm':
+			max = atoi(optarg);
+			break;
+		case 'b':
+			budget_all = atol(optarg);
+			break;
+		default:
+			return usage(1);
+		}
+	}
+	if (max < 1)
+		return usage(1);
+
+	buf = malloc(NUM_GROUP * 512);
+	if (!buf)
+		return 1;
+
+	printf("{\n  \"benchmark\": \"memory\",\n  \"results\": [");
+	for (i = 0; i < (int)(sizeof(schemas) / sizeof(schemas[0])); i++) {
+		for (sections = 1000; sections <= max; sections *= 10) {
+			rc |= measure(i, sections, buf, first);
+			first = 0;
+		}
+	}
+	printf("\n  ]\n}\n");
+	free(buf);
+
+	return rc;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,306 @@
+/*
+ * The whole life of a configuration on a synthetic one from synth.c:
+ * parsing a buffer, files and sections left at their defaults, lookups
+ * at the top level, through nested sections and by title, printing it,
+ * a copy with one nested option changed, and freeing it.  Each is the
+ * fastest of a few runs, written as JSON
+ * to stdout so results can be collected and compared between builds.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "synth.h"
+
+#define NUM_REPEAT  3
+#define NUM_LOOKUPS 100000
+#define NUM_KEYS    1024
+
+static struct synth s;
+static cfg_opt_t *opts;
+static unsigned int repeat = NUM_REPEAT;
+static unsigned long lookups = NUM_LOOKUPS;
+static volatile long sink;
+
+static cfg_t *parse_buf(const char *buf, double *secs)
+{
+	double start;
+	cfg_t *cfg;
+
+	start = now();
+	cfg = cfg_init(opts, CFGF_NONE);
+	if (!cfg || cfg_parse_buf(cfg, buf) != CFG_SUCCESS)
+		exit(1);
+	*secs = now() - start;
+
+	return cfg;
+}
+
+static void bench_parse_buf(const char *buf, size_t len)
+{
+	double secs, best = -1;
+	unsigned int i;
+
+	for (i = 0; i < repeat; i++) {
+		cfg_free(parse_buf(buf, &secs));
+		best = fastest(best, secs);
+	}
+	report("parse_buf", best, "mb_per_sec", len / best / 1e6);
+}
+
+static void bench_parse_file(void)
+{
+	char dir[] = "/tmp/confuse-bench-XXXXXX", path[64];
+	double start, best = -1;
+	unsigned int i;
+	size_t len;
+	cfg_t *cfg;
+
+	if (!mkdtemp(dir))
+		exit(1);
+	len = synth_files(&s, dir);
+	if (!len)
+		exit(1);
+
+	snprintf(path, sizeof(path), "%s/main.conf", dir);
+	for (i = 0; i < repeat; i++) {
+		start = now();
+		cfg = cfg_init(opts, CFGF_NONE);
+		if (!cfg || cfg_parse(cfg, path) != CFG_SUCCESS)
+			exit(1);
+		best = fastest(best, now() - start);
+		cfg_free(cfg);
+	}
+	report("parse_file", best, "mb_per_sec", len / best / 1e6);
+
+	remove(path);
+	for (i = 1; i <= s.includes; i++) {
+		snprintf(path, sizeof(path), "%s/inc%u.conf", dir, i);
+		remove(path);
+	}
+	rmdir(dir);
+}
+
+/* Only titles, every option of every nested section is a default */
+static void bench_parse_defaults(unsigned int sections)
+{
+	double secs, best = -1;
+	char *buf, *ptr, title[32];
+	unsigned int i;
+
+	buf = malloc(sections * 48 + 1);
+	if (!buf)
+		exit(1);
+	for (i = 0, ptr = buf; i < sections; i++) {
+		synth_title(&s, i, title, sizeof(title));
+		ptr += sprintf(ptr, "node %s {}\n", title);
+	}
+	*ptr = 0;
+
+	for (i = 0; i < repeat; i++) {
+		cfg_free(parse_buf(buf, &secs));
+		best = fastest(best, secs);
+	}
+	free(buf);
+	report("parse_defaults", best, "ns_per_section", best * 1e9 / sections);
+}
+
+static void bench_lookup(cfg_t *cfg, unsigned int sections)
+{
+	char *nested[NUM_KEYS], *titles[NUM_KEYS], title[32];
+	double start, best;
+	unsigned int i, j;
+	unsigned long n;
+	size_t len;
+
+	for (i = 0; i < NUM_KEYS; i++) {
+		synth_title(&s, (i * 7919) % sections, title, sizeof(title));
+		titles[i] = strdup(title);
+		nested[i] = malloc(strlen(title) + 16 + s.depth * 6);
+		if (!titles[i] || !nested[i])
+			exit(1);
+
+		len = sprintf(nested[i], "node=%s|", title);
+		for (j = 0; j < s.depth; j++)
+			len += sprintf(nested[i] + len, "child|");
+		strcpy(nested[i] + len, "port");
+	}
+
+	for (i = 0, best = -1; i < repeat; i++) {
+		start = now();
+		for (n = 0; n < lookups; n++)
+			sink += cfg_getint(cfg, "port");
+		best = fastest(best, now() - start);
+	}
+	report("lookup_flat", best, "ns_per_op", best * 1e9 / lookups);
+
+	for (i = 0, best = -1; i < repeat; i++) {
+		start = now();
+		for (n = 0; n < lookups; n++)
+			sink += cfg_getint(cfg, nested[n % NUM_KEYS]);
+		best = fastest(best, now() - start);
+	}
+	report("lookup_nested", best, "ns_per_op", best * 1e9 / lookups);
+
+	for (i = 0, best = -1; i < repeat; i++) {
+		start = now();
+		for (n = 0; n < lookups; n++)
+			sink += cfg_gettsec(cfg, "node", titles[n % NUM_KEYS]) != NULL;
+		best = fastest(best, now() - start);
+	}
+	report("lookup_titled", best, "ns_per_op", best * 1e9 / lookups);
+
+	for (i = 0; i < NUM_KEYS; i++) {
+		free(nested[i]);
+		free(titles[i]);
+	}
+}
+
+static int count(void *arg, const char *buf, size_t len)
+{
+	*(size_t *)arg += len;
+	return 0;
+}
+
+static void bench_print(cfg_t *cfg)
+{
+	double start, best = -1;
+	unsigned int i;
+	size_t len = 0;
+
+	for (i = 0; i < repeat; i++) {
+		len = 0;
+		start = now();
+		if (cfg_print_cb(cfg, count, &len))
+			exit(1);
+		best = fastest(best, now() - start);
+	}
+	report("print", best, "mb_per_sec", len / best / 1e6);
+}
+
+/* Should not grow with the number of sections, see cfg_dup() */
+static void bench_dup(cfg_t *cfg, unsigned int sections)
+{
+	double start, best = -1;
+	char title[32], *path;
+	unsigned int i;
+	size_t len;
+	cfg_t *copy;
+
+	synth_title(&s, sections / 2, title, sizeof(title));
+	path = malloc(strlen(title) + 16 + s.depth * 6);
+	if (!path)
+		exit(1);
+
+	len = sprintf(path, "node=%s|", title);
+	for (i = 0; i < s.depth; i++)
+		len += sprintf(path + len, "child|");
+	strcpy(path + len, "port");
+
+	/* Copies share its values, it is not timed or changed after this */
+	if (cfg_freeze(cfg) != CFG_SUCCESS)
+		exit(1);
+
+	for (i = 0; i < repeat; i++) {
+		start = now();
+		copy = cfg_dup(cfg);
+		if (!copy || cfg_setint(copy, path, 1) != CFG_SUCCESS)
+			exit(1);
+		cfg_free(copy);
+		best = fastest(best, now() - start);
+	}
+	free(path);
+	report("dup_change", best, "us_per_op", best * 1e6);
+}
+
+static void bench_free(const char *buf, unsigned int sections)
+{
+	double secs, start, best = -1;
+	unsigned int i;
+	cfg_t *cfg;
+
+	for (i = 0; i < repeat; i++) {
+		cfg = parse_buf(buf, &secs);
+		start = now();
+		cfg_free(cfg);
+		best = fastest(best, now() - start);
+	}
+	report("free", best, "ns_per_section", best * 1e9 / sections);
+}
+
+static int usage(int code)
+{
+	fprintf(stderr, "Usage: suite [-r NUM] [-n NUM] [OPTIONS]\n"
+		"  -r NUM   Runs of each benchmark, the fastest is reported, default %d\n"
+		"  -n NUM   Lookups per run, default %d\n", NUM_REPEAT, NUM_LOOKUPS);
+	synth_usage();
+
+	return code;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int sections;
+	double secs;
+	size_t len;
+	char *buf;
+	cfg_t *cfg;
+	int c;
+
+	synth_init(&s);
+	while ((c = getopt(argc, argv, "hr:n:" SYNTH_OPTS)) != EOF) {
+		switch (c) {
+		case 'h':
+			return usage(0);
+		case 'r':
+			repeat = atoi(optarg);
+			break;
+		case 'n':
+			lookups = atol(optarg);
+			break;
+		default:
+			if (synth_option(&s, c, optarg))
+				return usage(1);
+			break;
+		}
+	}
+	if (!repeat || !lookups)
+		return usage(1);
+
+	opts = synth_schema(&s);
+	buf = synth_buf(&s, &len, &sections);
+	if (!buf || !sections)
+		return usage(1);
+
+	/* Sections with the same title are merged */
+	cfg = parse_buf(buf, &secs);
+	s.sections = sections;
+	sections = cfg_size(cfg, "node");
+
+	report_begin("suite", "\"sections\": %u, \"titles\": %u, \"depth\": %u, \"list\": %u, "
+		     "\"comments\": %u, \"includes\": %u, \"bytes\": %lu, \"repeat\": %u, \"lookups\": %lu",
+		     s.sections, sections, s.depth, s.list, s.comments, s.includes,
+		     (unsigned long)len, repeat, lookups);
+
+	bench_parse_buf(buf, len);
+	bench_parse_file();
+	bench_parse_defaults(sections);
+	bench_lookup(cfg, sections);
+	bench_print(cfg);
+	bench_dup(cfg, sections);
+	bench_free(buf, sections);
+	report_end();
+
+	cfg_free(cfg);
+	free(buf);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,302 @@
+/*
+ * Synthetic configurations for the benchmarks: titled node sections
+ * with a few options of each type, a list and a chain of nested child
+ * sections, optionally with comments and spread over included files.
+ * The output only depends on the parameters, so runs can be compared.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "synth.h"
+
+struct sbuf {
+	char   *buf;
+	size_t  len;
+	size_t  size;
+};
+
+void synth_init(struct synth *s)
+{
+	memset(s, 0, sizeof(*s));
+	s->sections = 1000;
+	s->depth    = 2;
+	s->list     = 4;
+	s->comments = 10;
+}
+
+static int number(const char *arg, size_t *val)
+{
+	char *end;
+
+	*val = strtoul(arg, &end, 0);
+	switch (*end) {
+	case 'k':
+		*val <<= 10;
+		end++;
+		break;
+	case 'M':
+		*val <<= 20;
+		end++;
+		break;
+	}
+
+	return end == arg || *end ? -1 : 0;
+}
+
+int synth_option(struct synth *s, int opt, const char *arg)
+{
+	size_t val;
+
+	if (!arg || number(arg, &val))
+		return -1;
+
+	switch (opt) {
+	case 's':
+		s->sections = val;
+		break;
+	case 't':
+		s->titles = val;
+		break;
+	case 'd':
+		if (val > SYNTH_MAX_DEPTH)
+			return -1;
+		s->depth = val;
+		break;
+	case 'l':
+		s->list = val;
+		break;
+	case 'c':
+		if (val > 100)
+			return -1;
+		s->comments = val;
+		break;
+	case 'i':
+		s->includes = val;
+		break;
+	case 'b':
+		s->size = val;
+		break;
+	default:
+		return -1;
+	}
+
+	return 0;
+}
+
+void synth_usage(void)
+{
+	fprintf(stderr,
+		"  -s NUM   Sections, default 1000\n"
+		"  -t NUM   Distinct titles, sections with the same title are merged\n"
+		"  -d NUM   Nested sections in each section, at most %d, default 2\n"
+		"  -l NUM   Values in each list, default 4\n"
+		"  -c PCT   Percentage of options with a comment, default 10\n"
+		"  -i NUM   Spread the sections over NUM included files\n"
+		"  -b SIZE  Add sections up to SIZE bytes instead, k and M suffixes\n",
+		SYNTH_MAX_DEPTH);
+}
+
+cfg_opt_t *synth_schema(const struct synth *s)
+{
+	static cfg_opt_t levels[SYNTH_MAX_DEPTH + 1][7];
+	static cfg_opt_t opts[] = {
+		CFG_STR("name", "synth", CFGF_NONE),
+		CFG_INT("port", 8080, CFGF_NONE),
+		CFG_INT_LIST("ports", "{80, 443}", CFGF_NONE),
+		CFG_SEC("node", NULL, CFGF_MULTI | CFGF_TITLE),
+		CFG_FUNC("include", cfg_include),
+		CFG_END()
+	};
+	cfg_opt_t level[] = {
+		CFG_STR("host", "localhost", CFGF_NONE),
+		CFG_INT("port", 80, CFGF_NONE),
+		CFG_FLOAT("weight", 1.0, CFGF_NONE),
+		CFG_BOOL("enabled", cfg_true, CFGF_NONE),
+		CFG_STR_LIST("tags", "{web, eu}", CFGF_NONE),
+		CFG_SEC("child", NULL, CFGF_NONE),
+		CFG_END()
+	};
+	int i;
+
+	/* The innermost level has no child section */
+	for (i = s->depth; i >= 0; i--) {
+		memcpy(levels[i], level, sizeof(level));
+		if (i == (int)s->depth)
+			memset(&levels[i][5], 0, sizeof(level[5]));
+		else
+			levels[i][5].subopts = levels[i + 1];
+	}
+	opts[3].subopts = levels[0];
+
+	return opts;
+}
+
+void synth_title(const struct synth *s, unsigned int i, char *buf, size_t len)
+{
+	snprintf(buf, len, "t%u", s->titles ? i % s->titles : i);
+}
+
+static void append(struct sbuf *sb, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	for (;;) {
+		va_start(ap, fmt);
+		len = vsnprintf(sb->buf + sb->len, sb->size - sb->len, fmt, ap);
+		va_end(ap);
+		if (len < 0)
+			exit(1);
+		if (sb->len + len < sb->size)
+			break;
+
+		sb->size = sb->size * 2 + len + 4096;
+		sb->buf = realloc(sb->buf, sb->size);
+		if (!sb->buf)
+			exit(1);
+	}
+	sb->len += len;
+}
+
+/* Same sequence on every run */
+static unsigned int lcg(unsigned int *state)
+{
+	*state = *state * 1103515245 + 12345;
+	return (*state >> 16) & 0x7fff;
+}
+
+static void option(const struct synth *s, struct sbuf *sb, unsigned int *rnd,
+		   int indent, const char *fmt, ...)
+{
+	va_list ap;
+	char line[128];
+
+	if (lcg(rnd) % 100 < s->comments)
+		append(sb, "%*s# Synthetic comment, line %u\n", indent, "", *rnd & 0xfff);
+
+	va_start(ap, fmt);
+	vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+	append(sb, "%*s%s\n", indent, "", line);
+}
+
+static void section(const struct synth *s, struct sbuf *sb, unsigned int *rnd,
+		    unsigned int i, unsigned int level)
+{
+	int indent = 4 * (level + 1);
+	unsigned int j;
+
+	option(s, sb, rnd, indent, "host = \"host-%u.example.com\"", i);
+	option(s, sb, rnd, indent, "port = %u", 1024 + (i + level) % 60000);
+	option(s, sb, rnd, indent, "weight = %u.%u", i % 10, level);
+	option(s, sb, rnd, indent, "enabled = %s", i % 3 ? "true" : "false");
+
+	if (lcg(rnd) % 100 < s->comments)
+		append(sb, "%*s// Tags for section %u\n", indent, "", i);
+	append(sb, "%*stags = {", indent, "");
+	for (j = 0; j < s->list; j++)
+		append(sb, "%s\"tag%u\"", j ? ", " : "", (i + j) % 100);
+	append(sb, "}\n");
+
+	if (level < s->depth) {
+		append(sb, "%*schild {\n", indent, "");
+		section(s, sb, rnd, i, level + 1);
+		append(sb, "%*s}\n", indent, "");
+	}
+}
+
+/*
+ * The root options go to out[0], the sections round-robin to the
+ * others, or to out[0] as well when there is only one.
+ */
+static unsigned int generate(const struct synth *s, struct sbuf *out, unsigned int num)
+{
+	unsigned int rnd = 1, i, j;
+	struct sbuf *sb;
+	size_t total, len;
+	char title[32];
+
+	append(&out[0], "/* Generated by the libConfuse benchmarks */\n");
+	append(&out[0], "name = \"synth\"\nport = 8080\nports = {");
+	for (j = 0; j < s->list; j++)
+		append(&out[0], "%s%u", j ? ", " : "", 8000 + j);
+	append(&out[0], "}\n");
+
+	total = out[0].len;
+	for (i = 0; s->size ? total < s->size : i < s->sections; i++) {
+		sb = &out[num > 1 ? 1 + i % (num - 1) : 0];
+		len = sb->len;
+
+		synth_title(s, i, title, sizeof(title));
+		append(sb, "\nnode %s {\n", title);
+		section(s, sb, &rnd, i, 0);
+		append(sb, "}\n");
+
+		total += sb->len - len;
+	}
+
+	return i;
+}
+
+char *synth_buf(const struct synth *s, size_t *len, unsigned int *sections)
+{
+	struct sbuf sb = { NULL, 0, 0 };
+	unsigned int num;
+
+	num = generate(s, &sb, 1);
+	if (len)
+		*len = sb.len;
+	if (sections)
+		*sections = num;
+
+	return sb.buf;
+}
+
+size_t synth_files(const struct synth *s, const char *dir)
+{
+	unsigned int num = s->includes + 1, i;
+	struct sbuf *out;
+	char path[1024];
+	size_t total = 0;
+	int err = 0;
+	FILE *fp;
+
+	out = calloc(num, sizeof(struct sbuf));
+	if (!out)
+		return 0;
+
+	generate(s, out, num);
+	for (i = 1; i < num; i++)
+		append(&out[0], "include(\"%s/inc%u.conf\")\n", dir, i);
+
+	for (i = 0; i < num; i++) {
+		if (i)
+			snprintf(path, sizeof(path), "%s/inc%u.conf", dir, i);
+		else
+			snprintf(path, sizeof(path), "%s/main.conf", dir);
+
+		fp = fopen(path, "w");
+		if (!fp)
+			err = 1;
+		else {
+			if (out[i].len && fwrite(out[i].buf, out[i].len, 1, fp) != 1)
+				err = 1;
+			if (fclose(fp))
+				err = 1;
+		}
+
+		total += out[i].len;
+		free(out[i].buf);
+	}
+	free(out);
+
+	return err ? 0 : total;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
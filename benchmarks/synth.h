@@ -0,0 +1,55 @@
+/*
+ * Synthetic configurations for the benchmarks, see synth.c
+ */
+#ifndef SYNTH_H_
+#define SYNTH_H_
+
+#include <stddef.h>
+#include "confuse.h"
+
+#define SYNTH_MAX_DEPTH 16
+
+/* Options shared by the programs using the generator, for getopt() */
+#define SYNTH_OPTS "s:t:d:l:c:i:b:"
+
+struct synth {
+	unsigned int sections;	/* Titled sections at the top level */
+	unsigned int titles;	/* Distinct titles, 0 for one per section */
+	unsigned int depth;	/* Nested sections in each, at most SYNTH_MAX_DEPTH */
+	unsigned int list;	/* Values in each list */
+	unsigned int comments;	/* Percentage of options with a comment */
+	unsigned int includes;	/* Files the sections are spread over */
+	size_t       size;	/* Add sections up to this many bytes instead */
+};
+
+/* Defaults, then one of the SYNTH_OPTS, returns -1 if not valid */
+void synth_init(struct synth *s);
+int  synth_option(struct synth *s, int opt, const char *arg);
+void synth_usage(void);
+
+/* The schema of the generated configurations, for s->depth */
+cfg_opt_t *synth_schema(const struct synth *s);
+
+/* Title of section number i */
+void synth_title(const struct synth *s, unsigned int i, char *buf, size_t len);
+
+/*
+ * The whole configuration in one buffer, without includes, and the
+ * number of sections in it.  Free the buffer with free().
+ */
+char *synth_buf(const struct synth *s, size_t *len, unsigned int *sections);
+
+/*
+ * The same written to dir, as main.conf and s->includes files it
+ * includes.  Returns the total size, or 0 on error.
+ */
+size_t synth_files(const struct synth *s, const char *dir);
+
+#endif /* SYNTH_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,97 @@
+/*
+ * Concurrent reads of a frozen configuration: every thread looks up
+ * options by path in the same tree, without any locking.  Throughput
+ * should scale with the number of cores, since lookups that hit write
+ * nothing, not even errno, and allocate nothing.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "confuse.h"
+#include "bench.h"
+
+#define NUM_SECTIONS 100
+#define NUM_LOOKUPS  1000000
+
+static cfg_t *cfg;
+static char paths[NUM_SECTIONS][32];
+
+static void *reader(void *arg)
+{
+	unsigned int i, seed = (unsigned int)(size_t)arg;
+	long int sum = 0;
+
+	for (i = 0; i < NUM_LOOKUPS; i++) {
+		seed = seed * 1103515245 + 12345;
+		sum += cfg_getint(cfg, paths[(seed >> 8) % NUM_SECTIONS]);
+	}
+
+	return (void *)sum;
+}
+
+int main(void)
+{
+	cfg_opt_t backend_opts[] = {
+		CFG_STR("host", NULL, CFGF_NONE),
+		CFG_INT("port", 80, CFGF_NONE),
+		CFG_END()
+	};
+	cfg_opt_t opts[] = {
+		CFG_SEC("backend", backend_opts, CFGF_MULTI | CFGF_TITLE),
+		CFG_END()
+	};
+	pthread_t *threads;
+	double start, secs;
+	char what[32];
+	long int ncpu;
+	int i, n;
+
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpu < 1)
+		ncpu = 1;
+	threads = calloc(ncpu, sizeof(pthread_t));
+	cfg = cfg_init(opts, CFGF_NONE);
+	if (!threads || !cfg)
+		return 1;
+
+	for (i = 0; i < NUM_SECTIONS; i++) {
+		char title[16];
+
+		snprintf(title, sizeof(title), "b%d", i);
+		if (cfg_setint(cfg_addtsec(cfg, "backend", title), "port", 1024 + i))
+			return 1;
+		snprintf(paths[i], sizeof(paths[i]), "backend=%s|port", title);
+	}
+	cfg_freeze(cfg);
+
+	report_begin("threads", "\"sections\": %d, \"lookups\": %d, \"cpus\": %ld",
+		     NUM_SECTIONS, NUM_LOOKUPS, ncpu);
+	for (n = 1; n <= ncpu; n = n * 2 > ncpu && n < ncpu ? ncpu : n * 2) {
+		start = now();
+		for (i = 0; i < n; i++) {
+			if (pthread_create(&threads[i], NULL, reader, (void *)(size_t)(i + 1)))
+				return 1;
+		}
+		for (i = 0; i < n; i++)
+			pthread_join(threads[i], NULL);
+		secs = now() - start;
+
+		snprintf(what, sizeof(what), "getint_%d_threads", n);
+		report(what, secs, "mlookups_per_sec", n * (NUM_LOOKUPS / secs) / 1e6);
+	}
+	report_end();
+
+	cfg_free(cfg);
+	free(threads);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,93 @@
+/* Like reread.c, but reloads as soon as reread.conf is saved, no SIGHUP */
+#include <err.h>
+#include <poll.h>
+#include <stdio.h>
+#include <locale.h>
+#include "confuse.h"
+
+static cfg_t *read_config(const char *filename)
+{
+	static cfg_opt_t arg_opts[] = {
+		CFG_STR("value", "default", CFGF_NONE),
+		CFG_END()
+	};
+	static cfg_opt_t opts[] = {
+		CFG_INT("delay", 3, CFGF_NONE),
+		CFG_STR("message", "This is a message", CFGF_NONE),
+		CFG_SEC("argument", arg_opts, CFGF_MULTI | CFGF_TITLE),
+		CFG_FUNC("include", cfg_include),
+		CFG_END()
+	};
+	cfg_t *cfg;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	if (cfg_parse(cfg, filename) != CFG_SUCCESS) {
+		cfg_free(cfg);
+		return NULL;
+	}
+
+	return cfg;
+}
+
+static void print_config(cfg_t *cfg)
+{
+	unsigned int i;
+
+	printf("Message: %s", cfg_getstr(cfg, "message"));
+	for (i = 0; i < cfg_size(cfg, "argument"); i++)
+		printf(", %s", cfg_getstr(cfg_getnsec(cfg, "argument", i), "value"));
+	printf("\n");
+}
+
+static void reload(cfg_t *old, void *arg)
+{
+	cfg_t **cfg = arg;
+	cfg_t *new;
+
+	new = read_config("./reread.conf");
+	if (!new) {
+		warnx("Failed parsing configuration, keeping the old one");
+		return;
+	}
+
+	cfg_free(old);
+	*cfg = new;
+	print_config(new);
+}
+
+int main(void)
+{
+	struct pollfd pfd = { -1, POLLIN, 0 };
+	cfg_t *cfg;
+
+#ifdef LC_MESSAGES
+	setlocale(LC_MESSAGES, "");
+	setlocale(LC_CTYPE, "");
+#endif
+
+	cfg = read_config("./reread.conf");
+	if (!cfg)
+		errx(1, "Failed parsing configuration!\n");
+	print_config(cfg);
+
+	while (1) {
+		/* Without a descriptor, poll the file every other second */
+		pfd.fd = cfg_watch_fd(cfg);
+		if (poll(&pfd, 1, pfd.fd < 0 ? 2000 : -1) < 0)
+			break;
+
+		if (cfg_watch_dispatch(cfg, 100, reload, &cfg) < 0)
+			break;
+	}
+
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
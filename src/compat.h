@@ -51,4 +51,22 @@ c99_snprintf(char *buf, size_t size, const char *fmt, ...)
 }
 #endif
 
+/* Sequentially consistent atomic operations on long and void * */
+#if defined _MSC_VER
+#include <windows.h>
+#define cfg_atomic_inc(p)		InterlockedIncrement(p)
+#define cfg_atomic_dec(p)		InterlockedDecrement(p)
+#define cfg_atomic_load(p)		InterlockedCompareExchange(p, 0, 0)
+#define cfg_atomic_xchg(p, v)		InterlockedExchange(p, v)
+#define cfg_atomic_loadptr(p)		InterlockedCompareExchangePointer((PVOID volatile *)(p), NULL, NULL)
+#define cfg_atomic_xchgptr(p, v)	InterlockedExchangePointer((PVOID volatile *)(p), v)
+#else
+#define cfg_atomic_inc(p)		__atomic_add_fetch(p, 1, __ATOMIC_SEQ_CST)
+#define cfg_atomic_dec(p)		__atomic_sub_fetch(p, 1, __ATOMIC_SEQ_CST)
+#define cfg_atomic_load(p)		__atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define cfg_atomic_xchg(p, v)		__atomic_exchange_n(p, v, __ATOMIC_SEQ_CST)
+#define cfg_atomic_loadptr(p)		__atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define cfg_atomic_xchgptr(p, v)	__atomic_exchange_n(p, v, __ATOMIC_SEQ_CST)
+#endif
+
 #endif
@@ -33,8 +33,13 @@
 # include <unistd.h>
 #endif
 #include <ctype.h>
+#include <float.h>
 #include <limits.h>
+#include <locale.h>
 #include <inttypes.h>
+#ifdef HAVE_CLOCK_GETTIME
+# include <time.h>
+#endif
 
 #ifdef HAVE_SYS_STAT_H
 # include <sys/stat.h>
@@ -43,6 +48,19 @@
 # endif
 #endif
 
+#ifdef HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+#endif
+#ifdef HAVE_SYS_TIMERFD_H
+# include <sys/timerfd.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#endif
+
 #include "compat.h"
 #include "confuse.h"
 
@@ -62,6 +80,10 @@ const char confuse_copyright[] = PACKAGE_STRING " by Martin Hedenfalk <martin@bz
 const char confuse_author[] = "Martin Hedenfalk <martin@bzero.se>";
 
 char *cfg_yylval = NULL;
+size_t cfg_yylen = 0;
+
+/* Length of the current token, double-quoted strings may contain NUL */
+#define cfg_yylval_len() (cfg_yylen ? cfg_yylen : strlen(cfg_yylval))
 
 extern int  cfg_yylex(cfg_t *cfg);
 extern void cfg_yylex_destroy(void);
@@ -75,9 +97,15 @@ extern size_t cfg_raw_tell(void);
 extern void cfg_raw_seek(size_t pos);
 
 static int cfg_parse_internal(cfg_t *cfg, int level, int force_state, cfg_opt_t *force_opt);
+static cfg_opt_t *cfg_probeopt_secidx(cfg_t *cfg, const char *name, unsigned int *index, int rw);
+static cfg_t *cfg_opt_ownsec(cfg_opt_t *opt, unsigned int index);
 static void cfg_free_opt_array(cfg_opt_t *opts);
-static int cfg_print_pff_indent(cfg_t *cfg, FILE *fp,
-				cfg_print_filter_func_t fb_pff, int indent);
+typedef struct cfg_printer cfg_printer_t;
+static int cfg_fingerprint_sec(cfg_t *sec, cfg_fingerprint_t *fp);
+static void cfg_watch_add(cfg_t *cfg, const char *filename);
+static void cfg_watch_free(cfg_t *cfg);
+static int cfg_pr_sec(cfg_printer_t *pr, cfg_t *cfg,
+		      cfg_print_filter_func_t fb_pff, int indent);
 
 #define STATE_CONTINUE 0
 #define STATE_EOF -1
@@ -183,3384 +211,9831 @@ int strcasecmp(const char *s1, const char *s2)
 }
 #endif
 
-static cfg_opt_t *cfg_getopt_leaf(cfg_t *cfg, const char *name)
+/* Compare an option name with a name that need not be NUL terminated */
+static int cfg_namecmp(cfg_t *cfg, const char *optname, const char *name, size_t len)
 {
-	unsigned int i;
-
-	for (i = 0; cfg->opts && cfg->opts[i].name; i++) {
-		if (is_set(CFGF_NOCASE, cfg->flags)) {
-			if (strcasecmp(cfg->opts[i].name, name) == 0)
-				return &cfg->opts[i];
-		} else {
-			if (strcmp(cfg->opts[i].name, name) == 0)
-				return &cfg->opts[i];
-		}
+	if (is_set(CFGF_NOCASE, cfg->flags)) {
+		if (strncasecmp(optname, name, len))
+			return 1;
+	} else {
+		if (strncmp(optname, name, len))
+			return 1;
 	}
 
-	return NULL;
+	return optname[len] != 0;
 }
 
-static char *parse_title(const char *name, size_t *len)
+DLLIMPORT uint32_t cfg_hash(const char *name, size_t len)
 {
-	const char *escapes = "'\\";
-	char *title;
-	char *end;
-	char *ch;
-
-	if (*name != '\'') {
-		*len = strcspn(name, "|");
-		if (!*len)
-			return NULL;
-		return strndup(name, *len);
-	}
+	uint32_t hash = 2166136261u;
 
-	title = strdup(name + 1);
-	if (!title)
-		return NULL;
+	/* FNV-1a, ASCII case folded to match CFGF_NOCASE */
+	while (len--) {
+		unsigned char c = *name++;
 
-	*len = 1;
-	ch = title;
-	end = title + strlen(title);
-	while (ch < end) {
-		size_t l = strcspn(ch, escapes);
-		*len += l + 1;
-		ch += l;
-		switch (*ch) {
-		case '\'':
-			*ch = 0;
-			return title;
-		case '\\':
-			if (!ch[1] || strcspn(ch + 1, escapes)) {
-				free(title);
-				return NULL;
-			}
-			memmove(ch, ch + 1, strlen(ch));
-			ch++;
-			(*len)++;
-			break;
-		default:
-			free(title);
-			return NULL;
-		}
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		else if (c >= 0x80)
+			c = 0x80;
+		hash = (hash ^ c) * 16777619u;
 	}
 
-	free(title);
-	return NULL;
+	return hash;
 }
 
-static long int cfg_opt_gettsecidx(cfg_opt_t *opt, const char *title)
-{
-	unsigned int i, n;
-
-	n = cfg_opt_size(opt);
-	for (i = 0; i < n; i++) {
-		cfg_t *sec = cfg_opt_getnsec(opt, i);
+/*
+ * Memory is counted where it is allocated and freed, see
+ * cfg_memory_stats().  Sections point to the counters of all sections
+ * with their name, which point to those of the tree.  The counters are
+ * created with the root section and freed with it.
+ */
+struct cfg_memory {
+	cfg_t              *root;
+	cfg_memory_stats_t  stats;
+	struct cfg_memtype *types;
+};
 
-		if (!sec || !sec->title)
-			return -1;
+struct cfg_memtype {
+	struct cfg_memtype *next;
+	struct cfg_memory  *tree;
+	cfg_memory_stats_t  stats;
+	char                name[];
+};
 
-		if (is_set(CFGF_NOCASE, opt->flags)) {
-			if (strcasecmp(title, sec->title) == 0)
-				return i;
-		} else {
-			if (strcmp(title, sec->title) == 0)
-				return i;
-		}
+static void cfg_mem_add(cfg_memory_stats_t *stats, cfg_memory_category_t cat, int sign, size_t bytes)
+{
+	if (sign > 0) {
+		stats->category[cat].bytes += bytes;
+		stats->category[cat].allocs++;
+		stats->total.bytes += bytes;
+		stats->total.allocs++;
+	} else {
+		stats->category[cat].bytes -= bytes;
+		stats->category[cat].allocs--;
+		stats->total.bytes -= bytes;
+		stats->total.allocs--;
 	}
-
-	return -1;
 }
 
-static cfg_opt_t *cfg_getopt_secidx(cfg_t *cfg, const char *name,
-				    unsigned int *index)
+/* Count one allocation of sec, sign is 1 when allocated, -1 when freed */
+static void cfg_mem_count(cfg_t *sec, cfg_memory_category_t cat, int sign, size_t bytes)
 {
-	cfg_opt_t *opt = NULL;
-	cfg_t *sec = cfg;
-
-	if (!cfg || !cfg->name || !name || !*name) {
-		errno = EINVAL;
-		return NULL;
-	}
-
-	while (name && *name) {
-		char *title = NULL;
-		long int i = -1;
-		char *secname;
-		size_t len;
-
-		len = strcspn(name, "|=");
-		if (!index && name[len] == 0 /*len == strlen(name) */ )
-			/* no more subsections */
-			break;
-
-		if (!len)
-			break;
-
-		secname = strndup(name, len);
-		if (!secname)
-			return NULL;
+	struct cfg_memtype *type = sec ? sec->memtype : NULL;
 
-		do {
-			char *endptr;
-
-			opt = cfg_getopt_leaf(sec, secname);
-			if (!opt || (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC)) {
-				opt = NULL;
-				break;
-			}
-			if (name[len] != '=') {
-				/* non-multi, and backwards compat */
-				i = 0;
-				break;
-			}
-			if (!is_set(CFGF_MULTI, opt->flags))
-				break;
-			name += len + 1;
-			title = parse_title(name, &len);
-			if (!title)
-				break;
-			if (is_set(CFGF_TITLE, opt->flags)) {
-				i = cfg_opt_gettsecidx(opt, title);
-				break;
-			}
+	if (!type)
+		return;
 
-			errno = 0;
-			i = strtoul(title, &endptr, 0);
-			if (*endptr != '\0' || errno || i > UINT_MAX)
-				i = -1;
-		} while(0);
+	cfg_mem_add(&type->stats, cat, sign, bytes);
+	cfg_mem_add(&type->tree->stats, cat, sign, bytes);
+}
 
-		if (index)
-			*index = i >= 0 ? i : UINT_MAX;
+static void cfg_mem_str(cfg_t *sec, cfg_memory_category_t cat, int sign, const char *str)
+{
+	if (str)
+		cfg_mem_count(sec, cat, sign, strlen(str) + 1);
+}
 
-		sec = i >= 0 ? cfg_opt_getnsec(opt, i) : NULL;
-		if (!sec && !is_set(CFGF_IGNORE_UNKNOWN, cfg->flags)) {
-			if (opt && !is_set(CFGF_MULTI, opt->flags))
-				cfg_error(cfg, _("no such option '%s'"), secname);
-			else if (title)
-				cfg_error(cfg, _("no sub-section '%s' in '%s'"), title, secname);
-			else
-				cfg_error(cfg, _("no sub-section title/index for '%s'"), secname);
-		}
+/* Counters for sections named name in the tree of parent */
+static struct cfg_memtype *cfg_memtype_get(cfg_t *parent, const char *name)
+{
+	struct cfg_memory *tree;
+	struct cfg_memtype *type;
 
-		free(secname);
-		if (title)
-			free(title);
-		if (!sec)
-			return NULL;
+	if (!parent->memtype)
+		return NULL;
 
-		name += len;
-		name += strspn(name, "|");
+	tree = parent->memtype->tree;
+	for (type = tree->types; type; type = type->next) {
+		if (!strcmp(type->name, name))
+			return type;
 	}
 
-	if (!index) {
-		opt = cfg_getopt_leaf(sec, name);
+	/* On failure the sections go uncounted, alloc and free alike */
+	type = calloc(1, sizeof(*type) + strlen(name) + 1);
+	if (!type)
+		return NULL;
 
-		if (!opt && !is_set(CFGF_IGNORE_UNKNOWN, cfg->flags) && !is_set(CFGF_KEYSTRVAL, sec->flags))
-			cfg_error(cfg, _("no such option '%s'"), name);
-	}
+	strcpy(type->name, name);
+	type->tree = tree;
+	type->next = tree->types;
+	tree->types = type;
 
-	return opt;
+	return type;
 }
 
-DLLIMPORT cfg_opt_t *cfg_getnopt(cfg_t *cfg, unsigned int index)
+static struct cfg_memtype *cfg_memory_new(cfg_t *root)
 {
-	unsigned int i;
+	struct cfg_memory *tree;
+	struct cfg_memtype *type;
 
-	if (!cfg)
+	tree = calloc(1, sizeof(*tree));
+	if (!tree)
 		return NULL;
 
-	for (i = 0; cfg->opts && cfg->opts[i].name; i++) {
-		if (i == index)
-			return &cfg->opts[i];
+	type = calloc(1, sizeof(*type) + strlen(root->name) + 1);
+	if (!type) {
+		free(tree);
+		return NULL;
 	}
 
-	return NULL;
+	strcpy(type->name, root->name);
+	type->tree = tree;
+	tree->types = type;
+	tree->root = root;
+
+	return type;
 }
 
-DLLIMPORT cfg_opt_t *cfg_getopt(cfg_t *cfg, const char *name)
+static void cfg_memory_free(struct cfg_memory *tree)
 {
-	return cfg_getopt_secidx(cfg, name, NULL);
+	struct cfg_memtype *type, *next;
+
+	for (type = tree->types; type; type = next) {
+		next = type->next;
+		free(type);
+	}
+	free(tree);
 }
 
-DLLIMPORT const char *cfg_title(cfg_t *cfg)
+/* The copies of cfg_dupopt_array(), and the comments set on them */
+static void cfg_mem_opts(cfg_t *sec, cfg_opt_t *opts, int sign)
 {
-	if (cfg)
-		return cfg->title;
-	return NULL;
+	int i, n = cfg_numopts(opts);
+
+	cfg_mem_count(sec, CFG_MEMORY_OPTIONS, sign, (n + 1) * sizeof(cfg_opt_t));
+	for (i = 0; i < n; i++) {
+		cfg_mem_str(sec, CFG_MEMORY_OPTIONS, sign, opts[i].name);
+		cfg_mem_str(sec, CFG_MEMORY_OPTIONS, sign, opts[i].def.parsed);
+		cfg_mem_str(sec, CFG_MEMORY_OPTIONS, sign, opts[i].def.string);
+		cfg_mem_str(sec, CFG_MEMORY_COMMENTS, sign, opts[i].comment);
+		if (opts[i].subopts)
+			cfg_mem_opts(sec, opts[i].subopts, sign);
+	}
 }
 
-DLLIMPORT const char *cfg_getraw(cfg_t *cfg)
+/* A section with its name and options, but not their values */
+static void cfg_mem_section(cfg_t *sec, int sign)
 {
-	if (cfg)
-		return cfg->raw;
-	return NULL;
+	cfg_mem_count(sec, CFG_MEMORY_SECTIONS, sign, sizeof(cfg_t));
+	cfg_mem_str(sec, CFG_MEMORY_SECTIONS, sign, sec->name);
+	cfg_mem_str(sec, CFG_MEMORY_SECTIONS, sign, sec->filename);
+	cfg_mem_opts(sec, sec->opts, sign);
 }
 
-DLLIMPORT const char *cfg_name(cfg_t *cfg)
+/* Replace the file name of sec, which is counted as it changes */
+static void cfg_set_filename(cfg_t *sec, char *filename)
 {
-	if (cfg)
-		return cfg->name;
-	return NULL;
+	cfg_mem_str(sec, CFG_MEMORY_SECTIONS, -1, sec->filename);
+	free(sec->filename);
+	sec->filename = filename;
+	cfg_mem_str(sec, CFG_MEMORY_SECTIONS, 1, filename);
 }
 
-DLLIMPORT const char *cfg_opt_name(cfg_opt_t *opt)
+/* Called by the lexer around include() changing cfg->filename */
+void cfg_memory_filename(cfg_t *cfg, int sign)
 {
-	if (opt)
-		return opt->name;
-	return NULL;
+	cfg_mem_str(cfg, CFG_MEMORY_SECTIONS, sign, cfg->filename);
 }
 
-DLLIMPORT const char *cfg_opt_getstr(cfg_opt_t *opt)
+/*
+ * Values of CFGT_STR options are allocated with the length of their
+ * string, which may contain NUL bytes from escapes like "\x00".  The
+ * value of a CFG_SIMPLE_STR option is the user's variable, without.
+ */
+struct cfg_strval {
+	cfg_value_t val;
+	size_t      len;
+};
+
+/*
+ * Values of CFGT_PTR options note when the pointer is borrowed from
+ * the tree a copy was made from, which frees it, see cfg_opt_unshare()
+ */
+struct cfg_ptrval {
+	cfg_value_t val;
+	int         borrowed;
+};
+
+static size_t cfg_value_size(cfg_opt_t *opt)
 {
-	return cfg_opt_getnstr(opt, 0);
+	if (opt->type == CFGT_STR)
+		return sizeof(struct cfg_strval);
+	if (opt->type == CFGT_PTR)
+		return sizeof(struct cfg_ptrval);
+
+	return sizeof(cfg_value_t);
 }
 
-DLLIMPORT unsigned int cfg_opt_size(cfg_opt_t *opt)
+/* Copy of len bytes of str, NUL terminated, which may contain NUL bytes */
+static char *cfg_strdup_len(const char *str, size_t len)
 {
-	if (opt)
-		return opt->nvalues;
-	return 0;
+	char *dup;
+
+	if (len == SIZE_MAX)
+		return NULL;
+
+	dup = malloc(len + 1);
+	if (!dup)
+		return NULL;
+
+	memcpy(dup, str, len);
+	dup[len] = 0;
+
+	return dup;
 }
 
-DLLIMPORT unsigned int cfg_size(cfg_t *cfg, const char *name)
+/*
+ * With CFGF_INTERN, equal values and section titles in a tree share one
+ * allocation, from a table kept in the root section.  The entry is in
+ * front of the string, so releasing a string needs no lookup.
+ */
+#define CFG_INTERN_MIN 64
+
+struct cfg_istr {
+	struct cfg_istr *next;	/* Hash chain */
+	uint32_t         hash;
+	size_t           len;
+	size_t           refs;
+	char             str[];
+};
+
+struct cfg_intern {
+	cfg_t            *root;	/* Memory is counted there */
+	struct cfg_istr **bucket;
+	size_t            mask;	/* Number of buckets - 1, a power of two */
+	size_t            count;	/* Distinct strings */
+	size_t            refs;	/* Values and titles using them */
+	size_t            bytes;	/* Size of the distinct strings */
+	size_t            saved;	/* Size of the copies not made */
+};
+
+#define cfg_istr(str) ((struct cfg_istr *)((str) - offsetof(struct cfg_istr, str)))
+
+/* Case sensitive, unlike cfg_hash(), and over all len bytes */
+static uint32_t cfg_intern_hash(const char *str, size_t len)
 {
-	return cfg_opt_size(cfg_getopt(cfg, name));
+	uint32_t hash = 2166136261u;
+
+	while (len--)
+		hash = (hash ^ (unsigned char)*str++) * 16777619u;
+
+	return hash;
 }
 
-DLLIMPORT char *cfg_opt_getcomment(cfg_opt_t *opt)
+static struct cfg_intern *cfg_intern_new(cfg_t *root)
 {
-	if (opt)
-		return opt->comment;
+	struct cfg_intern *in;
 
-	return NULL;
+	in = calloc(1, sizeof(*in));
+	if (!in)
+		return NULL;
+
+	in->bucket = calloc(CFG_INTERN_MIN, sizeof(in->bucket[0]));
+	if (!in->bucket) {
+		free(in);
+		return NULL;
+	}
+	in->mask = CFG_INTERN_MIN - 1;
+	in->root = root;
+	cfg_mem_count(root, CFG_MEMORY_STRINGS, 1, sizeof(*in));
+	cfg_mem_count(root, CFG_MEMORY_STRINGS, 1, CFG_INTERN_MIN * sizeof(in->bucket[0]));
+
+	return in;
 }
 
-DLLIMPORT char *cfg_getcomment(cfg_t *cfg, const char *name)
+static void cfg_intern_free(struct cfg_intern *in)
 {
-	return cfg_opt_getcomment(cfg_getopt(cfg, name));
+	struct cfg_istr *is, *next;
+	size_t i;
+
+	if (!in)
+		return;
+
+	/* Normally empty by now, all values and titles released */
+	for (i = 0; i <= in->mask; i++) {
+		for (is = in->bucket[i]; is; is = next) {
+			next = is->next;
+			cfg_mem_count(in->root, CFG_MEMORY_STRINGS, -1, sizeof(*is) + is->len + 1);
+			free(is);
+		}
+	}
+	cfg_mem_count(in->root, CFG_MEMORY_STRINGS, -1, (in->mask + 1) * sizeof(in->bucket[0]));
+	cfg_mem_count(in->root, CFG_MEMORY_STRINGS, -1, sizeof(*in));
+	free(in->bucket);
+	free(in);
 }
 
-DLLIMPORT signed long cfg_opt_getnint(cfg_opt_t *opt, unsigned int index)
+/* Doubles the number of buckets, on failure the chains just get longer */
+static void cfg_intern_grow(struct cfg_intern *in)
 {
-	if (!opt || opt->type != CFGT_INT) {
-		errno = EINVAL;
-		return 0;
-	}
+	struct cfg_istr **bucket, *is, *next;
+	size_t mask = in->mask * 2 + 1;
+	size_t i;
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->number;
-	if (opt->simple_value.number)
-		return *opt->simple_value.number;
+	bucket = calloc(mask + 1, sizeof(bucket[0]));
+	if (!bucket)
+		return;
 
-	return 0;
+	for (i = 0; i <= in->mask; i++) {
+		for (is = in->bucket[i]; is; is = next) {
+			next = is->next;
+			is->next = bucket[is->hash & mask];
+			bucket[is->hash & mask] = is;
+		}
+	}
+	cfg_mem_count(in->root, CFG_MEMORY_STRINGS, -1, (in->mask + 1) * sizeof(bucket[0]));
+	cfg_mem_count(in->root, CFG_MEMORY_STRINGS, 1, (mask + 1) * sizeof(bucket[0]));
+	free(in->bucket);
+	in->bucket = bucket;
+	in->mask = mask;
 }
 
-DLLIMPORT signed long cfg_getnint(cfg_t *cfg, const char *name, unsigned int index)
+/* Shared copy of len bytes of str, NUL terminated */
+static char *cfg_intern_get(struct cfg_intern *in, const char *str, size_t len)
 {
-	return cfg_opt_getnint(cfg_getopt(cfg, name), index);
-}
-
-DLLIMPORT signed long cfg_getint(cfg_t *cfg, const char *name)
-{
-	return cfg_getnint(cfg, name, 0);
-}
+	uint32_t hash = cfg_intern_hash(str, len);
+	struct cfg_istr *is;
 
-DLLIMPORT int64_t cfg_opt_getnint64(cfg_opt_t *opt, unsigned int index)
-{
-	if (!opt || opt->type != CFGT_INT64) {
-		errno = EINVAL;
-		return 0;
+	for (is = in->bucket[hash & in->mask]; is; is = is->next) {
+		if (is->hash == hash && is->len == len && !memcmp(is->str, str, len)) {
+			is->refs++;
+			in->refs++;
+			in->saved += len + 1;
+			return is->str;
+		}
 	}
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->i64;
-	if (opt->simple_value.i64)
-		return *opt->simple_value.i64;
+	if (len > SIZE_MAX - sizeof(*is) - 1)
+		return NULL;
 
-	return 0;
-}
+	is = malloc(sizeof(*is) + len + 1);
+	if (!is)
+		return NULL;
 
-DLLIMPORT int64_t cfg_getnint64(cfg_t *cfg, const char *name, unsigned int index)
-{
-	return cfg_opt_getnint64(cfg_getopt(cfg, name), index);
-}
+	cfg_mem_count(in->root, CFG_MEMORY_STRINGS, 1, sizeof(*is) + len + 1);
+	is->hash = hash;
+	is->len = len;
+	is->refs = 1;
+	memcpy(is->str, str, len);
+	is->str[len] = 0;
 
-DLLIMPORT int64_t cfg_getint64(cfg_t *cfg, const char *name)
-{
-	return cfg_getnint64(cfg, name, 0);
+	is->next = in->bucket[hash & in->mask];
+	in->bucket[hash & in->mask] = is;
+	in->count++;
+	in->refs++;
+	in->bytes += len + 1;
+	if (in->count > in->mask)
+		cfg_intern_grow(in);
+
+	return is->str;
 }
 
-DLLIMPORT uint32_t cfg_opt_getnuint32(cfg_opt_t *opt, unsigned int index)
+static void cfg_intern_put(struct cfg_intern *in, char *str)
 {
-	if (!opt || opt->type != CFGT_UINT32) {
-		errno = EINVAL;
-		return 0;
-	}
+	struct cfg_istr *is = cfg_istr(str);
+	struct cfg_istr **pp;
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->u32;
-	if (opt->simple_value.u32)
-		return *opt->simple_value.u32;
+	in->refs--;
+	if (--is->refs) {
+		in->saved -= is->len + 1;
+		return;
+	}
 
-	return 0;
+	for (pp = &in->bucket[is->hash & in->mask]; *pp != is; pp = &(*pp)->next)
+		;
+	*pp = is->next;
+	in->count--;
+	in->bytes -= is->len + 1;
+	cfg_mem_count(in->root, CFG_MEMORY_STRINGS, -1, sizeof(*is) + is->len + 1);
+	free(is);
 }
 
-DLLIMPORT uint32_t cfg_getnuint32(cfg_t *cfg, const char *name, unsigned int index)
+/* The intern table of the tree sec is in, NULL without CFGF_INTERN */
+static struct cfg_intern *cfg_intern_of(cfg_t *sec)
 {
-	return cfg_opt_getnuint32(cfg_getopt(cfg, name), index);
-}
+	while (sec && sec->parent)
+		sec = sec->parent;
 
-DLLIMPORT uint32_t cfg_getuint32(cfg_t *cfg, const char *name)
-{
-	return cfg_getnuint32(cfg, name, 0);
+	return sec ? sec->intern : NULL;
 }
 
-DLLIMPORT uint64_t cfg_opt_getnuint64(cfg_opt_t *opt, unsigned int index)
+/*
+ * Copy of a value or title for the tree of sec, shared with CFGF_INTERN.
+ * Unless shared, it is counted in category cat of sec.
+ */
+static char *cfg_strdup_sec(cfg_t *sec, cfg_memory_category_t cat, const char *str, size_t len)
 {
-	if (!opt || opt->type != CFGT_UINT64) {
-		errno = EINVAL;
-		return 0;
-	}
+	struct cfg_intern *in = cfg_intern_of(sec);
+	char *dup;
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->u64;
-	if (opt->simple_value.u64)
-		return *opt->simple_value.u64;
+	if (in)
+		return cfg_intern_get(in, str, len);
 
-	return 0;
+	dup = cfg_strdup_len(str, len);
+	if (dup)
+		cfg_mem_count(sec, cat, 1, len + 1);
+
+	return dup;
 }
 
-DLLIMPORT uint64_t cfg_getnuint64(cfg_t *cfg, const char *name, unsigned int index)
+/* Free a string of length len from cfg_strdup_sec() */
+static void cfg_strfree_sec(cfg_t *sec, cfg_memory_category_t cat, char *str, size_t len)
 {
-	return cfg_opt_getnuint64(cfg_getopt(cfg, name), index);
+	struct cfg_intern *in;
+
+	if (!str)
+		return;
+
+	in = cfg_intern_of(sec);
+	if (in) {
+		cfg_intern_put(in, str);
+	} else {
+		cfg_mem_count(sec, cat, -1, len + 1);
+		free(str);
+	}
 }
 
-DLLIMPORT uint64_t cfg_getuint64(cfg_t *cfg, const char *name)
+/* Copy of str for a value, the values of CFG_SIMPLE_STR options are plain */
+static char *cfg_value_strdup(cfg_opt_t *opt, cfg_value_t *val, const char *str, size_t len)
 {
-	return cfg_getnuint64(cfg, name, 0);
+	if ((void *)val == (void *)opt->simple_value.ptr)
+		return cfg_strdup_len(str, len);
+
+	return cfg_strdup_sec(opt->sec, CFG_MEMORY_STRINGS, str, len);
 }
 
-DLLIMPORT int8_t cfg_opt_getnint8(cfg_opt_t *opt, unsigned int index)
+/* Replace the string of a value with one from cfg_value_strdup() */
+static void cfg_value_setstr(cfg_opt_t *opt, cfg_value_t *val, char *str, size_t len)
 {
-	if (!opt || opt->type != CFGT_INT8) {
-		errno = EINVAL;
-		return 0;
+	if ((void *)val == (void *)opt->simple_value.ptr) {
+		free(val->string);
+		val->string = str;
+		return;
 	}
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->i8;
-	if (opt->simple_value.i8)
-		return *opt->simple_value.i8;
-
-	return 0;
+	cfg_strfree_sec(opt->sec, CFG_MEMORY_STRINGS, val->string, ((struct cfg_strval *)val)->len);
+	val->string = str;
+	((struct cfg_strval *)val)->len = str ? len : 0;
 }
 
-DLLIMPORT int8_t cfg_getnint8(cfg_t *cfg, const char *name, unsigned int index)
+static size_t cfg_value_strlen(cfg_opt_t *opt, cfg_value_t *val)
 {
-	return cfg_opt_getnint8(cfg_getopt(cfg, name), index);
-}
+	if (!val->string)
+		return 0;
+	if ((void *)val == (void *)opt->simple_value.ptr)
+		return strlen(val->string);
 
-DLLIMPORT int8_t cfg_getint8(cfg_t *cfg, const char *name)
-{
-	return cfg_getnint8(cfg, name, 0);
+	return ((struct cfg_strval *)val)->len;
 }
 
-DLLIMPORT int16_t cfg_opt_getnint16(cfg_opt_t *opt, unsigned int index)
+/*
+ * Sections with many options get an open addressing table from name
+ * hash to position in opts[].  It is built when the section is created
+ * and extended when options are appended, so lookups never modify it
+ * and concurrent readers are safe.  Without a table, e.g. on ENOMEM,
+ * lookups fall back to the linear scan.
+ */
+#define CFG_INDEX_MIN 8
+
+struct cfg_index {
+	unsigned int mask;	/* Number of slots - 1, a power of two */
+	unsigned int count;
+	struct {
+		uint32_t     hash;
+		unsigned int pos;	/* Position in opts[] + 1, 0 if free */
+	} slot[];
+};
+
+#define cfg_index_size(ix) (sizeof(*(ix)) + ((ix)->mask + 1) * sizeof((ix)->slot[0]))
+
+/* Inserting in position order keeps the first of duplicate names first */
+static void cfg_index_insert(struct cfg_index *ix, cfg_opt_t *opt, unsigned int pos)
 {
-	if (!opt || opt->type != CFGT_INT16) {
-		errno = EINVAL;
-		return 0;
-	}
+	uint32_t hash = cfg_hash(opt->name, strlen(opt->name));
+	unsigned int i = hash & ix->mask;
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->i16;
-	if (opt->simple_value.i16)
-		return *opt->simple_value.i16;
+	while (ix->slot[i].pos)
+		i = (i + 1) & ix->mask;
 
-	return 0;
+	ix->slot[i].hash = hash;
+	ix->slot[i].pos = pos + 1;
+	ix->count++;
 }
 
-DLLIMPORT int16_t cfg_getnint16(cfg_t *cfg, const char *name, unsigned int index)
+static void cfg_index_build(cfg_t *cfg)
 {
-	return cfg_opt_getnint16(cfg_getopt(cfg, name), index);
-}
+	struct cfg_index *ix;
+	unsigned int i, n, size = 16;
 
-DLLIMPORT int16_t cfg_getint16(cfg_t *cfg, const char *name)
-{
-	return cfg_getnint16(cfg, name, 0);
-}
+	if (cfg->index)
+		cfg_mem_count(cfg, CFG_MEMORY_OPTIONS, -1, cfg_index_size(cfg->index));
+	free(cfg->index);
+	cfg->index = NULL;
 
-DLLIMPORT int32_t cfg_opt_getnint32(cfg_opt_t *opt, unsigned int index)
-{
-	if (!opt || opt->type != CFGT_INT32) {
-		errno = EINVAL;
-		return 0;
-	}
+	n = cfg_num(cfg);
+	if (n < CFG_INDEX_MIN)
+		return;
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->i32;
-	if (opt->simple_value.i32)
-		return *opt->simple_value.i32;
+	while (size < n * 2)
+		size <<= 1;
 
-	return 0;
-}
+	ix = calloc(1, sizeof(*ix) + size * sizeof(ix->slot[0]));
+	if (!ix)
+		return;
 
-DLLIMPORT int32_t cfg_getnint32(cfg_t *cfg, const char *name, unsigned int index)
-{
-	return cfg_opt_getnint32(cfg_getopt(cfg, name), index);
+	ix->mask = size - 1;
+	for (i = 0; i < n; i++)
+		cfg_index_insert(ix, &cfg->opts[i], i);
+	cfg->index = ix;
+	cfg_mem_count(cfg, CFG_MEMORY_OPTIONS, 1, cfg_index_size(ix));
 }
 
-DLLIMPORT int32_t cfg_getint32(cfg_t *cfg, const char *name)
+/* Called after appending opts[pos] */
+static void cfg_index_add(cfg_t *cfg, unsigned int pos)
 {
-	return cfg_getnint32(cfg, name, 0);
+	struct cfg_index *ix = cfg->index;
+
+	if (!ix || (ix->count + 1) * 2 > ix->mask + 1)
+		cfg_index_build(cfg);
+	else
+		cfg_index_insert(ix, &cfg->opts[pos], pos);
 }
 
-DLLIMPORT uint8_t cfg_opt_getnuint8(cfg_opt_t *opt, unsigned int index)
+static cfg_opt_t *cfg_index_find(cfg_t *cfg, const char *name, size_t len, uint32_t hash)
 {
-	if (!opt || opt->type != CFGT_UINT8) {
-		errno = EINVAL;
-		return 0;
-	}
+	struct cfg_index *ix = cfg->index;
+	unsigned int i = hash & ix->mask;
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->u8;
-	if (opt->simple_value.u8)
-		return *opt->simple_value.u8;
+	while (ix->slot[i].pos) {
+		cfg_opt_t *opt = &cfg->opts[ix->slot[i].pos - 1];
 
-	return 0;
-}
+		if (ix->slot[i].hash == hash && !cfg_namecmp(cfg, opt->name, name, len))
+			return opt;
+		i = (i + 1) & ix->mask;
+	}
 
-DLLIMPORT uint8_t cfg_getnuint8(cfg_t *cfg, const char *name, unsigned int index)
-{
-	return cfg_opt_getnuint8(cfg_getopt(cfg, name), index);
+	return NULL;
 }
 
-DLLIMPORT uint8_t cfg_getuint8(cfg_t *cfg, const char *name)
-{
-	return cfg_getnuint8(cfg, name, 0);
-}
+/*
+ * With CFGF_STATS each section has counters parallel to its opts[],
+ * and a list of the names looked up in it that do not exist.  They
+ * are updated by lookups and getters, without locking.
+ */
+#define CFG_STATS_UNKNOWN_MAX 64	/* Unknown names kept per section */
 
-DLLIMPORT uint16_t cfg_opt_getnuint16(cfg_opt_t *opt, unsigned int index)
-{
-	if (!opt || opt->type != CFGT_UINT16) {
-		errno = EINVAL;
-		return 0;
-	}
+struct cfg_unknown {
+	struct cfg_unknown *next;
+	uint64_t            lookups;
+	char                name[];
+};
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->u16;
-	if (opt->simple_value.u16)
-		return *opt->simple_value.u16;
+struct cfg_stats {
+	cfg_opt_stats_t    *opt;	/* nopts + 1, the last one unused */
+	unsigned int        nopts;
+	unsigned int        nunknown;
+	struct cfg_unknown *unknown;
+};
+
+static uint64_t cfg_stats_now(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec ts;
 
+	if (!clock_gettime(CLOCK_MONOTONIC, &ts))
+		return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
 	return 0;
 }
 
-DLLIMPORT uint16_t cfg_getnuint16(cfg_t *cfg, const char *name, unsigned int index)
+/* On failure the section is simply not counted */
+static void cfg_stats_new(cfg_t *sec)
 {
-	return cfg_opt_getnuint16(cfg_getopt(cfg, name), index);
-}
+	struct cfg_stats *st;
 
-DLLIMPORT uint16_t cfg_getuint16(cfg_t *cfg, const char *name)
-{
-	return cfg_getnuint16(cfg, name, 0);
-}
+	if (!is_set(CFGF_STATS, sec->flags))
+		return;
 
-DLLIMPORT double cfg_opt_getnfloat(cfg_opt_t *opt, unsigned int index)
-{
-	if (!opt || opt->type != CFGT_FLOAT) {
-		errno = EINVAL;
-		return 0;
-	}
+	st = calloc(1, sizeof(*st));
+	if (!st)
+		return;
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->fpnumber;
-	if (opt->simple_value.fpnumber)
-		return *opt->simple_value.fpnumber;
+	st->nopts = cfg_num(sec);
+	st->opt = calloc(st->nopts + 1, sizeof(st->opt[0]));
+	if (!st->opt) {
+		free(st);
+		return;
+	}
 
-	return 0;
+	cfg_mem_count(sec, CFG_MEMORY_OPTIONS, 1, sizeof(*st));
+	cfg_mem_count(sec, CFG_MEMORY_OPTIONS, 1, (st->nopts + 1) * sizeof(st->opt[0]));
+	sec->stats = st;
 }
 
-DLLIMPORT double cfg_getnfloat(cfg_t *cfg, const char *name, unsigned int index)
+/* Called after appending to sec->opts */
+static void cfg_stats_grow(cfg_t *sec)
 {
-	return cfg_opt_getnfloat(cfg_getopt(cfg, name), index);
+	struct cfg_stats *st = sec->stats;
+	cfg_opt_stats_t *opt;
+	unsigned int n;
+
+	if (!st)
+		return;
+
+	n = cfg_num(sec);
+	opt = reallocarray(st->opt, n + 1, sizeof(opt[0]));
+	if (!opt)
+		return;
+
+	memset(&opt[st->nopts + 1], 0, (n - st->nopts) * sizeof(opt[0]));
+	cfg_mem_count(sec, CFG_MEMORY_OPTIONS, -1, (st->nopts + 1) * sizeof(opt[0]));
+	cfg_mem_count(sec, CFG_MEMORY_OPTIONS, 1, (n + 1) * sizeof(opt[0]));
+	st->opt = opt;
+	st->nopts = n;
 }
 
-DLLIMPORT double cfg_getfloat(cfg_t *cfg, const char *name)
+/* Forget the unknown names looked up in sec */
+static void cfg_stats_unknown_free(cfg_t *sec)
 {
-	return cfg_getnfloat(cfg, name, 0);
+	struct cfg_stats *st = sec->stats;
+	struct cfg_unknown *u, *next;
+
+	for (u = st->unknown; u; u = next) {
+		next = u->next;
+		cfg_mem_count(sec, CFG_MEMORY_OPTIONS, -1, sizeof(*u) + strlen(u->name) + 1);
+		free(u);
+	}
+	st->unknown = NULL;
+	st->nunknown = 0;
 }
 
-DLLIMPORT cfg_bool_t cfg_opt_getnbool(cfg_opt_t *opt, unsigned int index)
+static void cfg_stats_free(cfg_t *sec)
 {
-	if (!opt || opt->type != CFGT_BOOL) {
-		errno = EINVAL;
-		return cfg_false;
-	}
+	struct cfg_stats *st = sec->stats;
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->boolean;
-	if (opt->simple_value.boolean)
-		return *opt->simple_value.boolean;
+	if (!st)
+		return;
 
-	return cfg_false;
+	cfg_stats_unknown_free(sec);
+	cfg_mem_count(sec, CFG_MEMORY_OPTIONS, -1, (st->nopts + 1) * sizeof(st->opt[0]));
+	cfg_mem_count(sec, CFG_MEMORY_OPTIONS, -1, sizeof(*st));
+	free(st->opt);
+	free(st);
+	sec->stats = NULL;
 }
 
-DLLIMPORT cfg_bool_t cfg_getnbool(cfg_t *cfg, const char *name, unsigned int index)
+/* Counters of opt, NULL unless an option of a counted section */
+static cfg_opt_stats_t *cfg_stats_of(cfg_opt_t *opt)
 {
-	return cfg_opt_getnbool(cfg_getopt(cfg, name), index);
-}
+	cfg_t *sec = opt ? opt->sec : NULL;
 
-DLLIMPORT cfg_bool_t cfg_getbool(cfg_t *cfg, const char *name)
-{
-	return cfg_getnbool(cfg, name, 0);
+	if (!sec || !sec->stats || opt < sec->opts || opt >= sec->opts + sec->stats->nopts)
+		return NULL;
+
+	return &sec->stats->opt[opt - sec->opts];
 }
 
-DLLIMPORT char *cfg_opt_getnstr(cfg_opt_t *opt, unsigned int index)
+static void cfg_stats_unknown(cfg_t *cfg, const char *name)
 {
-	if (!opt || opt->type != CFGT_STR) {
-		errno = EINVAL;
-		return NULL;
+	struct cfg_stats *st = cfg->stats;
+	struct cfg_unknown *u, **pp;
+
+	if (!name)
+		return;
+
+	for (pp = &st->unknown; *pp; pp = &(*pp)->next) {
+		if (!strcmp((*pp)->name, name)) {
+			(*pp)->lookups++;
+			return;
+		}
 	}
+	/* A frozen tree is read by threads without locks, nothing is added */
+	if (st->nunknown >= CFG_STATS_UNKNOWN_MAX || is_set(CFGF_FROZEN, cfg->flags))
+		return;
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->string;
-	if (opt->simple_value.string)
-		return *opt->simple_value.string;
+	u = calloc(1, sizeof(*u) + strlen(name) + 1);
+	if (!u)
+		return;
 
-	return NULL;
+	strcpy(u->name, name);
+	u->lookups = 1;
+	*pp = u;
+	st->nunknown++;
+	cfg_mem_count(cfg, CFG_MEMORY_OPTIONS, 1, sizeof(*u) + strlen(name) + 1);
 }
 
-DLLIMPORT char *cfg_getnstr(cfg_t *cfg, const char *name, unsigned int index)
+/* A lookup of name from cfg, which has counters, that found opt or not */
+static void cfg_stats_lookup(cfg_t *cfg, const char *name, cfg_opt_t *opt, uint64_t nsec)
 {
-	return cfg_opt_getnstr(cfg_getopt(cfg, name), index);
-}
+	cfg_opt_stats_t *st;
 
-DLLIMPORT char *cfg_getstr(cfg_t *cfg, const char *name)
-{
-	return cfg_getnstr(cfg, name, 0);
-}
+	if (!opt) {
+		cfg_stats_unknown(cfg, name);
+		return;
+	}
 
-DLLIMPORT void *cfg_opt_getnptr(cfg_opt_t *opt, unsigned int index)
-{
-	if (!opt || opt->type != CFGT_PTR) {
-		errno = EINVAL;
-		return NULL;
+	st = cfg_stats_of(opt);
+	if (st) {
+		st->lookups++;
+		st->nsec += nsec;
 	}
+}
 
+/* The value a getter returns, without counting the read, NULL if none */
+static cfg_value_t *cfg_opt_peek(cfg_opt_t *opt, unsigned int index)
+{
 	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->ptr;
+		return opt->values[index];
 	if (opt->simple_value.ptr)
-		return *opt->simple_value.ptr;
+		return (cfg_value_t *)opt->simple_value.ptr;
 
 	return NULL;
 }
 
-DLLIMPORT void *cfg_getnptr(cfg_t *cfg, const char *name, unsigned int index)
+/* Same for cfg_opt_getnsec() */
+static cfg_t *cfg_opt_peeksec(cfg_opt_t *opt, unsigned int index)
 {
-	return cfg_opt_getnptr(cfg_getopt(cfg, name), index);
+	if (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC)
+		return NULL;
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->section;
+
+	return NULL;
 }
 
-DLLIMPORT void *cfg_getptr(cfg_t *cfg, const char *name)
+/* A section of opt that belongs to the tree a copy was made from, see cfg_dup() */
+static int cfg_shared(cfg_opt_t *opt, cfg_t *sec)
 {
-	return cfg_getnptr(cfg, name, 0);
+	return sec->parent != opt->sec && is_set(CFGF_FROZEN, sec->flags);
 }
 
-DLLIMPORT cfg_t *cfg_opt_getnsec(cfg_opt_t *opt, unsigned int index)
-{
-	if (!opt || (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC)) {
-		errno = EINVAL;
-		return NULL;
-	}
+static void cfg_init_lazy(cfg_opt_t *opt);
 
-	if (opt->values && index < opt->nvalues)
-		return opt->values[index]->section;
+/*
+ * With CFGF_LAZY, a default that is a single number, boolean or string
+ * is read from opt->def until the option is set, see cfg_opt_default()
+ */
+static int cfg_lazy_plain(cfg_opt_t *opt)
+{
+	if (is_set(CFGF_LIST, opt->flags) || opt->def.parsed)
+		return 0;
 
-	errno = ENOENT;
-	return NULL;
-}
+	switch (opt->type) {
+	case CFGT_INT:
+	case CFGT_INT8:
+	case CFGT_INT16:
+	case CFGT_INT32:
+	case CFGT_INT64:
+	case CFGT_UINT8:
+	case CFGT_UINT16:
+	case CFGT_UINT32:
+	case CFGT_UINT64:
+	case CFGT_FLOAT:
+	case CFGT_BOOL:
+	case CFGT_STR:
+		return 1;
 
-DLLIMPORT cfg_t *cfg_getnsec(cfg_t *cfg, const char *name, unsigned int index)
-{
-	return cfg_opt_getnsec(cfg_getopt(cfg, name), index);
+	default:
+		return 0;
+	}
 }
 
-DLLIMPORT cfg_t *cfg_opt_gettsec(cfg_opt_t *opt, const char *title)
+/* Other defaults, lists and sections, are set on their first use */
+#define cfg_opt_lazy(opt)						\
+	do {								\
+		if ((opt) && is_set(CFGF_LAZYDEF, (opt)->flags) &&	\
+		    !cfg_lazy_plain(opt))				\
+			cfg_init_lazy(opt);				\
+	} while (0)
+
+/* Before the option changes, all of them */
+#define cfg_opt_lazyset(opt)						\
+	do {								\
+		if ((opt) && is_set(CFGF_LAZYDEF, (opt)->flags))	\
+			cfg_init_lazy(opt);				\
+	} while (0)
+
+/* Room for an option with its default as the value, see cfg_opt_default() */
+struct cfg_lazyopt {
+	cfg_opt_t          opt;
+	cfg_value_t       *values[1];
+	struct cfg_strval  val;
+};
+
+/*
+ * The option to read values from: opt itself, or while its default
+ * is left in opt->def, a copy of it in lo with the default as value,
+ * as cfg_init_default() would set it.  Nothing is allocated or changed
+ * in opt, so this is safe in a frozen tree, see cfg_freeze().
+ */
+static cfg_opt_t *cfg_opt_default(cfg_opt_t *opt, struct cfg_lazyopt *lo)
 {
-	long int i;
+	cfg_value_t *val = &lo->val.val;
 
-	if (!opt || !title) {
-		errno = EINVAL;
-		return NULL;
+	if (!opt || !is_set(CFGF_LAZYDEF, opt->flags))
+		return opt;
+
+	if (!cfg_lazy_plain(opt)) {
+		cfg_init_lazy(opt);
+		return opt;
 	}
 
-	if (!is_set(CFGF_TITLE, opt->flags)) {
-		errno = EINVAL;
-		return NULL;
+	memset(&lo->val, 0, sizeof(lo->val));
+	switch (opt->type) {
+	case CFGT_INT:    val->number = opt->def.number;           break;
+	case CFGT_INT8:   val->i8  = (int8_t)opt->def.number;      break;
+	case CFGT_INT16:  val->i16 = (int16_t)opt->def.number;     break;
+	case CFGT_INT32:  val->i32 = (int32_t)opt->def.number;     break;
+	case CFGT_INT64:  val->i64 = opt->def.number;              break;
+	case CFGT_UINT8:  val->u8  = (uint8_t)opt->def.number;     break;
+	case CFGT_UINT16: val->u16 = (uint16_t)opt->def.number;    break;
+	case CFGT_UINT32: val->u32 = (uint32_t)opt->def.number;    break;
+	case CFGT_UINT64: val->u64 = (uint64_t)opt->def.number;    break;
+	case CFGT_FLOAT:  val->fpnumber = opt->def.fpnumber;       break;
+	case CFGT_BOOL:   val->boolean = opt->def.boolean;         break;
+	default:
+		val->string = (char *)opt->def.string;
+		lo->val.len = val->string ? strlen(val->string) : 0;
+		break;
 	}
 
-	i = cfg_opt_gettsecidx(opt, title);
-	if (i >= 0)
-		return cfg_opt_getnsec(opt, i);
+	lo->opt = *opt;
+	lo->opt.flags &= ~(CFGF_LAZYDEF | CFGF_MODIFIED);
+	lo->opt.flags |= CFGF_DEFINIT | CFGF_RESET;
+	lo->values[0] = val;
+	lo->opt.values = lo->values;
+	lo->opt.nvalues = 1;
 
-	errno = ENOENT;
-	return NULL;
+	return &lo->opt;
 }
 
-DLLIMPORT cfg_t *cfg_gettsec(cfg_t *cfg, const char *name, const char *title)
+/* Unset strings are misses too, they read as NULL */
+static void cfg_stats_count(cfg_opt_t *opt, int typeok, unsigned int index)
 {
-	return cfg_opt_gettsec(cfg_getopt(cfg, name), title);
-}
+	cfg_opt_stats_t *st = cfg_stats_of(opt);
+	struct cfg_lazyopt lo;
+	cfg_value_t *val;
 
-DLLIMPORT cfg_t *cfg_getsec(cfg_t *cfg, const char *name)
-{
-	cfg_opt_t *opt;
-	unsigned int index;
+	if (!st)
+		return;
 
-	opt = cfg_getopt_secidx(cfg, name, &index);
-	return cfg_opt_getnsec(opt, index);
+	opt = cfg_opt_default(opt, &lo);
+	st->reads++;
+	if (!typeok)
+		st->errors++;
+	else if (!(val = cfg_opt_peek(opt, index)) || (opt->type == CFGT_STR && !val->string))
+		st->misses++;
 }
 
-static cfg_value_t *cfg_addval(cfg_opt_t *opt)
-{
-	void *ptr;
-
-	ptr = realloc(opt->values, (opt->nvalues + 1) * sizeof(cfg_value_t *));
-	if (!ptr)
-		return NULL;
+/* A read with a getter, typeok is only evaluated when counting */
+#define cfg_stats_read(opt, typeok, index)				\
+	do {								\
+		if ((opt) && (opt)->sec && (opt)->sec->stats)		\
+			cfg_stats_count(opt, typeok, index);		\
+	} while (0)
 
-	opt->values = ptr;
-	opt->values[opt->nvalues] = calloc(1, sizeof(cfg_value_t));
-	if (!opt->values[opt->nvalues])
-		return NULL;
 
-	opt->flags |= CFGF_MODIFIED;
+/*
+ * With CFGF_PROFILE the root section keeps a record per parsed file,
+ * buffer and include().  The clock is read when entering and leaving a
+ * phase, and the time since the last reading is charged to the phase
+ * and file current until then.  Phases entered while setting defaults
+ * are part of the defaults, which is where the parser runs for them.
+ */
+struct cfg_profile_rec {
+	cfg_profile_t prof;
+	uint64_t      start;
+	int           parent;	/* Record of the including file, or -1 */
+};
 
-	return opt->values[opt->nvalues++];
-}
+struct cfg_profiler {
+	cfg_t                  *root;
+	struct cfg_profile_rec *rec;
+	unsigned int            num;
+	unsigned int            size;
+	int                     cur;	/* Record being read, or -1 */
+	unsigned int            lost;	/* Includes not recorded, on ENOMEM */
+	cfg_profile_phase_t     phase;
+	uint64_t                mark;	/* Time charged up to */
+};
 
-static cfg_opt_t *cfg_addopt(cfg_t *cfg, char *key)
+/* The profiler of the tree sec is in, NULL without CFGF_PROFILE */
+static struct cfg_profiler *cfg_profile_of(cfg_t *sec)
 {
-	int num = cfg_num(cfg);
-	cfg_opt_t *opts;
-
-	opts = reallocarray(cfg->opts, num + 2, sizeof(cfg_opt_t));
-	if (!opts)
+	if (!sec || !is_set(CFGF_PROFILE, sec->flags))
 		return NULL;
+	while (sec->parent)
+		sec = sec->parent;
 
-	/* Write new opt to previous CFG_END() marker */
-	cfg->opts = opts;
-	cfg->opts[num].name = strdup(key);
-	cfg->opts[num].type = CFGT_STR;
+	return sec->profile;
+}
 
-	if (!cfg->opts[num].name) {
-		free(opts);
+/* The record being read, NULL outside of a parse */
+static cfg_profile_t *cfg_profile_rec(struct cfg_profiler *p)
+{
+	if (!p || p->cur < 0)
 		return NULL;
-	}
-
-	/* Set new CFG_END() */
-	memset(&cfg->opts[num + 1], 0, sizeof(cfg_opt_t));
 
-	return &cfg->opts[num];
+	return &p->rec[p->cur].prof;
 }
 
-DLLIMPORT int cfg_numopts(cfg_opt_t *opts)
+/* Same, but also NULL for defaults, which are not read from the input */
+static cfg_profile_t *cfg_profile_input(struct cfg_profiler *p)
 {
-	int n;
+	if (p && p->phase == CFG_PROFILE_DEFAULTS)
+		return NULL;
 
-	for (n = 0; opts && opts[n].name; n++)
-		/* do nothing */ ;
-	return n;
+	return cfg_profile_rec(p);
 }
 
-DLLIMPORT unsigned int cfg_num(cfg_t *cfg)
+static void cfg_profile_charge(struct cfg_profiler *p, uint64_t now)
 {
-	if (!cfg)
-		return 0;
-
-	return (unsigned int)cfg_numopts(cfg->opts);
+	p->rec[p->cur].prof.nsec[p->phase] += now - p->mark;
+	p->mark = now;
 }
 
-static cfg_opt_t *cfg_dupopt_array(cfg_opt_t *opts)
+/* Returns the phase to go back to with cfg_profile_leave() */
+static cfg_profile_phase_t cfg_profile_enter(struct cfg_profiler *p, cfg_profile_phase_t phase)
 {
-	int i;
-	cfg_opt_t *dupopts;
-	int n = cfg_numopts(opts);
+	cfg_profile_phase_t old;
 
-	dupopts = calloc(n + 1, sizeof(cfg_opt_t));
-	if (!dupopts)
-		return NULL;
+	if (!p || p->cur < 0)
+		return CFG_PROFILE_PARSE;
 
-	if (n)
-		memcpy(dupopts, opts, n * sizeof(cfg_opt_t));
+	old = p->phase;
+	if (old == phase || old == CFG_PROFILE_DEFAULTS)
+		return old;
 
-	for (i = 0; i < n; i++) {
-		/* Clear dynamic ptrs, protecting the original on failure */
-		dupopts[i].name = NULL;
-		dupopts[i].subopts = NULL;
-		dupopts[i].def.parsed = NULL;
-		dupopts[i].def.string = NULL;
-		dupopts[i].comment = NULL;
-	}
+	cfg_profile_charge(p, cfg_stats_now());
+	p->phase = phase;
 
-	for (i = 0; i < n; i++) {
-		dupopts[i].name = strdup(opts[i].name);
-		if (!dupopts[i].name)
-			goto err;
+	return old;
+}
 
-		if (opts[i].subopts) {
-			dupopts[i].subopts = cfg_dupopt_array(opts[i].subopts);
-			if (!dupopts[i].subopts)
-				goto err;
-		}
+static void cfg_profile_leave(struct cfg_profiler *p, cfg_profile_phase_t old)
+{
+	if (!p || p->cur < 0 || p->phase == old)
+		return;
 
-		if (opts[i].def.parsed) {
-			dupopts[i].def.parsed = strdup(opts[i].def.parsed);
-			if (!dupopts[i].def.parsed)
-				goto err;
-		}
+	cfg_profile_charge(p, cfg_stats_now());
+	p->phase = old;
+}
 
-		if (opts[i].def.string) {
-			dupopts[i].def.string = strdup(opts[i].def.string);
-			if (!dupopts[i].def.string)
-				goto err;
-		}
+/* Start a record for filename, returns it for cfg_profile_end(), or -1 */
+static int cfg_profile_begin(struct cfg_profiler *p, const char *filename, uint64_t bytes)
+{
+	struct cfg_profile_rec *rec;
+	uint64_t now;
+	char *name;
 
-		if (opts[i].comment) {
-			dupopts[i].comment = strdup(opts[i].comment);
-			if (!dupopts[i].comment)
-				goto err;
-		}
-	}
+	if (!p)
+		return -1;
 
-	return dupopts;
-err:
-	cfg_free_opt_array(dupopts);
-	return NULL;
-}
+	if (p->num == p->size) {
+		unsigned int size = p->size ? p->size * 2 : 8;
 
-DLLIMPORT int cfg_parse_boolean(const char *s)
-{
-	if (!s) {
-		errno = EINVAL;
-		return CFG_FAIL;
+		rec = reallocarray(p->rec, size, sizeof(*rec));
+		if (!rec)
+			return -1;
+		if (p->size)
+			cfg_mem_count(p->root, CFG_MEMORY_PATHS, -1, p->size * sizeof(*rec));
+		cfg_mem_count(p->root, CFG_MEMORY_PATHS, 1, size * sizeof(*rec));
+		p->rec = rec;
+		p->size = size;
 	}
 
-	if (strcasecmp(s, "true") == 0 || strcasecmp(s, "on") == 0 || strcasecmp(s, "yes") == 0)
-		return 1;
-	if (strcasecmp(s, "false") == 0 || strcasecmp(s, "off") == 0 || strcasecmp(s, "no") == 0)
-		return 0;
+	name = strdup(filename ? filename : "");
+	if (!name)
+		return -1;
+	cfg_mem_str(p->root, CFG_MEMORY_PATHS, 1, name);
 
-	return CFG_FAIL;
+	now = cfg_stats_now();
+	if (p->cur >= 0)
+		cfg_profile_charge(p, now);
+	else
+		p->phase = CFG_PROFILE_PARSE;
+
+	rec = &p->rec[p->num];
+	memset(rec, 0, sizeof(*rec));
+	rec->prof.filename = name;
+	rec->prof.depth = p->cur >= 0 ? p->rec[p->cur].prof.depth + 1 : 0;
+	rec->prof.bytes = bytes;
+	rec->start = now;
+	rec->parent = p->cur;
+	p->cur = p->num++;
+	p->mark = now;
+
+	return p->cur;
 }
 
-static void cfg_init_defaults(cfg_t *cfg)
+/* End record index, and any left open inside it by a parse error */
+static void cfg_profile_end(struct cfg_profiler *p, int index)
 {
-	int i;
+	uint64_t now;
 
-	for (i = 0; cfg->opts && cfg->opts[i].name; i++) {
-		int j;
-
-		for (j = 0; j < i; ++j) {
-			if (is_set(CFGF_NOCASE, cfg->opts[i].flags | cfg->opts[j].flags)) {
-				if (strcasecmp(cfg->opts[i].name, cfg->opts[j].name))
-					continue;
-			} else {
-				if (strcmp(cfg->opts[i].name, cfg->opts[j].name))
-					continue;
-			}
-			/*
-			 * There are two definitions of the same option name.
-			 * What to do? It's a programming error and not an end
-			 * user input error. Lets print a message and abort...
-			 */
-			cfg_error(cfg, _("duplicate option '%s' not allowed"),
-				cfg->opts[i].name);
-			break;
-		}
+	if (!p || index < 0)
+		return;
 
-		/* libConfuse doesn't handle default values for "simple" options */
-		if (cfg->opts[i].simple_value.ptr || is_set(CFGF_NODEFAULT, cfg->opts[i].flags))
-			continue;
+	now = cfg_stats_now();
+	while (p->cur >= index) {
+		struct cfg_profile_rec *rec = &p->rec[p->cur];
 
-		if (cfg->opts[i].type != CFGT_SEC && cfg->opts[i].type != CFGT_RAWSEC) {
-			cfg->opts[i].flags |= CFGF_DEFINIT;
+		cfg_profile_charge(p, now);
+		rec->prof.wall = now - rec->start;
+		p->cur = rec->parent;
+	}
+	if (p->cur < 0)
+		p->lost = 0;
+}
 
-			if (is_set(CFGF_LIST, cfg->opts[i].flags) || cfg->opts[i].def.parsed) {
-				int xstate, ret = 0;
-				char *buf;
-				FILE *fp;
+static uint64_t cfg_profile_fsize(FILE *fp)
+{
+#ifdef HAVE_SYS_STAT_H
+	struct stat st;
+	int fd = fileno(fp);
 
-				/* If it's a list, but no default value was given,
-				 * keep the option uninitialized.
-				 */
-				buf = cfg->opts[i].def.parsed;
-				if (!buf || !buf[0])
-					continue;
+	if (fd >= 0 && !fstat(fd, &st) && S_ISREG(st.st_mode))
+		return (uint64_t)st.st_size;
+#endif
+	return 0;
+}
 
-				/* setup scanning from the string specified for the
-				 * "default" value, force the correct state and option
-				 */
+/* Called by the lexer with the file opened by include(), NULL at its end */
+void cfg_profile_include(cfg_t *cfg, FILE *fp)
+{
+	struct cfg_profiler *p = cfg_profile_of(cfg);
 
-				if (is_set(CFGF_LIST, cfg->opts[i].flags))
-					/* lists must be surrounded by {braces} */
-					xstate = 3;
-				else if (cfg->opts[i].type == CFGT_FUNC)
-					xstate = 0;
-				else
-					xstate = 2;
-
-				fp = fmemopen(buf, strlen(buf), "r");
-				if (!fp) {
-					/*
-					 * fmemopen() on older GLIBC versions do not accept zero
-					 * length buffers for some reason.  This is a workaround.
-					 */
-					if (strlen(buf) > 0)
-						ret = STATE_ERROR;
-				} else {
-					cfg_scan_fp_begin(fp);
-
-					do {
-						ret = cfg_parse_internal(cfg, 1, xstate, &cfg->opts[i]);
-						xstate = -1;
-					} while (ret == STATE_CONTINUE);
-
-					cfg_scan_fp_end();
-					fclose(fp);
-				}
+	if (!p || p->cur < 0)
+		return;
 
-				if (ret == STATE_ERROR) {
-					/*
-					 * If there was an error parsing the default string,
-					 * the initialization of the default value could be
-					 * inconsistent or empty. What to do? It's a
-					 * programming error and not an end user input
-					 * error. Lets print a message and abort...
-					 */
-					fprintf(stderr, "Parse error in default value '%s'"
-						" for option '%s'\n", cfg->opts[i].def.parsed, cfg->opts[i].name);
-					fprintf(stderr, "Check your initialization macros and the" " libConfuse documentation\n");
-					abort();
-				}
-			} else {
-				switch (cfg->opts[i].type) {
-				case CFGT_INT:
-					cfg_opt_setnint(&cfg->opts[i], cfg->opts[i].def.number, 0);
-					break;
+	if (fp) {
+		if (cfg_profile_begin(p, cfg->filename, cfg_profile_fsize(fp)) < 0)
+			p->lost++;
+	} else if (p->lost) {
+		p->lost--;
+	} else {
+		cfg_profile_end(p, p->cur);
+	}
+}
 
-				case CFGT_INT8:
-					cfg_opt_setnint8(&cfg->opts[i], (int8_t)cfg->opts[i].def.number, 0);
-					break;
+static struct cfg_profiler *cfg_profile_new(cfg_t *root)
+{
+	struct cfg_profiler *p;
 
-				case CFGT_INT16:
-					cfg_opt_setnint16(&cfg->opts[i], (int16_t)cfg->opts[i].def.number, 0);
-					break;
+	p = calloc(1, sizeof(*p));
+	if (!p)
+		return NULL;
 
-				case CFGT_INT32:
-					cfg_opt_setnint32(&cfg->opts[i], (int32_t)cfg->opts[i].def.number, 0);
-					break;
+	p->root = root;
+	p->cur = -1;
+	cfg_mem_count(root, CFG_MEMORY_PATHS, 1, sizeof(*p));
 
-				case CFGT_INT64:
-					cfg_opt_setnint64(&cfg->opts[i], cfg->opts[i].def.number, 0);
-					break;
+	return p;
+}
 
-				case CFGT_UINT8:
-					cfg_opt_setnuint8(&cfg->opts[i], (uint8_t)cfg->opts[i].def.number, 0);
-					break;
+static void cfg_profile_clear(struct cfg_profiler *p)
+{
+	unsigned int i;
 
-				case CFGT_UINT16:
-					cfg_opt_setnuint16(&cfg->opts[i], (uint16_t)cfg->opts[i].def.number, 0);
-					break;
+	for (i = 0; i < p->num; i++) {
+		cfg_mem_str(p->root, CFG_MEMORY_PATHS, -1, p->rec[i].prof.filename);
+		free((char *)p->rec[i].prof.filename);
+	}
+	if (p->rec)
+		cfg_mem_count(p->root, CFG_MEMORY_PATHS, -1, p->size * sizeof(p->rec[0]));
+	free(p->rec);
+	p->rec = NULL;
+	p->num = p->size = 0;
+}
 
-				case CFGT_UINT32:
-					cfg_opt_setnuint32(&cfg->opts[i], (uint32_t)cfg->opts[i].def.number, 0);
-					break;
+static void cfg_profile_free(struct cfg_profiler *p)
+{
+	if (!p)
+		return;
 
-				case CFGT_UINT64:
-					cfg_opt_setnuint64(&cfg->opts[i], (uint64_t)cfg->opts[i].def.number, 0);
-					break;
+	cfg_profile_clear(p);
+	cfg_mem_count(p->root, CFG_MEMORY_PATHS, -1, sizeof(*p));
+	free(p);
+}
 
-				case CFGT_FLOAT:
-					cfg_opt_setnfloat(&cfg->opts[i], cfg->opts[i].def.fpnumber, 0);
-					break;
+/*
+ * A read-only view of other trees, see cfg_overlay().  It has no
+ * options of its own, lookups go to the layers instead.
+ */
+struct cfg_overlay {
+	unsigned int num;
+	cfg_t *layer[];		/* Bottom first */
+};
 
-				case CFGT_BOOL:
-					cfg_opt_setnbool(&cfg->opts[i], cfg->opts[i].def.boolean, 0);
-					break;
+static cfg_opt_t cfg_overlay_opts[] = {
+	CFG_END()
+};
 
-				case CFGT_STR:
-					cfg_opt_setnstr(&cfg->opts[i], cfg->opts[i].def.string, 0);
-					break;
+static cfg_opt_t *cfg_overlay_probe(cfg_t *cfg, const char *name, unsigned int *index);
 
-				case CFGT_FUNC:
-				case CFGT_PTR:
-					break;
+/* Same as cfg_getopt_leaf(), but name need not be NUL terminated */
+static cfg_opt_t *cfg_getopt_leafn(cfg_t *cfg, const char *name, size_t len)
+{
+	cfg_opt_t *opt = NULL;
+	unsigned int i;
 
-				default:
-					cfg_error(cfg, "internal error in cfg_init_defaults(%s)", cfg->opts[i].name);
-					break;
-				}
+	if (cfg->index) {
+		opt = cfg_index_find(cfg, name, len, cfg_hash(name, len));
+	} else {
+		for (i = 0; cfg->opts && cfg->opts[i].name; i++) {
+			if (!cfg_namecmp(cfg, cfg->opts[i].name, name, len)) {
+				opt = &cfg->opts[i];
+				break;
 			}
-
-			/* The default value should only be returned if no value
-			 * is given in the configuration file, so we set the RESET
-			 * flag here. When/If cfg_setopt() is called, the value(s)
-			 * will be freed and the flag unset.
-			 */
-			cfg->opts[i].flags |= CFGF_RESET;
-			cfg->opts[i].flags &= ~CFGF_MODIFIED;
-		} else if (!is_set(CFGF_MULTI, cfg->opts[i].flags)) {
-			cfg_setopt(cfg, &cfg->opts[i], NULL);
-			cfg->opts[i].flags |= CFGF_DEFINIT;
 		}
 	}
+	cfg_opt_lazy(opt);
+
+	return opt;
 }
 
-static cfg_opt_t rawsec_no_opts[] = { CFG_END() };
+static cfg_opt_t *cfg_getopt_leaf(cfg_t *cfg, const char *name)
+{
+	return cfg_getopt_leafn(cfg, name, strlen(name));
+}
 
-/* Append an include() function to a section's (already duplicated) option
- * array, so that CFGF_USE_INCLUDE_FUNCTION sections gain include support. */
-static int cfg_section_add_include(cfg_t *sec)
+DLLIMPORT cfg_opt_t *cfg_gethopt(cfg_t *cfg, const char *name, size_t len, uint32_t hash)
 {
-	int num = cfg_numopts(sec->opts);
-	cfg_opt_t *opts;
+	cfg_opt_t *opt = NULL;
+	unsigned int i;
 
-	opts = reallocarray(sec->opts, num + 2, sizeof(cfg_opt_t));
-	if (!opts)
-		return CFG_FAIL;
+	if (!cfg || !name) {
+		errno = EINVAL;
+		return NULL;
+	}
 
-	sec->opts = opts;
-	memset(&sec->opts[num], 0, sizeof(cfg_opt_t));
-	sec->opts[num].name = strdup("include");
-	if (!sec->opts[num].name)
-		return CFG_FAIL;
-	sec->opts[num].type = CFGT_FUNC;
-	sec->opts[num].func = &cfg_include;
+	if (cfg->overlay) {
+		cfg_opt_t *found = NULL;
 
-	memset(&sec->opts[num + 1], 0, sizeof(cfg_opt_t)); /* new CFG_END() */
+		/* Same as cfg_overlay_probe(), for an option of the top level */
+		for (i = cfg->overlay->num; i-- > 0; ) {
+			opt = cfg_gethopt(cfg->overlay->layer[i], name, len, hash);
+			if (!opt)
+				continue;
+			found = opt;
+			if (is_set(CFGF_MODIFIED, opt->flags))
+				break;
+		}
 
-	return CFG_SUCCESS;
+		return found;
+	}
+
+	if (cfg->index) {
+		opt = cfg_index_find(cfg, name, len, hash);
+	} else {
+		for (i = 0; cfg->opts && cfg->opts[i].name; i++) {
+			if (!cfg_namecmp(cfg, cfg->opts[i].name, name, len)) {
+				opt = &cfg->opts[i];
+				break;
+			}
+		}
+	}
+	cfg_opt_lazy(opt);
+
+	return opt;
 }
 
-/*
- * Detect an integer radix prefix, like strtol() base 0 but also handling
- * binary '0b' (see issue #145).  Points *digits at the first digit after
- * any prefix and returns the radix.
- */
-static int cfg_int_radix(const char *value, const char **digits)
+static char *parse_title(const char *name, size_t *len)
 {
-	int radix = 0;
+	const char *escapes = "'\\";
+	char *title;
+	char *end;
+	char *ch;
 
-	*digits = value;
-	if (value[0] == '0') {
-		switch (value[1]) {
-		case 'b':
-			radix = 2;
-			*digits = &value[2];
-			break;
+	if (*name != '\'') {
+		*len = strcspn(name, "|");
+		if (!*len)
+			return NULL;
+		return strndup(name, *len);
+	}
 
-		case 'x':
-			radix = 16;
-			*digits = &value[2];
-			break;
+	title = strdup(name + 1);
+	if (!title)
+		return NULL;
 
+	*len = 1;
+	ch = title;
+	end = title + strlen(title);
+	while (ch < end) {
+		size_t l = strcspn(ch, escapes);
+		*len += l + 1;
+		ch += l;
+		switch (*ch) {
+		case '\'':
+			*ch = 0;
+			return title;
+		case '\\':
+			if (!ch[1] || strcspn(ch + 1, escapes)) {
+				free(title);
+				return NULL;
+			}
+			memmove(ch, ch + 1, strlen(ch));
+			ch++;
+			(*len)++;
+			break;
 		default:
-			radix = 8;
-			*digits = &value[1];
+			free(title);
+			return NULL;
 		}
 	}
 
-	return radix;
+	free(title);
+	return NULL;
 }
 
-DLLIMPORT cfg_value_t *cfg_setopt(cfg_t *cfg, cfg_opt_t *opt, const char *value)
+static long int cfg_opt_gettsecidx(cfg_opt_t *opt, const char *title)
 {
-	cfg_value_t *val = NULL;
-	const char *s;
-	char *endptr;
-	long int i;
-	int64_t i64;
-	uint64_t u64;
-	double f;
-	void *p;
-	int b;
+	unsigned int i, n;
 
-	if (!cfg || !opt) {
-		errno = EINVAL;
-		return NULL;
-	}
+	n = cfg_opt_size(opt);
+	for (i = 0; i < n; i++) {
+		cfg_t *sec = cfg_opt_peeksec(opt, i);
 
-	if (opt->simple_value.ptr) {
-		if (opt->type == CFGT_SEC) {
-			errno = EINVAL;
-			return NULL;
-		}
-		val = (cfg_value_t *)opt->simple_value.ptr;
-	} else {
-		if (is_set(CFGF_RESET, opt->flags)) {
-			cfg_free_value(opt);
-			opt->flags &= ~CFGF_RESET;
+		if (!sec || !sec->title)
+			return -1;
+
+		if (is_set(CFGF_NOCASE, opt->flags)) {
+			if (strcasecmp(title, sec->title) == 0)
+				return i;
+		} else {
+			if (strcmp(title, sec->title) == 0)
+				return i;
 		}
+	}
 
-		if (opt->nvalues == 0 || is_set(CFGF_MULTI, opt->flags) || is_set(CFGF_LIST, opt->flags)) {
-			val = NULL;
+	return -1;
+}
 
-			if ((opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC) && is_set(CFGF_TITLE, opt->flags)) {
-				unsigned int i;
+/*
+ * With rw set, the sections on the path are copied as they are walked,
+ * if they are still shared by a copy, so the option can be changed.
+ */
+static cfg_opt_t *cfg_lookup_secidx(cfg_t *cfg, const char *name,
+				    unsigned int *index, int rw)
+{
+	cfg_opt_t *opt = NULL;
+	cfg_t *sec = cfg;
 
-				/* XXX: Check if there already is a section with the same title. */
+	/* Errors are reported by the bottom layer */
+	if (cfg && cfg->overlay) {
+		opt = cfg_overlay_probe(cfg, name, index);
+		if (opt)
+			return opt;
+		return cfg_lookup_secidx(cfg->overlay->layer[0], name, index, 0);
+	}
 
-				/*
-				 * Check there are either no sections at
-				 * all, or a non-NULL section title.
-				 */
-				if (opt->nvalues != 0 && !value) {
-					errno = EINVAL;
-					return NULL;
-				}
+	if (!cfg || !cfg->name || !name || !*name) {
+		errno = EINVAL;
+		return NULL;
+	}
 
-				for (i = 0; i < opt->nvalues && val == NULL; i++) {
-					cfg_t *sec = opt->values[i]->section;
+	/*
+	 * Most lookups hit, resolve those without allocating and without
+	 * touching errno.  Misses take the long way to report an error.
+	 */
+	opt = cfg_probeopt_secidx(cfg, name, index, rw);
+	if (opt)
+		return opt;
 
-					if (is_set(CFGF_NOCASE, cfg->flags)) {
-						if (strcasecmp(value, sec->title) == 0)
-							val = opt->values[i];
-					} else {
-						if (strcmp(value, sec->title) == 0)
-							val = opt->values[i];
-					}
-				}
+	while (name && *name) {
+		char *title = NULL;
+		long int i = -1;
+		char *secname;
+		size_t len;
 
-				if (val && is_set(CFGF_NO_TITLE_DUPES, opt->flags)) {
-					cfg_error(cfg, _("found duplicate title '%s'"), value);
-					return NULL;
-				}
-			}
+		len = strcspn(name, "|=");
+		if (!index && name[len] == 0 /*len == strlen(name) */ )
+			/* no more subsections */
+			break;
 
-			if (!val) {
-				val = cfg_addval(opt);
-				if (!val)
-					return NULL;
-			}
-		} else {
-			val = opt->values[0];
-		}
-	}
+		if (!len)
+			break;
 
-	switch (opt->type) {
-	case CFGT_INT:
-		if (opt->parsecb) {
-			if ((*opt->parsecb) (cfg, opt, value, &i) != 0)
-				return NULL;
-		} else {
-			const char *str;
-			int radix;
+		secname = strndup(name, len);
+		if (!secname)
+			return NULL;
 
-			if (!value) {
-				errno = EINVAL;
-				return NULL;
-			}
+		do {
+			char *endptr;
 
-			radix = cfg_int_radix(value, &str);
-			i = strtol(str, &endptr, radix);
-			if (*endptr != '\0') {
-				cfg_error(cfg, _("invalid integer value for option '%s'"), opt->name);
-				return NULL;
+			opt = cfg_getopt_leaf(sec, secname);
+			if (!opt || (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC)) {
+				opt = NULL;
+				break;
 			}
-
-			if (errno == ERANGE) {
-				cfg_error(cfg, _("integer value for option '%s' is out of range"), opt->name);
-				return NULL;
+			if (name[len] != '=') {
+				/* non-multi, and backwards compat */
+				i = 0;
+				break;
 			}
-		}
-		val->number = i;
-		break;
-
-	case CFGT_INT8:
-	case CFGT_INT16:
-	case CFGT_INT32:
-	case CFGT_INT64:
-		if (opt->parsecb) {
-			if ((*opt->parsecb) (cfg, opt, value, &i64) != 0)
-				return NULL;
-		} else {
-			const char *str;
-			int radix;
-
-			if (!value) {
-				errno = EINVAL;
-				return NULL;
+			if (!is_set(CFGF_MULTI, opt->flags))
+				break;
+			name += len + 1;
+			title = parse_title(name, &len);
+			if (!title)
+				break;
+			if (is_set(CFGF_TITLE, opt->flags)) {
+				i = cfg_opt_gettsecidx(opt, title);
+				break;
 			}
 
-			radix = cfg_int_radix(value, &str);
 			errno = 0;
-			i64 = strtoll(str, &endptr, radix);
-			if (*endptr != '\0') {
-				cfg_error(cfg, _("invalid integer value for option '%s'"), opt->name);
-				return NULL;
-			}
+			i = strtoul(title, &endptr, 0);
+			if (*endptr != '\0' || errno || i > UINT_MAX)
+				i = -1;
+		} while(0);
 
-			if (errno == ERANGE) {
-				cfg_error(cfg, _("integer value for option '%s' is out of range"), opt->name);
-				return NULL;
-			}
+		if (index)
+			*index = i >= 0 ? i : UINT_MAX;
+
+		if (i < 0)
+			sec = NULL;
+		else
+			sec = rw ? cfg_opt_ownsec(opt, i) : cfg_opt_peeksec(opt, i);
+		if (!sec && !is_set(CFGF_IGNORE_UNKNOWN, cfg->flags)) {
+			if (opt && !is_set(CFGF_MULTI, opt->flags))
+				cfg_error(cfg, _("no such option '%s'"), secname);
+			else if (title)
+				cfg_error(cfg, _("no sub-section '%s' in '%s'"), title, secname);
+			else
+				cfg_error(cfg, _("no sub-section title/index for '%s'"), secname);
 		}
-		{
-			int64_t lo = INT64_MIN, hi = INT64_MAX;
 
-			switch (opt->type) {
-			case CFGT_INT8:  lo = INT8_MIN;  hi = INT8_MAX;  break;
-			case CFGT_INT16: lo = INT16_MIN; hi = INT16_MAX; break;
-			case CFGT_INT32: lo = INT32_MIN; hi = INT32_MAX; break;
-			default:         break;
-			}
+		free(secname);
+		if (title)
+			free(title);
+		if (!sec)
+			return NULL;
 
-			if (i64 < lo || i64 > hi) {
-				cfg_error(cfg, _("integer value for option '%s' is out of range"), opt->name);
-				return NULL;
-			}
+		name += len;
+		name += strspn(name, "|");
+	}
 
-			switch (opt->type) {
-			case CFGT_INT8:  val->i8  = (int8_t)i64;  break;
-			case CFGT_INT16: val->i16 = (int16_t)i64; break;
-			case CFGT_INT32: val->i32 = (int32_t)i64; break;
-			default:         val->i64 = i64;          break;
-			}
-		}
-		break;
+	if (!index) {
+		opt = cfg_getopt_leaf(sec, name);
 
-	case CFGT_UINT8:
-	case CFGT_UINT16:
-	case CFGT_UINT32:
-	case CFGT_UINT64:
-		if (opt->parsecb) {
-			if ((*opt->parsecb) (cfg, opt, value, &u64) != 0)
-				return NULL;
-		} else {
-			const char *str;
-			int radix;
+		if (!opt && !is_set(CFGF_IGNORE_UNKNOWN, cfg->flags) && !is_set(CFGF_KEYSTRVAL, sec->flags))
+			cfg_error(cfg, _("no such option '%s'"), name);
+	}
 
-			if (!value) {
-				errno = EINVAL;
-				return NULL;
-			}
+	return opt;
+}
 
-			if (value[0] == '-') {
-				cfg_error(cfg, _("negative value for unsigned option '%s'"), opt->name);
-				return NULL;
-			}
+/*
+ * Measure the title/index following '=' in a path, i.e. the part
+ * parse_title() would extract, without copying it.  Returns the number
+ * of characters consumed, including any quotes, or 0 if malformed.
+ */
+static size_t cfg_probe_title(const char *name)
+{
+	size_t len;
 
-			radix = cfg_int_radix(value, &str);
-			errno = 0;
-			u64 = strtoull(str, &endptr, radix);
-			if (*endptr != '\0') {
-				cfg_error(cfg, _("invalid integer value for option '%s'"), opt->name);
-				return NULL;
-			}
+	if (*name != '\'')
+		return strcspn(name, "|");
 
-			if (errno == ERANGE) {
-				cfg_error(cfg, _("integer value for option '%s' is out of range"), opt->name);
-				return NULL;
-			}
+	for (len = 1; name[len]; len++) {
+		if (name[len] == '\'')
+			return len + 1;
+		if (name[len] == '\\') {
+			if (name[len + 1] != '\'' && name[len + 1] != '\\')
+				return 0;
+			len++;
 		}
-		{
-			uint64_t max = UINT64_MAX;
+	}
 
-			switch (opt->type) {
-			case CFGT_UINT8:  max = UINT8_MAX;  break;
-			case CFGT_UINT16: max = UINT16_MAX; break;
-			case CFGT_UINT32: max = UINT32_MAX; break;
-			default:          break;
-			}
+	return 0;
+}
 
-			if (u64 > max) {
-				cfg_error(cfg, _("integer value for option '%s' is out of range"), opt->name);
-				return NULL;
-			}
+/* Compare a section title with a (possibly quoted) title from a path */
+static int cfg_probe_titlecmp(const char *title, const char *name, size_t len, int nocase)
+{
+	const char *end = name + len;
+	int quoted = *name == '\'';
 
-			switch (opt->type) {
-			case CFGT_UINT8:  val->u8  = (uint8_t)u64;  break;
-			case CFGT_UINT16: val->u16 = (uint16_t)u64; break;
-			case CFGT_UINT32: val->u32 = (uint32_t)u64; break;
-			default:          val->u64 = u64;           break;
-			}
-		}
-		break;
+	if (quoted) {
+		name++;
+		end--;
+	}
 
-	case CFGT_FLOAT:
-		if (opt->parsecb) {
-			if ((*opt->parsecb) (cfg, opt, value, &f) != 0)
-				return NULL;
-		} else {
-			if (!value) {
-				errno = EINVAL;
-				return NULL;
-			}
-			f = strtod(value, &endptr);
-			if (*endptr != '\0') {
-				cfg_error(cfg, _("invalid floating point value for option '%s'"), opt->name);
-				return NULL;
-			}
-			if (errno == ERANGE) {
-				cfg_error(cfg, _("floating point value for option '%s' is out of range"), opt->name);
-				return NULL;
-			}
-		}
-		val->fpnumber = f;
-		break;
+	while (name < end) {
+		int c = (unsigned char)*name++;
 
-	case CFGT_STR:
-		if (opt->parsecb) {
-			s = NULL;
-			if ((*opt->parsecb) (cfg, opt, value, &s) != 0)
-				return NULL;
-		} else {
-			s = value;
-		}
+		if (quoted && c == '\\')
+			c = (unsigned char)*name++;
+		if (nocase ? tolower(c) != tolower((unsigned char)*title) : c != (unsigned char)*title)
+			return 1;
+		title++;
+	}
 
-		if (!s) {
-			errno = EINVAL;
-			return NULL;
-		}
+	return *title != 0;
+}
 
-		free(val->string);
-		val->string = strdup(s);
-		if (!val->string)
-			return NULL;
-		break;
+static long int cfg_probe_tsecidx(cfg_opt_t *opt, const char *name, size_t len)
+{
+	unsigned int i;
 
-	case CFGT_SEC:
-		if (is_set(CFGF_MULTI, opt->flags) || val->section == NULL) {
-			if (val->section) {
-				val->section->path = NULL; /* Global search path */
-				cfg_free(val->section);
-			}
-			val->section = calloc(1, sizeof(cfg_t));
-			if (!val->section)
-				return NULL;
+	for (i = 0; i < opt->nvalues; i++) {
+		cfg_t *sec = opt->values[i]->section;
 
-			val->section->name = strdup(opt->name);
-			if (!val->section->name) {
-				free(val->section);
-				return NULL;
-			}
+		if (!sec || !sec->title)
+			return -1;
 
-			val->section->flags = cfg->flags;
-			if (is_set(CFGF_KEYSTRVAL, opt->flags))
-				val->section->flags |= CFGF_KEYSTRVAL;
+		if (!cfg_probe_titlecmp(sec->title, name, len, is_set(CFGF_NOCASE, opt->flags | sec->flags)))
+			return i;
+	}
 
-			val->section->filename = cfg->filename ? strdup(cfg->filename) : NULL;
-			if (cfg->filename && !val->section->filename) {
-				free(val->section->name);
-				free(val->section);
-				return NULL;
-			}
+	return -1;
+}
 
-			val->section->line = cfg->line;
-			val->section->errfunc = cfg->errfunc;
-			val->section->title = value ? strdup(value) : NULL;
-			if (value && !val->section->title) {
-				free(val->section->filename);
-				free(val->section->name);
-				free(val->section);
-				return NULL;
-			}
+/* Section index given as a number, like strtoul() base 0 but without errno */
+static long int cfg_probe_nsecidx(const char *name, size_t len)
+{
+	unsigned long val = 0;
+	unsigned int base = 10;
+	size_t i = 0;
 
-			val->section->opts = cfg_dupopt_array(opt->subopts);
-			if (!val->section->opts) {
-				if (val->section->title)
-					free(val->section->title);
-				if (val->section->filename)
-					free(val->section->filename);
-				free(val->section->name);
-				free(val->section);
-				return NULL;
-			}
+	if (*name == '\'') {
+		i++;
+		len--;
+	}
+	if (i >= len)
+		return -1;
 
-			if (is_set(CFGF_USE_INCLUDE_FUNCTION, opt->flags) &&
-			    cfg_section_add_include(val->section) != CFG_SUCCESS)
-				return NULL;
+	if (name[i] == '0' && i + 1 < len) {
+		base = 8;
+		i++;
+		if (name[i] == 'x' || name[i] == 'X') {
+			base = 16;
+			if (++i >= len)
+				return -1;
 		}
-		if (!is_set(CFGF_DEFINIT, opt->flags))
-			cfg_init_defaults(val->section);
-		break;
+	}
 
-	case CFGT_RAWSEC:
-		if (is_set(CFGF_MULTI, opt->flags) || val->section == NULL) {
-			if (val->section) {
-				val->section->path = NULL; /* Global search path */
-				cfg_free(val->section);
-			}
-			val->section = calloc(1, sizeof(cfg_t));
-			if (!val->section)
-				return NULL;
+	for (; i < len; i++) {
+		unsigned int d;
+		int c = (unsigned char)name[i];
 
-			val->section->name = strdup(opt->name);
-			if (!val->section->name) {
-				free(val->section);
-				return NULL;
-			}
+		if (c >= '0' && c <= '9')
+			d = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			d = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			d = c - 'A' + 10;
+		else
+			return -1;
 
-			/* The body is walked by the mini discard parser, so it must ignore. */
-			val->section->flags = cfg->flags | CFGF_IGNORE_UNKNOWN;
-			val->section->filename = cfg->filename ? strdup(cfg->filename) : NULL;
-			if (cfg->filename && !val->section->filename) {
-				free(val->section->name);
-				free(val->section);
-				return NULL;
-			}
+		if (d >= base)
+			return -1;
+		val = val * base + d;
+		if (val > UINT_MAX)
+			return -1;
+	}
 
-			val->section->line = cfg->line;
-			val->section->errfunc = cfg->errfunc;
-			val->section->title = value ? strdup(value) : NULL;
-			if (value && !val->section->title) {
-				free(val->section->filename);
-				free(val->section->name);
-				free(val->section);
-				return NULL;
-			}
+	return (long int)val;
+}
 
-			/* A raw section carries no sub-options, unless it opts in
-			 * to include() via CFGF_USE_INCLUDE_FUNCTION. */
-			val->section->opts = cfg_dupopt_array(rawsec_no_opts);
-			if (!val->section->opts) {
-				free(val->section->title);
-				free(val->section->filename);
-				free(val->section->name);
-				free(val->section);
-				return NULL;
-			}
+/*
+ * Silent and non-allocating version of cfg_getopt_secidx(), used by
+ * cfg_exists() and the cfg_tryget*() family.  A miss simply returns
+ * NULL: no call to cfg_error(), no gettext lookup, no errno.
+ */
+static cfg_opt_t *cfg_probeopt_secidx(cfg_t *cfg, const char *name,
+				      unsigned int *index, int rw)
+{
+	cfg_opt_t *opt = NULL;
+	cfg_t *sec = cfg;
 
-			if (is_set(CFGF_USE_INCLUDE_FUNCTION, opt->flags) &&
-			    cfg_section_add_include(val->section) != CFG_SUCCESS)
-				return NULL;
-		}
-		break;
+	if (cfg && cfg->overlay)
+		return cfg_overlay_probe(cfg, name, index);
 
-	case CFGT_BOOL:
-		if (opt->parsecb) {
-			if ((*opt->parsecb) (cfg, opt, value, &b) != 0)
-				return NULL;
-		} else {
-			b = cfg_parse_boolean(value);
-			if (b == -1) {
-				cfg_error(cfg, _("invalid boolean value for option '%s'"), opt->name);
-				return NULL;
-			}
-		}
-		val->boolean = (cfg_bool_t)b;
-		break;
+	if (!cfg || !cfg->name || !name || !*name)
+		return NULL;
 
-	case CFGT_PTR:
-		if (!opt->parsecb) {
-			errno = EINVAL;
+	while (*name) {
+		long int i = 0;
+		size_t len;
+
+		len = strcspn(name, "|=");
+		if (!index && name[len] == 0)
+			/* no more subsections */
+			break;
+
+		if (!len)
 			return NULL;
-		}
 
-		if ((*opt->parsecb) (cfg, opt, value, &p) != 0)
+		opt = cfg_getopt_leafn(sec, name, len);
+		if (!opt || (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC))
 			return NULL;
-		if (val->ptr && opt->freecb)
-			opt->freecb(val->ptr);
-		val->ptr = p;
-		break;
 
-	default:
-		cfg_error(cfg, "internal error in cfg_setopt(%s, %s)", opt->name, (value) ? (value) : "NULL");
-		return NULL;
-	}
+		if (name[len] == '=') {
+			if (!is_set(CFGF_MULTI, opt->flags))
+				return NULL;
 
-	opt->flags |= CFGF_MODIFIED;
+			name += len + 1;
+			len = cfg_probe_title(name);
+			if (!len)
+				return NULL;
 
-	return val;
-}
+			if (is_set(CFGF_TITLE, opt->flags))
+				i = cfg_probe_tsecidx(opt, name, len);
+			else
+				i = cfg_probe_nsecidx(name, len);
+			if (i < 0)
+				return NULL;
+		}
 
-DLLIMPORT int cfg_opt_setmulti(cfg_t *cfg, cfg_opt_t *opt, unsigned int nvalues, char **values)
-{
-	cfg_opt_t old;
-	unsigned int i;
+		if (!opt->values || (unsigned long)i >= opt->nvalues)
+			return NULL;
 
-	if (!opt || !nvalues) {
-		errno = EINVAL;
-		return CFG_FAIL;
+		if (index)
+			*index = (unsigned int)i;
+
+		sec = rw ? cfg_opt_ownsec(opt, i) : opt->values[i]->section;
+		if (!sec)
+			return NULL;
+
+		name += len;
+		name += strspn(name, "|");
 	}
 
-	old = *opt;
-	opt->nvalues = 0;
-	opt->values = NULL;
+	if (!index)
+		opt = cfg_getopt_leaf(sec, name);
 
-	for (i = 0; i < nvalues; i++) {
-		if (cfg_setopt(cfg, opt, values[i]))
-			continue;
+	return opt;
+}
 
-		/* ouch, revert */
-		cfg_free_value(opt);
-		opt->nvalues = old.nvalues;
-		opt->values = old.values;
-		opt->flags &= ~(CFGF_RESET | CFGF_MODIFIED);
-		opt->flags |= old.flags & (CFGF_RESET | CFGF_MODIFIED);
+/*
+ * The option in the top-most layer where it is set, see CFGF_MODIFIED,
+ * otherwise in the bottom-most layer that has it, with its default.
+ * Paths are looked up in each layer, so an option of a section is
+ * found in a lower layer when the section in the layer above leaves
+ * it at its default.
+ */
+static cfg_opt_t *cfg_overlay_probe(cfg_t *cfg, const char *name, unsigned int *index)
+{
+	struct cfg_overlay *ov = cfg->overlay;
+	cfg_opt_t *opt, *found = NULL;
+	unsigned int i, idx = 0, found_idx = 0;
 
-		return CFG_FAIL;
+	for (i = ov->num; i-- > 0; ) {
+		opt = cfg_probeopt_secidx(ov->layer[i], name, index ? &idx : NULL, 0);
+		if (!opt)
+			continue;
+
+		found = opt;
+		found_idx = idx;
+		if (is_set(CFGF_MODIFIED, opt->flags))
+			break;
 	}
 
-	cfg_free_value(&old);
-	opt->flags |= CFGF_MODIFIED;
+	if (found && index)
+		*index = found_idx;
 
-	return CFG_SUCCESS;
+	return found;
 }
 
-DLLIMPORT int cfg_setmulti(cfg_t *cfg, const char *name, unsigned int nvalues, char **values)
+/*
+ * An overlay has no sections of its own, and those of a single layer
+ * would show values the overlay doesn't have, so the functions that
+ * return or walk its sections fail.  Paths still work, see above.
+ */
+static int cfg_overlay_nosec(cfg_t *cfg)
 {
-	cfg_opt_t *opt;
-
-	if (!cfg || !name || !values) {
+	if (cfg && cfg->overlay) {
 		errno = EINVAL;
-		return CFG_FAIL;
-	}
-
-	opt = cfg_getopt(cfg, name);
-	if (!opt) {
-		errno = ENOENT;
-		return CFG_FAIL;
+		return 1;
 	}
 
-	return cfg_opt_setmulti(cfg, opt, nvalues, values);
+	return 0;
 }
 
-/** An entry in the configuration include search path, see cfg_add_searchpath() */
-struct cfg_searchpath_t {
-	char *dir;	        /**< directory to search */
-	cfg_searchpath_t *next; /**< next in list */
-};
+/* Lookups by name from the API, counted with CFGF_STATS */
+static cfg_opt_t *cfg_getopt_secidx(cfg_t *cfg, const char *name, unsigned int *index, int rw)
+{
+	uint64_t start;
+	cfg_opt_t *opt;
 
-/* prepend a new cfg_searchpath_t to the linked list */
+	if (!cfg || !cfg->stats)
+		return cfg_lookup_secidx(cfg, name, index, rw);
 
-DLLIMPORT int cfg_add_searchpath(cfg_t *cfg, const char *dir)
-{
-	cfg_searchpath_t *p;
-	char *d;
+	start = cfg_stats_now();
+	opt = cfg_lookup_secidx(cfg, name, index, rw);
+	cfg_stats_lookup(cfg, name, opt, cfg_stats_now() - start);
 
-	if (!cfg || !dir) {
-		errno = EINVAL;
-		return CFG_FAIL;
-	}
+	return opt;
+}
 
-	d = cfg_tilde_expand(dir);
-	if (!d)
-		return CFG_FAIL;
+/* Same for the silent lookups of the cfg_tryget*() family */
+static cfg_opt_t *cfg_tryopt_secidx(cfg_t *cfg, const char *name, unsigned int *index)
+{
+	uint64_t start;
+	cfg_opt_t *opt;
 
-	p = malloc(sizeof(cfg_searchpath_t));
-	if (!p) {
-		free(d);
-		return CFG_FAIL;
-	}
+	if (!cfg || !cfg->stats)
+		return cfg_probeopt_secidx(cfg, name, index, 0);
 
-	p->next   = cfg->path;
-	p->dir    = d;
-	cfg->path = p;
+	start = cfg_stats_now();
+	opt = cfg_probeopt_secidx(cfg, name, index, 0);
+	cfg_stats_lookup(cfg, name, opt, cfg_stats_now() - start);
 
-	return CFG_SUCCESS;
+	return opt;
 }
 
-DLLIMPORT cfg_errfunc_t cfg_set_error_function(cfg_t *cfg, cfg_errfunc_t errfunc)
+DLLIMPORT cfg_opt_t *cfg_getnopt(cfg_t *cfg, unsigned int index)
 {
-	cfg_errfunc_t old;
+	unsigned int i;
 
-	if (!cfg) {
-		errno = EINVAL;
+	if (!cfg)
 		return NULL;
-	}
 
-	old = cfg->errfunc;
-	cfg->errfunc = errfunc;
+	for (i = 0; cfg->opts && cfg->opts[i].name; i++) {
+		if (i == index) {
+			cfg_opt_lazy(&cfg->opts[i]);
+			return &cfg->opts[i];
+		}
+	}
 
-	return old;
+	return NULL;
 }
 
-DLLIMPORT cfg_print_filter_func_t cfg_set_print_filter_func(cfg_t *cfg, cfg_print_filter_func_t pff)
+DLLIMPORT cfg_opt_t *cfg_getopt(cfg_t *cfg, const char *name)
 {
-	cfg_print_filter_func_t old;
+	return cfg_getopt_secidx(cfg, name, NULL, 0);
+}
 
-	if (!cfg) {
-		errno = EINVAL;
+/*
+ * Lookups of the functions that change values, overlays are read-only
+ * and sections still shared by a copy are copied on the way
+ */
+static cfg_opt_t *cfg_getopt_rw(cfg_t *cfg, const char *name, unsigned int *index)
+{
+	if (cfg && cfg->overlay) {
+		errno = EPERM;
 		return NULL;
 	}
 
-	old = cfg->pff;
-	cfg->pff = pff;
-
-	return old;
+	return cfg_getopt_secidx(cfg, name, index, 1);
 }
 
-DLLIMPORT void cfg_error(cfg_t *cfg, const char *fmt, ...)
+DLLIMPORT const char *cfg_title(cfg_t *cfg)
 {
-	va_list ap;
+	if (cfg)
+		return cfg->title;
+	return NULL;
+}
 
-	va_start(ap, fmt);
+DLLIMPORT const char *cfg_getraw(cfg_t *cfg)
+{
+	if (cfg)
+		return cfg->raw;
+	return NULL;
+}
 
-	if (cfg && cfg->errfunc)
-		(*cfg->errfunc) (cfg, fmt, ap);
-	else {
-		if (cfg && cfg->filename && cfg->line)
-			fprintf(stderr, "%s:%d: ", cfg->filename, cfg->line);
-		else if (cfg && cfg->filename)
-			fprintf(stderr, "%s: ", cfg->filename);
-		vfprintf(stderr, fmt, ap);
-		fprintf(stderr, "\n");
-	}
+DLLIMPORT const char *cfg_name(cfg_t *cfg)
+{
+	if (cfg)
+		return cfg->name;
+	return NULL;
+}
 
-	va_end(ap);
+DLLIMPORT const char *cfg_opt_name(cfg_opt_t *opt)
+{
+	if (opt)
+		return opt->name;
+	return NULL;
 }
 
-static int call_function(cfg_t *cfg, cfg_opt_t *opt, cfg_opt_t *funcopt)
+DLLIMPORT const char *cfg_opt_getstr(cfg_opt_t *opt)
 {
-	int ret;
-	const char **argv;
-	unsigned int i;
+	return cfg_opt_getnstr(opt, 0);
+}
 
-	if (!cfg || !opt ||!funcopt) {
-		errno = EINVAL;
-		return CFG_FAIL;
-	}
+DLLIMPORT unsigned int cfg_opt_size(cfg_opt_t *opt)
+{
+	struct cfg_lazyopt lo;
 
-	/*
-	 * create am argv string vector and call the registered function
-	 */
-	argv = calloc(funcopt->nvalues, sizeof(char *));
-	if (!argv)
-		return CFG_FAIL;
+	opt = cfg_opt_default(opt, &lo);
+	if (opt)
+		return opt->nvalues;
+	return 0;
+}
 
-	for (i = 0; i < funcopt->nvalues; i++)
-		argv[i] = funcopt->values[i]->string;
+DLLIMPORT unsigned int cfg_size(cfg_t *cfg, const char *name)
+{
+	return cfg_opt_size(cfg_getopt(cfg, name));
+}
 
-	ret = (*opt->func) (cfg, opt, funcopt->nvalues, argv);
-	cfg_free_value(funcopt);
-	free(argv);
+DLLIMPORT char *cfg_opt_getcomment(cfg_opt_t *opt)
+{
+	if (opt)
+		return opt->comment;
 
-	return ret;
+	return NULL;
 }
 
-static void cfg_handle_deprecated(cfg_t *cfg, cfg_opt_t *opt)
+DLLIMPORT char *cfg_getcomment(cfg_t *cfg, const char *name)
 {
-	if (is_set(CFGF_DROP, opt->flags)) {
-		cfg_error(cfg, _("dropping deprecated configuration option '%s'"), opt->name);
-		cfg_free_value(opt);
-	} else {
-		cfg_error(cfg, _("found deprecated option '%s', please update configuration file."), opt->name);
-	}
+	return cfg_opt_getcomment(cfg_getopt(cfg, name));
 }
 
-static int cfg_parse_internal(cfg_t *cfg, int level, int force_state, cfg_opt_t *force_opt)
+DLLIMPORT signed long cfg_opt_getnint(cfg_opt_t *opt, unsigned int index)
 {
-	int state = 0;
-	char *comment = NULL;
-	char *opttitle = NULL;
-	cfg_opt_t *opt = NULL;
-	cfg_value_t *val = NULL;
-	cfg_opt_t funcopt = CFG_STR(NULL, NULL, 0);
-
-	int ignore = 0;		/* ignore until this token, traverse parser w/o error */
-	int num_values = 0;	/* number of values found for a list option */
-	int rc;
-	size_t rawmark = 0;	/* capture offset before a func, for include() expansion */
+	struct cfg_lazyopt lo;
 
-	if (force_state != -1)
-		state = force_state;
-	if (force_opt)
-		opt = force_opt;
+	cfg_stats_read(opt, opt->type == CFGT_INT, index);
+	opt = cfg_opt_default(opt, &lo);
 
-	if (level > CFG_MAX_NESTING_DEPTH) {
-		cfg_error(cfg, _("too deeply nested sections (max %d), "
-				 "bailing out to avoid stack exhaustion"),
-			  CFG_MAX_NESTING_DEPTH);
-		goto error;
+	if (!opt || opt->type != CFGT_INT) {
+		errno = EINVAL;
+		return 0;
 	}
 
-	while (1) {
-		int tok = cfg_yylex(cfg);
-
-		if (tok == 0) {
-			/* lexer.l should have called cfg_error() */
-			goto error;
-		}
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->number;
+	if (opt->simple_value.number)
+		return *opt->simple_value.number;
 
-		if (tok == EOF) {
-			if (state != 0) {
-				cfg_error(cfg, _("premature end of file"));
-				goto error;
-			}
+	return 0;
+}
 
-			if (opt && is_set(CFGF_DEPRECATED, opt->flags))
-				cfg_handle_deprecated(cfg, opt);
+DLLIMPORT signed long cfg_getnint(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnint(cfg_getopt(cfg, name), index);
+}
 
-			if (comment)
-				free(comment);
+DLLIMPORT signed long cfg_getint(cfg_t *cfg, const char *name)
+{
+	return cfg_getnint(cfg, name, 0);
+}
 
-			return STATE_EOF;
-		}
+DLLIMPORT int64_t cfg_opt_getnint64(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
 
-		/*
-		 * A comment may appear between any two tokens, see issue #150.
-		 * Handle it once here (capture when CFGF_COMMENTS is set, else
-		 * skip); the unknown-option discard states (>= 10) do their own.
-		 */
-		if (tok == CFGT_COMMENT && state < 10) {
-			if (is_set(CFGF_COMMENTS, cfg->flags)) {
-				if (comment)
-					free(comment);
-				comment = strdup(cfg_yylval);
-			}
-			continue;
-		}
+	cfg_stats_read(opt, opt->type == CFGT_INT64, index);
+	opt = cfg_opt_default(opt, &lo);
 
-		switch (state) {
-		case 0:	/* expecting an option name */
-			if (opt && is_set(CFGF_DEPRECATED, opt->flags))
-				cfg_handle_deprecated(cfg, opt);
+	if (!opt || opt->type != CFGT_INT64) {
+		errno = EINVAL;
+		return 0;
+	}
 
-			switch (tok) {
-			case '}':
-				if (level == 0) {
-					cfg_error(cfg, _("unexpected closing brace"));
-					goto error;
-				}
-				if (comment)
-					free(comment);
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->i64;
+	if (opt->simple_value.i64)
+		return *opt->simple_value.i64;
 
-				return STATE_EOF;
+	return 0;
+}
 
-			case CFGT_STR:
-				break;
+DLLIMPORT int64_t cfg_getnint64(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnint64(cfg_getopt(cfg, name), index);
+}
 
-			default:
-				cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
-				goto error;
-			}
+DLLIMPORT int64_t cfg_getint64(cfg_t *cfg, const char *name)
+{
+	return cfg_getnint64(cfg, name, 0);
+}
 
-			opt = cfg_getopt(cfg, cfg_yylval);
-			if (!opt) {
-				if (is_set(CFGF_IGNORE_UNKNOWN, cfg->flags)) {
-					state = 10;
-					break;
-				}
+DLLIMPORT uint32_t cfg_opt_getnuint32(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
 
-				/* Not found, is it a dynamic key-value section? */
-				if (is_set(CFGF_KEYSTRVAL, cfg->flags)) {
-					opt = cfg_addopt(cfg, cfg_yylval);
-					if (!opt)
-						goto error;
+	cfg_stats_read(opt, opt->type == CFGT_UINT32, index);
+	opt = cfg_opt_default(opt, &lo);
 
-					state = 1;
-					break;
-				}
+	if (!opt || opt->type != CFGT_UINT32) {
+		errno = EINVAL;
+		return 0;
+	}
 
-				goto error;
-			}
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->u32;
+	if (opt->simple_value.u32)
+		return *opt->simple_value.u32;
 
-			if (opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC) {
-				if (is_set(CFGF_TITLE, opt->flags))
-					state = 6;
-				else
-					state = 5;
-			} else if (opt->type == CFGT_FUNC) {
-				if (cfg_raw_active())
-					rawmark = cfg_raw_tell() - strlen(cfg_yylval);
-				state = 7;
-			} else {
-				state = 1;
-			}
-			break;
+	return 0;
+}
 
-		case 1:	/* expecting an equal sign or plus-equal sign */
-			if (!opt)
-				goto error;
+DLLIMPORT uint32_t cfg_getnuint32(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnuint32(cfg_getopt(cfg, name), index);
+}
 
-			if (tok == '+') {
-				if (!is_set(CFGF_LIST, opt->flags)) {
-					cfg_error(cfg, _("attempt to append to non-list option '%s'"), opt->name);
-					goto error;
-				}
-				/* Even if the reset flag was set by
-				 * cfg_init_defaults, appending to the defaults
-				 * should be ok.
-				 */
-				opt->flags &= ~CFGF_RESET;
-			} else if (tok == '=') {
-				/* set the (temporary) reset flag to clear the old
-				 * values, since we obviously didn't want to append */
-				opt->flags |= CFGF_RESET;
-			} else {
-				cfg_error(cfg, _("missing equal sign after option '%s'"), opt->name);
-				goto error;
-			}
+DLLIMPORT uint32_t cfg_getuint32(cfg_t *cfg, const char *name)
+{
+	return cfg_getnuint32(cfg, name, 0);
+}
 
-			opt->flags |= CFGF_MODIFIED;
+DLLIMPORT uint64_t cfg_opt_getnuint64(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
 
-			if (is_set(CFGF_LIST, opt->flags)) {
-				state = 3;
-				num_values = 0;
-			} else {
-				state = 2;
-			}
-			break;
+	cfg_stats_read(opt, opt->type == CFGT_UINT64, index);
+	opt = cfg_opt_default(opt, &lo);
 
-		case 2:	/* expecting an option value */
-			if (tok == '}' && opt && is_set(CFGF_LIST, opt->flags)) {
-				state = 0;
-				if (num_values == 0 && is_set(CFGF_RESET, opt->flags))
-					/* Reset flags was set, and the empty list was
-					 * specified. Free all old values. */
-					cfg_free_value(opt);
-				break;
-			}
+	if (!opt || opt->type != CFGT_UINT64) {
+		errno = EINVAL;
+		return 0;
+	}
 
-			if (tok != CFGT_STR) {
-				cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
-				goto error;
-			}
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->u64;
+	if (opt->simple_value.u64)
+		return *opt->simple_value.u64;
 
-			if (cfg_setopt(cfg, opt, cfg_yylval) == NULL)
-				goto error;
+	return 0;
+}
 
-			if (opt && opt->validcb && (*opt->validcb) (cfg, opt) != 0)
-				goto error;
+DLLIMPORT uint64_t cfg_getnuint64(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnuint64(cfg_getopt(cfg, name), index);
+}
 
-			/* Inherit last read comment */
-			cfg_opt_setcomment(opt, comment);
-			if (comment)
-				free(comment);
-			comment = NULL;
+DLLIMPORT uint64_t cfg_getuint64(cfg_t *cfg, const char *name)
+{
+	return cfg_getnuint64(cfg, name, 0);
+}
 
-			if (opt && is_set(CFGF_LIST, opt->flags)) {
-				++num_values;
-				state = 4;
-			} else {
-				state = 0;
-			}
-			break;
+DLLIMPORT int8_t cfg_opt_getnint8(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
 
-		case 3:	/* expecting an opening brace for a list option */
-			if (tok != '{') {
-				if (tok != CFGT_STR) {
-					cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
-					goto error;
-				}
+	cfg_stats_read(opt, opt->type == CFGT_INT8, index);
+	opt = cfg_opt_default(opt, &lo);
 
-				if (cfg_setopt(cfg, opt, cfg_yylval) == NULL)
-					goto error;
-				if (opt && opt->validcb && (*opt->validcb) (cfg, opt) != 0)
-					goto error;
-				++num_values;
-				state = 0;
-			} else {
-				state = 2;
-			}
-			break;
+	if (!opt || opt->type != CFGT_INT8) {
+		errno = EINVAL;
+		return 0;
+	}
 
-		case 4:	/* expecting a separator for a list option, or closing (list) brace */
-			if (tok == ',') {
-				state = 2;
-			} else if (tok == '}') {
-				state = 0;
-				if (opt && opt->validcb && (*opt->validcb) (cfg, opt) != 0)
-					goto error;
-			} else {
-				cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
-				goto error;
-			}
-			break;
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->i8;
+	if (opt->simple_value.i8)
+		return *opt->simple_value.i8;
 
-		case 5:	/* expecting an opening brace for a section */
-			if (tok != '{') {
-				cfg_error(cfg, _("missing opening brace for section '%s'"), opt ? opt->name : "");
-				goto error;
-			}
+	return 0;
+}
 
-			val = cfg_setopt(cfg, opt, opttitle);
-			if (!val)
-				goto error;
+DLLIMPORT int8_t cfg_getnint8(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnint8(cfg_getopt(cfg, name), index);
+}
 
-			if (opttitle)
-				free(opttitle);
-			opttitle = NULL;
+DLLIMPORT int8_t cfg_getint8(cfg_t *cfg, const char *name)
+{
+	return cfg_getnint8(cfg, name, 0);
+}
 
-			val->section->path = cfg->path; /* Remember global search path */
-			val->section->line = cfg->line;
-			val->section->errfunc = cfg->errfunc;
+DLLIMPORT int16_t cfg_opt_getnint16(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
 
-			if (opt->type == CFGT_RAWSEC)
-				cfg_raw_begin();
+	cfg_stats_read(opt, opt->type == CFGT_INT16, index);
+	opt = cfg_opt_default(opt, &lo);
 
-			rc = cfg_parse_internal(val->section, level + 1, -1, NULL);
-			if (rc != STATE_EOF) {
-				if (opt->type == CFGT_RAWSEC)
-					cfg_raw_end();
-				goto error;
-			}
+	if (!opt || opt->type != CFGT_INT16) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->i16;
+	if (opt->simple_value.i16)
+		return *opt->simple_value.i16;
+
+	return 0;
+}
+
+DLLIMPORT int16_t cfg_getnint16(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnint16(cfg_getopt(cfg, name), index);
+}
+
+DLLIMPORT int16_t cfg_getint16(cfg_t *cfg, const char *name)
+{
+	return cfg_getnint16(cfg, name, 0);
+}
+
+DLLIMPORT int32_t cfg_opt_getnint32(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
+
+	cfg_stats_read(opt, opt->type == CFGT_INT32, index);
+	opt = cfg_opt_default(opt, &lo);
+
+	if (!opt || opt->type != CFGT_INT32) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->i32;
+	if (opt->simple_value.i32)
+		return *opt->simple_value.i32;
+
+	return 0;
+}
+
+DLLIMPORT int32_t cfg_getnint32(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnint32(cfg_getopt(cfg, name), index);
+}
+
+DLLIMPORT int32_t cfg_getint32(cfg_t *cfg, const char *name)
+{
+	return cfg_getnint32(cfg, name, 0);
+}
+
+DLLIMPORT uint8_t cfg_opt_getnuint8(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
+
+	cfg_stats_read(opt, opt->type == CFGT_UINT8, index);
+	opt = cfg_opt_default(opt, &lo);
+
+	if (!opt || opt->type != CFGT_UINT8) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->u8;
+	if (opt->simple_value.u8)
+		return *opt->simple_value.u8;
+
+	return 0;
+}
+
+DLLIMPORT uint8_t cfg_getnuint8(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnuint8(cfg_getopt(cfg, name), index);
+}
+
+DLLIMPORT uint8_t cfg_getuint8(cfg_t *cfg, const char *name)
+{
+	return cfg_getnuint8(cfg, name, 0);
+}
+
+DLLIMPORT uint16_t cfg_opt_getnuint16(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
+
+	cfg_stats_read(opt, opt->type == CFGT_UINT16, index);
+	opt = cfg_opt_default(opt, &lo);
+
+	if (!opt || opt->type != CFGT_UINT16) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->u16;
+	if (opt->simple_value.u16)
+		return *opt->simple_value.u16;
+
+	return 0;
+}
+
+DLLIMPORT uint16_t cfg_getnuint16(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnuint16(cfg_getopt(cfg, name), index);
+}
+
+DLLIMPORT uint16_t cfg_getuint16(cfg_t *cfg, const char *name)
+{
+	return cfg_getnuint16(cfg, name, 0);
+}
+
+DLLIMPORT double cfg_opt_getnfloat(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
+
+	cfg_stats_read(opt, opt->type == CFGT_FLOAT, index);
+	opt = cfg_opt_default(opt, &lo);
+
+	if (!opt || opt->type != CFGT_FLOAT) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->fpnumber;
+	if (opt->simple_value.fpnumber)
+		return *opt->simple_value.fpnumber;
+
+	return 0;
+}
+
+DLLIMPORT double cfg_getnfloat(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnfloat(cfg_getopt(cfg, name), index);
+}
+
+DLLIMPORT double cfg_getfloat(cfg_t *cfg, const char *name)
+{
+	return cfg_getnfloat(cfg, name, 0);
+}
+
+DLLIMPORT cfg_bool_t cfg_opt_getnbool(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
+
+	cfg_stats_read(opt, opt->type == CFGT_BOOL, index);
+	opt = cfg_opt_default(opt, &lo);
+
+	if (!opt || opt->type != CFGT_BOOL) {
+		errno = EINVAL;
+		return cfg_false;
+	}
+
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->boolean;
+	if (opt->simple_value.boolean)
+		return *opt->simple_value.boolean;
+
+	return cfg_false;
+}
+
+DLLIMPORT cfg_bool_t cfg_getnbool(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnbool(cfg_getopt(cfg, name), index);
+}
+
+DLLIMPORT cfg_bool_t cfg_getbool(cfg_t *cfg, const char *name)
+{
+	return cfg_getnbool(cfg, name, 0);
+}
+
+DLLIMPORT char *cfg_opt_getnstr(cfg_opt_t *opt, unsigned int index)
+{
+	struct cfg_lazyopt lo;
+
+	cfg_stats_read(opt, opt->type == CFGT_STR, index);
+	opt = cfg_opt_default(opt, &lo);
+
+	if (!opt || opt->type != CFGT_STR) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->string;
+	if (opt->simple_value.string)
+		return *opt->simple_value.string;
+
+	return NULL;
+}
+
+DLLIMPORT char *cfg_opt_getnstr_len(cfg_opt_t *opt, unsigned int index, size_t *len)
+{
+	char *str;
+
+	str = cfg_opt_getnstr(opt, index);
+	if (len) {
+		if (opt && opt->values && index < opt->nvalues)
+			*len = cfg_value_strlen(opt, opt->values[index]);
+		else
+			*len = str ? strlen(str) : 0;
+	}
+
+	return str;
+}
+
+DLLIMPORT char *cfg_getnstr_len(cfg_t *cfg, const char *name, unsigned int index, size_t *len)
+{
+	return cfg_opt_getnstr_len(cfg_getopt(cfg, name), index, len);
+}
+
+DLLIMPORT char *cfg_getstr_len(cfg_t *cfg, const char *name, size_t *len)
+{
+	return cfg_getnstr_len(cfg, name, 0, len);
+}
+
+DLLIMPORT char *cfg_getnstr(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnstr(cfg_getopt(cfg, name), index);
+}
+
+DLLIMPORT char *cfg_getstr(cfg_t *cfg, const char *name)
+{
+	return cfg_getnstr(cfg, name, 0);
+}
+
+DLLIMPORT void *cfg_opt_getnptr(cfg_opt_t *opt, unsigned int index)
+{
+	cfg_opt_lazy(opt);
+	cfg_stats_read(opt, opt->type == CFGT_PTR, index);
+
+	if (!opt || opt->type != CFGT_PTR) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index]->ptr;
+	if (opt->simple_value.ptr)
+		return *opt->simple_value.ptr;
+
+	return NULL;
+}
+
+DLLIMPORT void *cfg_getnptr(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_getnptr(cfg_getopt(cfg, name), index);
+}
+
+DLLIMPORT void *cfg_getptr(cfg_t *cfg, const char *name)
+{
+	return cfg_getnptr(cfg, name, 0);
+}
+
+DLLIMPORT cfg_t *cfg_opt_getnsec(cfg_opt_t *opt, unsigned int index)
+{
+	cfg_opt_lazy(opt);
+	cfg_stats_read(opt, opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC, index);
+
+	if (!opt || (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	/* The caller may change it, see cfg_dup() */
+	if (opt->values && index < opt->nvalues)
+		return cfg_opt_ownsec(opt, index);
+
+	errno = ENOENT;
+	return NULL;
+}
+
+DLLIMPORT cfg_t *cfg_getnsec(cfg_t *cfg, const char *name, unsigned int index)
+{
+	if (cfg_overlay_nosec(cfg))
+		return NULL;
+
+	return cfg_opt_getnsec(cfg_getopt_secidx(cfg, name, NULL, 1), index);
+}
+
+DLLIMPORT cfg_t *cfg_opt_gettsec(cfg_opt_t *opt, const char *title)
+{
+	long int i;
+
+	if (!opt || !title) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!is_set(CFGF_TITLE, opt->flags)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	i = cfg_opt_gettsecidx(opt, title);
+	if (i >= 0)
+		return cfg_opt_getnsec(opt, i);
+
+	errno = ENOENT;
+	return NULL;
+}
+
+DLLIMPORT cfg_t *cfg_gettsec(cfg_t *cfg, const char *name, const char *title)
+{
+	if (cfg_overlay_nosec(cfg))
+		return NULL;
+
+	return cfg_opt_gettsec(cfg_getopt_secidx(cfg, name, NULL, 1), title);
+}
+
+DLLIMPORT cfg_t *cfg_getsec(cfg_t *cfg, const char *name)
+{
+	cfg_opt_t *opt;
+	unsigned int index;
+
+	if (cfg_overlay_nosec(cfg))
+		return NULL;
+
+	opt = cfg_getopt_secidx(cfg, name, &index, 1);
+	return cfg_opt_getnsec(opt, index);
+}
+
+DLLIMPORT cfg_bool_t cfg_exists(cfg_t *cfg, const char *name)
+{
+	struct cfg_lazyopt lo;
+	cfg_opt_t *opt;
+	unsigned int index;
+
+	/* A section, possibly given by title or index, or a plain option? */
+	if (cfg_probeopt_secidx(cfg, name, &index, 0))
+		return cfg_true;
+
+	opt = cfg_opt_default(cfg_tryopt_secidx(cfg, name, NULL), &lo);
+	if (!opt)
+		return cfg_false;
+
+	if (opt->simple_value.ptr)
+		return opt->type != CFGT_STR || *opt->simple_value.string ? cfg_true : cfg_false;
+	if (!opt->values || !opt->nvalues)
+		return cfg_false;
+	if (opt->type == CFGT_STR && !is_set(CFGF_LIST, opt->flags) && !opt->values[0]->string)
+		return cfg_false;
+
+	return cfg_true;
+}
+
+DLLIMPORT int cfg_trygetopt(cfg_t *cfg, const char *name, cfg_opt_t **opt)
+{
+	cfg_opt_t *o;
+
+	o = cfg_tryopt_secidx(cfg, name, NULL);
+	if (!o)
+		return CFG_FAIL;
+
+	if (opt)
+		*opt = o;
+
+	return CFG_SUCCESS;
+}
+
+/*
+ * Look up the value cell, or the CFG_SIMPLE_* variable, of a typed
+ * option, or a default not set yet, kept in lo
+ */
+static cfg_value_t *cfg_tryval(cfg_t *cfg, const char *name, cfg_type_t type, unsigned int index,
+			       struct cfg_lazyopt *lo)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_tryopt_secidx(cfg, name, NULL);
+	if (!opt)
+		return NULL;
+
+	cfg_stats_read(opt, opt->type == type, index);
+	opt = cfg_opt_default(opt, lo);
+	if (opt->type != type)
+		return NULL;
+
+	if (opt->values && index < opt->nvalues)
+		return opt->values[index];
+	if (opt->simple_value.ptr && index == 0)
+		return (cfg_value_t *)opt->simple_value.ptr;
+
+	return NULL;
+}
+
+DLLIMPORT int cfg_trygetnint(cfg_t *cfg, const char *name, unsigned int index, long int *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_INT, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->number;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetint(cfg_t *cfg, const char *name, long int *value)
+{
+	return cfg_trygetnint(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnint64(cfg_t *cfg, const char *name, unsigned int index, int64_t *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_INT64, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->i64;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetint64(cfg_t *cfg, const char *name, int64_t *value)
+{
+	return cfg_trygetnint64(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnuint32(cfg_t *cfg, const char *name, unsigned int index, uint32_t *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_UINT32, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->u32;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetuint32(cfg_t *cfg, const char *name, uint32_t *value)
+{
+	return cfg_trygetnuint32(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnuint64(cfg_t *cfg, const char *name, unsigned int index, uint64_t *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_UINT64, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->u64;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetuint64(cfg_t *cfg, const char *name, uint64_t *value)
+{
+	return cfg_trygetnuint64(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnint8(cfg_t *cfg, const char *name, unsigned int index, int8_t *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_INT8, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->i8;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetint8(cfg_t *cfg, const char *name, int8_t *value)
+{
+	return cfg_trygetnint8(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnint16(cfg_t *cfg, const char *name, unsigned int index, int16_t *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_INT16, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->i16;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetint16(cfg_t *cfg, const char *name, int16_t *value)
+{
+	return cfg_trygetnint16(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnint32(cfg_t *cfg, const char *name, unsigned int index, int32_t *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_INT32, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->i32;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetint32(cfg_t *cfg, const char *name, int32_t *value)
+{
+	return cfg_trygetnint32(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnuint8(cfg_t *cfg, const char *name, unsigned int index, uint8_t *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_UINT8, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->u8;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetuint8(cfg_t *cfg, const char *name, uint8_t *value)
+{
+	return cfg_trygetnuint8(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnuint16(cfg_t *cfg, const char *name, unsigned int index, uint16_t *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_UINT16, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->u16;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetuint16(cfg_t *cfg, const char *name, uint16_t *value)
+{
+	return cfg_trygetnuint16(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnfloat(cfg_t *cfg, const char *name, unsigned int index, double *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_FLOAT, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->fpnumber;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetfloat(cfg_t *cfg, const char *name, double *value)
+{
+	return cfg_trygetnfloat(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnbool(cfg_t *cfg, const char *name, unsigned int index, cfg_bool_t *value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_BOOL, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->boolean;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetbool(cfg_t *cfg, const char *name, cfg_bool_t *value)
+{
+	return cfg_trygetnbool(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnstr(cfg_t *cfg, const char *name, unsigned int index, char **value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_STR, index, &lo);
+
+	if (!val || !val->string)
+		return CFG_FAIL;
+	if (value)
+		*value = val->string;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetstr(cfg_t *cfg, const char *name, char **value)
+{
+	return cfg_trygetnstr(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnptr(cfg_t *cfg, const char *name, unsigned int index, void **value)
+{
+	struct cfg_lazyopt lo;
+	cfg_value_t *val = cfg_tryval(cfg, name, CFGT_PTR, index, &lo);
+
+	if (!val)
+		return CFG_FAIL;
+	if (value)
+		*value = val->ptr;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetptr(cfg_t *cfg, const char *name, void **value)
+{
+	return cfg_trygetnptr(cfg, name, 0, value);
+}
+
+DLLIMPORT int cfg_trygetnsec(cfg_t *cfg, const char *name, unsigned int index, cfg_t **sec)
+{
+	cfg_opt_t *opt;
+
+	if (cfg_overlay_nosec(cfg))
+		return CFG_FAIL;
+
+	opt = cfg_tryopt_secidx(cfg, name, NULL);
+	if (!opt || (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC))
+		return CFG_FAIL;
+	if (!opt->values || index >= opt->nvalues)
+		return CFG_FAIL;
+	if (sec)
+		*sec = opt->values[index]->section;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygetsec(cfg_t *cfg, const char *name, cfg_t **sec)
+{
+	cfg_opt_t *opt;
+	unsigned int index;
+
+	if (cfg_overlay_nosec(cfg))
+		return CFG_FAIL;
+
+	opt = cfg_tryopt_secidx(cfg, name, &index);
+	if (!opt)
+		return CFG_FAIL;
+	if (sec)
+		*sec = opt->values[index]->section;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_trygettsec(cfg_t *cfg, const char *name, const char *title, cfg_t **sec)
+{
+	cfg_opt_t *opt;
+	unsigned int i;
+
+	if (cfg_overlay_nosec(cfg))
+		return CFG_FAIL;
+
+	opt = cfg_tryopt_secidx(cfg, name, NULL);
+	if (!opt || !title || !is_set(CFGF_TITLE, opt->flags))
+		return CFG_FAIL;
+
+	for (i = 0; i < opt->nvalues; i++) {
+		cfg_t *s = opt->values[i]->section;
+
+		if (!s || !s->title)
+			return CFG_FAIL;
+
+		if (is_set(CFGF_NOCASE, opt->flags | s->flags) ? strcasecmp(title, s->title) : strcmp(title, s->title))
+			continue;
+
+		if (sec)
+			*sec = s;
+		return CFG_SUCCESS;
+	}
+
+	return CFG_FAIL;
+}
+
+/* Mutating a frozen section fails, see cfg_freeze() */
+static int cfg_frozen(cfg_t *sec)
+{
+	if (sec && is_set(CFGF_FROZEN, sec->flags)) {
+		errno = EPERM;
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Drop the cached fingerprint of a section and all sections above it */
+static void cfg_invalidate(cfg_t *cfg)
+{
+	while (cfg && cfg->fpvalid) {
+		cfg->fpvalid = 0;
+		cfg = cfg->parent;
+	}
+}
+
+/* An option value has changed, see CFGF_MODIFIED and cfg_fingerprint() */
+static void cfg_opt_changed(cfg_opt_t *opt)
+{
+	opt->flags |= CFGF_MODIFIED;
+	cfg_invalidate(opt->sec);
+}
+
+/* Let the options of a section know which section they belong to */
+static void cfg_own_opts(cfg_t *cfg)
+{
+	int i;
+
+	for (i = 0; cfg->opts[i].name; i++)
+		cfg->opts[i].sec = cfg;
+	cfg_index_build(cfg);
+}
+
+/* Size of the values[] array of nvalues > 0, see cfg_addval() */
+static size_t cfg_values_cap(unsigned int nvalues)
+{
+	size_t cap = 1;
+
+	while (cap < nvalues)
+		cap <<= 1;
+
+	return cap;
+}
+
+static cfg_value_t *cfg_addval(cfg_opt_t *opt)
+{
+	unsigned int n = opt->nvalues;
+	size_t size;
+
+	/*
+	 * The array grows in powers of two, so there is room unless
+	 * nvalues is zero or a power of two.  cfg_opt_rmnsec() shrinks
+	 * it again, so its size follows from nvalues.
+	 */
+	if (!opt->values || !(n & (n - 1))) {
+		void *ptr;
+
+		ptr = reallocarray(opt->values, n ? n * 2 : 1, sizeof(cfg_value_t *));
+		if (!ptr)
+			return NULL;
+
+		opt->values = ptr;
+	}
+
+	size = cfg_value_size(opt);
+	opt->values[n] = calloc(1, size);
+	if (!opt->values[n])
+		return NULL;
+
+	cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, 1, size);
+	if (!(n & (n - 1))) {
+		if (n)
+			cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, -1, n * sizeof(cfg_value_t *));
+		cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, 1, (n ? n * 2 : 1) * sizeof(cfg_value_t *));
+	}
+
+	cfg_opt_changed(opt);
+
+	return opt->values[opt->nvalues++];
+}
+
+/*
+ * Give opt its own values before they change, while they are shared
+ * with the tree a copy was made from, see cfg_dup().  Sections stay
+ * shared until they change too, along with their values, so only the
+ * array is copied, see cfg_opt_ownsec().
+ */
+static int cfg_opt_unshare(cfg_opt_t *opt)
+{
+	size_t size = cfg_value_size(opt);
+	unsigned int i, n = opt->nvalues;
+	cfg_value_t **values;
+
+	if (!is_set(CFGF_SHARED, opt->flags))
+		return 0;
+
+	if (!n) {
+		opt->flags &= ~CFGF_SHARED;
+		opt->values = NULL;
+		return 0;
+	}
+
+	values = calloc(cfg_values_cap(n), sizeof(cfg_value_t *));
+	if (!values)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		if (opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC) {
+			values[i] = opt->values[i];
+			continue;
+		}
+
+		values[i] = malloc(size);
+		if (!values[i])
+			goto err;
+		memcpy(values[i], opt->values[i], size);
+		if (opt->type == CFGT_STR && values[i]->string) {
+			values[i]->string = cfg_strdup_sec(opt->sec, CFG_MEMORY_STRINGS, opt->values[i]->string,
+							   ((struct cfg_strval *)values[i])->len);
+			if (!values[i]->string) {
+				free(values[i]);
+				goto err;
+			}
+		}
+		/* Only one of the trees can free it, the one it came from */
+		if (opt->type == CFGT_PTR && values[i]->ptr)
+			((struct cfg_ptrval *)values[i])->borrowed = 1;
+		cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, 1, size);
+	}
+
+	cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, 1, cfg_values_cap(n) * sizeof(cfg_value_t *));
+	opt->flags &= ~CFGF_SHARED;
+	opt->values = values;
+
+	return 0;
+err:
+	while (i-- > 0) {
+		if (opt->type == CFGT_STR)
+			cfg_strfree_sec(opt->sec, CFG_MEMORY_STRINGS, values[i]->string,
+					((struct cfg_strval *)values[i])->len);
+		cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, -1, size);
+		free(values[i]);
+	}
+	free(values);
+
+	return -1;
+}
+
+/* A value of its own for the section at index of opt, instead of a shared one */
+static cfg_value_t *cfg_opt_ownval(cfg_opt_t *opt, unsigned int index, cfg_t *sec)
+{
+	cfg_value_t *val;
+
+	val = calloc(1, sizeof(cfg_value_t));
+	if (!val)
+		return NULL;
+
+	cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, 1, sizeof(cfg_value_t));
+	val->section = sec;
+	opt->values[index] = val;
+
+	return val;
+}
+
+static cfg_opt_t *cfg_addopt(cfg_t *cfg, char *key)
+{
+	int num = cfg_num(cfg);
+	cfg_opt_t *opts;
+
+	opts = reallocarray(cfg->opts, num + 2, sizeof(cfg_opt_t));
+	if (!opts)
+		return NULL;
+
+	/* Write new opt to previous CFG_END() marker */
+	cfg->opts = opts;
+	cfg->opts[num].name = strdup(key);
+	cfg->opts[num].type = CFGT_STR;
+	cfg->opts[num].sec = cfg;
+
+	if (!cfg->opts[num].name) {
+		free(opts);
+		return NULL;
+	}
+	cfg_mem_count(cfg, CFG_MEMORY_OPTIONS, -1, (num + 1) * sizeof(cfg_opt_t));
+	cfg_mem_count(cfg, CFG_MEMORY_OPTIONS, 1, (num + 2) * sizeof(cfg_opt_t));
+	cfg_mem_str(cfg, CFG_MEMORY_OPTIONS, 1, key);
+
+	/* Set new CFG_END() */
+	memset(&cfg->opts[num + 1], 0, sizeof(cfg_opt_t));
+	cfg_index_add(cfg, num);
+	cfg_stats_grow(cfg);
+
+	return &cfg->opts[num];
+}
+
+DLLIMPORT int cfg_numopts(cfg_opt_t *opts)
+{
+	int n;
+
+	for (n = 0; opts && opts[n].name; n++)
+		/* do nothing */ ;
+	return n;
+}
+
+DLLIMPORT unsigned int cfg_num(cfg_t *cfg)
+{
+	if (!cfg)
+		return 0;
+
+	return (unsigned int)cfg_numopts(cfg->opts);
+}
+
+static cfg_opt_t *cfg_dupopt_array(cfg_opt_t *opts)
+{
+	int i;
+	cfg_opt_t *dupopts;
+	int n = cfg_numopts(opts);
+
+	dupopts = calloc(n + 1, sizeof(cfg_opt_t));
+	if (!dupopts)
+		return NULL;
+
+	if (n)
+		memcpy(dupopts, opts, n * sizeof(cfg_opt_t));
+
+	for (i = 0; i < n; i++) {
+		/* Clear dynamic ptrs, protecting the original on failure */
+		dupopts[i].name = NULL;
+		dupopts[i].subopts = NULL;
+		dupopts[i].def.parsed = NULL;
+		dupopts[i].def.string = NULL;
+		dupopts[i].comment = NULL;
+	}
+
+	for (i = 0; i < n; i++) {
+		dupopts[i].name = strdup(opts[i].name);
+		if (!dupopts[i].name)
+			goto err;
+
+		if (opts[i].subopts) {
+			dupopts[i].subopts = cfg_dupopt_array(opts[i].subopts);
+			if (!dupopts[i].subopts)
+				goto err;
+		}
+
+		if (opts[i].def.parsed) {
+			dupopts[i].def.parsed = strdup(opts[i].def.parsed);
+			if (!dupopts[i].def.parsed)
+				goto err;
+		}
+
+		if (opts[i].def.string) {
+			dupopts[i].def.string = strdup(opts[i].def.string);
+			if (!dupopts[i].def.string)
+				goto err;
+		}
+
+		if (opts[i].comment) {
+			dupopts[i].comment = strdup(opts[i].comment);
+			if (!dupopts[i].comment)
+				goto err;
+		}
+	}
+
+	return dupopts;
+err:
+	cfg_free_opt_array(dupopts);
+	return NULL;
+}
+
+DLLIMPORT int cfg_parse_boolean(const char *s)
+{
+	if (!s) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (strcasecmp(s, "true") == 0 || strcasecmp(s, "on") == 0 || strcasecmp(s, "yes") == 0)
+		return 1;
+	if (strcasecmp(s, "false") == 0 || strcasecmp(s, "off") == 0 || strcasecmp(s, "no") == 0)
+		return 0;
+
+	return CFG_FAIL;
+}
+
+/* Set the default value of one option, see cfg_init_defaults() */
+static void cfg_init_default(cfg_t *cfg, cfg_opt_t *opt)
+{
+	/* libConfuse doesn't handle default values for "simple" options */
+	if (opt->simple_value.ptr || is_set(CFGF_NODEFAULT, opt->flags))
+		return;
+
+	if (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC) {
+		opt->flags |= CFGF_DEFINIT;
+
+		if (is_set(CFGF_LIST, opt->flags) || opt->def.parsed) {
+			int xstate, ret = 0;
+			char *buf;
+			FILE *fp;
+
+			/* If it's a list, but no default value was given,
+			 * keep the option uninitialized.
+			 */
+			buf = opt->def.parsed;
+			if (!buf || !buf[0])
+				return;
+
+			/* setup scanning from the string specified for the
+			 * "default" value, force the correct state and option
+			 */
+
+			if (is_set(CFGF_LIST, opt->flags))
+				/* lists must be surrounded by {braces} */
+				xstate = 3;
+			else if (opt->type == CFGT_FUNC)
+				xstate = 0;
+			else
+				xstate = 2;
+
+			fp = fmemopen(buf, strlen(buf), "r");
+			if (!fp) {
+				/*
+				 * fmemopen() on older GLIBC versions do not accept zero
+				 * length buffers for some reason.  This is a workaround.
+				 */
+				if (strlen(buf) > 0)
+					ret = STATE_ERROR;
+			} else {
+				cfg_scan_fp_begin(fp);
+
+				do {
+					ret = cfg_parse_internal(cfg, 1, xstate, opt);
+					xstate = -1;
+				} while (ret == STATE_CONTINUE);
+
+				cfg_scan_fp_end();
+				fclose(fp);
+			}
+
+			if (ret == STATE_ERROR) {
+				/*
+				 * If there was an error parsing the default string,
+				 * the initialization of the default value could be
+				 * inconsistent or empty. What to do? It's a
+				 * programming error and not an end user input
+				 * error. Lets print a message and abort...
+				 */
+				fprintf(stderr, "Parse error in default value '%s'"
+					" for option '%s'\n", opt->def.parsed, opt->name);
+				fprintf(stderr, "Check your initialization macros and the" " libConfuse documentation\n");
+				abort();
+			}
+		} else {
+			switch (opt->type) {
+			case CFGT_INT:
+				cfg_opt_setnint(opt, opt->def.number, 0);
+				break;
+
+			case CFGT_INT8:
+				cfg_opt_setnint8(opt, (int8_t)opt->def.number, 0);
+				break;
+
+			case CFGT_INT16:
+				cfg_opt_setnint16(opt, (int16_t)opt->def.number, 0);
+				break;
+
+			case CFGT_INT32:
+				cfg_opt_setnint32(opt, (int32_t)opt->def.number, 0);
+				break;
+
+			case CFGT_INT64:
+				cfg_opt_setnint64(opt, opt->def.number, 0);
+				break;
+
+			case CFGT_UINT8:
+				cfg_opt_setnuint8(opt, (uint8_t)opt->def.number, 0);
+				break;
+
+			case CFGT_UINT16:
+				cfg_opt_setnuint16(opt, (uint16_t)opt->def.number, 0);
+				break;
+
+			case CFGT_UINT32:
+				cfg_opt_setnuint32(opt, (uint32_t)opt->def.number, 0);
+				break;
+
+			case CFGT_UINT64:
+				cfg_opt_setnuint64(opt, (uint64_t)opt->def.number, 0);
+				break;
+
+			case CFGT_FLOAT:
+				cfg_opt_setnfloat(opt, opt->def.fpnumber, 0);
+				break;
+
+			case CFGT_BOOL:
+				cfg_opt_setnbool(opt, opt->def.boolean, 0);
+				break;
+
+			case CFGT_STR:
+				cfg_opt_setnstr(opt, opt->def.string, 0);
+				break;
+
+			case CFGT_FUNC:
+			case CFGT_PTR:
+				break;
+
+			default:
+				cfg_error(cfg, "internal error in cfg_init_defaults(%s)", opt->name);
+				break;
+			}
+		}
+
+		/* The default value should only be returned if no value
+		 * is given in the configuration file, so we set the RESET
+		 * flag here. When/If cfg_setopt() is called, the value(s)
+		 * will be freed and the flag unset.
+		 */
+		opt->flags |= CFGF_RESET;
+		opt->flags &= ~CFGF_MODIFIED;
+	} else if (!is_set(CFGF_MULTI, opt->flags)) {
+		cfg_setopt(cfg, opt, NULL);
+		opt->flags |= CFGF_DEFINIT;
+	}
+}
+
+/*
+ * With CFGF_LAZY, options with a default that takes work to set, or a
+ * section to create, get it on first use instead.  Functions are left
+ * alone, their default calls them.
+ */
+static int cfg_lazy_default(cfg_opt_t *opt)
+{
+	if (opt->simple_value.ptr || is_set(CFGF_NODEFAULT, opt->flags))
+		return 0;
+
+	switch (opt->type) {
+	case CFGT_FUNC:
+		return 0;
+
+	case CFGT_SEC:
+	case CFGT_RAWSEC:
+		return !is_set(CFGF_MULTI, opt->flags);
+
+	default:
+		break;
+	}
+
+	if (is_set(CFGF_LIST, opt->flags))
+		return opt->def.parsed && opt->def.parsed[0];
+
+	return 1;
+}
+
+static void cfg_init_defaults(cfg_t *cfg)
+{
+	struct cfg_profiler *prof = cfg_profile_of(cfg);
+	cfg_profile_phase_t phase;
+	int i;
+
+	cfg->flags &= ~CFGF_LAZYDEF;
+	phase = cfg_profile_enter(prof, CFG_PROFILE_DEFAULTS);
+	for (i = 0; cfg->opts && cfg->opts[i].name; i++) {
+		int j;
+
+		for (j = 0; j < i; ++j) {
+			if (is_set(CFGF_NOCASE, cfg->opts[i].flags | cfg->opts[j].flags)) {
+				if (strcasecmp(cfg->opts[i].name, cfg->opts[j].name))
+					continue;
+			} else {
+				if (strcmp(cfg->opts[i].name, cfg->opts[j].name))
+					continue;
+			}
+			/*
+			 * There are two definitions of the same option name.
+			 * What to do? It's a programming error and not an end
+			 * user input error. Lets print a message and abort...
+			 */
+			cfg_error(cfg, _("duplicate option '%s' not allowed"),
+				cfg->opts[i].name);
+			break;
+		}
+
+		if (is_set(CFGF_LAZY, cfg->flags) && cfg_lazy_default(&cfg->opts[i])) {
+			cfg->opts[i].flags |= CFGF_LAZYDEF;
+			cfg->flags |= CFGF_LAZYDEF;
+			continue;
+		}
+
+		cfg_init_default(cfg, &cfg->opts[i]);
+	}
+	cfg_profile_leave(prof, phase);
+}
+
+static void cfg_init_lazy(cfg_opt_t *opt)
+{
+	struct cfg_profiler *prof = cfg_profile_of(opt->sec);
+	cfg_profile_phase_t phase;
+
+	opt->flags &= ~CFGF_LAZYDEF;
+	phase = cfg_profile_enter(prof, CFG_PROFILE_DEFAULTS);
+	cfg_init_default(opt->sec, opt);
+	cfg_profile_leave(prof, phase);
+}
+
+/*
+ * Sets the defaults of a section that are set on first use, before it
+ * is frozen, see CFGF_LAZY.  The others are read from opt->def.
+ */
+static void cfg_sec_lazy(cfg_t *sec)
+{
+	int i;
+
+	if (!sec || !is_set(CFGF_LAZYDEF, sec->flags))
+		return;
+
+	sec->flags &= ~CFGF_LAZYDEF;
+	for (i = 0; sec->opts[i].name; i++)
+		cfg_opt_lazy(&sec->opts[i]);
+}
+
+static cfg_opt_t rawsec_no_opts[] = { CFG_END() };
+
+/* Append an include() function to a section's (already duplicated) option
+ * array, so that CFGF_USE_INCLUDE_FUNCTION sections gain include support. */
+static int cfg_section_add_include(cfg_t *sec)
+{
+	int num = cfg_numopts(sec->opts);
+	cfg_opt_t *opts;
+
+	opts = reallocarray(sec->opts, num + 2, sizeof(cfg_opt_t));
+	if (!opts)
+		return CFG_FAIL;
+
+	sec->opts = opts;
+	memset(&sec->opts[num], 0, sizeof(cfg_opt_t));
+	sec->opts[num].name = strdup("include");
+	if (!sec->opts[num].name)
+		return CFG_FAIL;
+	cfg_mem_count(sec, CFG_MEMORY_OPTIONS, -1, (num + 1) * sizeof(cfg_opt_t));
+	cfg_mem_count(sec, CFG_MEMORY_OPTIONS, 1, (num + 2) * sizeof(cfg_opt_t));
+	cfg_mem_str(sec, CFG_MEMORY_OPTIONS, 1, sec->opts[num].name);
+	sec->opts[num].type = CFGT_FUNC;
+	sec->opts[num].func = &cfg_include;
+	sec->opts[num].sec = sec;
+
+	memset(&sec->opts[num + 1], 0, sizeof(cfg_opt_t)); /* new CFG_END() */
+	cfg_index_add(sec, num);
+	cfg_stats_grow(sec);
+
+	return CFG_SUCCESS;
+}
+
+/*
+ * Round-trip formatting of doubles using the Grisu2 algorithm from
+ * Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers", PLDI 2010.  The digits always read back
+ * to the same double and are usually the shortest that do, but not
+ * always: 1e23 prints as 9.999999999999999e22.  The cached powers of
+ * ten are normalized f * 2^e ~= 10^k, for k = -348, -340, ..., 340.
+ */
+typedef struct {
+	uint64_t f;
+	int e;
+} cfg_diyfp_t;
+
+static const uint64_t cfg_pow10_f[] = {
+	UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x8b16fb203055ac76),
+	UINT64_C(0xcf42894a5dce35ea), UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df),
+	UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f), UINT64_C(0xbe5691ef416bd60c),
+	UINT64_C(0x8dd01fad907ffc3c), UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+	UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d), UINT64_C(0x823c12795db6ce57),
+	UINT64_C(0xc21094364dfb5637), UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7),
+	UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5), UINT64_C(0xb23867fb2a35b28e),
+	UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+	UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6), UINT64_C(0xf3e2f893dec3f126),
+	UINT64_C(0xb5b5ada8aaff80b8), UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053),
+	UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd), UINT64_C(0xa6dfbd9fb8e5b88f),
+	UINT64_C(0xf8a95fcf88747d94), UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+	UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac), UINT64_C(0xe45c10c42a2b3b06),
+	UINT64_C(0xaa242499697392d3), UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb),
+	UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c), UINT64_C(0x9c40000000000000),
+	UINT64_C(0xe8d4a51000000000), UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+	UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70), UINT64_C(0xd5d238a4abe98068),
+	UINT64_C(0x9f4f2726179a2245), UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8),
+	UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a), UINT64_C(0x924d692ca61be758),
+	UINT64_C(0xda01ee641a708dea), UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+	UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2), UINT64_C(0xc83553c5c8965d3d),
+	UINT64_C(0x952ab45cfa97a0b3), UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25),
+	UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece), UINT64_C(0x88fcf317f22241e2),
+	UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+	UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0xbb764c4ca7a44410),
+	UINT64_C(0x8bab8eefb6409c1a), UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129),
+	UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429), UINT64_C(0x80444b5e7aa7cf85),
+	UINT64_C(0xbf21e44003acdd2d), UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+	UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9), UINT64_C(0xaf87023b9bf0ee6b)
+};
+
+static const int16_t cfg_pow10_e[] = {
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+	-954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+	-688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+	-422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+	-157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+	109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+	641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+	907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const uint64_t cfg_pow10_u64[] = {
+	UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+	UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+	UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+	UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+	UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+	UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+	UINT64_C(10000000000000000000)
+};
+
+static cfg_diyfp_t cfg_diyfp_mul(cfg_diyfp_t x, cfg_diyfp_t y)
+{
+	const uint64_t M32 = 0xFFFFFFFF;
+	uint64_t a = x.f >> 32, b = x.f & M32, c = y.f >> 32, d = y.f & M32;
+	uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+	cfg_diyfp_t r;
+
+	tmp += UINT64_C(1) << 31;	/* round */
+	r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+	r.e = x.e + y.e + 64;
+
+	return r;
+}
+
+static void cfg_grisu_round(char *buf, int len, uint64_t delta, uint64_t rest,
+			    uint64_t ten_kappa, uint64_t wp_w)
+{
+	while (rest < wp_w && delta - rest >= ten_kappa &&
+	       (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+		buf[len - 1]--;
+		rest += ten_kappa;
+	}
+}
+
+static int cfg_grisu_digits(cfg_diyfp_t w, cfg_diyfp_t mp, uint64_t delta, char *buf, int *K)
+{
+	uint64_t one = UINT64_C(1) << -mp.e;
+	uint64_t wp_w = mp.f - w.f;
+	uint32_t p1 = (uint32_t)(mp.f >> -mp.e);
+	uint64_t p2 = mp.f & (one - 1);
+	int kappa, len = 0;
+
+	for (kappa = 10; kappa > 1 && p1 < cfg_pow10_u64[kappa - 1]; kappa--)
+		;
+
+	while (kappa > 0) {
+		uint32_t d = p1 / (uint32_t)cfg_pow10_u64[kappa - 1];
+		uint64_t rest;
+
+		p1 %= (uint32_t)cfg_pow10_u64[kappa - 1];
+		if (d || len)
+			buf[len++] = (char)('0' + d);
+		kappa--;
+
+		rest = ((uint64_t)p1 << -mp.e) + p2;
+		if (rest <= delta) {
+			*K += kappa;
+			cfg_grisu_round(buf, len, delta, rest, cfg_pow10_u64[kappa] << -mp.e, wp_w);
+			return len;
+		}
+	}
+
+	for (;;) {
+		char d;
+
+		p2 *= 10;
+		delta *= 10;
+		d = (char)(p2 >> -mp.e);
+		if (d || len)
+			buf[len++] = (char)('0' + d);
+		p2 &= one - 1;
+		kappa--;
+
+		if (p2 < delta) {
+			*K += kappa;
+			cfg_grisu_round(buf, len, delta, p2, one, -kappa < 20 ? wp_w * cfg_pow10_u64[-kappa] : 0);
+			return len;
+		}
+	}
+}
+
+/* Digits of a finite, positive value, which is digits * 10^K */
+static int cfg_grisu2(uint64_t bits, char *buf, int *K)
+{
+	cfg_diyfp_t v, w, mp, mm, c;
+	int biased = (int)((bits >> 52) & 0x7FF);
+	unsigned int idx;
+	double dk;
+	int k;
+
+	v.f = bits & ((UINT64_C(1) << 52) - 1);
+	if (biased) {
+		v.f += UINT64_C(1) << 52;
+		v.e = biased - 1075;
+	} else {
+		v.e = -1074;
+	}
+
+	/* Upper and lower boundary, normalized to the same exponent */
+	mp.f = (v.f << 1) + 1;
+	mp.e = v.e - 1;
+	while (!(mp.f & (UINT64_C(1) << 53))) {
+		mp.f <<= 1;
+		mp.e--;
+	}
+	mp.f <<= 10;
+	mp.e -= 10;
+
+	if (v.f == UINT64_C(1) << 52) {
+		mm.f = (v.f << 2) - 1;
+		mm.e = v.e - 2;
+	} else {
+		mm.f = (v.f << 1) - 1;
+		mm.e = v.e - 1;
+	}
+	mm.f <<= mm.e - mp.e;
+	mm.e = mp.e;
+
+	w = v;
+	while (!(w.f & (UINT64_C(1) << 63))) {
+		w.f <<= 1;
+		w.e--;
+	}
+
+	/* Scale by a cached 10^-k so the product exponent is in [-60, -32] */
+	dk = (-61 - mp.e) * 0.30102999566398114 + 347;
+	k = (int)dk;
+	if (k != dk)
+		k++;
+	idx = (unsigned int)((k >> 3) + 1);
+	*K = -(-348 + (int)idx * 8);
+	c.f = cfg_pow10_f[idx];
+	c.e = cfg_pow10_e[idx];
+
+	w = cfg_diyfp_mul(w, c);
+	mp = cfg_diyfp_mul(mp, c);
+	mm = cfg_diyfp_mul(mm, c);
+	mm.f++;
+	mp.f--;
+
+	return cfg_grisu_digits(w, mp, mp.f - mm.f, buf, K);
+}
+
+/*
+ * Format a double with the fewest digits that read back to the same
+ * value, using only characters the lexer accepts in an unquoted value,
+ * i.e., no '+' in the exponent.  Integral values get a ".0" suffix to
+ * still look like a float.  The buffer must hold at least 32 bytes.
+ */
+static size_t cfg_dtoa(double value, char *out)
+{
+	char digits[24];
+	char *p = out;
+	uint64_t bits;
+	int len, K, kk, i;
+
+	memcpy(&bits, &value, sizeof(bits));
+	if (((bits >> 52) & 0x7FF) == 0x7FF && (bits & ((UINT64_C(1) << 52) - 1))) {
+		memcpy(out, "nan", 4);
+		return 3;
+	}
+
+	if (bits >> 63) {
+		*p++ = '-';
+		bits &= ~(UINT64_C(1) << 63);
+	}
+
+	if (((bits >> 52) & 0x7FF) == 0x7FF) {
+		memcpy(p, "inf", 4);
+		return p + 3 - out;
+	}
+
+	if (!bits) {
+		memcpy(p, "0.0", 4);
+		return p + 3 - out;
+	}
+
+	len = cfg_grisu2(bits, digits, &K);
+	kk = len + K;		/* 10^(kk-1) <= value < 10^kk */
+
+	if (kk > 0 && kk <= 17) {
+		if (K >= 0) {
+			memcpy(p, digits, len);
+			p += len;
+			for (i = 0; i < K; i++)
+				*p++ = '0';
+			*p++ = '.';
+			*p++ = '0';
+		} else {
+			memcpy(p, digits, kk);
+			p += kk;
+			*p++ = '.';
+			memcpy(p, digits + kk, len - kk);
+			p += len - kk;
+		}
+	} else if (kk <= 0 && kk > -5) {
+		*p++ = '0';
+		*p++ = '.';
+		for (i = kk; i < 0; i++)
+			*p++ = '0';
+		memcpy(p, digits, len);
+		p += len;
+	} else {
+		int exp10 = kk - 1;
+
+		*p++ = digits[0];
+		if (len > 1) {
+			*p++ = '.';
+			memcpy(p, digits + 1, len - 1);
+			p += len - 1;
+		}
+		*p++ = 'e';
+		if (exp10 < 0) {
+			*p++ = '-';
+			exp10 = -exp10;
+		}
+		if (exp10 >= 100)
+			*p++ = (char)('0' + exp10 / 100);
+		if (exp10 >= 10)
+			*p++ = (char)('0' + exp10 / 10 % 10);
+		*p++ = (char)('0' + exp10 % 10);
+	}
+	*p = 0;
+
+	return p - out;
+}
+
+/*
+ * Locale independent strtod().  Plain decimal numbers with at most 19
+ * significant digits and a small exponent are converted exactly with a
+ * single multiplication or division (Clinger's fast path).  Anything
+ * else goes to strtod(), with the '.' swapped for the decimal point of
+ * the current locale.
+ */
+static double cfg_strtod(const char *str, char **endptr)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const char *p = str, *dp;
+	char tmp[64], *copy, *end;
+	uint64_t mant = 0;
+	int ndigits = 0, exp10 = 0, truncated = 0, neg = 0;
+	size_t len, dplen, i, j;
+	double v;
+
+	if (*p == '-' || *p == '+')
+		neg = *p++ == '-';
+	if (!(isdigit((unsigned char)*p) || (*p == '.' && isdigit((unsigned char)p[1]))) ||
+	    (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')))
+		return strtod(str, endptr);	/* inf, nan, hex, or invalid */
+
+	for (; isdigit((unsigned char)*p); p++) {
+		if (ndigits < 19) {
+			mant = mant * 10 + (*p - '0');
+			if (mant)
+				ndigits++;
+		} else {
+			exp10++;
+			truncated |= *p != '0';
+		}
+	}
+	if (*p == '.') {
+		for (p++; isdigit((unsigned char)*p); p++) {
+			if (ndigits < 19) {
+				mant = mant * 10 + (*p - '0');
+				if (mant)
+					ndigits++;
+				exp10--;
+			} else {
+				truncated |= *p != '0';
+			}
+		}
+	}
+	if ((*p == 'e' || *p == 'E') &&
+	    (isdigit((unsigned char)p[1]) ||
+	     ((p[1] == '-' || p[1] == '+') && isdigit((unsigned char)p[2])))) {
+		int eneg = 0, e = 0;
+
+		p++;
+		if (*p == '-' || *p == '+')
+			eneg = *p++ == '-';
+		for (; isdigit((unsigned char)*p); p++) {
+			if (e < 100000)
+				e = e * 10 + (*p - '0');
+		}
+		exp10 += eneg ? -e : e;
+	}
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+	if (!truncated && mant <= UINT64_C(1) << 53) {
+		v = (double)mant;
+		if (mant && exp10 > 22 && exp10 <= 22 + 15 &&
+		    mant * cfg_pow10_u64[exp10 - 22] / cfg_pow10_u64[exp10 - 22] == mant &&
+		    mant * cfg_pow10_u64[exp10 - 22] <= UINT64_C(1) << 53) {
+			v = (double)(mant * cfg_pow10_u64[exp10 - 22]);
+			exp10 = 22;
+		}
+		if (!mant)
+			exp10 = 0;	/* +-0.0, whatever the exponent */
+
+		if (exp10 >= -22 && exp10 <= 22) {
+			if (exp10 > 0)
+				v *= pow10[exp10];
+			else if (exp10 < 0)
+				v /= pow10[-exp10];
+			if (endptr)
+				*endptr = (char *)p;
+
+			return neg ? -v : v;
+		}
+	}
+#endif
+
+	dp = localeconv()->decimal_point;
+	if (!dp || !strcmp(dp, "."))
+		return strtod(str, endptr);
+
+	dplen = strlen(dp);
+	len = p - str;
+	copy = tmp;
+	if (len + dplen >= sizeof(tmp)) {
+		copy = malloc(len + dplen);
+		if (!copy) {
+			if (endptr)
+				*endptr = (char *)str;
+			return 0;
+		}
+	}
+
+	for (i = j = 0; i < len; i++) {
+		if (str[i] == '.') {
+			memcpy(copy + j, dp, dplen);
+			j += dplen;
+		} else {
+			copy[j++] = str[i];
+		}
+	}
+	copy[j] = 0;
+
+	v = strtod(copy, &end);
+	if (endptr)
+		*endptr = (char *)(end == copy + j ? p : str);
+	if (copy != tmp)
+		free(copy);
+
+	return v;
+}
+
+/*
+ * Parse an integer in decimal, hex '0x', octal '0', or binary '0b' (see
+ * issue #145), with optional sign.  The range [min, max] is checked as
+ * the digits are accumulated, so a single pass both validates the input
+ * and the target width.  Negative results are returned two's complement
+ * in *result.  On error errno is set to EINVAL for malformed input, or
+ * ERANGE if the value does not fit, and CFG_FAIL is returned.
+ */
+static int cfg_strtoint(const char *str, int64_t min, uint64_t max, uint64_t *result)
+{
+	unsigned int base = 10, d;
+	uint64_t val = 0, limit, cutoff;
+	int neg = 0, overflow = 0;
+	const char *digits;
+
+	while (isspace((unsigned char)*str))
+		str++;
+	if (*str == '-' || *str == '+')
+		neg = *str++ == '-';
+
+	if (str[0] == '0') {
+		switch (str[1]) {
+		case 'b':
+			base = 2;
+			str += 2;
+			break;
+
+		case 'x':
+		case 'X':
+			base = 16;
+			str += 2;
+			break;
+
+		default:
+			base = 8;
+			break;
+		}
+	}
+
+	limit = neg ? (uint64_t)0 - (uint64_t)min : max;
+	cutoff = limit / base;
+
+	for (digits = str; ; str++) {
+		unsigned int c = (unsigned char)*str;
+
+		if (c - '0' < 10)
+			d = c - '0';
+		else if ((c | 0x20) - 'a' < 6)
+			d = (c | 0x20) - 'a' + 10;
+		else
+			break;
+		if (d >= base)
+			break;
+
+		if (val > cutoff || (val == cutoff && d > limit - cutoff * base))
+			overflow = 1;
+		else
+			val = val * base + d;
+	}
+
+	if (*str || str == digits) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (overflow) {
+		errno = ERANGE;
+		return CFG_FAIL;
+	}
+
+	*result = neg ? (uint64_t)0 - val : val;
+
+	return CFG_SUCCESS;
+}
+
+/* Range of the integer types, CFGT_INT64 for the rest */
+static void cfg_int_range(cfg_type_t type, int64_t *min, uint64_t *max)
+{
+	switch (type) {
+	case CFGT_INT:    *min = LONG_MIN;  *max = LONG_MAX;   break;
+	case CFGT_INT8:   *min = INT8_MIN;  *max = INT8_MAX;   break;
+	case CFGT_INT16:  *min = INT16_MIN; *max = INT16_MAX;  break;
+	case CFGT_INT32:  *min = INT32_MIN; *max = INT32_MAX;  break;
+	case CFGT_UINT8:  *min = 0;         *max = UINT8_MAX;  break;
+	case CFGT_UINT16: *min = 0;         *max = UINT16_MAX; break;
+	case CFGT_UINT32: *min = 0;         *max = UINT32_MAX; break;
+	case CFGT_UINT64: *min = 0;         *max = UINT64_MAX; break;
+	default:          *min = INT64_MIN; *max = INT64_MAX;  break;
+	}
+}
+
+/* Parse an integer option value into *result, with the range of the type */
+static int cfg_setopt_int(cfg_t *cfg, cfg_opt_t *opt, const char *value, uint64_t *result)
+{
+	int64_t min;
+	uint64_t max;
+
+	cfg_int_range(opt->type, &min, &max);
+	if (!value) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (min == 0 && value[0] == '-') {
+		cfg_error(cfg, _("negative value for unsigned option '%s'"), opt->name);
+		return CFG_FAIL;
+	}
+
+	if (cfg_strtoint(value, min, max, result)) {
+		if (errno == ERANGE)
+			cfg_error(cfg, _("integer value for option '%s' is out of range"), opt->name);
+		else
+			cfg_error(cfg, _("invalid integer value for option '%s'"), opt->name);
+		return CFG_FAIL;
+	}
+
+	return CFG_SUCCESS;
+}
+
+/*
+ * The value cell a new value of opt goes to: a new one for lists and
+ * multi-sections, the section with the same title, or the only one.
+ */
+static cfg_value_t *cfg_setopt_slot(cfg_t *cfg, cfg_opt_t *opt, const char *value)
+{
+	cfg_value_t *val = NULL;
+
+	cfg_opt_lazyset(opt);
+	if (opt->simple_value.ptr) {
+		if (opt->type == CFGT_SEC) {
+			errno = EINVAL;
+			return NULL;
+		}
+		val = (cfg_value_t *)opt->simple_value.ptr;
+	} else {
+		if (is_set(CFGF_RESET, opt->flags)) {
+			cfg_free_value(opt);
+			opt->flags &= ~CFGF_RESET;
+		}
+		if (cfg_opt_unshare(opt))
+			return NULL;
+
+		if (opt->nvalues == 0 || is_set(CFGF_MULTI, opt->flags) || is_set(CFGF_LIST, opt->flags)) {
+			val = NULL;
+
+			if ((opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC) && is_set(CFGF_TITLE, opt->flags)) {
+				unsigned int i;
+
+				/* XXX: Check if there already is a section with the same title. */
+
+				/*
+				 * Check there are either no sections at
+				 * all, or a non-NULL section title.
+				 */
+				if (opt->nvalues != 0 && !value) {
+					errno = EINVAL;
+					return NULL;
+				}
+
+				for (i = 0; i < opt->nvalues && val == NULL; i++) {
+					cfg_t *sec = opt->values[i]->section;
+
+					if (is_set(CFGF_NOCASE, cfg->flags)) {
+						if (strcasecmp(value, sec->title) == 0)
+							val = opt->values[i];
+					} else {
+						if (strcmp(value, sec->title) == 0)
+							val = opt->values[i];
+					}
+				}
+
+				if (val && is_set(CFGF_NO_TITLE_DUPES, opt->flags)) {
+					cfg_error(cfg, _("found duplicate title '%s'"), value);
+					return NULL;
+				}
+
+				/* Replaced, not changed, so it isn't copied */
+				if (val && cfg_shared(opt, val->section)) {
+					val = cfg_opt_ownval(opt, i - 1, NULL);
+					if (!val)
+						return NULL;
+				}
+			}
+
+			if (!val) {
+				val = cfg_addval(opt);
+				if (!val)
+					return NULL;
+			}
+		} else {
+			/* A shared section is copied into a new value first */
+			if ((opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC) && !cfg_opt_ownsec(opt, 0))
+				return NULL;
+			val = opt->values[0];
+		}
+	}
+
+	return val;
+}
+
+/* Same as cfg_setopt(), len is the length of string values */
+static cfg_value_t *cfg_setopt_len(cfg_t *cfg, cfg_opt_t *opt, const char *value, size_t len)
+{
+	cfg_value_t *val;
+	cfg_profile_t *profile;
+	const char *s;
+	char *str;
+	char *endptr;
+	long int i;
+	int64_t i64;
+	uint64_t u64;
+	double f;
+	void *p;
+	int b;
+
+	if (!cfg || !opt) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (cfg_frozen(cfg) || cfg_frozen(opt->sec))
+		return NULL;
+
+	val = cfg_setopt_slot(cfg, opt, value);
+	if (!val)
+		return NULL;
+
+	switch (opt->type) {
+	case CFGT_INT:
+		if (opt->parsecb) {
+			if ((*opt->parsecb) (cfg, opt, value, &i) != 0)
+				return NULL;
+		} else {
+			if (cfg_setopt_int(cfg, opt, value, &u64))
+				return NULL;
+			i = (long int)(int64_t)u64;
+		}
+		val->number = i;
+		break;
+
+	case CFGT_INT8:
+	case CFGT_INT16:
+	case CFGT_INT32:
+	case CFGT_INT64:
+		if (opt->parsecb) {
+			if ((*opt->parsecb) (cfg, opt, value, &i64) != 0)
+				return NULL;
+		} else {
+			if (cfg_setopt_int(cfg, opt, value, &u64))
+				return NULL;
+			i64 = (int64_t)u64;
+		}
+		{
+			int64_t lo = INT64_MIN, hi = INT64_MAX;
+
+			switch (opt->type) {
+			case CFGT_INT8:  lo = INT8_MIN;  hi = INT8_MAX;  break;
+			case CFGT_INT16: lo = INT16_MIN; hi = INT16_MAX; break;
+			case CFGT_INT32: lo = INT32_MIN; hi = INT32_MAX; break;
+			default:         break;
+			}
+
+			if (i64 < lo || i64 > hi) {
+				cfg_error(cfg, _("integer value for option '%s' is out of range"), opt->name);
+				return NULL;
+			}
+
+			switch (opt->type) {
+			case CFGT_INT8:  val->i8  = (int8_t)i64;  break;
+			case CFGT_INT16: val->i16 = (int16_t)i64; break;
+			case CFGT_INT32: val->i32 = (int32_t)i64; break;
+			default:         val->i64 = i64;          break;
+			}
+		}
+		break;
+
+	case CFGT_UINT8:
+	case CFGT_UINT16:
+	case CFGT_UINT32:
+	case CFGT_UINT64:
+		if (opt->parsecb) {
+			if ((*opt->parsecb) (cfg, opt, value, &u64) != 0)
+				return NULL;
+		} else {
+			if (cfg_setopt_int(cfg, opt, value, &u64))
+				return NULL;
+		}
+		{
+			uint64_t max = UINT64_MAX;
+
+			switch (opt->type) {
+			case CFGT_UINT8:  max = UINT8_MAX;  break;
+			case CFGT_UINT16: max = UINT16_MAX; break;
+			case CFGT_UINT32: max = UINT32_MAX; break;
+			default:          break;
+			}
+
+			if (u64 > max) {
+				cfg_error(cfg, _("integer value for option '%s' is out of range"), opt->name);
+				return NULL;
+			}
+
+			switch (opt->type) {
+			case CFGT_UINT8:  val->u8  = (uint8_t)u64;  break;
+			case CFGT_UINT16: val->u16 = (uint16_t)u64; break;
+			case CFGT_UINT32: val->u32 = (uint32_t)u64; break;
+			default:          val->u64 = u64;           break;
+			}
+		}
+		break;
+
+	case CFGT_FLOAT:
+		if (opt->parsecb) {
+			if ((*opt->parsecb) (cfg, opt, value, &f) != 0)
+				return NULL;
+		} else {
+			if (!value) {
+				errno = EINVAL;
+				return NULL;
+			}
+			errno = 0;
+			f = cfg_strtod(value, &endptr);
+			if (*endptr != '\0') {
+				cfg_error(cfg, _("invalid floating point value for option '%s'"), opt->name);
+				return NULL;
+			}
+			/* Subnormals are fine, only overflow and underflow to zero is not */
+			if (errno == ERANGE && (f == 0 || f > DBL_MAX || f < -DBL_MAX)) {
+				cfg_error(cfg, _("floating point value for option '%s' is out of range"), opt->name);
+				return NULL;
+			}
+		}
+		val->fpnumber = f;
+		break;
+
+	case CFGT_STR:
+		if (opt->parsecb) {
+			s = NULL;
+			if ((*opt->parsecb) (cfg, opt, value, &s) != 0)
+				return NULL;
+		} else {
+			s = value;
+		}
+
+		if (!s) {
+			errno = EINVAL;
+			return NULL;
+		}
+		if (s != value)
+			len = strlen(s);
+
+		str = cfg_value_strdup(opt, val, s, len);
+		if (!str)
+			return NULL;
+		cfg_value_setstr(opt, val, str, len);
+		break;
+
+	case CFGT_SEC:
+		if (is_set(CFGF_MULTI, opt->flags) || val->section == NULL) {
+			if (val->section) {
+				val->section->path = NULL; /* Global search path */
+				cfg_free(val->section);
+			}
+			val->section = calloc(1, sizeof(cfg_t));
+			if (!val->section)
+				return NULL;
+			val->section->parent = cfg;
+
+			val->section->name = strdup(opt->name);
+			if (!val->section->name) {
+				free(val->section);
+				return NULL;
+			}
+			val->section->memtype = cfg_memtype_get(cfg, opt->name);
+
+			val->section->flags = cfg->flags;
+			if (is_set(CFGF_KEYSTRVAL, opt->flags))
+				val->section->flags |= CFGF_KEYSTRVAL;
+
+			val->section->filename = cfg->filename ? strdup(cfg->filename) : NULL;
+			if (cfg->filename && !val->section->filename) {
+				free(val->section->name);
+				free(val->section);
+				return NULL;
+			}
+
+			val->section->line = cfg->line;
+			val->section->errfunc = cfg->errfunc;
+			val->section->title = value ? cfg_strdup_sec(val->section, CFG_MEMORY_TITLES, value, strlen(value)) : NULL;
+			if (value && !val->section->title) {
+				free(val->section->filename);
+				free(val->section->name);
+				free(val->section);
+				return NULL;
+			}
+
+			val->section->opts = cfg_dupopt_array(opt->subopts);
+			if (!val->section->opts) {
+				cfg_strfree_sec(val->section, CFG_MEMORY_TITLES, val->section->title, value ? strlen(value) : 0);
+				if (val->section->filename)
+					free(val->section->filename);
+				free(val->section->name);
+				free(val->section);
+				return NULL;
+			}
+			cfg_own_opts(val->section);
+			cfg_mem_section(val->section, 1);
+			cfg_stats_new(val->section);
+			if ((profile = cfg_profile_rec(cfg_profile_of(cfg))) != NULL)
+				profile->sections++;
+
+			if (is_set(CFGF_USE_INCLUDE_FUNCTION, opt->flags) &&
+			    cfg_section_add_include(val->section) != CFG_SUCCESS)
+				return NULL;
+		}
+		if (!is_set(CFGF_DEFINIT, opt->flags))
+			cfg_init_defaults(val->section);
+		break;
+
+	case CFGT_RAWSEC:
+		if (is_set(CFGF_MULTI, opt->flags) || val->section == NULL) {
+			if (val->section) {
+				val->section->path = NULL; /* Global search path */
+				cfg_free(val->section);
+			}
+			val->section = calloc(1, sizeof(cfg_t));
+			if (!val->section)
+				return NULL;
+			val->section->parent = cfg;
+
+			val->section->name = strdup(opt->name);
+			if (!val->section->name) {
+				free(val->section);
+				return NULL;
+			}
+			val->section->memtype = cfg_memtype_get(cfg, opt->name);
+
+			/* The body is walked by the mini discard parser, so it must ignore. */
+			val->section->flags = cfg->flags | CFGF_IGNORE_UNKNOWN;
+			val->section->filename = cfg->filename ? strdup(cfg->filename) : NULL;
+			if (cfg->filename && !val->section->filename) {
+				free(val->section->name);
+				free(val->section);
+				return NULL;
+			}
+
+			val->section->line = cfg->line;
+			val->section->errfunc = cfg->errfunc;
+			val->section->title = value ? cfg_strdup_sec(val->section, CFG_MEMORY_TITLES, value, strlen(value)) : NULL;
+			if (value && !val->section->title) {
+				free(val->section->filename);
+				free(val->section->name);
+				free(val->section);
+				return NULL;
+			}
+
+			/* A raw section carries no sub-options, unless it opts in
+			 * to include() via CFGF_USE_INCLUDE_FUNCTION. */
+			val->section->opts = cfg_dupopt_array(rawsec_no_opts);
+			if (!val->section->opts) {
+				cfg_strfree_sec(val->section, CFG_MEMORY_TITLES, val->section->title, value ? strlen(value) : 0);
+				free(val->section->filename);
+				free(val->section->name);
+				free(val->section);
+				return NULL;
+			}
+			cfg_own_opts(val->section);
+			cfg_mem_section(val->section, 1);
+			cfg_stats_new(val->section);
+			if ((profile = cfg_profile_rec(cfg_profile_of(cfg))) != NULL)
+				profile->sections++;
+
+			if (is_set(CFGF_USE_INCLUDE_FUNCTION, opt->flags) &&
+			    cfg_section_add_include(val->section) != CFG_SUCCESS)
+				return NULL;
+		}
+		break;
+
+	case CFGT_BOOL:
+		if (opt->parsecb) {
+			if ((*opt->parsecb) (cfg, opt, value, &b) != 0)
+				return NULL;
+		} else {
+			b = cfg_parse_boolean(value);
+			if (b == -1) {
+				cfg_error(cfg, _("invalid boolean value for option '%s'"), opt->name);
+				return NULL;
+			}
+		}
+		val->boolean = (cfg_bool_t)b;
+		break;
+
+	case CFGT_PTR:
+		if (!opt->parsecb) {
+			errno = EINVAL;
+			return NULL;
+		}
+
+		if ((*opt->parsecb) (cfg, opt, value, &p) != 0)
+			return NULL;
+		if (val->ptr && opt->freecb && !((struct cfg_ptrval *)val)->borrowed)
+			opt->freecb(val->ptr);
+		((struct cfg_ptrval *)val)->borrowed = 0;
+		val->ptr = p;
+		break;
+
+	default:
+		cfg_error(cfg, "internal error in cfg_setopt(%s, %s)", opt->name, (value) ? (value) : "NULL");
+		return NULL;
+	}
+
+	cfg_opt_changed(opt);
+
+	return val;
+}
+
+DLLIMPORT cfg_value_t *cfg_setopt(cfg_t *cfg, cfg_opt_t *opt, const char *value)
+{
+	return cfg_setopt_len(cfg, opt, value, value ? strlen(value) : 0);
+}
+
+DLLIMPORT int cfg_opt_setmulti(cfg_t *cfg, cfg_opt_t *opt, unsigned int nvalues, char **values)
+{
+	cfg_opt_t old;
+	unsigned int i;
+
+	if (!opt || !nvalues) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (cfg_frozen(opt->sec))
+		return CFG_FAIL;
+
+	old = *opt;
+	opt->nvalues = 0;
+	opt->values = NULL;
+
+	for (i = 0; i < nvalues; i++) {
+		if (cfg_setopt(cfg, opt, values[i]))
+			continue;
+
+		/* ouch, revert */
+		cfg_free_value(opt);
+		opt->nvalues = old.nvalues;
+		opt->values = old.values;
+		opt->flags &= ~(CFGF_RESET | CFGF_MODIFIED | CFGF_SHARED);
+		opt->flags |= old.flags & (CFGF_RESET | CFGF_MODIFIED | CFGF_SHARED);
+
+		return CFG_FAIL;
+	}
+
+	old.comment = NULL;	/* Kept by opt */
+	cfg_free_value(&old);
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setmulti(cfg_t *cfg, const char *name, unsigned int nvalues, char **values)
+{
+	cfg_opt_t *opt;
+
+	if (!cfg || !name || !values) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (!opt) {
+		errno = ENOENT;
+		return CFG_FAIL;
+	}
+
+	return cfg_opt_setmulti(cfg, opt, nvalues, values);
+}
+
+/** An entry in the configuration include search path, see cfg_add_searchpath() */
+struct cfg_searchpath_t {
+	char *dir;	        /**< directory to search */
+	cfg_searchpath_t *next; /**< next in list */
+};
+
+/* prepend a new cfg_searchpath_t to the linked list */
+
+DLLIMPORT int cfg_add_searchpath(cfg_t *cfg, const char *dir)
+{
+	cfg_searchpath_t *p;
+	char *d;
+
+	if (!cfg || !dir) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	d = cfg_tilde_expand(dir);
+	if (!d)
+		return CFG_FAIL;
+
+	p = malloc(sizeof(cfg_searchpath_t));
+	if (!p) {
+		free(d);
+		return CFG_FAIL;
+	}
+
+	p->next   = cfg->path;
+	p->dir    = d;
+	cfg->path = p;
+	cfg_mem_count(cfg, CFG_MEMORY_PATHS, 1, sizeof(*p));
+	cfg_mem_str(cfg, CFG_MEMORY_PATHS, 1, d);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT cfg_errfunc_t cfg_set_error_function(cfg_t *cfg, cfg_errfunc_t errfunc)
+{
+	cfg_errfunc_t old;
+
+	if (!cfg) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	old = cfg->errfunc;
+	cfg->errfunc = errfunc;
+
+	return old;
+}
+
+DLLIMPORT cfg_print_filter_func_t cfg_set_print_filter_func(cfg_t *cfg, cfg_print_filter_func_t pff)
+{
+	cfg_print_filter_func_t old;
+
+	if (!cfg) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	old = cfg->pff;
+	cfg->pff = pff;
+
+	return old;
+}
+
+static void cfg_verror(cfg_t *cfg, const char *fmt, va_list ap)
+{
+	if (cfg && cfg->errfunc)
+		(*cfg->errfunc) (cfg, fmt, ap);
+	else {
+		if (cfg && cfg->filename && cfg->line)
+			fprintf(stderr, "%s:%d: ", cfg->filename, cfg->line);
+		else if (cfg && cfg->filename)
+			fprintf(stderr, "%s: ", cfg->filename);
+		vfprintf(stderr, fmt, ap);
+		fprintf(stderr, "\n");
+	}
+}
+
+DLLIMPORT void cfg_error(cfg_t *cfg, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	cfg_verror(cfg, fmt, ap);
+	va_end(ap);
+}
+
+static int call_function(cfg_t *cfg, cfg_opt_t *opt, cfg_opt_t *funcopt)
+{
+	struct cfg_profiler *prof;
+	cfg_profile_phase_t phase;
+	int ret;
+	const char **argv;
+	unsigned int i;
+
+	if (!cfg || !opt ||!funcopt) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	/*
+	 * create am argv string vector and call the registered function
+	 */
+	argv = calloc(funcopt->nvalues, sizeof(char *));
+	if (!argv)
+		return CFG_FAIL;
+
+	for (i = 0; i < funcopt->nvalues; i++)
+		argv[i] = funcopt->values[i]->string;
+
+	prof = cfg_profile_of(cfg);
+	phase = cfg_profile_enter(prof, CFG_PROFILE_CALLBACK);
+	ret = (*opt->func) (cfg, opt, funcopt->nvalues, argv);
+	cfg_profile_leave(prof, phase);
+	cfg_free_value(funcopt);
+	free(argv);
+
+	return ret;
+}
+
+static void cfg_handle_deprecated(cfg_t *cfg, cfg_opt_t *opt)
+{
+	if (is_set(CFGF_DROP, opt->flags)) {
+		cfg_error(cfg, _("dropping deprecated configuration option '%s'"), opt->name);
+		cfg_free_value(opt);
+	} else {
+		cfg_error(cfg, _("found deprecated option '%s', please update configuration file."), opt->name);
+	}
+}
+
+/* Set a value read by the parser, and count it with CFGF_PROFILE */
+static cfg_value_t *cfg_parse_setopt(cfg_t *cfg, cfg_opt_t *opt, const char *value, size_t len,
+				     struct cfg_profiler *prof)
+{
+	cfg_profile_phase_t phase;
+	cfg_profile_t *profile;
+	cfg_value_t *val;
+
+	phase = cfg_profile_enter(prof, CFG_PROFILE_SETOPT);
+	val = cfg_setopt_len(cfg, opt, value, len);
+	cfg_profile_leave(prof, phase);
+
+	if (val && opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC &&
+	    (profile = cfg_profile_input(prof)) != NULL)
+		profile->options++;
+
+	return val;
+}
+
+/* Call the validation callback of opt, if any, returns non-zero on error */
+static int cfg_parse_validate(cfg_t *cfg, cfg_opt_t *opt, struct cfg_profiler *prof)
+{
+	cfg_profile_phase_t phase;
+	int rc;
+
+	if (!opt || !opt->validcb)
+		return 0;
+
+	phase = cfg_profile_enter(prof, CFG_PROFILE_CALLBACK);
+	rc = (*opt->validcb) (cfg, opt);
+	cfg_profile_leave(prof, phase);
+
+	return rc;
+}
+
+static int cfg_parse_internal(cfg_t *cfg, int level, int force_state, cfg_opt_t *force_opt)
+{
+	int state = 0;
+	char *comment = NULL;
+	char *opttitle = NULL;
+	cfg_opt_t *opt = NULL;
+	cfg_value_t *val = NULL;
+	cfg_opt_t funcopt = CFG_STR(NULL, NULL, 0);
+	struct cfg_profiler *prof = cfg_profile_of(cfg);
+	cfg_profile_phase_t phase;
+	cfg_profile_t *profile;
+
+	int ignore = 0;		/* ignore until this token, traverse parser w/o error */
+	int num_values = 0;	/* number of values found for a list option */
+	int rc;
+	size_t rawmark = 0;	/* capture offset before a func, for include() expansion */
+
+	if (force_state != -1)
+		state = force_state;
+	if (force_opt)
+		opt = force_opt;
+
+	if (level > CFG_MAX_NESTING_DEPTH) {
+		cfg_error(cfg, _("too deeply nested sections (max %d), "
+				 "bailing out to avoid stack exhaustion"),
+			  CFG_MAX_NESTING_DEPTH);
+		goto error;
+	}
+
+	while (1) {
+		int tok;
+
+		phase = cfg_profile_enter(prof, CFG_PROFILE_LEX);
+		tok = cfg_yylex(cfg);
+		cfg_profile_leave(prof, phase);
+
+		if (tok == 0) {
+			/* lexer.l should have called cfg_error() */
+			goto error;
+		}
+
+		if (tok == EOF) {
+			if (state != 0) {
+				cfg_error(cfg, _("premature end of file"));
+				goto error;
+			}
+
+			if (opt && is_set(CFGF_DEPRECATED, opt->flags))
+				cfg_handle_deprecated(cfg, opt);
+
+			if (comment)
+				free(comment);
+
+			return STATE_EOF;
+		}
+
+		if ((profile = cfg_profile_input(prof)) != NULL)
+			profile->tokens++;
+
+		/*
+		 * A comment may appear between any two tokens, see issue #150.
+		 * Handle it once here (capture when CFGF_COMMENTS is set, else
+		 * skip); the unknown-option discard states (>= 10) do their own.
+		 */
+		if (tok == CFGT_COMMENT && state < 10) {
+			if (is_set(CFGF_COMMENTS, cfg->flags)) {
+				if (comment)
+					free(comment);
+				comment = strdup(cfg_yylval);
+			}
+			continue;
+		}
+
+		switch (state) {
+		case 0:	/* expecting an option name */
+			if (opt && is_set(CFGF_DEPRECATED, opt->flags))
+				cfg_handle_deprecated(cfg, opt);
+
+			switch (tok) {
+			case '}':
+				if (level == 0) {
+					cfg_error(cfg, _("unexpected closing brace"));
+					goto error;
+				}
+				if (comment)
+					free(comment);
+
+				return STATE_EOF;
+
+			case CFGT_STR:
+				break;
+
+			default:
+				cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
+				goto error;
+			}
+
+			/* Not counted with CFGF_STATS */
+			opt = cfg_lookup_secidx(cfg, cfg_yylval, NULL, 1);
+			if (!opt) {
+				if (is_set(CFGF_IGNORE_UNKNOWN, cfg->flags)) {
+					state = 10;
+					break;
+				}
+
+				/* Not found, is it a dynamic key-value section? */
+				if (is_set(CFGF_KEYSTRVAL, cfg->flags)) {
+					opt = cfg_addopt(cfg, cfg_yylval);
+					if (!opt)
+						goto error;
+
+					state = 1;
+					break;
+				}
+
+				goto error;
+			}
+
+			if (opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC) {
+				if (is_set(CFGF_TITLE, opt->flags))
+					state = 6;
+				else
+					state = 5;
+			} else if (opt->type == CFGT_FUNC) {
+				if (cfg_raw_active())
+					rawmark = cfg_raw_tell() - strlen(cfg_yylval);
+				state = 7;
+			} else {
+				state = 1;
+			}
+			break;
+
+		case 1:	/* expecting an equal sign or plus-equal sign */
+			if (!opt)
+				goto error;
+
+			if (tok == '+') {
+				if (!is_set(CFGF_LIST, opt->flags)) {
+					cfg_error(cfg, _("attempt to append to non-list option '%s'"), opt->name);
+					goto error;
+				}
+				/* Even if the reset flag was set by
+				 * cfg_init_defaults, appending to the defaults
+				 * should be ok.
+				 */
+				opt->flags &= ~CFGF_RESET;
+			} else if (tok == '=') {
+				/* set the (temporary) reset flag to clear the old
+				 * values, since we obviously didn't want to append */
+				opt->flags |= CFGF_RESET;
+			} else {
+				cfg_error(cfg, _("missing equal sign after option '%s'"), opt->name);
+				goto error;
+			}
+
+			cfg_opt_changed(opt);
+
+			if (is_set(CFGF_LIST, opt->flags)) {
+				state = 3;
+				num_values = 0;
+			} else {
+				state = 2;
+			}
+			break;
+
+		case 2:	/* expecting an option value */
+			if (tok == '}' && opt && is_set(CFGF_LIST, opt->flags)) {
+				state = 0;
+				if (num_values == 0 && is_set(CFGF_RESET, opt->flags))
+					/* Reset flags was set, and the empty list was
+					 * specified. Free all old values. */
+					cfg_free_value(opt);
+				break;
+			}
+
+			if (tok != CFGT_STR) {
+				cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
+				goto error;
+			}
+
+			if (cfg_parse_setopt(cfg, opt, cfg_yylval, cfg_yylval_len(), prof) == NULL)
+				goto error;
+
+			if (cfg_parse_validate(cfg, opt, prof))
+				goto error;
+
+			/* Inherit last read comment */
+			cfg_opt_setcomment(opt, comment);
+			if (comment)
+				free(comment);
+			comment = NULL;
+
+			if (opt && is_set(CFGF_LIST, opt->flags)) {
+				++num_values;
+				state = 4;
+			} else {
+				state = 0;
+			}
+			break;
+
+		case 3:	/* expecting an opening brace for a list option */
+			if (tok != '{') {
+				if (tok != CFGT_STR) {
+					cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
+					goto error;
+				}
+
+				if (cfg_parse_setopt(cfg, opt, cfg_yylval, cfg_yylval_len(), prof) == NULL)
+					goto error;
+				if (cfg_parse_validate(cfg, opt, prof))
+					goto error;
+				++num_values;
+				state = 0;
+			} else {
+				state = 2;
+			}
+			break;
+
+		case 4:	/* expecting a separator for a list option, or closing (list) brace */
+			if (tok == ',') {
+				state = 2;
+			} else if (tok == '}') {
+				state = 0;
+				if (cfg_parse_validate(cfg, opt, prof))
+					goto error;
+			} else {
+				cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
+				goto error;
+			}
+			break;
+
+		case 5:	/* expecting an opening brace for a section */
+			if (tok != '{') {
+				cfg_error(cfg, _("missing opening brace for section '%s'"), opt ? opt->name : "");
+				goto error;
+			}
+
+			val = cfg_parse_setopt(cfg, opt, opttitle, opttitle ? strlen(opttitle) : 0, prof);
+			if (!val)
+				goto error;
+
+			if (opttitle)
+				free(opttitle);
+			opttitle = NULL;
+
+			val->section->path = cfg->path; /* Remember global search path */
+			val->section->line = cfg->line;
+			val->section->errfunc = cfg->errfunc;
+
+			if (opt->type == CFGT_RAWSEC)
+				cfg_raw_begin();
+
+			rc = cfg_parse_internal(val->section, level + 1, -1, NULL);
+			if (rc != STATE_EOF) {
+				if (opt->type == CFGT_RAWSEC)
+					cfg_raw_end();
+				goto error;
+			}
+
+			if (opt->type == CFGT_RAWSEC) {
+				cfg_mem_str(val->section, CFG_MEMORY_RAW, -1, val->section->raw);
+				free(val->section->raw);
+				val->section->raw = strdup(cfg_raw_end());
+				if (!val->section->raw)
+					goto error;
+				cfg_mem_str(val->section, CFG_MEMORY_RAW, 1, val->section->raw);
+			}
+
+			cfg->line = val->section->line;
+			if (cfg_parse_validate(cfg, opt, prof))
+				goto error;
+			state = 0;
+			break;
+
+		case 6:	/* expecting a title for a section */
+			if (tok != CFGT_STR) {
+				cfg_error(cfg, _("missing title for section '%s'"), opt ? opt->name : "");
+				goto error;
+			} else {
+				opttitle = strdup(cfg_yylval);
+				if (!opttitle)
+					goto error;
+			}
+			state = 5;
+			break;
+
+		case 7:	/* expecting an opening parenthesis for a function */
+			if (tok != '(') {
+				cfg_error(cfg, _("missing parenthesis for function '%s'"), opt ? opt->name : "");
+				goto error;
+			}
+			state = 8;
+			break;
+
+		case 8:	/* expecting a function parameter or a closing paren */
+			if (tok == ')') {
+				if (call_function(cfg, opt, &funcopt))
+					goto error;
+				/* Replace an include() call
+				 * by its expanded content
+				 * in the raw capture*/
+				if (cfg_raw_active() && opt && opt->func == cfg_include)
+					cfg_raw_seek(rawmark);
+				state = 0;
+			} else if (tok == CFGT_STR) {
+				val = cfg_addval(&funcopt);
+				if (!val)
+					goto error;
+
+				val->string = strdup(cfg_yylval);
+				if (!val->string)
+					goto error;
+
+				state = 9;
+			} else {
+				cfg_error(cfg, _("syntax error in call of function '%s'"), opt ? opt->name : "");
+				goto error;
+			}
+			break;
+
+		case 9:	/* expecting a comma in a function or a closing paren */
+			if (tok == ')') {
+				if (call_function(cfg, opt, &funcopt))
+					goto error;
+				/* Replace an include() call
+				 * by its expanded content
+				 * in the raw capture*/
+				if (cfg_raw_active() && opt && opt->func == cfg_include)
+					cfg_raw_seek(rawmark);
+				state = 0;
+			} else if (tok == ',') {
+				state = 8;
+			} else {
+				cfg_error(cfg, _("syntax error in call of function '%s'"), opt ? opt->name : "");
+				goto error;
+			}
+			break;
+
+		case 10: /* unknown option, mini-discard parser states: 10-15 */
+			if (comment) {
+				free(comment);
+				comment = NULL;
+			}
+
+			if (tok == '+') {
+				ignore = '=';
+				state = 13; /* Append to list, should be followed by '=' */
+			} else if (tok == '=') {
+				ignore = 0;
+				state = 14; /* Assignment, regular handling */
+			} else if (tok == '(') {
+				ignore = ')';
+				state = 13; /* Function, ignore until end of param list */
+			} else if (tok == '{') {
+				state = 12; /* Section, ignore all until closing brace */
+			} else if (tok == CFGT_STR) {
+				state = 11; /* No '=' ... must be a titled section */
+			} else if (tok == '}') {
+				if (comment)
+					free(comment);
+
+				return force_state >= 10 ? STATE_CONTINUE : STATE_EOF;
+			}
+			break;
+
+		case 11: /* unknown option, expecting start of title section */
+			if (tok != '{') {
+				cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
+				goto error;
+			}
+			state = 12;
+			break;
+
+		case 12: /* unknown option, recursively ignore entire sub-section */
+			if (tok == '}') {
+				state = force_state >= 10 ? 15 : 0;
+				break;
+			} else if (tok == CFGT_COMMENT) {
+				state = 15;
+				rc = cfg_parse_internal(cfg, level + 1, 15, NULL);
+				if (rc != STATE_CONTINUE)
+					goto error;
+				break;
+			} else {
+				rc = cfg_parse_internal(cfg, level + 1, 10, NULL);
+				if (rc != STATE_CONTINUE)
+					goto error;
+				state = force_state >= 10 ? 15 : 0;
+			}
+			break;
+
+		case 13: /* unknown option, consume tokens silently until end of func/list */
+			if (tok != ignore)
+				break;
+
+			if (ignore == '=') {
+				ignore = 0;
+				state = 14;
+				break;
+			}
+
+			ignore = 0;
+			state = force_state >= 10 ? 15 : 0;
+			break;
+
+		case 14: /* unknown option, assuming value or start of list */
+			if (tok == '{') {
+				ignore = '}';
+				state = 13;
+				break;
+			}
+
+			if (tok != CFGT_STR) {
+				cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
+				goto error;
+			}
+
+			ignore = 0;
+			state = force_state >= 10 ? 15 : 0;
+			break;
+
+		case 15: /* unknown option, dummy read of next parameter in sub-section */
+			if (tok == CFGT_COMMENT)
+				continue;
+			else if (tok == '}')
+				return force_state >= 10 ? STATE_CONTINUE : STATE_EOF;
+			state = 10;
+			break;
+
+		default:
+			cfg_error(cfg, _("Internal error in cfg_parse_internal(), unknown state %d"), state);
+			goto error;
+		}
+	}
+
+	if (comment)
+		free(comment);
+
+	return STATE_EOF;
+
+error:
+	if (opttitle)
+		free(opttitle);
+	if (comment)
+		free(comment);
+
+	return STATE_ERROR;
+}
+
+/* Parse fp, of size bytes if known, profiled with CFGF_PROFILE */
+static int cfg_parse_stream(cfg_t *cfg, FILE *fp, uint64_t bytes)
+{
+	struct cfg_profiler *prof;
+	int ret, rec;
+
+	if (!cfg || !fp) {
+		errno = EINVAL;
+		return CFG_PARSE_ERROR;
+	}
+
+	if (cfg_frozen(cfg))
+		return CFG_FAIL;
+
+	if (!cfg->filename)
+		cfg_set_filename(cfg, strdup("FILE"));
+	if (!cfg->filename)
+		return CFG_PARSE_ERROR;
+
+	prof = cfg_profile_of(cfg);
+	if (prof && !bytes)
+		bytes = cfg_profile_fsize(fp);
+	rec = cfg_profile_begin(prof, cfg->filename, bytes);
+
+	cfg->line = 1;
+	cfg_scan_fp_begin(fp);
+	ret = cfg_parse_internal(cfg, 0, -1, NULL);
+	cfg_scan_fp_end();
+	cfg_profile_end(prof, rec);
+	if (ret == STATE_ERROR)
+		return CFG_PARSE_ERROR;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_parse_fp(cfg_t *cfg, FILE *fp)
+{
+	return cfg_parse_stream(cfg, fp, 0);
+}
+
+static char *cfg_make_fullpath(const char *dir, const char *file)
+{
+	int np;
+	char *path;
+	size_t len;
+
+	if (!dir || !file) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	len = strlen(dir) + strlen(file) + 2;
+	path = malloc(len);
+	if (!path)
+		return NULL;
+
+	np = snprintf(path, len, "%s/%s", dir, file);
+
+	/*
+	 * np is the number of characters that would have
+	 * been printed if there was enough room in path.
+	 * if np >= n then the snprintf() was truncated
+	 * (which must be a bug).
+	 */
+	assert(np < (int)len);
+
+	return path;
+}
+
+DLLIMPORT char *cfg_searchpath(cfg_searchpath_t *p, const char *file)
+{
+	char *fullpath;
+#ifdef HAVE_SYS_STAT_H
+	struct stat st;
+	int err;
+#endif
+
+	if (!p || !file) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (file[0] == '/') {
+		fullpath = strdup(file);
+		if (!fullpath)
+			return NULL;
+		goto check;
+	}
+
+	if ((fullpath = cfg_searchpath(p->next, file)) != NULL)
+		return fullpath;
+
+	if ((fullpath = cfg_make_fullpath(p->dir, file)) == NULL)
+		return NULL;
+
+check:
+#ifdef HAVE_SYS_STAT_H
+	err = stat((const char *)fullpath, &st);
+	if ((!err) && S_ISREG(st.st_mode))
+		return fullpath;
+#else
+	/* needs an alternative check here for win32 */
+#endif
+
+	free(fullpath);
+	return NULL;
+}
+
+DLLIMPORT int cfg_parse(cfg_t *cfg, const char *filename)
+{
+	int ret;
+	char *fn;
+	FILE *fp;
+
+	if (!cfg || !filename) {
+		errno = EINVAL;
+		return CFG_FILE_ERROR;
+	}
+
+	if (cfg_frozen(cfg))
+		return CFG_FAIL;
+
+	if (cfg->path)
+		fn = cfg_searchpath(cfg->path, filename);
+	else
+		fn = cfg_tilde_expand(filename);
+	if (!fn)
+		return CFG_FILE_ERROR;
+
+	cfg_set_filename(cfg, fn);
+
+	fp = fopen(cfg->filename, "r");
+	if (!fp)
+		return CFG_FILE_ERROR;
+	cfg_watch_add(cfg, cfg->filename);
+
+	ret = cfg_parse_fp(cfg, fp);
+	fclose(fp);
+
+	return ret;
+}
+
+DLLIMPORT int cfg_parse_buf(cfg_t *cfg, const char *buf)
+{
+	int ret;
+	char *fn;
+	FILE *fp;
+
+	if (!cfg) {
+		errno = EINVAL;
+		return CFG_PARSE_ERROR;
+	}
+
+	if (cfg_frozen(cfg))
+		return CFG_FAIL;
+
+	if (!buf)
+		return CFG_SUCCESS;
+
+	fn = strdup("[buf]");
+	if (!fn)
+		return CFG_PARSE_ERROR;
+
+	cfg_set_filename(cfg, fn);
+
+	fp = fmemopen((void *)buf, strlen(buf), "r");
+	if (!fp) {
+		/*
+		 * fmemopen() on older GLIBC versions do not accept zero
+		 * length buffers for some reason.  This is a workaround.
+		 */
+		if (strlen(buf) > 0)
+			return CFG_FILE_ERROR;
+
+		return CFG_SUCCESS;
+	}
+
+	ret = cfg_parse_stream(cfg, fp, strlen(buf));
+	fclose(fp);
+
+	return ret;
+}
+
+/*
+ * JSON input, see cfg_parse_json().  A recursive descent reader that
+ * sets values as it goes, strings in the buffer are used where they
+ * are unless they have escapes or need a terminating NUL.
+ */
+struct cfg_json {
+	const char *p;		/* Next character */
+	const char *end;
+	int line;
+	struct cfg_profiler *prof;
+	char *str;		/* Unescaped strings, see cfg_json_string() */
+	size_t size;
+};
+
+static int cfg_json_object(struct cfg_json *js, cfg_t *cfg, int level);
+
+static int cfg_json_error(struct cfg_json *js, cfg_t *cfg, const char *fmt, ...)
+{
+	va_list ap;
+
+	cfg->line = js->line;
+	va_start(ap, fmt);
+	cfg_verror(cfg, fmt, ap);
+	va_end(ap);
+
+	return -1;
+}
+
+static int cfg_json_unexpected(struct cfg_json *js, cfg_t *cfg)
+{
+	if (js->p >= js->end)
+		return cfg_json_error(js, cfg, _("premature end of file"));
+
+	return cfg_json_error(js, cfg, _("unexpected token '%c'"), *js->p);
+}
+
+/* Skip white space, returns the next character or EOF */
+static int cfg_json_ws(struct cfg_json *js)
+{
+	for (; js->p < js->end; js->p++) {
+		switch (*js->p) {
+		case '\n':
+			js->line++;
+			break;
+		case ' ':
+		case '\t':
+		case '\r':
+			break;
+		default:
+			return (unsigned char)*js->p;
+		}
+	}
+
+	return EOF;
+}
+
+static int cfg_json_expect(struct cfg_json *js, cfg_t *cfg, int c)
+{
+	if (cfg_json_ws(js) != c)
+		return cfg_json_unexpected(js, cfg);
+	js->p++;
+
+	return 0;
+}
+
+static int cfg_json_literal(struct cfg_json *js, cfg_t *cfg, const char *word)
+{
+	size_t len = strlen(word);
+
+	if ((size_t)(js->end - js->p) < len || memcmp(js->p, word, len))
+		return cfg_json_unexpected(js, cfg);
+	js->p += len;
+
+	return 0;
+}
+
+/*
+ * Start of an object or array: 1 if a member follows, 0 if it is
+ * empty, and after each member, 1 if another one follows, 0 at the
+ * end of it.  Negative on errors, for loops over the members.
+ */
+static int cfg_json_open(struct cfg_json *js, cfg_t *cfg, int open, int close)
+{
+	if (cfg_json_expect(js, cfg, open))
+		return -1;
+	if (cfg_json_ws(js) != close)
+		return 1;
+	js->p++;
+
+	return 0;
+}
+
+static int cfg_json_next(struct cfg_json *js, cfg_t *cfg, int close)
+{
+	int c = cfg_json_ws(js);
+
+	if (c != ',' && c != close)
+		return cfg_json_unexpected(js, cfg);
+	js->p++;
+
+	return c == ',';
+}
+
+static char *cfg_json_buf(struct cfg_json *js, size_t len)
+{
+	char *str;
+
+	if (len > js->size) {
+		str = realloc(js->str, len);
+		if (!str)
+			return NULL;
+		js->str = str;
+		js->size = len;
+	}
+
+	return js->str;
+}
+
+static int cfg_json_hex4(const char *p)
+{
+	int i, val = 0;
+
+	for (i = 0; i < 4; i++) {
+		val <<= 4;
+		if (p[i] >= '0' && p[i] <= '9')
+			val |= p[i] - '0';
+		else if (p[i] >= 'a' && p[i] <= 'f')
+			val |= p[i] - 'a' + 10;
+		else if (p[i] >= 'A' && p[i] <= 'F')
+			val |= p[i] - 'A' + 10;
+		else
+			return -1;
+	}
+
+	return val;
+}
+
+static char *cfg_json_utf8(char *out, long cp)
+{
+	if (cp < 0x80) {
+		*out++ = (char)cp;
+	} else if (cp < 0x800) {
+		*out++ = (char)(0xc0 | (cp >> 6));
+		*out++ = (char)(0x80 | (cp & 0x3f));
+	} else if (cp < 0x10000) {
+		*out++ = (char)(0xe0 | (cp >> 12));
+		*out++ = (char)(0x80 | ((cp >> 6) & 0x3f));
+		*out++ = (char)(0x80 | (cp & 0x3f));
+	} else {
+		*out++ = (char)(0xf0 | (cp >> 18));
+		*out++ = (char)(0x80 | ((cp >> 12) & 0x3f));
+		*out++ = (char)(0x80 | ((cp >> 6) & 0x3f));
+		*out++ = (char)(0x80 | (cp & 0x3f));
+	}
+
+	return out;
+}
+
+/*
+ * A string, at its opening quote.  Without escapes, and unless a NUL
+ * terminated copy is needed, it is used where it is in the buffer,
+ * otherwise it is unescaped to js->str, valid until the next string.
+ */
+static int cfg_json_string(struct cfg_json *js, cfg_t *cfg, const char **str, size_t *len, int copy)
+{
+	const char *start = js->p + 1, *p, *close;
+	long cp, lo;
+	char *out;
+
+	for (close = start; close < js->end && *close != '"'; close++) {
+		if (*close == '\\' && close + 1 < js->end)
+			close++;
+	}
+	if (close >= js->end) {
+		js->p = close;
+		return cfg_json_unexpected(js, cfg);
+	}
+
+	out = NULL;
+	if (copy || memchr(start, '\\', close - start)) {
+		/* Never longer unescaped */
+		out = cfg_json_buf(js, close - start + 1);
+		if (!out)
+			return -1;
+		*str = out;
+	} else {
+		*str = start;
+	}
+
+	for (p = start; p < close; ) {
+		if ((unsigned char)*p < 0x20) {
+			js->p = p;
+			return cfg_json_error(js, cfg, _("invalid character in string"));
+		}
+		if (*p != '\\') {
+			if (out)
+				*out++ = *p;
+			p++;
+			continue;
+		}
+
+		p++;
+		switch (*p++) {
+		case '"':
+		case '\\':
+		case '/':
+			*out++ = p[-1];
+			continue;
+		case 'b':
+			*out++ = '\b';
+			continue;
+		case 'f':
+			*out++ = '\f';
+			continue;
+		case 'n':
+			*out++ = '\n';
+			continue;
+		case 'r':
+			*out++ = '\r';
+			continue;
+		case 't':
+			*out++ = '\t';
+			continue;
+		case 'u':
+			if (close - p < 4 || (cp = cfg_json_hex4(p)) < 0)
+				break;
+			p += 4;
+
+			/* Outside the basic plane as a surrogate pair */
+			if (cp >= 0xdc00 && cp < 0xe000)
+				break;
+			if (cp >= 0xd800 && cp < 0xdc00) {
+				if (close - p < 6 || p[0] != '\\' || p[1] != 'u')
+					break;
+				lo = cfg_json_hex4(p + 2);
+				if (lo < 0xdc00 || lo >= 0xe000)
+					break;
+				cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+				p += 6;
+			}
+			out = cfg_json_utf8(out, cp);
+			continue;
+		default:
+			break;
+		}
+
+		js->p = p - 1;
+		return cfg_json_error(js, cfg, _("invalid escape sequence in string"));
+	}
+
+	if (out) {
+		*len = out - *str;
+		*out = 0;
+	} else {
+		*len = close - start;
+	}
+	js->p = close + 1;
+
+	return 0;
+}
+
+/* A member name and the colon after it */
+static int cfg_json_key(struct cfg_json *js, cfg_t *cfg, const char **key, size_t *len)
+{
+	if (cfg_json_ws(js) != '"')
+		return cfg_json_unexpected(js, cfg);
+	if (cfg_json_string(js, cfg, key, len, 0))
+		return -1;
+
+	return cfg_json_expect(js, cfg, ':');
+}
+
+/* Length of the number at js->p, 0 if there is none, and if it is an integer */
+static size_t cfg_json_number(struct cfg_json *js, int *integer)
+{
+	const char *p = js->p, *end = js->end;
+
+	*integer = 1;
+	if (p < end && *p == '-')
+		p++;
+	if (p < end && *p == '0')
+		p++;
+	else if (p < end && *p >= '1' && *p <= '9')
+		while (p < end && isdigit((unsigned char)*p))
+			p++;
+	else
+		return 0;
+
+	if (p < end && *p == '.') {
+		*integer = 0;
+		if (++p >= end || !isdigit((unsigned char)*p))
+			return 0;
+		while (p < end && isdigit((unsigned char)*p))
+			p++;
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		*integer = 0;
+		if (++p < end && (*p == '+' || *p == '-'))
+			p++;
+		if (p >= end || !isdigit((unsigned char)*p))
+			return 0;
+		while (p < end && isdigit((unsigned char)*p))
+			p++;
+	}
+
+	return p - js->p;
+}
+
+/* Skip a value of an unknown option, see CFGF_IGNORE_UNKNOWN */
+static int cfg_json_skip(struct cfg_json *js, cfg_t *cfg, int level)
+{
+	const char *str;
+	size_t len;
+	int rc, integer;
+
+	if (level > CFG_MAX_NESTING_DEPTH)
+		return cfg_json_error(js, cfg, _("too deeply nested sections (max %d), "
+						 "bailing out to avoid stack exhaustion"),
+				      CFG_MAX_NESTING_DEPTH);
+
+	switch (cfg_json_ws(js)) {
+	case '"':
+		return cfg_json_string(js, cfg, &str, &len, 0);
+
+	case 't':
+		return cfg_json_literal(js, cfg, "true");
+
+	case 'f':
+		return cfg_json_literal(js, cfg, "false");
+
+	case 'n':
+		return cfg_json_literal(js, cfg, "null");
+
+	case '{':
+		for (rc = cfg_json_open(js, cfg, '{', '}'); rc > 0; rc = cfg_json_next(js, cfg, '}')) {
+			if (cfg_json_key(js, cfg, &str, &len) || cfg_json_skip(js, cfg, level + 1))
+				return -1;
+		}
+		return rc;
+
+	case '[':
+		for (rc = cfg_json_open(js, cfg, '[', ']'); rc > 0; rc = cfg_json_next(js, cfg, ']')) {
+			if (cfg_json_skip(js, cfg, level + 1))
+				return -1;
+		}
+		return rc;
+
+	default:
+		len = cfg_json_number(js, &integer);
+		if (!len)
+			return cfg_json_unexpected(js, cfg);
+		js->p += len;
+		return 0;
+	}
+}
+
+/* A value set without cfg_parse_setopt(), counted the same */
+static void cfg_json_changed(struct cfg_json *js, cfg_opt_t *opt)
+{
+	cfg_profile_t *profile;
+
+	cfg_opt_changed(opt);
+	if ((profile = cfg_profile_input(js->prof)) != NULL)
+		profile->options++;
+}
+
+static int cfg_json_setopt(struct cfg_json *js, cfg_t *cfg, cfg_opt_t *opt, const char *value, size_t len)
+{
+	cfg->line = js->line;
+
+	return cfg_parse_setopt(cfg, opt, value, len, js->prof) ? 0 : -1;
+}
+
+/*
+ * A number, to integer and float options without going through a
+ * string.  Options with a parse callback, and of other types, get
+ * the number as it is written.
+ */
+static int cfg_json_setnum(struct cfg_json *js, cfg_t *cfg, cfg_opt_t *opt)
+{
+	const char *num = js->p;
+	cfg_value_t *val;
+	uint64_t u64 = 0, max;
+	int64_t i64, min;
+	size_t len, i;
+	int integer, neg, range = 0;
+	char *end;
+	double f = 0;
+
+	len = cfg_json_number(js, &integer);
+	if (!len)
+		return cfg_json_unexpected(js, cfg);
+	js->p += len;
+	neg = *num == '-';
+
+	if (opt->parsecb || opt->type < CFGT_INT || opt->type == CFGT_STR ||
+	    opt->type == CFGT_BOOL || opt->type > CFGT_UINT64 ||
+	    (opt->type > CFGT_FLOAT && opt->type < CFGT_INT8)) {
+		if (!cfg_json_buf(js, len + 1))
+			return -1;
+		memcpy(js->str, num, len);
+		js->str[len] = 0;
+
+		return cfg_json_setopt(js, cfg, opt, js->str, len);
+	}
+
+	if (opt->type == CFGT_FLOAT) {
+		/* Stops at the end of the number, which may be the end of the buffer */
+		if (num + len == js->end) {
+			if (!cfg_json_buf(js, len + 1))
+				return -1;
+			memcpy(js->str, num, len);
+			js->str[len] = 0;
+			num = js->str;
+		}
+
+		errno = 0;
+		f = cfg_strtod(num, &end);
+		if (end != num + len)
+			return cfg_json_error(js, cfg, _("invalid floating point value for option '%s'"), opt->name);
+		if (errno == ERANGE && (f == 0 || f > DBL_MAX || f < -DBL_MAX))
+			return cfg_json_error(js, cfg, _("floating point value for option '%s' is out of range"), opt->name);
+	} else {
+		if (!integer)
+			return cfg_json_error(js, cfg, _("invalid integer value for option '%s'"), opt->name);
+
+		for (i = neg; i < len; i++) {
+			unsigned int digit = num[i] - '0';
+
+			if (u64 > (UINT64_MAX - digit) / 10) {
+				range = 1;
+				break;
+			}
+			u64 = u64 * 10 + digit;
+		}
+
+		cfg_int_range(opt->type, &min, &max);
+		if (neg && min == 0 && u64)
+			return cfg_json_error(js, cfg, _("negative value for unsigned option '%s'"), opt->name);
+		if (range || (neg ? u64 > 0 - (uint64_t)min : u64 > max))
+			return cfg_json_error(js, cfg, _("integer value for option '%s' is out of range"), opt->name);
+	}
+
+	cfg->line = js->line;
+	val = cfg_setopt_slot(cfg, opt, NULL);
+	if (!val)
+		return -1;
+
+	i64 = neg ? (int64_t)(0 - u64) : (int64_t)u64;
+	switch (opt->type) {
+	case CFGT_INT:    val->number   = (long int)i64; break;
+	case CFGT_INT8:   val->i8       = (int8_t)i64;   break;
+	case CFGT_INT16:  val->i16      = (int16_t)i64;  break;
+	case CFGT_INT32:  val->i32      = (int32_t)i64;  break;
+	case CFGT_INT64:  val->i64      = i64;           break;
+	case CFGT_UINT8:  val->u8       = (uint8_t)u64;  break;
+	case CFGT_UINT16: val->u16      = (uint16_t)u64; break;
+	case CFGT_UINT32: val->u32      = (uint32_t)u64; break;
+	case CFGT_UINT64: val->u64      = u64;           break;
+	default:          val->fpnumber = f;             break;
+	}
+	cfg_json_changed(js, opt);
+
+	return 0;
+}
+
+static int cfg_json_setbool(struct cfg_json *js, cfg_t *cfg, cfg_opt_t *opt, int b)
+{
+	cfg_value_t *val;
+
+	if (cfg_json_literal(js, cfg, b ? "true" : "false"))
+		return -1;
+
+	if (opt->type != CFGT_BOOL || opt->parsecb)
+		return cfg_json_setopt(js, cfg, opt, b ? "true" : "false", b ? 4 : 5);
+
+	cfg->line = js->line;
+	val = cfg_setopt_slot(cfg, opt, NULL);
+	if (!val)
+		return -1;
+	val->boolean = b ? cfg_true : cfg_false;
+	cfg_json_changed(js, opt);
+
+	return 0;
+}
+
+/* One value of a plain option, or of a list */
+static int cfg_json_value(struct cfg_json *js, cfg_t *cfg, cfg_opt_t *opt)
+{
+	const char *str;
+	size_t len;
+	int c, rc;
+
+	c = cfg_json_ws(js);
+	if (c == '"') {
+		rc = cfg_json_string(js, cfg, &str, &len, 1);
+		if (!rc)
+			rc = cfg_json_setopt(js, cfg, opt, str, len);
+	} else if (c == 't' || c == 'f') {
+		rc = cfg_json_setbool(js, cfg, opt, c == 't');
+	} else if (c == '-' || isdigit(c)) {
+		rc = cfg_json_setnum(js, cfg, opt);
+	} else {
+		rc = cfg_json_unexpected(js, cfg);
+	}
+
+	if (rc)
+		return rc;
+
+	return cfg_parse_validate(cfg, opt, js->prof) ? -1 : 0;
+}
+
+/* One section, from an object, or for raw sections from a string */
+static int cfg_json_section(struct cfg_json *js, cfg_t *cfg, cfg_opt_t *opt,
+			    const char *title, size_t len, int level)
+{
+	cfg_value_t *val;
+	const char *raw;
+	size_t rawlen;
+	cfg_t *sec;
+
+	if (cfg_json_ws(js) != (opt->type == CFGT_RAWSEC ? '"' : '{'))
+		return cfg_json_unexpected(js, cfg);
+
+	cfg->line = js->line;
+	val = cfg_parse_setopt(cfg, opt, title, len, js->prof);
+	if (!val)
+		return -1;
+
+	sec = val->section;
+	sec->path = cfg->path; /* Remember global search path */
+	sec->line = js->line;
+	sec->errfunc = cfg->errfunc;
+
+	if (opt->type == CFGT_RAWSEC) {
+		if (cfg_json_string(js, cfg, &raw, &rawlen, 1))
+			return -1;
+
+		cfg_mem_str(sec, CFG_MEMORY_RAW, -1, sec->raw);
+		free(sec->raw);
+		sec->raw = strdup(raw);
+		if (!sec->raw)
+			return -1;
+		cfg_mem_str(sec, CFG_MEMORY_RAW, 1, sec->raw);
+	} else if (cfg_json_object(js, sec, level + 1)) {
+		return -1;
+	}
+
+	return cfg_parse_validate(cfg, opt, js->prof) ? -1 : 0;
+}
+
+/* Titled sections keyed by title, others one object or an array of them */
+static int cfg_json_sections(struct cfg_json *js, cfg_t *cfg, cfg_opt_t *opt, int level)
+{
+	const char *title;
+	size_t len;
+	int rc;
+
+	if (is_set(CFGF_TITLE, opt->flags)) {
+		for (rc = cfg_json_open(js, cfg, '{', '}'); rc > 0; rc = cfg_json_next(js, cfg, '}')) {
+			if (cfg_json_ws(js) != '"')
+				return cfg_json_unexpected(js, cfg);
+			if (cfg_json_string(js, cfg, &title, &len, 1) ||
+			    cfg_json_expect(js, cfg, ':') ||
+			    cfg_json_section(js, cfg, opt, title, len, level))
+				return -1;
+		}
+
+		return rc;
+	}
+
+	if (cfg_json_ws(js) != '[')
+		return cfg_json_section(js, cfg, opt, NULL, 0, level);
+
+	if (!is_set(CFGF_MULTI, opt->flags))
+		return cfg_json_error(js, cfg, _("array for single section '%s'"), opt->name);
+
+	for (rc = cfg_json_open(js, cfg, '[', ']'); rc > 0; rc = cfg_json_next(js, cfg, ']')) {
+		if (cfg_json_section(js, cfg, opt, NULL, 0, level))
+			return -1;
+	}
+
+	return rc;
+}
+
+/* A function call, its arguments a string or an array of them */
+static int cfg_json_func(struct cfg_json *js, cfg_t *cfg, cfg_opt_t *opt)
+{
+	cfg_opt_t funcopt = CFG_STR(NULL, NULL, 0);
+	cfg_value_t *val;
+	const char *str;
+	size_t len;
+	int rc, array;
+
+	/* Files are included by the lexer, which is not used here */
+	if (opt->func == cfg_include)
+		return cfg_json_error(js, cfg, _("include() is not supported in JSON"));
+
+	array = cfg_json_ws(js) == '[';
+	rc = array ? cfg_json_open(js, cfg, '[', ']') : 1;
+	for (; rc > 0; rc = array ? cfg_json_next(js, cfg, ']') : 0) {
+		if (cfg_json_ws(js) != '"') {
+			rc = cfg_json_unexpected(js, cfg);
+			break;
+		}
+		if (cfg_json_string(js, cfg, &str, &len, 1)) {
+			rc = -1;
+			break;
+		}
+
+		val = cfg_addval(&funcopt);
+		if (!val || (val->string = strdup(str)) == NULL) {
+			rc = -1;
+			break;
+		}
+	}
+
+	if (!rc) {
+		cfg->line = js->line;
+		rc = call_function(cfg, opt, &funcopt) ? -1 : 0;
+	}
+	cfg_free_value(&funcopt);
+
+	return rc;
+}
+
+/* The value of an option, an array for lists replaces all values */
+static int cfg_json_opt(struct cfg_json *js, cfg_t *cfg, cfg_opt_t *opt, int level)
+{
+	int rc, c;
+
+	c = cfg_json_ws(js);
+	if (c == 'n')
+		return cfg_json_literal(js, cfg, "null");
+
+	switch (opt->type) {
+	case CFGT_SEC:
+	case CFGT_RAWSEC:
+		return cfg_json_sections(js, cfg, opt, level);
+
+	case CFGT_FUNC:
+		return cfg_json_func(js, cfg, opt);
+
+	case CFGT_NONE:
+	case CFGT_COMMENT:
+		return cfg_json_error(js, cfg, _("unexpected value for option '%s'"), opt->name);
+
+	default:
+		break;
+	}
+
+	/* As with '=', see cfg_parse_internal() */
+	opt->flags |= CFGF_RESET;
+	cfg_opt_changed(opt);
+
+	if (c != '[')
+		return cfg_json_value(js, cfg, opt);
+	if (!is_set(CFGF_LIST, opt->flags))
+		return cfg_json_error(js, cfg, _("array for non-list option '%s'"), opt->name);
+
+	rc = cfg_json_open(js, cfg, '[', ']');
+	if (!rc) {
+		if (is_set(CFGF_RESET, opt->flags))
+			cfg_free_value(opt);
+		return 0;
+	}
+
+	for (; rc > 0; rc = cfg_json_next(js, cfg, ']')) {
+		if (cfg_json_value(js, cfg, opt))
+			return -1;
+	}
+	if (rc)
+		return rc;
+
+	return cfg_parse_validate(cfg, opt, js->prof) ? -1 : 0;
+}
+
+static int cfg_json_object(struct cfg_json *js, cfg_t *cfg, int level)
+{
+	cfg_opt_t *opt;
+	const char *key;
+	char *name;
+	size_t len;
+	int rc;
+
+	if (level > CFG_MAX_NESTING_DEPTH)
+		return cfg_json_error(js, cfg, _("too deeply nested sections (max %d), "
+						 "bailing out to avoid stack exhaustion"),
+				      CFG_MAX_NESTING_DEPTH);
+
+	for (rc = cfg_json_open(js, cfg, '{', '}'); rc > 0; rc = cfg_json_next(js, cfg, '}')) {
+		if (cfg_json_key(js, cfg, &key, &len))
+			return -1;
+
+		/* Not counted with CFGF_STATS */
+		opt = cfg_getopt_leafn(cfg, key, len);
+		if (!opt && is_set(CFGF_IGNORE_UNKNOWN, cfg->flags)) {
+			if (cfg_json_skip(js, cfg, level))
+				return -1;
+			continue;
+		}
+
+		/* Not found, is it a dynamic key-value section? */
+		if (!opt && is_set(CFGF_KEYSTRVAL, cfg->flags)) {
+			name = strndup(key, len);
+			if (!name)
+				return -1;
+			opt = cfg_addopt(cfg, name);
+			free(name);
+			if (!opt)
+				return -1;
+		}
+
+		if (!opt)
+			return cfg_json_error(js, cfg, _("no such option '%.*s'"), (int)len, key);
+
+		if (cfg_json_opt(js, cfg, opt, level))
+			return -1;
+
+		if (is_set(CFGF_DEPRECATED, opt->flags))
+			cfg_handle_deprecated(cfg, opt);
+	}
+
+	return rc;
+}
+
+DLLIMPORT int cfg_parse_json(cfg_t *cfg, const char *buf, size_t len)
+{
+	struct cfg_json js;
+	char *fn;
+	int rc, rec;
+
+	if (!cfg) {
+		errno = EINVAL;
+		return CFG_PARSE_ERROR;
+	}
+
+	if (cfg_frozen(cfg))
+		return CFG_FAIL;
+
+	if (!buf)
+		return CFG_SUCCESS;
+
+	fn = strdup("[json]");
+	if (!fn)
+		return CFG_PARSE_ERROR;
+
+	cfg_set_filename(cfg, fn);
+
+	memset(&js, 0, sizeof(js));
+	js.p = buf;
+	js.end = buf + len;
+	js.line = 1;
+	js.prof = cfg_profile_of(cfg);
+	rec = cfg_profile_begin(js.prof, cfg->filename, len);
+
+	/* Only white space is like an empty cfg_parse_buf() */
+	rc = 0;
+	cfg->line = 1;
+	if (cfg_json_ws(&js) != EOF) {
+		rc = cfg_json_object(&js, cfg, 0);
+		if (!rc && cfg_json_ws(&js) != EOF)
+			rc = cfg_json_unexpected(&js, cfg);
+	}
+
+	cfg_profile_end(js.prof, rec);
+	free(js.str);
+
+	return rc ? CFG_PARSE_ERROR : CFG_SUCCESS;
+}
+
+DLLIMPORT cfg_t *cfg_init(cfg_opt_t *opts, cfg_flag_t flags)
+{
+	cfg_t *cfg;
+	int rec;
+
+	cfg = calloc(1, sizeof(cfg_t));
+	if (!cfg)
+		return NULL;
+
+	cfg->name = strdup("root");
+	if (!cfg->name) {
+		free(cfg);
+		return NULL;
+	}
+
+	cfg->memtype = cfg_memory_new(cfg);
+	if (!cfg->memtype) {
+		free(cfg->name);
+		free(cfg);
+		return NULL;
+	}
+
+	cfg->opts = cfg_dupopt_array(opts);
+	if (!cfg->opts) {
+		cfg_memory_free(cfg->memtype->tree);
+		free(cfg->name);
+		free(cfg);
+		return NULL;
+	}
+	cfg_own_opts(cfg);
+	cfg_mem_section(cfg, 1);
+
+	cfg->flags = flags;
+	cfg->filename = NULL;
+	cfg->line = 0;
+	cfg->errfunc = NULL;
+	cfg->refcount = 1;
+	cfg_stats_new(cfg);
+
+	if (is_set(CFGF_INTERN, flags)) {
+		cfg->intern = cfg_intern_new(cfg);
+		if (!cfg->intern) {
+			cfg_free(cfg);
+			return NULL;
+		}
+	}
+
+	if (is_set(CFGF_PROFILE, flags)) {
+		cfg->profile = cfg_profile_new(cfg);
+		if (!cfg->profile) {
+			cfg_free(cfg);
+			return NULL;
+		}
+	}
+
+#if defined(ENABLE_NLS) && defined(HAVE_GETTEXT)
+	bindtextdomain(PACKAGE, LOCALEDIR);
+#endif
+
+	rec = cfg_profile_begin(cfg->profile, "[init]", 0);
+	cfg_init_defaults(cfg);
+	cfg_profile_end(cfg->profile, rec);
+
+	return cfg;
+}
+
+DLLIMPORT int cfg_intern_stats(cfg_t *cfg, cfg_intern_stats_t *stats)
+{
+	struct cfg_intern *in;
+
+	if (!cfg || !stats) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	in = cfg_intern_of(cfg);
+	if (in) {
+		stats->strings = in->count;
+		stats->refs    = in->refs;
+		stats->bytes   = in->bytes;
+		stats->saved   = in->saved;
+	}
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_memory_stats(cfg_t *cfg, cfg_memory_stats_t *stats)
+{
+	if (!cfg || !stats) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	if (cfg->memtype)
+		*stats = cfg->memtype->tree->stats;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_memory_stats_type(cfg_t *cfg, const char *name, cfg_memory_stats_t *stats)
+{
+	struct cfg_memtype *type;
+
+	if (!cfg || !name || !stats) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	if (!cfg->memtype)
+		return CFG_SUCCESS;
+
+	for (type = cfg->memtype->tree->types; type; type = type->next) {
+		if (!strcmp(type->name, name)) {
+			*stats = type->stats;
+			break;
+		}
+	}
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT char *cfg_tilde_expand(const char *filename)
+{
+	char *expanded = NULL;
+
+#ifndef _WIN32
+	/* Do tilde expansion */
+	if (filename[0] == '~') {
+		struct passwd *passwd = NULL;
+		const char *file = NULL;
+
+		if (filename[1] == '/' || filename[1] == 0) {
+			/* ~ or ~/path */
+			passwd = getpwuid(geteuid());
+			file = filename + 1;
+		} else {
+			char *user; /* ~user or ~user/path */
+			size_t len;
+
+			file = strchr(filename, '/');
+			if (file == NULL)
+				file = filename + strlen(filename);
+
+			len = file - filename - 1;
+			user = malloc(len + 1);
+			if (!user)
+				return NULL;
+
+			strncpy(user, &filename[1], len);
+			user[len] = 0;
+			passwd = getpwnam(user);
+			free(user);
+		}
+
+		if (passwd) {
+			expanded = malloc(strlen(passwd->pw_dir) + strlen(file) + 1);
+			if (!expanded)
+				return NULL;
+
+			strcpy(expanded, passwd->pw_dir);
+			strcat(expanded, file);
+		}
+	}
+#endif
+	if (!expanded)
+		expanded = strdup(filename);
+
+	return expanded;
+}
+
+DLLIMPORT int cfg_free_value(cfg_opt_t *opt)
+{
+	if (!opt) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (cfg_frozen(opt->sec))
+		return CFG_FAIL;
+
+	/* No default either, as if it had been set */
+	opt->flags &= ~CFGF_LAZYDEF;
+
+	if (opt->comment && !is_set(CFGF_RESET, opt->flags)) {
+		cfg_mem_str(opt->sec, CFG_MEMORY_COMMENTS, -1, opt->comment);
+		free(opt->comment);
+		opt->comment = NULL;
+	}
+
+	if (is_set(CFGF_SHARED, opt->flags)) {
+		/* Freed with the tree a copy was made from */
+		opt->flags &= ~CFGF_SHARED;
+	} else if (opt->values) {
+		size_t size = cfg_value_size(opt);
+		unsigned int i;
+
+		for (i = 0; i < opt->nvalues; i++) {
+			if (opt->type == CFGT_STR) {
+				cfg_strfree_sec(opt->sec, CFG_MEMORY_STRINGS, opt->values[i]->string,
+						((struct cfg_strval *)opt->values[i])->len);
+			} else if (opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC) {
+				/* With its value, see cfg_opt_unshare() */
+				if (cfg_shared(opt, opt->values[i]->section))
+					continue;
+				opt->values[i]->section->path = NULL; /* Global search path */
+				cfg_free(opt->values[i]->section);
+			} else if (opt->type == CFGT_PTR && opt->freecb && opt->values[i]->ptr &&
+				   !((struct cfg_ptrval *)opt->values[i])->borrowed) {
+				(opt->freecb) (opt->values[i]->ptr);
+			}
+			cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, -1, size);
+			free(opt->values[i]);
+		}
+		if (opt->nvalues)
+			cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, -1, cfg_values_cap(opt->nvalues) * sizeof(cfg_value_t *));
+		free(opt->values);
+	}
+
+	opt->values  = NULL;
+	opt->nvalues = 0;
+	cfg_invalidate(opt->sec);
+
+	return CFG_SUCCESS;
+}
+
+static void cfg_free_opt_array(cfg_opt_t *opts)
+{
+	int i;
+
+	for (i = 0; opts[i].name; ++i) {
+		free((void *)opts[i].name);
+		if (opts[i].comment)
+			free(opts[i].comment);
+		if (opts[i].def.parsed)
+			free(opts[i].def.parsed);
+		if (opts[i].def.string)
+			free((void *)opts[i].def.string);
+		if (opts[i].subopts)
+			cfg_free_opt_array(opts[i].subopts);
+	}
+	free(opts);
+}
+
+static int cfg_free_searchpath(cfg_t *cfg, cfg_searchpath_t *p)
+{
+	if (p) {
+		cfg_free_searchpath(cfg, p->next);
+		cfg_mem_str(cfg, CFG_MEMORY_PATHS, -1, p->dir);
+		cfg_mem_count(cfg, CFG_MEMORY_PATHS, -1, sizeof(*p));
+		free(p->dir);
+		free(p);
+	}
+
+	return CFG_SUCCESS;
+}
+
+static void cfg_overlay_free(cfg_t *cfg)
+{
+	unsigned int i;
+
+	for (i = 0; i < cfg->overlay->num; i++)
+		cfg_release(cfg->overlay->layer[i]);
+	free(cfg->overlay);
+	free(cfg);
+}
+
+static void cfg_free_sec(cfg_t *cfg)
+{
+	struct cfg_memory *tree = NULL;
+	cfg_t *source;
+	int i;
+
+	if (cfg->overlay) {
+		cfg_overlay_free(cfg);
+		return;
+	}
+
+	/* Frozen or not, it's going away */
+	cfg->flags &= ~CFGF_FROZEN;
+
+	if (cfg->watch)
+		cfg_watch_free(cfg);
+
+	if (cfg->comment)
+		free(cfg->comment);
+
+	for (i = 0; cfg->opts[i].name; ++i)
+		cfg_free_value(&cfg->opts[i]);
+
+	cfg_stats_free(cfg);
+	cfg_mem_section(cfg, -1);
+	cfg_free_opt_array(cfg->opts);
+	cfg_free_searchpath(cfg, cfg->path);
+	if (cfg->index)
+		cfg_mem_count(cfg, CFG_MEMORY_OPTIONS, -1, cfg_index_size(cfg->index));
+	free(cfg->index);
+
+	if (cfg->name)
+		free(cfg->name);
+	if (cfg->title)
+		cfg_strfree_sec(cfg, CFG_MEMORY_TITLES, cfg->title, strlen(cfg->title));
+	if (cfg->filename)
+		free(cfg->filename);
+	cfg_mem_str(cfg, CFG_MEMORY_RAW, -1, cfg->raw);
+	if (cfg->raw)
+		free(cfg->raw);
+	cfg_intern_free(cfg->intern);
+	cfg_profile_free(cfg->profile);
+
+	if (cfg->memtype && cfg->memtype->tree->root == cfg)
+		tree = cfg->memtype->tree;
+	source = cfg->source;
+	free(cfg);
+
+	if (tree) {
+		/* Anything still counted was leaked, or counted wrong */
+		assert(tree->stats.total.bytes == 0 && tree->stats.total.allocs == 0);
+		cfg_memory_free(tree);
+	}
+
+	/* Only now that nothing refers to its values, see cfg_dup() */
+	if (source)
+		cfg_release(source);
+}
+
+DLLIMPORT int cfg_free(cfg_t *cfg)
+{
+	int isroot;
+
+	if (!cfg) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	/* Others still hold the tree, e.g. a copy or an overlay of it */
+	if (!cfg->parent && cfg_atomic_dec(&cfg->refcount) > 0)
+		return CFG_SUCCESS;
+
+	isroot = cfg->name && !strcmp(cfg->name, "root");
+	cfg_free_sec(cfg);
+	if (isroot)
+		cfg_yylex_destroy();
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT cfg_t *cfg_acquire(cfg_t *cfg)
+{
+	cfg_t *root = cfg;
+
+	if (!cfg) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	while (root->parent)
+		root = root->parent;
+	cfg_atomic_inc(&root->refcount);
+
+	return cfg;
+}
+
+DLLIMPORT int cfg_release(cfg_t *cfg)
+{
+	if (!cfg) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	while (cfg->parent)
+		cfg = cfg->parent;
+	if (cfg_atomic_dec(&cfg->refcount) == 0)
+		cfg_free_sec(cfg);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT cfg_t *cfg_overlay(cfg_t *base, cfg_t *top, ...)
+{
+	struct cfg_overlay *ov;
+	unsigned int i, num;
+	cfg_t *cfg, *layer;
+	va_list ap;
+
+	if (!base) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	num = 1;
+	va_start(ap, top);
+	for (layer = top; layer; layer = va_arg(ap, cfg_t *))
+		num++;
+	va_end(ap);
+
+	cfg = calloc(1, sizeof(*cfg));
+	ov = calloc(1, sizeof(*ov) + num * sizeof(cfg_t *));
+	if (!cfg || !ov) {
+		free(cfg);
+		free(ov);
+		return NULL;
+	}
+
+	/* Shared, not copied, each layer is kept until the overlay is freed */
+	ov->layer[0] = cfg_acquire(base);
+	va_start(ap, top);
+	for (i = 1, layer = top; i < num; i++, layer = va_arg(ap, cfg_t *))
+		ov->layer[i] = cfg_acquire(layer);
+	va_end(ap);
+	ov->num = num;
+
+	cfg->overlay = ov;
+	cfg->opts = cfg_overlay_opts;
+	cfg->flags = CFGF_FROZEN;
+	cfg->errfunc = base->errfunc;
+	cfg->refcount = 1;
+
+	return cfg;
+}
+
+/*
+ * A copy of the section src for parent, or a new root section.  The
+ * options are copied, but not their values, which they share with src
+ * until they change, see cfg_opt_unshare(), nor the sections below.
+ */
+static cfg_t *cfg_sec_copy(cfg_t *parent, cfg_t *src)
+{
+	cfg_t *sec;
+	int i;
+
+	sec = calloc(1, sizeof(cfg_t));
+	if (!sec)
+		return NULL;
+
+	sec->parent = parent;
+	sec->flags = src->flags & ~CFGF_FROZEN;
+	sec->line = src->line;
+	sec->errfunc = src->errfunc;
+	sec->pff = src->pff;
+	sec->name = strdup(src->name);
+	sec->filename = src->filename ? strdup(src->filename) : NULL;
+	sec->opts = cfg_dupopt_array(src->opts);
+	if (sec->name)
+		sec->memtype = parent ? cfg_memtype_get(parent, sec->name) : cfg_memory_new(sec);
+	if (!sec->name || (src->filename && !sec->filename) || !sec->opts || (!parent && !sec->memtype)) {
+		if (sec->opts)
+			cfg_free_opt_array(sec->opts);
+		if (!parent && sec->memtype)
+			cfg_memory_free(sec->memtype->tree);
+		free(sec->filename);
+		free(sec->name);
+		free(sec);
+		return NULL;
+	}
+
+	for (i = 0; sec->opts[i].name; i++) {
+		if (sec->opts[i].values)
+			sec->opts[i].flags |= CFGF_SHARED;
+	}
+	cfg_own_opts(sec);
+	cfg_mem_section(sec, 1);
+	cfg_stats_new(sec);
+
+	if (src->title) {
+		sec->title = cfg_strdup_sec(sec, CFG_MEMORY_TITLES, src->title, strlen(src->title));
+		if (!sec->title)
+			goto err;
+	}
+
+	if (src->raw) {
+		sec->raw = strdup(src->raw);
+		if (!sec->raw)
+			goto err;
+		cfg_mem_str(sec, CFG_MEMORY_RAW, 1, sec->raw);
+	}
+
+	/* Subsections use the search path of the root */
+	if (parent && src->path)
+		sec->path = parent->path;
+
+	return sec;
+err:
+	cfg_free_sec(sec);
+	return NULL;
+}
+
+/*
+ * The section at index of opt, copied first if it is shared with the
+ * tree a copy was made from, so that it can be changed, see cfg_dup()
+ */
+static cfg_t *cfg_opt_ownsec(cfg_opt_t *opt, unsigned int index)
+{
+	cfg_t *sec = cfg_opt_peeksec(opt, index);
+
+	if (!sec || !cfg_shared(opt, sec) || is_set(CFGF_FROZEN, opt->sec->flags))
+		return sec;
+
+	if (cfg_opt_unshare(opt))
+		return NULL;
+
+	sec = cfg_sec_copy(opt->sec, sec);
+	if (sec && !cfg_opt_ownval(opt, index, sec)) {
+		cfg_free(sec);
+		return NULL;
+	}
+
+	return sec;
+}
+
+/* Add the directories of p to cfg, in the same order */
+static int cfg_dup_searchpath(cfg_t *cfg, cfg_searchpath_t *p)
+{
+	if (!p)
+		return CFG_SUCCESS;
+	if (cfg_dup_searchpath(cfg, p->next))
+		return CFG_FAIL;
+
+	return cfg_add_searchpath(cfg, p->dir);
+}
+
+DLLIMPORT cfg_t *cfg_dup(cfg_t *cfg)
+{
+	cfg_t *dup;
+
+	/* The values are shared, they must not change, see cfg_freeze() */
+	if (!cfg || cfg->parent || cfg->overlay || !is_set(CFGF_FROZEN, cfg->flags)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	dup = cfg_sec_copy(NULL, cfg);
+	if (!dup)
+		return NULL;
+
+	dup->refcount = 1;
+	dup->source = cfg_acquire(cfg);
+
+	if (is_set(CFGF_INTERN, dup->flags)) {
+		dup->intern = cfg_intern_new(dup);
+		if (!dup->intern) {
+			cfg_free(dup);
+			return NULL;
+		}
+	}
+
+	if (is_set(CFGF_PROFILE, dup->flags)) {
+		dup->profile = cfg_profile_new(dup);
+		if (!dup->profile) {
+			cfg_free(dup);
+			return NULL;
+		}
+	}
+
+	if (cfg_dup_searchpath(dup, cfg->path)) {
+		cfg_free(dup);
+		return NULL;
+	}
+
+	return dup;
+}
+
+/*
+ * A reader takes its reference to the current tree between entering
+ * and leaving one of two reader counts, picked by the epoch.  Having
+ * swapped in a new tree, the writer flips the epoch and waits for the
+ * count readers used to drain, twice, so that both have been empty
+ * since the swap.  A reader that read the epoch long ago cannot slip
+ * through, and new readers never hold up the writer.  After that
+ * nobody can still be about to take a reference to the old tree, and
+ * the handle can drop its own.
+ */
+struct cfg_handle_t {
+	cfg_t *cfg;
+	long readers[2];
+	long epoch;
+	long lock;
+};
+
+DLLIMPORT cfg_handle_t *cfg_handle_init(cfg_t *cfg)
+{
+	cfg_handle_t *handle;
+
+	handle = calloc(1, sizeof(*handle));
+	if (!handle)
+		return NULL;
+	handle->cfg = cfg;
+
+	return handle;
+}
+
+DLLIMPORT cfg_t *cfg_handle_acquire(cfg_handle_t *handle)
+{
+	cfg_t *cfg;
+	long epoch;
+
+	if (!handle) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	epoch = cfg_atomic_load(&handle->epoch) & 1;
+	cfg_atomic_inc(&handle->readers[epoch]);
+	cfg = cfg_atomic_loadptr(&handle->cfg);
+	if (cfg)
+		cfg_atomic_inc(&cfg->refcount);
+	cfg_atomic_dec(&handle->readers[epoch]);
+
+	return cfg;
+}
+
+DLLIMPORT int cfg_handle_swap(cfg_handle_t *handle, cfg_t *cfg)
+{
+	cfg_t *old;
+	long epoch;
+	int i;
+
+	if (!handle) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	/* One writer at a time */
+	while (cfg_atomic_xchg(&handle->lock, 1))
+		;
+
+	old = cfg_atomic_xchgptr(&handle->cfg, cfg);
+	for (i = 0; i < 2; i++) {
+		epoch = cfg_atomic_inc(&handle->epoch) - 1;
+		while (cfg_atomic_load(&handle->readers[epoch & 1]))
+			;
+	}
+
+	cfg_atomic_xchg(&handle->lock, 0);
+
+	if (old)
+		cfg_release(old);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_handle_free(cfg_handle_t *handle)
+{
+	if (!handle) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (handle->cfg)
+		cfg_release(handle->cfg);
+	free(handle);
+
+	return CFG_SUCCESS;
+}
+
+static void cfg_freeze_sec(cfg_t *cfg)
+{
+	unsigned int i, j;
+
+	/* Nothing is set on first use from now on, see cfg_opt_default() */
+	cfg_sec_lazy(cfg);
+	cfg->flags |= CFGF_FROZEN;
+	for (i = 0; cfg->opts[i].name; i++) {
+		cfg_opt_t *opt = &cfg->opts[i];
+
+		if (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC)
+			continue;
+		for (j = 0; j < opt->nvalues; j++) {
+			/* Already frozen, and not ours to change */
+			if (!cfg_shared(opt, opt->values[j]->section))
+				cfg_freeze_sec(opt->values[j]->section);
+		}
+	}
+}
+
+DLLIMPORT int cfg_freeze(cfg_t *cfg)
+{
+	cfg_fingerprint_t fp;
+
+	if (!cfg) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	cfg_freeze_sec(cfg);
+
+	/* Fill the fingerprint cache now, readers must not write it */
+	cfg_fingerprint_sec(cfg, &fp);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_include(cfg_t *cfg, cfg_opt_t *opt, int argc, const char **argv)
+{
+	struct cfg_profiler *prof;
+	cfg_profile_phase_t phase;
+	int ret;
+
+	(void)opt;		/* Unused in this predefined include FUNC */
+
+	if (!cfg || !argv) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (argc != 1) {
+		cfg_error(cfg, _("wrong number of arguments to cfg_include()"));
+		return 1;
+	}
+
+	prof = cfg_profile_of(cfg);
+	phase = cfg_profile_enter(prof, CFG_PROFILE_INCLUDE);
+	ret = cfg_lexer_include(cfg, argv[0]);
+	cfg_profile_leave(prof, phase);
+	if (ret == CFG_SUCCESS)
+		cfg_watch_add(cfg, cfg->filename);
+
+	return ret;
+}
+
+static cfg_value_t *cfg_opt_getval(cfg_opt_t *opt, unsigned int index)
+{
+	cfg_value_t *val = NULL;
+
+	if (index != 0 && !is_set(CFGF_LIST, opt->flags) && !is_set(CFGF_MULTI, opt->flags)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (cfg_frozen(opt->sec))
+		return NULL;
+
+	cfg_opt_lazyset(opt);
+
+	if (opt->simple_value.ptr)
+		val = (cfg_value_t *)opt->simple_value.ptr;
+	else {
+		if (is_set(CFGF_RESET, opt->flags)) {
+			cfg_free_value(opt);
+			opt->flags &= ~CFGF_RESET;
+		}
+		if (cfg_opt_unshare(opt))
+			return NULL;
+
+		if (index >= opt->nvalues)
+			val = cfg_addval(opt);
+		else
+			val = opt->values[index];
+	}
+
+	return val;
+}
+
+DLLIMPORT int cfg_opt_setcomment(cfg_opt_t *opt, char *comment)
+{
+	char *oldcomment, *newcomment;
+
+	if (!opt || !comment) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (cfg_frozen(opt->sec))
+		return CFG_FAIL;
+
+	oldcomment = opt->comment;
+	newcomment = strdup(comment);
+	if (!newcomment)
+		return CFG_FAIL;
+
+	cfg_mem_str(opt->sec, CFG_MEMORY_COMMENTS, -1, oldcomment);
+	cfg_mem_str(opt->sec, CFG_MEMORY_COMMENTS, 1, newcomment);
+	if (oldcomment)
+		free(oldcomment);
+	opt->comment = newcomment;
+	opt->flags |= CFGF_COMMENTS;
+	opt->flags |= CFGF_MODIFIED;
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setcomment(cfg_t *cfg, const char *name, char *comment)
+{
+	return cfg_opt_setcomment(cfg_getopt_rw(cfg, name, NULL), comment);
+}
+
+DLLIMPORT int cfg_opt_setnint(cfg_opt_t *opt, long int value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_INT) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	val->number = value;
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+/* Call the validation callback of opt for a new value, if any */
+static int cfg_validate_value(cfg_t *cfg, cfg_opt_t *opt, void *value)
+{
+	struct cfg_profiler *prof;
+	cfg_profile_phase_t phase;
+	int rc;
+
+	if (!opt || !opt->validcb2)
+		return 0;
+
+	prof = cfg_profile_of(cfg);
+	phase = cfg_profile_enter(prof, CFG_PROFILE_CALLBACK);
+	rc = (*opt->validcb2)(cfg, opt, value);
+	cfg_profile_leave(prof, phase);
+
+	return rc;
+}
+
+DLLIMPORT int cfg_setnint(cfg_t *cfg, const char *name, long int value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, &value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnint(opt, value, index);
+}
+
+DLLIMPORT int cfg_setint(cfg_t *cfg, const char *name, long int value)
+{
+	return cfg_setnint(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnint64(cfg_opt_t *opt, int64_t value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_INT64) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	val->i64 = value;
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setnint64(cfg_t *cfg, const char *name, int64_t value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, &value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnint64(opt, value, index);
+}
+
+DLLIMPORT int cfg_setint64(cfg_t *cfg, const char *name, int64_t value)
+{
+	return cfg_setnint64(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnuint32(cfg_opt_t *opt, uint32_t value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_UINT32) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	val->u32 = value;
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setnuint32(cfg_t *cfg, const char *name, uint32_t value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, &value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnuint32(opt, value, index);
+}
+
+DLLIMPORT int cfg_setuint32(cfg_t *cfg, const char *name, uint32_t value)
+{
+	return cfg_setnuint32(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnuint64(cfg_opt_t *opt, uint64_t value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_UINT64) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	val->u64 = value;
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setnuint64(cfg_t *cfg, const char *name, uint64_t value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, &value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnuint64(opt, value, index);
+}
+
+DLLIMPORT int cfg_setuint64(cfg_t *cfg, const char *name, uint64_t value)
+{
+	return cfg_setnuint64(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnint8(cfg_opt_t *opt, int8_t value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_INT8) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	val->i8 = value;
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setnint8(cfg_t *cfg, const char *name, int8_t value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, &value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnint8(opt, value, index);
+}
+
+DLLIMPORT int cfg_setint8(cfg_t *cfg, const char *name, int8_t value)
+{
+	return cfg_setnint8(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnint16(cfg_opt_t *opt, int16_t value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_INT16) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	val->i16 = value;
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setnint16(cfg_t *cfg, const char *name, int16_t value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, &value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnint16(opt, value, index);
+}
+
+DLLIMPORT int cfg_setint16(cfg_t *cfg, const char *name, int16_t value)
+{
+	return cfg_setnint16(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnint32(cfg_opt_t *opt, int32_t value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_INT32) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
 
-			if (opt->type == CFGT_RAWSEC) {
-				free(val->section->raw);
-				val->section->raw = strdup(cfg_raw_end());
-				if (!val->section->raw)
-					goto error;
-			}
+	val->i32 = value;
+	cfg_opt_changed(opt);
 
-			cfg->line = val->section->line;
-			if (opt && opt->validcb && (*opt->validcb) (cfg, opt) != 0)
-				goto error;
-			state = 0;
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setnint32(cfg_t *cfg, const char *name, int32_t value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, &value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnint32(opt, value, index);
+}
+
+DLLIMPORT int cfg_setint32(cfg_t *cfg, const char *name, int32_t value)
+{
+	return cfg_setnint32(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnuint8(cfg_opt_t *opt, uint8_t value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_UINT8) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	val->u8 = value;
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setnuint8(cfg_t *cfg, const char *name, uint8_t value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, &value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnuint8(opt, value, index);
+}
+
+DLLIMPORT int cfg_setuint8(cfg_t *cfg, const char *name, uint8_t value)
+{
+	return cfg_setnuint8(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnuint16(cfg_opt_t *opt, uint16_t value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_UINT16) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	val->u16 = value;
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setnuint16(cfg_t *cfg, const char *name, uint16_t value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, &value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnuint16(opt, value, index);
+}
+
+DLLIMPORT int cfg_setuint16(cfg_t *cfg, const char *name, uint16_t value)
+{
+	return cfg_setnuint16(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnfloat(cfg_opt_t *opt, double value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_FLOAT) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	val->fpnumber = value;
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setnfloat(cfg_t *cfg, const char *name, double value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, &value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnfloat(opt, value, index);
+}
+
+DLLIMPORT int cfg_setfloat(cfg_t *cfg, const char *name, double value)
+{
+	return cfg_setnfloat(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnbool(cfg_opt_t *opt, cfg_bool_t value, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_BOOL) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	val->boolean = value;
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_setnbool(cfg_t *cfg, const char *name, cfg_bool_t value, unsigned int index)
+{
+	return cfg_opt_setnbool(cfg_getopt_rw(cfg, name, NULL), value, index);
+}
+
+DLLIMPORT int cfg_setbool(cfg_t *cfg, const char *name, cfg_bool_t value)
+{
+	return cfg_setnbool(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_opt_setnstr_take(cfg_opt_t *opt, char *value, size_t len, unsigned int index)
+{
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_STR) {
+		free(value);
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val) {
+		free(value);
+		return CFG_FAIL;
+	}
+
+	/* Shared strings are allocated by the table, adopting is a copy */
+	if (value && (void *)val != (void *)opt->simple_value.ptr && cfg_intern_of(opt->sec)) {
+		char *str = value;
+
+		value = cfg_intern_get(cfg_intern_of(opt->sec), str, len);
+		free(str);
+		if (!value)
+			return CFG_FAIL;
+	} else if (value && (void *)val != (void *)opt->simple_value.ptr) {
+		cfg_mem_count(opt->sec, CFG_MEMORY_STRINGS, 1, len + 1);
+	}
+
+	cfg_value_setstr(opt, val, value, len);
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_opt_setnstr_len(cfg_opt_t *opt, const char *value, size_t len, unsigned int index)
+{
+	char *newstr = NULL;
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_STR) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	if (value) {
+		newstr = cfg_value_strdup(opt, val, value, len);
+		if (!newstr)
+			return CFG_FAIL;
+	}
+
+	cfg_value_setstr(opt, val, newstr, len);
+	cfg_opt_changed(opt);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_opt_setnstr(cfg_opt_t *opt, const char *value, unsigned int index)
+{
+	return cfg_opt_setnstr_len(opt, value, value ? strlen(value) : 0, index);
+}
+
+DLLIMPORT int cfg_setnstr(cfg_t *cfg, const char *name, const char *value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, (void *)value))
+		return CFG_FAIL;
+
+	return cfg_opt_setnstr(opt, value, index);
+}
+
+DLLIMPORT int cfg_setstr(cfg_t *cfg, const char *name, const char *value)
+{
+	return cfg_setnstr(cfg, name, value, 0);
+}
+
+DLLIMPORT int cfg_setnstr_take(cfg_t *cfg, const char *name, char *value, unsigned int index)
+{
+	cfg_opt_t *opt;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (cfg_validate_value(cfg, opt, (void *)value)) {
+		free(value);
+		return CFG_FAIL;
+	}
+
+	return cfg_opt_setnstr_take(opt, value, value ? strlen(value) : 0, index);
+}
+
+DLLIMPORT int cfg_setstr_take(cfg_t *cfg, const char *name, char *value)
+{
+	return cfg_setnstr_take(cfg, name, value, 0);
+}
+
+static int cfg_addlist_internal(cfg_opt_t *opt, unsigned int nvalues, va_list ap)
+{
+	int result = CFG_FAIL;
+	unsigned int i;
+
+	for (i = 0; i < nvalues; i++) {
+		switch (opt->type) {
+		case CFGT_INT:
+			result = cfg_opt_setnint(opt, va_arg(ap, int), opt->nvalues);
+			break;
+
+		case CFGT_INT8:
+			result = cfg_opt_setnint8(opt, (int8_t)va_arg(ap, int), opt->nvalues);
+			break;
+
+		case CFGT_INT16:
+			result = cfg_opt_setnint16(opt, (int16_t)va_arg(ap, int), opt->nvalues);
+			break;
+
+		case CFGT_INT32:
+			result = cfg_opt_setnint32(opt, va_arg(ap, int32_t), opt->nvalues);
+			break;
+
+		case CFGT_INT64:
+			result = cfg_opt_setnint64(opt, va_arg(ap, int64_t), opt->nvalues);
+			break;
+
+		case CFGT_UINT8:
+			result = cfg_opt_setnuint8(opt, (uint8_t)va_arg(ap, int), opt->nvalues);
+			break;
+
+		case CFGT_UINT16:
+			result = cfg_opt_setnuint16(opt, (uint16_t)va_arg(ap, int), opt->nvalues);
+			break;
+
+		case CFGT_UINT32:
+			result = cfg_opt_setnuint32(opt, va_arg(ap, uint32_t), opt->nvalues);
 			break;
 
-		case 6:	/* expecting a title for a section */
-			if (tok != CFGT_STR) {
-				cfg_error(cfg, _("missing title for section '%s'"), opt ? opt->name : "");
-				goto error;
-			} else {
-				opttitle = strdup(cfg_yylval);
-				if (!opttitle)
-					goto error;
-			}
-			state = 5;
+		case CFGT_UINT64:
+			result = cfg_opt_setnuint64(opt, va_arg(ap, uint64_t), opt->nvalues);
 			break;
 
-		case 7:	/* expecting an opening parenthesis for a function */
-			if (tok != '(') {
-				cfg_error(cfg, _("missing parenthesis for function '%s'"), opt ? opt->name : "");
-				goto error;
-			}
-			state = 8;
+		case CFGT_FLOAT:
+			result = cfg_opt_setnfloat(opt, va_arg(ap, double), opt->nvalues);
 			break;
 
-		case 8:	/* expecting a function parameter or a closing paren */
-			if (tok == ')') {
-				if (call_function(cfg, opt, &funcopt))
-					goto error;
-				/* Replace an include() call
-				 * by its expanded content
-				 * in the raw capture*/
-				if (cfg_raw_active() && opt && opt->func == cfg_include)
-					cfg_raw_seek(rawmark);
-				state = 0;
-			} else if (tok == CFGT_STR) {
-				val = cfg_addval(&funcopt);
-				if (!val)
-					goto error;
-
-				val->string = strdup(cfg_yylval);
-				if (!val->string)
-					goto error;
+		case CFGT_BOOL:
+			result = cfg_opt_setnbool(opt, va_arg(ap, cfg_bool_t), opt->nvalues);
+			break;
 
-				state = 9;
-			} else {
-				cfg_error(cfg, _("syntax error in call of function '%s'"), opt ? opt->name : "");
-				goto error;
-			}
+		case CFGT_STR:
+			result = cfg_opt_setnstr(opt, va_arg(ap, char *), opt->nvalues);
 			break;
 
-		case 9:	/* expecting a comma in a function or a closing paren */
-			if (tok == ')') {
-				if (call_function(cfg, opt, &funcopt))
-					goto error;
-				/* Replace an include() call
-				 * by its expanded content
-				 * in the raw capture*/
-				if (cfg_raw_active() && opt && opt->func == cfg_include)
-					cfg_raw_seek(rawmark);
-				state = 0;
-			} else if (tok == ',') {
-				state = 8;
-			} else {
-				cfg_error(cfg, _("syntax error in call of function '%s'"), opt ? opt->name : "");
-				goto error;
-			}
+		case CFGT_FUNC:
+		case CFGT_SEC:
+		default:
+			result = CFG_SUCCESS;
 			break;
+		}
+	}
 
-		case 10: /* unknown option, mini-discard parser states: 10-15 */
-			if (comment) {
-				free(comment);
-				comment = NULL;
-			}
+	return result;
+}
 
-			if (tok == '+') {
-				ignore = '=';
-				state = 13; /* Append to list, should be followed by '=' */
-			} else if (tok == '=') {
-				ignore = 0;
-				state = 14; /* Assignment, regular handling */
-			} else if (tok == '(') {
-				ignore = ')';
-				state = 13; /* Function, ignore until end of param list */
-			} else if (tok == '{') {
-				state = 12; /* Section, ignore all until closing brace */
-			} else if (tok == CFGT_STR) {
-				state = 11; /* No '=' ... must be a titled section */
-			} else if (tok == '}') {
-				if (comment)
-					free(comment);
+DLLIMPORT int cfg_setlist(cfg_t *cfg, const char *name, unsigned int nvalues, ...)
+{
+	va_list ap;
+	cfg_opt_t *opt = cfg_getopt_rw(cfg, name, NULL);
+
+	if (!opt || !is_set(CFGF_LIST, opt->flags)) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (cfg_frozen(opt->sec))
+		return CFG_FAIL;
+
+	cfg_free_value(opt);
+	va_start(ap, nvalues);
+	cfg_addlist_internal(opt, nvalues, ap);
+	va_end(ap);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_addlist(cfg_t *cfg, const char *name, unsigned int nvalues, ...)
+{
+	va_list ap;
+	cfg_opt_t *opt = cfg_getopt_rw(cfg, name, NULL);
+
+	if (!opt || !is_set(CFGF_LIST, opt->flags)) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (cfg_frozen(opt->sec))
+		return CFG_FAIL;
+
+	opt->flags &= ~CFGF_RESET;
+	va_start(ap, nvalues);
+	cfg_addlist_internal(opt, nvalues, ap);
+	va_end(ap);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT cfg_t *cfg_addtsec(cfg_t *cfg, const char *name, const char *title)
+{
+	cfg_t *sec;
+	cfg_opt_t *opt;
+	cfg_value_t *val;
+
+	/* Read-only, see cfg_overlay() */
+	if (cfg && cfg->overlay) {
+		errno = EPERM;
+		return NULL;
+	}
+
+	sec = cfg_gettsec(cfg, name, title);
+	if (sec)
+		return sec;
+
+	opt = cfg_getopt_rw(cfg, name, NULL);
+	if (!opt) {
+		cfg_error(cfg, _("no such option '%s'"), name);
+		return NULL;
+	}
+	val = cfg_setopt(cfg, opt, title);
+	if (!val)
+		return NULL;
+
+	val->section->path = cfg->path; /* Remember global search path. */
+	val->section->line = 1;
+	val->section->errfunc = cfg->errfunc;
+
+	return val->section;
+}
+
+DLLIMPORT int cfg_opt_rmnsec(cfg_opt_t *opt, unsigned int index)
+{
+	unsigned int n;
+	cfg_value_t *val;
+
+	if (!opt || opt->type != CFGT_SEC) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	n = cfg_opt_size(opt);
+	if (index >= n)
+		return CFG_FAIL;
+
+	val = cfg_opt_getval(opt, index);
+	if (!val)
+		return CFG_FAIL;
+
+	if (index + 1 != n) {
+		/* not removing last, move the tail */
+		memmove(&opt->values[index], &opt->values[index + 1], sizeof(opt->values[index]) * (n - index - 1));
+	}
+	--opt->nvalues;
+	cfg_invalidate(opt->sec);
+
+	/* Shrink the array as cfg_addval() grows it */
+	n = opt->nvalues;
+	if (!n) {
+		cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, -1, sizeof(cfg_value_t *));
+		free(opt->values);
+		opt->values = NULL;
+	} else if (!(n & (n - 1))) {
+		void *ptr = reallocarray(opt->values, n, sizeof(cfg_value_t *));
+
+		if (ptr)
+			opt->values = ptr;
+		cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, -1, n * 2 * sizeof(cfg_value_t *));
+		cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, 1, n * sizeof(cfg_value_t *));
+	}
+
+	/* With its value, see cfg_opt_unshare() */
+	if (cfg_shared(opt, val->section))
+		return CFG_SUCCESS;
+
+	val->section->path = NULL; /* Global search path */
+	cfg_free(val->section);
+	cfg_mem_count(opt->sec, CFG_MEMORY_VALUES, -1, sizeof(cfg_value_t));
+	free(val);
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_rmnsec(cfg_t *cfg, const char *name, unsigned int index)
+{
+	return cfg_opt_rmnsec(cfg_getopt_rw(cfg, name, NULL), index);
+}
+
+DLLIMPORT int cfg_rmsec(cfg_t *cfg, const char *name)
+{
+	cfg_opt_t *opt;
+	unsigned int index;
+
+	opt = cfg_getopt_rw(cfg, name, &index);
+	return cfg_opt_rmnsec(opt, index);
+}
+
+DLLIMPORT int cfg_opt_rmtsec(cfg_opt_t *opt, const char *title)
+{
+	unsigned int i, n;
+
+	if (!opt || !title) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	if (!is_set(CFGF_TITLE, opt->flags))
+		return CFG_FAIL;
+
+	n = cfg_opt_size(opt);
+	for (i = 0; i < n; i++) {
+		cfg_t *sec = cfg_opt_peeksec(opt, i);
+
+		if (!sec || !sec->title)
+			return CFG_FAIL;
+
+		if (is_set(CFGF_NOCASE, opt->flags)) {
+			if (strcasecmp(title, sec->title) == 0)
+				break;
+		} else {
+			if (strcmp(title, sec->title) == 0)
+				break;
+		}
+	}
+	if (i == n)
+		return CFG_FAIL;
+
+	return cfg_opt_rmnsec(opt, i);
+}
+
+DLLIMPORT int cfg_rmtsec(cfg_t *cfg, const char *name, const char *title)
+{
+	return cfg_opt_rmtsec(cfg_getopt_rw(cfg, name, NULL), title);
+}
+
+/*
+ * Output buffer behind all the print functions.  With a write callback
+ * the buffer is flushed to it whenever it fills up, without one the
+ * buffer grows to hold all of the output, see cfg_print_to_buffer().
+ */
+struct cfg_printer {
+	char *buf;
+	size_t len;
+	size_t size;
+	cfg_write_func_t write;
+	void *arg;
+	FILE *fp;		/* Handed to user print functions, if any */
+	FILE *tmp;		/* Stand-in for fp when not printing to a FILE */
+	int error;
+};
+
+#define CFG_PRINTBUF_SIZE 4096
+
+static const char cfg_digits[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static const char cfg_spaces[] = "                                ";
+
+static int cfg_pr_fwrite(void *arg, const char *buf, size_t len)
+{
+	return fwrite(buf, 1, len, (FILE *)arg) == len ? 0 : -1;
+}
+
+static void cfg_pr_flush(cfg_printer_t *pr)
+{
+	if (!pr->write)
+		return;
+
+	if (pr->len && !pr->error && pr->write(pr->arg, pr->buf, pr->len))
+		pr->error = 1;
+	pr->len = 0;
+}
 
-				return force_state >= 10 ? STATE_CONTINUE : STATE_EOF;
+static void cfg_pr_write(cfg_printer_t *pr, const char *s, size_t len)
+{
+	if (pr->size - pr->len < len) {
+		if (pr->write) {
+			cfg_pr_flush(pr);
+			if (len >= pr->size) {
+				if (!pr->error && pr->write(pr->arg, s, len))
+					pr->error = 1;
+				return;
 			}
-			break;
+		} else {
+			size_t size = pr->size;
+			char *buf;
 
-		case 11: /* unknown option, expecting start of title section */
-			if (tok != '{') {
-				cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
-				goto error;
-			}
-			state = 12;
-			break;
+			while (size - pr->len < len)
+				size *= 2;
 
-		case 12: /* unknown option, recursively ignore entire sub-section */
-			if (tok == '}') {
-				state = force_state >= 10 ? 15 : 0;
-				break;
-			} else if (tok == CFGT_COMMENT) {
-				state = 15;
-				rc = cfg_parse_internal(cfg, level + 1, 15, NULL);
-				if (rc != STATE_CONTINUE)
-					goto error;
-				break;
-			} else {
-				rc = cfg_parse_internal(cfg, level + 1, 10, NULL);
-				if (rc != STATE_CONTINUE)
-					goto error;
-				state = force_state >= 10 ? 15 : 0;
+			buf = realloc(pr->buf, size);
+			if (!buf) {
+				pr->error = 1;
+				return;
 			}
-			break;
+			pr->buf = buf;
+			pr->size = size;
+		}
+	}
 
-		case 13: /* unknown option, consume tokens silently until end of func/list */
-			if (tok != ignore)
-				break;
+	memcpy(pr->buf + pr->len, s, len);
+	pr->len += len;
+}
 
-			if (ignore == '=') {
-				ignore = 0;
-				state = 14;
-				break;
-			}
+static void cfg_pr_puts(cfg_printer_t *pr, const char *s)
+{
+	cfg_pr_write(pr, s, strlen(s));
+}
 
-			ignore = 0;
-			state = force_state >= 10 ? 15 : 0;
-			break;
+static void cfg_pr_putc(cfg_printer_t *pr, char c)
+{
+	if (pr->len < pr->size)
+		pr->buf[pr->len++] = c;
+	else
+		cfg_pr_write(pr, &c, 1);
+}
 
-		case 14: /* unknown option, assuming value or start of list */
-			if (tok == '{') {
-				ignore = '}';
-				state = 13;
-				break;
-			}
+/* Two digits at a time, from the end, instead of going via printf() */
+static void cfg_pr_uint(cfg_printer_t *pr, uint64_t val, int neg)
+{
+	char num[21];
+	char *p = num + sizeof(num);
 
-			if (tok != CFGT_STR) {
-				cfg_error(cfg, _("unexpected token '%s'"), cfg_yylval);
-				goto error;
-			}
+	while (val >= 100) {
+		unsigned int i = (unsigned int)(val % 100) * 2;
 
-			ignore = 0;
-			state = force_state >= 10 ? 15 : 0;
+		val /= 100;
+		*--p = cfg_digits[i + 1];
+		*--p = cfg_digits[i];
+	}
+	if (val >= 10) {
+		unsigned int i = (unsigned int)val * 2;
+
+		*--p = cfg_digits[i + 1];
+		*--p = cfg_digits[i];
+	} else {
+		*--p = '0' + (char)val;
+	}
+	if (neg)
+		*--p = '-';
+
+	cfg_pr_write(pr, p, num + sizeof(num) - p);
+}
+
+static void cfg_pr_int(cfg_printer_t *pr, int64_t val)
+{
+	if (val < 0)
+		cfg_pr_uint(pr, 0 - (uint64_t)val, 1);
+	else
+		cfg_pr_uint(pr, (uint64_t)val, 0);
+}
+
+/* Copy runs of plain characters in one go, escape only '"' and '\' */
+/* NUL bytes are printed as "\x00", which the lexer reads back */
+static void cfg_pr_quoted(cfg_printer_t *pr, const char *str, size_t len)
+{
+	cfg_pr_putc(pr, '"');
+	while (str && len) {
+		size_t n = strcspn(str, "\"\\");
+
+		cfg_pr_write(pr, str, n);
+		str += n;
+		len -= n;
+		if (!len)
 			break;
 
-		case 15: /* unknown option, dummy read of next parameter in sub-section */
-			if (tok == CFGT_COMMENT)
+		len--;
+		if (!*str) {
+			cfg_pr_puts(pr, "\\x00");
+			str++;
+			continue;
+		}
+
+		cfg_pr_putc(pr, '\\');
+		cfg_pr_putc(pr, *str++);
+	}
+	cfg_pr_putc(pr, '"');
+}
+
+/* Length of the valid UTF-8 sequence at str, 0 if there is none */
+static size_t cfg_utf8_len(const unsigned char *str, size_t len)
+{
+	unsigned char lo = 0x80, hi = 0xbf;
+	size_t n, i;
+
+	if (str[0] >= 0xc2 && str[0] <= 0xdf)
+		n = 2;
+	else if (str[0] >= 0xe0 && str[0] <= 0xef)
+		n = 3;
+	else if (str[0] >= 0xf0 && str[0] <= 0xf4)
+		n = 4;
+	else
+		return 0;
+
+	/* No overlong forms, surrogates or code points above U+10FFFF */
+	if (str[0] == 0xe0)
+		lo = 0xa0;
+	else if (str[0] == 0xed)
+		hi = 0x9f;
+	else if (str[0] == 0xf0)
+		lo = 0x90;
+	else if (str[0] == 0xf4)
+		hi = 0x8f;
+
+	if (len < n || str[1] < lo || str[1] > hi)
+		return 0;
+	for (i = 2; i < n; i++) {
+		if (str[i] < 0x80 || str[i] > 0xbf)
+			return 0;
+	}
+
+	return n;
+}
+
+/*
+ * A JSON string, control characters escaped, valid UTF-8 as it is, and
+ * other bytes escaped as the code point of the same value, \u0080 to
+ * \u00ff, so the output is always valid JSON
+ */
+static void cfg_pr_json(cfg_printer_t *pr, const char *str, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	char esc[6] = { '\\', 'u', '0', '0' };
+	size_t n, u;
+
+	cfg_pr_putc(pr, '"');
+	while (len) {
+		for (n = 0; n < len; n++) {
+			unsigned char c = str[n];
+
+			if (c < 0x20 || c == '"' || c == '\\')
+				break;
+			if (c < 0x80)
 				continue;
-			else if (tok == '}')
-				return force_state >= 10 ? STATE_CONTINUE : STATE_EOF;
-			state = 10;
+
+			u = cfg_utf8_len((const unsigned char *)str + n, len - n);
+			if (!u)
+				break;
+			n += u - 1;
+		}
+		cfg_pr_write(pr, str, n);
+		str += n;
+		len -= n;
+		if (!len)
 			break;
 
+		switch (*str) {
+		case '"':
+		case '\\':
+			cfg_pr_putc(pr, '\\');
+			cfg_pr_putc(pr, *str);
+			break;
+		case '\n':
+			cfg_pr_puts(pr, "\\n");
+			break;
+		case '\t':
+			cfg_pr_puts(pr, "\\t");
+			break;
 		default:
-			cfg_error(cfg, _("Internal error in cfg_parse_internal(), unknown state %d"), state);
-			goto error;
+			esc[4] = hex[(unsigned char)*str >> 4];
+			esc[5] = hex[*str & 0xf];
+			cfg_pr_write(pr, esc, sizeof(esc));
+			break;
 		}
+		str++;
+		len--;
 	}
+	cfg_pr_putc(pr, '"');
+}
 
-	if (comment)
-		free(comment);
-
-	return STATE_EOF;
+static void cfg_pr_indent(cfg_printer_t *pr, int indent)
+{
+	size_t len = indent > 0 ? (size_t)indent * 2 : 0;
 
-error:
-	if (opttitle)
-		free(opttitle);
-	if (comment)
-		free(comment);
+	while (len) {
+		size_t n = len < sizeof(cfg_spaces) - 1 ? len : sizeof(cfg_spaces) - 1;
 
-	return STATE_ERROR;
+		cfg_pr_write(pr, cfg_spaces, n);
+		len -= n;
+	}
 }
 
-DLLIMPORT int cfg_parse_fp(cfg_t *cfg, FILE *fp)
+/*
+ * User print functions take a FILE.  When not printing to one, let
+ * them print to a temporary file and copy the result from there.
+ */
+static void cfg_pr_pf(cfg_printer_t *pr, cfg_opt_t *opt, unsigned int index)
 {
-	int ret;
+	char chunk[512];
+	long len;
 
-	if (!cfg || !fp) {
-		errno = EINVAL;
-		return CFG_PARSE_ERROR;
+	if (pr->fp) {
+		cfg_pr_flush(pr);
+		opt->pf(opt, index, pr->fp);
+		return;
 	}
 
-	if (!cfg->filename)
-		cfg->filename = strdup("FILE");
-	if (!cfg->filename)
-		return CFG_PARSE_ERROR;
+	if (!pr->tmp) {
+		pr->tmp = tmpfile();
+		if (!pr->tmp) {
+			pr->error = 1;
+			return;
+		}
+	}
 
-	cfg->line = 1;
-	cfg_scan_fp_begin(fp);
-	ret = cfg_parse_internal(cfg, 0, -1, NULL);
-	cfg_scan_fp_end();
-	if (ret == STATE_ERROR)
-		return CFG_PARSE_ERROR;
+	rewind(pr->tmp);
+	opt->pf(opt, index, pr->tmp);
+	len = ftell(pr->tmp);
+	rewind(pr->tmp);
+
+	while (len > 0) {
+		size_t num = (size_t)len < sizeof(chunk) ? (size_t)len : sizeof(chunk);
+
+		num = fread(chunk, 1, num, pr->tmp);
+		if (!num)
+			break;
+		cfg_pr_write(pr, chunk, num);
+		len -= (long)num;
+	}
+	if (len)
+		pr->error = 1;
+}
+
+static int cfg_pr_init(cfg_printer_t *pr, char *buf, size_t size, cfg_write_func_t cb, void *arg, FILE *fp)
+{
+	memset(pr, 0, sizeof(*pr));
+	pr->write = cb;
+	pr->arg = arg;
+	pr->fp = fp;
+	pr->size = size;
+	pr->buf = buf;
+	if (!buf) {
+		pr->buf = malloc(size);
+		if (!pr->buf)
+			return CFG_FAIL;
+	}
 
 	return CFG_SUCCESS;
 }
 
-static char *cfg_make_fullpath(const char *dir, const char *file)
+/* Flush and release a printer, returns CFG_FAIL if any write failed */
+static int cfg_pr_done(cfg_printer_t *pr)
 {
-	int np;
-	char *path;
-	size_t len;
+	cfg_pr_flush(pr);
+	if (pr->tmp)
+		fclose(pr->tmp);
 
-	if (!dir || !file) {
+	return pr->error ? CFG_FAIL : CFG_SUCCESS;
+}
+
+static int cfg_pr_var(cfg_printer_t *pr, cfg_opt_t *opt, unsigned int index)
+{
+	cfg_value_t zero, *val;
+	char num[32];
+
+	/* Not counted as reads with CFGF_STATS, missing values print as 0 */
+	memset(&zero, 0, sizeof(zero));
+	val = cfg_opt_peek(opt, index);
+	if (!val)
+		val = &zero;
+
+	switch (opt->type) {
+	case CFGT_INT:
+		cfg_pr_int(pr, val->number);
+		break;
+
+	case CFGT_INT8:
+		cfg_pr_int(pr, val->i8);
+		break;
+
+	case CFGT_INT16:
+		cfg_pr_int(pr, val->i16);
+		break;
+
+	case CFGT_INT32:
+		cfg_pr_int(pr, val->i32);
+		break;
+
+	case CFGT_INT64:
+		cfg_pr_int(pr, val->i64);
+		break;
+
+	case CFGT_UINT8:
+		cfg_pr_uint(pr, val->u8, 0);
+		break;
+
+	case CFGT_UINT16:
+		cfg_pr_uint(pr, val->u16, 0);
+		break;
+
+	case CFGT_UINT32:
+		cfg_pr_uint(pr, val->u32, 0);
+		break;
+
+	case CFGT_UINT64:
+		cfg_pr_uint(pr, val->u64, 0);
+		break;
+
+	case CFGT_FLOAT:
+		cfg_pr_write(pr, num, cfg_dtoa(val->fpnumber, num));
+		break;
+
+	case CFGT_STR:
+		cfg_pr_quoted(pr, val->string, cfg_value_strlen(opt, val));
+		break;
+
+	case CFGT_BOOL:
+		cfg_pr_puts(pr, val->boolean ? "true" : "false");
+		break;
+
+	case CFGT_NONE:
+	case CFGT_SEC:
+	case CFGT_RAWSEC:
+	case CFGT_FUNC:
+	case CFGT_PTR:
+	case CFGT_COMMENT:
+		break;
+	}
+
+	return CFG_SUCCESS;
+}
+
+DLLIMPORT int cfg_opt_nprint_var(cfg_opt_t *opt, unsigned int index, FILE *fp)
+{
+	char buf[CFG_PRINTBUF_SIZE];
+	struct cfg_lazyopt lo;
+	cfg_printer_t pr;
+
+	if (!opt || !fp) {
 		errno = EINVAL;
-		return NULL;
+		return CFG_FAIL;
 	}
 
-	len = strlen(dir) + strlen(file) + 2;
-	path = malloc(len);
-	if (!path)
-		return NULL;
+	opt = cfg_opt_default(opt, &lo);
+	cfg_pr_init(&pr, buf, sizeof(buf), cfg_pr_fwrite, fp, fp);
+	cfg_pr_var(&pr, opt, index);
 
-	np = snprintf(path, len, "%s/%s", dir, file);
+	return cfg_pr_done(&pr);
+}
 
-	/*
-	 * np is the number of characters that would have
-	 * been printed if there was enough room in path.
-	 * if np >= n then the snprintf() was truncated
-	 * (which must be a bug).
-	 */
-	assert(np < (int)len);
+static void cfg_pr_value(cfg_printer_t *pr, cfg_opt_t *opt, unsigned int index)
+{
+	if (opt->pf)
+		cfg_pr_pf(pr, opt, index);
+	else
+		cfg_pr_var(pr, opt, index);
+}
+
+static int cfg_pr_opt(cfg_printer_t *pr, cfg_opt_t *opt,
+		      cfg_print_filter_func_t pff, int indent)
+{
+	if (is_set(CFGF_COMMENTS, opt->flags) && opt->comment) {
+		cfg_pr_indent(pr, indent);
+		cfg_pr_puts(pr, "/* ");
+		cfg_pr_puts(pr, opt->comment);
+		cfg_pr_puts(pr, " */\n");
+	}
+
+	if (opt->type == CFGT_SEC) {
+		cfg_t *sec;
+		unsigned int i;
+
+		for (i = 0; i < cfg_opt_size(opt); i++) {
+			sec = cfg_opt_peeksec(opt, i);
+			cfg_pr_indent(pr, indent);
+			cfg_pr_puts(pr, opt->name);
+			if (is_set(CFGF_TITLE, opt->flags)) {
+				cfg_pr_puts(pr, " \"");
+				cfg_pr_puts(pr, cfg_title(sec));
+				cfg_pr_putc(pr, '"');
+			}
+			cfg_pr_puts(pr, " {\n");
+			cfg_pr_sec(pr, sec, pff, indent + 1);
+			cfg_pr_indent(pr, indent);
+			cfg_pr_puts(pr, "}\n");
+		}
+	} else if (opt->type == CFGT_RAWSEC) {
+		cfg_t *sec;
+		unsigned int i;
+
+		for (i = 0; i < cfg_opt_size(opt); i++) {
+			sec = cfg_opt_peeksec(opt, i);
+			cfg_pr_indent(pr, indent);
+			cfg_pr_puts(pr, opt->name);
+			if (is_set(CFGF_TITLE, opt->flags)) {
+				cfg_pr_puts(pr, " \"");
+				cfg_pr_puts(pr, cfg_title(sec));
+				cfg_pr_putc(pr, '"');
+			}
+			cfg_pr_puts(pr, " {");
+			cfg_pr_puts(pr, sec->raw ? sec->raw : "");
+			cfg_pr_puts(pr, "}\n");
+		}
+	} else if (opt->type != CFGT_FUNC && opt->type != CFGT_NONE) {
+		if (is_set(CFGF_LIST, opt->flags)) {
+			cfg_pr_indent(pr, indent);
+			cfg_pr_puts(pr, opt->name);
+			cfg_pr_puts(pr, " = {");
 
-	return path;
-}
+			if (opt->nvalues) {
+				unsigned int i;
 
-DLLIMPORT char *cfg_searchpath(cfg_searchpath_t *p, const char *file)
-{
-	char *fullpath;
-#ifdef HAVE_SYS_STAT_H
-	struct stat st;
-	int err;
-#endif
+				cfg_pr_value(pr, opt, 0);
+				for (i = 1; i < opt->nvalues; i++) {
+					cfg_pr_puts(pr, ", ");
+					cfg_pr_value(pr, opt, i);
+				}
+			}
 
-	if (!p || !file) {
-		errno = EINVAL;
-		return NULL;
-	}
+			cfg_pr_putc(pr, '}');
+		} else {
+			cfg_pr_indent(pr, indent);
+			/* comment out the option if is not set */
+			if (cfg_opt_size(opt) == 0 ||
+			    (opt->type == CFGT_STR && !cfg_opt_peek(opt, 0)->string))
+				cfg_pr_puts(pr, "# ");
+			cfg_pr_puts(pr, opt->name);
+			cfg_pr_putc(pr, '=');
+			cfg_pr_value(pr, opt, 0);
+		}
 
-	if (file[0] == '/') {
-		fullpath = strdup(file);
-		if (!fullpath)
-			return NULL;
-		goto check;
+		cfg_pr_putc(pr, '\n');
+	} else if (opt->pf) {
+		cfg_pr_indent(pr, indent);
+		cfg_pr_pf(pr, opt, 0);
+		cfg_pr_putc(pr, '\n');
 	}
 
-	if ((fullpath = cfg_searchpath(p->next, file)) != NULL)
-		return fullpath;
+	return CFG_SUCCESS;
+}
 
-	if ((fullpath = cfg_make_fullpath(p->dir, file)) == NULL)
-		return NULL;
+static int cfg_pr_sec(cfg_printer_t *pr, cfg_t *cfg,
+		      cfg_print_filter_func_t fb_pff, int indent)
+{
+	int i, result = CFG_SUCCESS;
+	struct cfg_lazyopt lo;
 
-check:
-#ifdef HAVE_SYS_STAT_H
-	err = stat((const char *)fullpath, &st);
-	if ((!err) && S_ISREG(st.st_mode))
-		return fullpath;
-#else
-	/* needs an alternative check here for win32 */
-#endif
+	for (i = 0; cfg->opts[i].name; i++) {
+		cfg_print_filter_func_t pff = cfg->pff ? cfg->pff : fb_pff;
+		if (pff && pff(cfg, &cfg->opts[i]))
+			continue;
+		result += cfg_pr_opt(pr, cfg_opt_default(&cfg->opts[i], &lo), pff, indent);
+	}
 
-	free(fullpath);
-	return NULL;
+	return result;
 }
 
-DLLIMPORT int cfg_parse(cfg_t *cfg, const char *filename)
+DLLIMPORT int cfg_opt_print_indent(cfg_opt_t *opt, FILE *fp, int indent)
 {
-	int ret;
-	char *fn;
-	FILE *fp;
+	char buf[CFG_PRINTBUF_SIZE];
+	struct cfg_lazyopt lo;
+	cfg_printer_t pr;
+	int result;
 
-	if (!cfg || !filename) {
+	if (!opt || !fp) {
 		errno = EINVAL;
-		return CFG_FILE_ERROR;
+		return CFG_FAIL;
 	}
 
-	if (cfg->path)
-		fn = cfg_searchpath(cfg->path, filename);
-	else
-		fn = cfg_tilde_expand(filename);
-	if (!fn)
-		return CFG_FILE_ERROR;
-
-	free(cfg->filename);
-	cfg->filename = fn;
-
-	fp = fopen(cfg->filename, "r");
-	if (!fp)
-		return CFG_FILE_ERROR;
+	opt = cfg_opt_default(opt, &lo);
+	cfg_pr_init(&pr, buf, sizeof(buf), cfg_pr_fwrite, fp, fp);
+	result = cfg_pr_opt(&pr, opt, NULL, indent);
+	if (cfg_pr_done(&pr))
+		return CFG_FAIL;
 
-	ret = cfg_parse_fp(cfg, fp);
-	fclose(fp);
+	return result;
+}
 
-	return ret;
+DLLIMPORT int cfg_opt_print(cfg_opt_t *opt, FILE *fp)
+{
+	return cfg_opt_print_indent(opt, fp, 0);
 }
 
-DLLIMPORT int cfg_parse_buf(cfg_t *cfg, const char *buf)
+DLLIMPORT int cfg_print_indent(cfg_t *cfg, FILE *fp, int indent)
 {
-	int ret;
-	char *fn;
-	FILE *fp;
+	char buf[CFG_PRINTBUF_SIZE];
+	cfg_printer_t pr;
+	int result;
 
-	if (!cfg) {
+	if (!cfg || !fp || cfg_overlay_nosec(cfg)) {
 		errno = EINVAL;
-		return CFG_PARSE_ERROR;
+		return CFG_FAIL;
 	}
 
-	if (!buf)
-		return CFG_SUCCESS;
+	cfg_pr_init(&pr, buf, sizeof(buf), cfg_pr_fwrite, fp, fp);
+	result = cfg_pr_sec(&pr, cfg, NULL, indent);
+	if (cfg_pr_done(&pr))
+		return CFG_FAIL;
 
-	fn = strdup("[buf]");
-	if (!fn)
-		return CFG_PARSE_ERROR;
+	return result;
+}
 
-	free(cfg->filename);
-	cfg->filename = fn;
+DLLIMPORT int cfg_print(cfg_t *cfg, FILE *fp)
+{
+	return cfg_print_indent(cfg, fp, 0);
+}
 
-	fp = fmemopen((void *)buf, strlen(buf), "r");
-	if (!fp) {
-		/*
-		 * fmemopen() on older GLIBC versions do not accept zero
-		 * length buffers for some reason.  This is a workaround.
-		 */
-		if (strlen(buf) > 0)
-			return CFG_FILE_ERROR;
+DLLIMPORT int cfg_print_cb(cfg_t *cfg, cfg_write_func_t cb, void *arg)
+{
+	char buf[CFG_PRINTBUF_SIZE];
+	cfg_printer_t pr;
+	int result;
 
-		return CFG_SUCCESS;
+	if (!cfg || !cb || cfg_overlay_nosec(cfg)) {
+		errno = EINVAL;
+		return CFG_FAIL;
 	}
 
-	ret = cfg_parse_fp(cfg, fp);
-	fclose(fp);
+	cfg_pr_init(&pr, buf, sizeof(buf), cb, arg, NULL);
+	result = cfg_pr_sec(&pr, cfg, NULL, 0);
+	if (cfg_pr_done(&pr))
+		return CFG_FAIL;
 
-	return ret;
+	return result;
 }
 
-DLLIMPORT cfg_t *cfg_init(cfg_opt_t *opts, cfg_flag_t flags)
+DLLIMPORT int cfg_print_to_buffer(cfg_t *cfg, char **buf, size_t *len)
 {
-	cfg_t *cfg;
-
-	cfg = calloc(1, sizeof(cfg_t));
-	if (!cfg)
-		return NULL;
+	cfg_printer_t pr;
+	int result;
 
-	cfg->name = strdup("root");
-	if (!cfg->name) {
-		free(cfg);
-		return NULL;
+	if (!cfg || !buf || cfg_overlay_nosec(cfg)) {
+		errno = EINVAL;
+		return CFG_FAIL;
 	}
 
-	cfg->opts = cfg_dupopt_array(opts);
-	if (!cfg->opts) {
-		free(cfg->name);
-		free(cfg);
-		return NULL;
+	if (cfg_pr_init(&pr, NULL, CFG_PRINTBUF_SIZE, NULL, NULL, NULL)) {
+		errno = ENOMEM;
+		return CFG_FAIL;
 	}
 
-	cfg->flags = flags;
-	cfg->filename = NULL;
-	cfg->line = 0;
-	cfg->errfunc = NULL;
-
-#if defined(ENABLE_NLS) && defined(HAVE_GETTEXT)
-	bindtextdomain(PACKAGE, LOCALEDIR);
-#endif
+	result = cfg_pr_sec(&pr, cfg, NULL, 0);
+	cfg_pr_putc(&pr, 0);
+	if (cfg_pr_done(&pr)) {
+		free(pr.buf);
+		errno = ENOMEM;
+		return CFG_FAIL;
+	}
 
-	cfg_init_defaults(cfg);
+	*buf = pr.buf;
+	if (len)
+		*len = pr.len - 1;
 
-	return cfg;
+	return result;
 }
 
-DLLIMPORT char *cfg_tilde_expand(const char *filename)
+/*
+ * JSON output, see cfg_print_json().  Like the text output it goes
+ * from the tree straight to the printer, one value at a time.
+ */
+static void cfg_pr_json_var(cfg_printer_t *pr, cfg_opt_t *opt, unsigned int index)
 {
-	char *expanded = NULL;
+	cfg_value_t *val;
+	char num[32];
+	size_t len;
 
-#ifndef _WIN32
-	/* Do tilde expansion */
-	if (filename[0] == '~') {
-		struct passwd *passwd = NULL;
-		const char *file = NULL;
+	val = cfg_opt_peek(opt, index);
+	if (!val) {
+		cfg_pr_puts(pr, "null");
+		return;
+	}
 
-		if (filename[1] == '/' || filename[1] == 0) {
-			/* ~ or ~/path */
-			passwd = getpwuid(geteuid());
-			file = filename + 1;
-		} else {
-			char *user; /* ~user or ~user/path */
-			size_t len;
+	switch (opt->type) {
+	case CFGT_FLOAT:
+		/* JSON has no NaN or infinity */
+		len = cfg_dtoa(val->fpnumber, num);
+		if (num[len - 1] == 'n' || num[len - 1] == 'f')
+			cfg_pr_puts(pr, "null");
+		else
+			cfg_pr_write(pr, num, len);
+		break;
 
-			file = strchr(filename, '/');
-			if (file == NULL)
-				file = filename + strlen(filename);
+	case CFGT_STR:
+		if (val->string)
+			cfg_pr_json(pr, val->string, cfg_value_strlen(opt, val));
+		else
+			cfg_pr_puts(pr, "null");
+		break;
 
-			len = file - filename - 1;
-			user = malloc(len + 1);
-			if (!user)
-				return NULL;
+	default:
+		cfg_pr_var(pr, opt, index);
+		break;
+	}
+}
 
-			strncpy(user, &filename[1], len);
-			user[len] = 0;
-			passwd = getpwnam(user);
-			free(user);
-		}
+static void cfg_pr_json_sec(cfg_printer_t *pr, cfg_t *cfg, cfg_print_filter_func_t fb_pff);
 
-		if (passwd) {
-			expanded = malloc(strlen(passwd->pw_dir) + strlen(file) + 1);
-			if (!expanded)
-				return NULL;
+static void cfg_pr_json_value(cfg_printer_t *pr, cfg_opt_t *opt, unsigned int index,
+			      cfg_print_filter_func_t pff)
+{
+	cfg_t *sec;
 
-			strcpy(expanded, passwd->pw_dir);
-			strcat(expanded, file);
-		}
+	if (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC) {
+		cfg_pr_json_var(pr, opt, index);
+		return;
 	}
-#endif
-	if (!expanded)
-		expanded = strdup(filename);
 
-	return expanded;
+	sec = cfg_opt_peeksec(opt, index);
+	if (!sec)
+		cfg_pr_puts(pr, "null");
+	else if (opt->type == CFGT_RAWSEC)
+		cfg_pr_json(pr, sec->raw ? sec->raw : "", sec->raw ? strlen(sec->raw) : 0);
+	else
+		cfg_pr_json_sec(pr, sec, pff);
 }
 
-DLLIMPORT int cfg_free_value(cfg_opt_t *opt)
+static void cfg_pr_json_opt(cfg_printer_t *pr, cfg_opt_t *opt, cfg_print_filter_func_t pff)
 {
-	if (!opt) {
-		errno = EINVAL;
-		return CFG_FAIL;
-	}
-
-	if (opt->comment && !is_set(CFGF_RESET, opt->flags)) {
-		free(opt->comment);
-		opt->comment = NULL;
-	}
+	int sec = opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC;
+	unsigned int i, n = cfg_opt_size(opt);
+	const char *title;
 
-	if (opt->values) {
-		unsigned int i;
+	cfg_pr_json(pr, opt->name, strlen(opt->name));
+	cfg_pr_putc(pr, ':');
 
-		for (i = 0; i < opt->nvalues; i++) {
-			if (opt->type == CFGT_STR) {
-				free((void *)opt->values[i]->string);
-			} else if (opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC) {
-				opt->values[i]->section->path = NULL; /* Global search path */
-				cfg_free(opt->values[i]->section);
-			} else if (opt->type == CFGT_PTR && opt->freecb && opt->values[i]->ptr) {
-				(opt->freecb) (opt->values[i]->ptr);
-			}
-			free(opt->values[i]);
+	if (sec && is_set(CFGF_TITLE, opt->flags)) {
+		/* Titled sections by title, in the order they were added */
+		cfg_pr_putc(pr, '{');
+		for (i = 0; i < n; i++) {
+			if (i)
+				cfg_pr_putc(pr, ',');
+			title = cfg_title(cfg_opt_peeksec(opt, i));
+			cfg_pr_json(pr, title ? title : "", title ? strlen(title) : 0);
+			cfg_pr_putc(pr, ':');
+			cfg_pr_json_value(pr, opt, i, pff);
 		}
-		free(opt->values);
+		cfg_pr_putc(pr, '}');
+	} else if (is_set(CFGF_LIST, opt->flags) || (sec && is_set(CFGF_MULTI, opt->flags))) {
+		cfg_pr_putc(pr, '[');
+		for (i = 0; i < n; i++) {
+			if (i)
+				cfg_pr_putc(pr, ',');
+			cfg_pr_json_value(pr, opt, i, pff);
+		}
+		cfg_pr_putc(pr, ']');
+	} else if (n) {
+		cfg_pr_json_value(pr, opt, 0, pff);
+	} else {
+		cfg_pr_puts(pr, "null");
 	}
-
-	opt->values  = NULL;
-	opt->nvalues = 0;
-
-	return CFG_SUCCESS;
 }
 
-static void cfg_free_opt_array(cfg_opt_t *opts)
+static void cfg_pr_json_sec(cfg_printer_t *pr, cfg_t *cfg, cfg_print_filter_func_t fb_pff)
 {
-	int i;
+	cfg_print_filter_func_t pff = cfg->pff ? cfg->pff : fb_pff;
+	struct cfg_lazyopt lo;
+	int i, first = 1;
 
-	for (i = 0; opts[i].name; ++i) {
-		free((void *)opts[i].name);
-		if (opts[i].comment)
-			free(opts[i].comment);
-		if (opts[i].def.parsed)
-			free(opts[i].def.parsed);
-		if (opts[i].def.string)
-			free((void *)opts[i].def.string);
-		if (opts[i].subopts)
-			cfg_free_opt_array(opts[i].subopts);
-	}
-	free(opts);
-}
+	cfg_pr_putc(pr, '{');
+	for (i = 0; cfg->opts[i].name; i++) {
+		cfg_opt_t *opt = &cfg->opts[i];
+
+		switch (opt->type) {
+		case CFGT_NONE:
+		case CFGT_FUNC:
+		case CFGT_PTR:
+		case CFGT_COMMENT:
+			continue;
+		default:
+			break;
+		}
+		if (pff && pff(cfg, opt))
+			continue;
 
-static int cfg_free_searchpath(cfg_searchpath_t *p)
-{
-	if (p) {
-		cfg_free_searchpath(p->next);
-		free(p->dir);
-		free(p);
+		if (!first)
+			cfg_pr_putc(pr, ',');
+		first = 0;
+		cfg_pr_json_opt(pr, cfg_opt_default(opt, &lo), pff);
 	}
-
-	return CFG_SUCCESS;
+	cfg_pr_putc(pr, '}');
 }
 
-DLLIMPORT int cfg_free(cfg_t *cfg)
+DLLIMPORT int cfg_print_json(cfg_t *cfg, cfg_write_func_t cb, void *arg)
 {
-	int i;
-	int isroot = 0;
+	char buf[CFG_PRINTBUF_SIZE];
+	cfg_printer_t pr;
 
-	if (!cfg) {
+	if (!cfg || !cb || cfg_overlay_nosec(cfg)) {
 		errno = EINVAL;
 		return CFG_FAIL;
 	}
 
-	if (cfg->comment)
-		free(cfg->comment);
+	cfg_pr_init(&pr, buf, sizeof(buf), cb, arg, NULL);
+	cfg_pr_json_sec(&pr, cfg, NULL);
+	cfg_pr_putc(&pr, '\n');
 
-	for (i = 0; cfg->opts[i].name; ++i)
-		cfg_free_value(&cfg->opts[i]);
+	return cfg_pr_done(&pr);
+}
 
-	cfg_free_opt_array(cfg->opts);
-	cfg_free_searchpath(cfg->path);
+DLLIMPORT cfg_print_func_t cfg_opt_set_print_func(cfg_opt_t *opt, cfg_print_func_t pf)
+{
+	cfg_print_func_t oldpf;
 
-	if (cfg->name) {
-		isroot = !strcmp(cfg->name, "root");
-		free(cfg->name);
+	if (!opt) {
+		errno = EINVAL;
+		return NULL;
 	}
-	if (cfg->title)
-		free(cfg->title);
-	if (cfg->filename)
-		free(cfg->filename);
-	if (cfg->raw)
-		free(cfg->raw);
 
-	free(cfg);
-	if (isroot)
-		cfg_yylex_destroy();
+	oldpf = opt->pf;
+	opt->pf = pf;
 
-	return CFG_SUCCESS;
+	return oldpf;
 }
 
-DLLIMPORT int cfg_include(cfg_t *cfg, cfg_opt_t *opt, int argc, const char **argv)
+DLLIMPORT cfg_print_func_t cfg_set_print_func(cfg_t *cfg, const char *name, cfg_print_func_t pf)
 {
-	(void)opt;		/* Unused in this predefined include FUNC */
+	return cfg_opt_set_print_func(cfg_getopt_rw(cfg, name, NULL), pf);
+}
 
-	if (!cfg || !argv) {
+static cfg_opt_t *cfg_getopt_array(cfg_opt_t *rootopts, int cfg_flags, const char *name)
+{
+	unsigned int i;
+	cfg_opt_t *opts = rootopts;
+
+	if (!rootopts || !name) {
 		errno = EINVAL;
-		return CFG_FAIL;
+		return NULL;
 	}
 
-	if (argc != 1) {
-		cfg_error(cfg, _("wrong number of arguments to cfg_include()"));
-		return 1;
+	while (name && *name) {
+		cfg_t *seccfg;
+		char *secname;
+		size_t len = strcspn(name, "|");
+
+		if (name[len] == 0 /*len == strlen(name) */ )
+			/* no more subsections */
+			break;
+
+		if (len) {
+			cfg_opt_t *secopt;
+
+			secname = strndup(name, len);
+			if (!secname)
+				return NULL;
+
+			secopt = cfg_getopt_array(opts, cfg_flags, secname);
+			free(secname);
+			if (!secopt) {
+				/*fprintf(stderr, "section not found\n"); */
+				return NULL;
+			}
+			if (secopt->type != CFGT_SEC) {
+				/*fprintf(stderr, "not a section!\n"); */
+				return NULL;
+			}
+
+			if (!is_set(CFGF_MULTI, secopt->flags) && (seccfg = cfg_opt_peeksec(secopt, 0)) != NULL)
+				opts = seccfg->opts;
+			else
+				opts = secopt->subopts;
+
+			if (!opts) {
+				/*fprintf(stderr, "section have no subopts!?\n"); */
+				return NULL;
+			}
+		}
+		name += len;
+		name += strspn(name, "|");
+	}
+
+	for (i = 0; opts[i].name; i++) {
+		if (is_set(CFGF_NOCASE, cfg_flags)) {
+			if (strcasecmp(opts[i].name, name) == 0)
+				return &opts[i];
+		} else {
+			if (strcmp(opts[i].name, name) == 0)
+				return &opts[i];
+		}
 	}
 
-	return cfg_lexer_include(cfg, argv[0]);
+	return NULL;
 }
 
-static cfg_value_t *cfg_opt_getval(cfg_opt_t *opt, unsigned int index)
+DLLIMPORT cfg_validate_callback_t cfg_set_validate_func(cfg_t *cfg, const char *name, cfg_validate_callback_t vf)
 {
-	cfg_value_t *val = NULL;
+	cfg_opt_t *opt;
+	cfg_validate_callback_t oldvf;
 
-	if (index != 0 && !is_set(CFGF_LIST, opt->flags) && !is_set(CFGF_MULTI, opt->flags)) {
-		errno = EINVAL;
+	opt = cfg_getopt_array(cfg->opts, cfg->flags, name);
+	if (!opt)
 		return NULL;
-	}
 
-	if (opt->simple_value.ptr)
-		val = (cfg_value_t *)opt->simple_value.ptr;
-	else {
-		if (is_set(CFGF_RESET, opt->flags)) {
-			cfg_free_value(opt);
-			opt->flags &= ~CFGF_RESET;
-		}
+	oldvf = opt->validcb;
+	opt->validcb = vf;
 
-		if (index >= opt->nvalues)
-			val = cfg_addval(opt);
-		else
-			val = opt->values[index];
-	}
+	return oldvf;
+}
 
-	return val;
+DLLIMPORT cfg_validate_callback2_t cfg_set_validate_func2(cfg_t *cfg, const char *name, cfg_validate_callback2_t vf)
+{
+	cfg_opt_t *opt;
+	cfg_validate_callback2_t oldvf;
+
+	opt = cfg_getopt_array(cfg->opts, cfg->flags, name);
+	if (!opt)
+		return NULL;
+
+	oldvf = opt->validcb2;
+	opt->validcb2 = vf;
+
+	return oldvf;
 }
 
-DLLIMPORT int cfg_opt_setcomment(cfg_opt_t *opt, char *comment)
+/*
+ * Streaming MurmurHash3 x64_128, by Austin Appleby, public domain.
+ * All input is fed as little-endian bytes, so fingerprints are the
+ * same on every platform.
+ */
+typedef struct {
+	uint64_t h1, h2;
+	uint64_t total;
+	unsigned char buf[16];
+	size_t len;
+} cfg_hash_t;
+
+#define CFG_ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+#define CFG_HASH_C1 UINT64_C(0x87c37b91114253d5)
+#define CFG_HASH_C2 UINT64_C(0x4cf5ad432745937f)
+
+static uint64_t cfg_hash_load(const unsigned char *p, size_t len)
 {
-	char *oldcomment, *newcomment;
+	uint64_t v = 0;
 
-	if (!opt || !comment) {
-		errno = EINVAL;
-		return CFG_FAIL;
-	}
+	while (len--)
+		v = (v << 8) | p[len];
 
-	oldcomment = opt->comment;
-	newcomment = strdup(comment);
-	if (!newcomment)
-		return CFG_FAIL;
+	return v;
+}
 
-	if (oldcomment)
-		free(oldcomment);
-	opt->comment = newcomment;
-	opt->flags |= CFGF_COMMENTS;
-	opt->flags |= CFGF_MODIFIED;
+static uint64_t cfg_hash_fmix(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= UINT64_C(0xff51afd7ed558ccd);
+	k ^= k >> 33;
+	k *= UINT64_C(0xc4ceb9fe1a85ec53);
+	k ^= k >> 33;
 
-	return CFG_SUCCESS;
+	return k;
 }
 
-DLLIMPORT int cfg_setcomment(cfg_t *cfg, const char *name, char *comment)
+static void cfg_hash_block(cfg_hash_t *h, const unsigned char *p)
 {
-	return cfg_opt_setcomment(cfg_getopt(cfg, name), comment);
+	uint64_t k1 = cfg_hash_load(p, 8);
+	uint64_t k2 = cfg_hash_load(p + 8, 8);
+
+	k1 *= CFG_HASH_C1;
+	k1 = CFG_ROTL64(k1, 31);
+	k1 *= CFG_HASH_C2;
+	h->h1 ^= k1;
+	h->h1 = CFG_ROTL64(h->h1, 27);
+	h->h1 += h->h2;
+	h->h1 = h->h1 * 5 + 0x52dce729;
+
+	k2 *= CFG_HASH_C2;
+	k2 = CFG_ROTL64(k2, 33);
+	k2 *= CFG_HASH_C1;
+	h->h2 ^= k2;
+	h->h2 = CFG_ROTL64(h->h2, 31);
+	h->h2 += h->h1;
+	h->h2 = h->h2 * 5 + 0x38495ab5;
 }
 
-DLLIMPORT int cfg_opt_setnint(cfg_opt_t *opt, long int value, unsigned int index)
+static void cfg_hash_bytes(cfg_hash_t *h, const void *data, size_t len)
 {
-	cfg_value_t *val;
+	const unsigned char *p = data;
 
-	if (!opt || opt->type != CFGT_INT) {
-		errno = EINVAL;
-		return CFG_FAIL;
+	h->total += len;
+	if (h->len) {
+		size_t num = 16 - h->len < len ? 16 - h->len : len;
+
+		memcpy(h->buf + h->len, p, num);
+		h->len += num;
+		p += num;
+		len -= num;
+		if (h->len < 16)
+			return;
+		cfg_hash_block(h, h->buf);
+		h->len = 0;
 	}
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
+	for (; len >= 16; p += 16, len -= 16)
+		cfg_hash_block(h, p);
 
-	val->number = value;
-	opt->flags |= CFGF_MODIFIED;
+	memcpy(h->buf, p, len);
+	h->len = len;
+}
 
-	return CFG_SUCCESS;
+static void cfg_hash_u64(cfg_hash_t *h, uint64_t v)
+{
+	unsigned char buf[8];
+	int i;
+
+	for (i = 0; i < 8; i++, v >>= 8)
+		buf[i] = (unsigned char)v;
+	cfg_hash_bytes(h, buf, sizeof(buf));
 }
 
-DLLIMPORT int cfg_setnint(cfg_t *cfg, const char *name, long int value, unsigned int index)
+/* Length prefixed, so that "ab" + "c" differs from "a" + "bc" */
+static void cfg_hash_strn(cfg_hash_t *h, const char *str, size_t len)
 {
-	cfg_opt_t *opt;
+	if (!str) {
+		cfg_hash_u64(h, 0);
+		return;
+	}
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)&value) != 0)
-		return CFG_FAIL;
+	cfg_hash_u64(h, (uint64_t)len + 1);
+	cfg_hash_bytes(h, str, len);
+}
 
-	return cfg_opt_setnint(opt, value, index);
+static void cfg_hash_str(cfg_hash_t *h, const char *str)
+{
+	cfg_hash_strn(h, str, str ? strlen(str) : 0);
 }
 
-DLLIMPORT int cfg_setint(cfg_t *cfg, const char *name, long int value)
+/* Same as cfg_hash_str() of the lower case string, for CFGF_NOCASE titles */
+static void cfg_hash_nocase(cfg_hash_t *h, const char *str)
 {
-	return cfg_setnint(cfg, name, value, 0);
+	unsigned char buf[64];
+	size_t len, i, n;
+
+	if (!str) {
+		cfg_hash_u64(h, 0);
+		return;
+	}
+
+	len = strlen(str);
+	cfg_hash_u64(h, (uint64_t)len + 1);
+	while (len) {
+		n = len < sizeof(buf) ? len : sizeof(buf);
+		for (i = 0; i < n; i++)
+			buf[i] = (unsigned char)tolower((unsigned char)str[i]);
+		cfg_hash_bytes(h, buf, n);
+		str += n;
+		len -= n;
+	}
 }
 
-DLLIMPORT int cfg_opt_setnint64(cfg_opt_t *opt, int64_t value, unsigned int index)
+static cfg_fingerprint_t cfg_hash_final(cfg_hash_t *h)
 {
-	cfg_value_t *val;
+	cfg_fingerprint_t fp;
+	uint64_t k1, k2;
 
-	if (!opt || opt->type != CFGT_INT64) {
-		errno = EINVAL;
-		return CFG_FAIL;
+	if (h->len > 8) {
+		k2 = cfg_hash_load(h->buf + 8, h->len - 8);
+		k2 *= CFG_HASH_C2;
+		k2 = CFG_ROTL64(k2, 33);
+		k2 *= CFG_HASH_C1;
+		h->h2 ^= k2;
+	}
+	if (h->len) {
+		k1 = cfg_hash_load(h->buf, h->len > 8 ? 8 : h->len);
+		k1 *= CFG_HASH_C1;
+		k1 = CFG_ROTL64(k1, 31);
+		k1 *= CFG_HASH_C2;
+		h->h1 ^= k1;
 	}
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
+	h->h1 ^= h->total;
+	h->h2 ^= h->total;
+	h->h1 += h->h2;
+	h->h2 += h->h1;
+	h->h1 = cfg_hash_fmix(h->h1);
+	h->h2 = cfg_hash_fmix(h->h2);
+	h->h1 += h->h2;
+	h->h2 += h->h1;
 
-	val->i64 = value;
-	opt->flags |= CFGF_MODIFIED;
+	fp.hi = h->h1;
+	fp.lo = h->h2;
 
-	return CFG_SUCCESS;
+	return fp;
 }
 
-DLLIMPORT int cfg_setnint64(cfg_t *cfg, const char *name, int64_t value, unsigned int index)
+static void cfg_hash_value(cfg_hash_t *h, cfg_opt_t *opt, cfg_value_t *val)
 {
-	cfg_opt_t *opt;
+	cfg_type_t type = opt->type;
+	uint64_t bits;
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)&value) != 0)
-		return CFG_FAIL;
+	switch (type) {
+	case CFGT_INT:    cfg_hash_u64(h, (uint64_t)(int64_t)val->number); break;
+	case CFGT_INT8:   cfg_hash_u64(h, (uint64_t)(int64_t)val->i8);     break;
+	case CFGT_INT16:  cfg_hash_u64(h, (uint64_t)(int64_t)val->i16);    break;
+	case CFGT_INT32:  cfg_hash_u64(h, (uint64_t)(int64_t)val->i32);    break;
+	case CFGT_INT64:  cfg_hash_u64(h, (uint64_t)val->i64);             break;
+	case CFGT_UINT8:  cfg_hash_u64(h, val->u8);                        break;
+	case CFGT_UINT16: cfg_hash_u64(h, val->u16);                       break;
+	case CFGT_UINT32: cfg_hash_u64(h, val->u32);                       break;
+	case CFGT_UINT64: cfg_hash_u64(h, val->u64);                       break;
+	case CFGT_BOOL:   cfg_hash_u64(h, val->boolean ? 1 : 0);           break;
+	case CFGT_STR:    cfg_hash_strn(h, val->string, cfg_value_strlen(opt, val)); break;
 
-	return cfg_opt_setnint64(opt, value, index);
+	case CFGT_FLOAT:
+		memcpy(&bits, &val->fpnumber, sizeof(bits));
+		if (val->fpnumber != val->fpnumber)
+			bits = UINT64_C(0x7ff8000000000000);	/* one NaN */
+		cfg_hash_u64(h, bits);
+		break;
+
+	default:
+		break;
+	}
 }
 
-DLLIMPORT int cfg_setint64(cfg_t *cfg, const char *name, int64_t value)
+/*
+ * Returns non-zero if the result could be cached, i.e., if neither this
+ * section nor any section below it has CFG_SIMPLE_* options.
+ */
+static int cfg_fingerprint_sec(cfg_t *sec, cfg_fingerprint_t *fp)
 {
-	return cfg_setnint64(cfg, name, value, 0);
+	struct cfg_lazyopt lo;
+	cfg_hash_t h;
+	int cacheable = 1;
+	unsigned int i, j;
+
+	if (sec->fpvalid) {
+		*fp = sec->fingerprint;
+		return 1;
+	}
+
+	memset(&h, 0, sizeof(h));
+	if (is_set(CFGF_NOCASE, sec->flags))
+		cfg_hash_nocase(&h, sec->title);
+	else
+		cfg_hash_str(&h, sec->title);
+	cfg_hash_str(&h, sec->raw);
+
+	for (i = 0; sec->opts && sec->opts[i].name; i++) {
+		cfg_opt_t *opt = cfg_opt_default(&sec->opts[i], &lo);
+
+		if (opt->type == CFGT_NONE || opt->type == CFGT_FUNC ||
+		    opt->type == CFGT_PTR || opt->type == CFGT_COMMENT)
+			continue;
+
+		cfg_hash_str(&h, opt->name);
+		cfg_hash_u64(&h, opt->type);
+
+		if (opt->simple_value.ptr) {
+			cacheable = 0;
+			cfg_hash_u64(&h, 1);
+			cfg_hash_value(&h, opt, (cfg_value_t *)opt->simple_value.ptr);
+			continue;
+		}
+
+		cfg_hash_u64(&h, opt->nvalues);
+		for (j = 0; j < opt->nvalues; j++) {
+			if (opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC) {
+				cfg_fingerprint_t sub;
+
+				if (!cfg_fingerprint_sec(opt->values[j]->section, &sub))
+					cacheable = 0;
+				cfg_hash_u64(&h, sub.hi);
+				cfg_hash_u64(&h, sub.lo);
+			} else {
+				cfg_hash_value(&h, opt, opt->values[j]);
+			}
+		}
+	}
+
+	*fp = cfg_hash_final(&h);
+	if (cacheable) {
+		sec->fingerprint = *fp;
+		sec->fpvalid = 1;
+	}
+
+	return cacheable;
 }
 
-DLLIMPORT int cfg_opt_setnuint32(cfg_opt_t *opt, uint32_t value, unsigned int index)
+DLLIMPORT cfg_fingerprint_t cfg_fingerprint(cfg_t *cfg)
 {
-	cfg_value_t *val;
+	cfg_fingerprint_t fp = { 0, 0 };
 
-	if (!opt || opt->type != CFGT_UINT32) {
+	if (!cfg || cfg_overlay_nosec(cfg)) {
 		errno = EINVAL;
-		return CFG_FAIL;
+		return fp;
 	}
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
+	cfg_fingerprint_sec(cfg, &fp);
 
-	val->u32 = value;
-	opt->flags |= CFGF_MODIFIED;
+	return fp;
+}
+
+struct cfg_differ {
+	cfg_diff_func_t cb;
+	void *arg;
+	char *path;
+	size_t len;
+	size_t size;
+};
 
-	return CFG_SUCCESS;
-}
+static int cfg_diff_sec(struct cfg_differ *df, cfg_t *osec, cfg_t *nsec);
 
-DLLIMPORT int cfg_setnuint32(cfg_t *cfg, const char *name, uint32_t value, unsigned int index)
+static int cfg_diff_append(struct cfg_differ *df, const char *str, size_t len)
 {
-	cfg_opt_t *opt;
+	if (df->len + len + 1 > df->size) {
+		size_t size = df->size ? df->size : 128;
+		char *path;
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)&value) != 0)
-		return CFG_FAIL;
+		while (df->len + len + 1 > size)
+			size *= 2;
+		path = realloc(df->path, size);
+		if (!path)
+			return -1;
+		df->path = path;
+		df->size = size;
+	}
 
-	return cfg_opt_setnuint32(opt, value, index);
+	memcpy(df->path + df->len, str, len);
+	df->len += len;
+	df->path[df->len] = 0;
+
+	return 0;
 }
 
-DLLIMPORT int cfg_setuint32(cfg_t *cfg, const char *name, uint32_t value)
+/* Append "|name" to the path, or just "name" at the top level */
+static int cfg_diff_name(struct cfg_differ *df, const char *name)
 {
-	return cfg_setnuint32(cfg, name, value, 0);
+	if (df->len && cfg_diff_append(df, "|", 1))
+		return -1;
+
+	return cfg_diff_append(df, name, strlen(name));
 }
 
-DLLIMPORT int cfg_opt_setnuint64(cfg_opt_t *opt, uint64_t value, unsigned int index)
+/* Append "=title", quoted the way cfg_getopt() wants it if needed */
+static int cfg_diff_title(struct cfg_differ *df, const char *title)
 {
-	cfg_value_t *val;
+	size_t len;
 
-	if (!opt || opt->type != CFGT_UINT64) {
-		errno = EINVAL;
-		return CFG_FAIL;
-	}
+	if (cfg_diff_append(df, "=", 1))
+		return -1;
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
+	if (*title && *title != '\'' && !strchr(title, '|'))
+		return cfg_diff_append(df, title, strlen(title));
 
-	val->u64 = value;
-	opt->flags |= CFGF_MODIFIED;
+	if (cfg_diff_append(df, "'", 1))
+		return -1;
+	while (*title) {
+		len = strcspn(title, "'\\");
+		if (cfg_diff_append(df, title, len))
+			return -1;
+		title += len;
+		if (!*title)
+			break;
+		if (cfg_diff_append(df, "\\", 1) || cfg_diff_append(df, title++, 1))
+			return -1;
+	}
 
-	return CFG_SUCCESS;
+	return cfg_diff_append(df, "'", 1);
 }
 
-DLLIMPORT int cfg_setnuint64(cfg_t *cfg, const char *name, uint64_t value, unsigned int index)
+static int cfg_diff_index(struct cfg_differ *df, unsigned int index)
 {
-	cfg_opt_t *opt;
+	char buf[16];
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)&value) != 0)
-		return CFG_FAIL;
+	return cfg_diff_append(df, buf, snprintf(buf, sizeof(buf), "=%u", index));
+}
 
-	return cfg_opt_setnuint64(opt, value, index);
+static int cfg_diff_report(struct cfg_differ *df, cfg_diff_kind_t kind,
+			   cfg_opt_t *oopt, cfg_opt_t *nopt, cfg_t *osec, cfg_t *nsec)
+{
+	return df->cb(df->arg, kind, df->path, oopt, nopt, osec, nsec) ? -1 : 0;
 }
 
-DLLIMPORT int cfg_setuint64(cfg_t *cfg, const char *name, uint64_t value)
+static int cfg_diff_value_eq(cfg_opt_t *oopt, cfg_value_t *a, cfg_opt_t *nopt, cfg_value_t *b)
 {
-	return cfg_setnuint64(cfg, name, value, 0);
+	switch (oopt->type) {
+	case CFGT_INT:    return a->number == b->number;
+	case CFGT_INT8:   return a->i8 == b->i8;
+	case CFGT_INT16:  return a->i16 == b->i16;
+	case CFGT_INT32:  return a->i32 == b->i32;
+	case CFGT_INT64:  return a->i64 == b->i64;
+	case CFGT_UINT8:  return a->u8 == b->u8;
+	case CFGT_UINT16: return a->u16 == b->u16;
+	case CFGT_UINT32: return a->u32 == b->u32;
+	case CFGT_UINT64: return a->u64 == b->u64;
+	case CFGT_FLOAT:  return !memcmp(&a->fpnumber, &b->fpnumber, sizeof(a->fpnumber)) ||
+				  (a->fpnumber != a->fpnumber && b->fpnumber != b->fpnumber);
+	case CFGT_BOOL:   return !a->boolean == !b->boolean;
+	case CFGT_STR:
+		if (!a->string || !b->string || a->string == b->string)
+			return a->string == b->string;
+		return cfg_value_strlen(oopt, a) == cfg_value_strlen(nopt, b) &&
+			!memcmp(a->string, b->string, cfg_value_strlen(oopt, a));
+	default:
+		return 1;
+	}
 }
 
-DLLIMPORT int cfg_opt_setnint8(cfg_opt_t *opt, int8_t value, unsigned int index)
+static int cfg_diff_values(cfg_opt_t *oopt, cfg_opt_t *nopt)
 {
-	cfg_value_t *val;
+	unsigned int i;
 
-	if (!opt || opt->type != CFGT_INT8) {
-		errno = EINVAL;
-		return CFG_FAIL;
+	if (oopt->simple_value.ptr || nopt->simple_value.ptr) {
+		if (!oopt->simple_value.ptr || !nopt->simple_value.ptr)
+			return 1;
+		return !cfg_diff_value_eq(oopt, (cfg_value_t *)oopt->simple_value.ptr,
+					  nopt, (cfg_value_t *)nopt->simple_value.ptr);
 	}
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
+	if (oopt->nvalues != nopt->nvalues)
+		return 1;
 
-	val->i8 = value;
-	opt->flags |= CFGF_MODIFIED;
+	for (i = 0; i < oopt->nvalues; i++) {
+		if (!cfg_diff_value_eq(oopt, oopt->values[i], nopt, nopt->values[i]))
+			return 1;
+	}
 
-	return CFG_SUCCESS;
+	return 0;
 }
 
-DLLIMPORT int cfg_setnint8(cfg_t *cfg, const char *name, int8_t value, unsigned int index)
+static int cfg_diff_same(cfg_t *osec, cfg_t *nsec)
 {
-	cfg_opt_t *opt;
+	cfg_fingerprint_t ofp, nfp;
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)&value) != 0)
-		return CFG_FAIL;
+	cfg_fingerprint_sec(osec, &ofp);
+	cfg_fingerprint_sec(nsec, &nfp);
 
-	return cfg_opt_setnint8(opt, value, index);
+	return ofp.hi == nfp.hi && ofp.lo == nfp.lo;
 }
 
-DLLIMPORT int cfg_setint8(cfg_t *cfg, const char *name, int8_t value)
+/*
+ * Report a section that was added, removed or, if both are given and
+ * they differ, modified and descend into it.  The path is only built
+ * when there is something to report, most sections are just skipped.
+ */
+static int cfg_diff_section(struct cfg_differ *df, cfg_opt_t *oopt, cfg_opt_t *nopt,
+			    cfg_t *osec, cfg_t *nsec, unsigned int index)
 {
-	return cfg_setnint8(cfg, name, value, 0);
-}
+	cfg_diff_kind_t kind = CFG_DIFF_MODIFIED;
+	cfg_t *sec = osec ? osec : nsec;
+	size_t len = df->len;
+	int rc;
 
-DLLIMPORT int cfg_opt_setnint16(cfg_opt_t *opt, int16_t value, unsigned int index)
-{
-	cfg_value_t *val;
+	if (!nsec)
+		kind = CFG_DIFF_REMOVED;
+	else if (!osec)
+		kind = CFG_DIFF_ADDED;
+	else if (cfg_diff_same(osec, nsec))
+		return 0;
 
-	if (!opt || opt->type != CFGT_INT16) {
-		errno = EINVAL;
-		return CFG_FAIL;
+	if (is_set(CFGF_MULTI, oopt->flags)) {
+		if (!is_set(CFGF_TITLE, oopt->flags))
+			rc = cfg_diff_index(df, index);
+		else
+			rc = sec->title ? cfg_diff_title(df, sec->title) : 0;
+		if (rc)
+			return -1;
 	}
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
-
-	val->i16 = value;
-	opt->flags |= CFGF_MODIFIED;
+	rc = cfg_diff_report(df, kind, oopt, nopt, osec, nsec);
+	if (!rc && kind == CFG_DIFF_MODIFIED)
+		rc = cfg_diff_sec(df, osec, nsec);
+	df->path[df->len = len] = 0;
 
-	return CFG_SUCCESS;
+	return rc;
 }
 
-DLLIMPORT int cfg_setnint16(cfg_t *cfg, const char *name, int16_t value, unsigned int index)
+static uint64_t cfg_diff_hash(const char *title, int nocase)
 {
-	cfg_opt_t *opt;
+	uint64_t h = UINT64_C(0xcbf29ce484222325);
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)&value) != 0)
-		return CFG_FAIL;
+	while (*title) {
+		h ^= nocase ? (unsigned char)tolower((unsigned char)*title) : (unsigned char)*title;
+		h *= UINT64_C(0x100000001b3);
+		title++;
+	}
 
-	return cfg_opt_setnint16(opt, value, index);
+	return h;
 }
 
-DLLIMPORT int cfg_setint16(cfg_t *cfg, const char *name, int16_t value)
+static int cfg_diff_titlecmp(const char *a, const char *b, int nocase)
 {
-	return cfg_setnint16(cfg, name, value, 0);
+	if (!a || !b)
+		return a != b;
+
+	return nocase ? strcasecmp(a, b) : strcmp(a, b);
 }
 
-DLLIMPORT int cfg_opt_setnint32(cfg_opt_t *opt, int32_t value, unsigned int index)
+/*
+ * Titled multi-sections.  Reloaded configurations mostly keep their
+ * order, so pair up sections by position for as long as the titles
+ * agree, then fall back to an index of the remaining new titles.
+ */
+static int cfg_diff_titled(struct cfg_differ *df, cfg_opt_t *oopt, cfg_opt_t *nopt)
 {
-	cfg_value_t *val;
+	int nocase = is_set(CFGF_NOCASE, oopt->flags) ||
+		(oopt->sec && is_set(CFGF_NOCASE, oopt->sec->flags));
+	unsigned int i, j, n, first, mask, *index;
+	unsigned char *used;
+	int rc = -1;
 
-	if (!opt || opt->type != CFGT_INT32) {
-		errno = EINVAL;
-		return CFG_FAIL;
+	n = oopt->nvalues < nopt->nvalues ? oopt->nvalues : nopt->nvalues;
+	for (first = 0; first < n; first++) {
+		cfg_t *osec = oopt->values[first]->section;
+		cfg_t *nsec = nopt->values[first]->section;
+
+		/* The title is part of the fingerprint */
+		if (cfg_diff_same(osec, nsec))
+			continue;
+		if (cfg_diff_titlecmp(osec->title, nsec->title, nocase))
+			break;
+		if (cfg_diff_section(df, oopt, nopt, osec, nsec, 0))
+			return -1;
 	}
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
+	if (first == oopt->nvalues && first == nopt->nvalues)
+		return 0;
 
-	val->i32 = value;
-	opt->flags |= CFGF_MODIFIED;
+	n = nopt->nvalues - first;
+	for (mask = 1; mask < 2 * n; mask <<= 1)
+		;
+	index = calloc(mask, sizeof(*index));
+	used = calloc(n + 1, 1);
+	if (!index || !used)
+		goto done;
+	mask--;
 
-	return CFG_SUCCESS;
-}
+	for (i = 0; i < n; i++) {
+		cfg_t *nsec = nopt->values[first + i]->section;
 
-DLLIMPORT int cfg_setnint32(cfg_t *cfg, const char *name, int32_t value, unsigned int index)
-{
-	cfg_opt_t *opt;
+		if (!nsec->title)
+			continue;
+		j = cfg_diff_hash(nsec->title, nocase) & mask;
+		while (index[j])
+			j = (j + 1) & mask;
+		index[j] = i + 1;
+	}
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)&value) != 0)
-		return CFG_FAIL;
+	for (i = first; i < oopt->nvalues; i++) {
+		cfg_t *osec = oopt->values[i]->section;
+		cfg_t *nsec = NULL;
 
-	return cfg_opt_setnint32(opt, value, index);
-}
+		j = osec->title ? cfg_diff_hash(osec->title, nocase) & mask : 0;
+		for (; osec->title && index[j]; j = (j + 1) & mask) {
+			cfg_t *sec = nopt->values[first + index[j] - 1]->section;
 
-DLLIMPORT int cfg_setint32(cfg_t *cfg, const char *name, int32_t value)
-{
-	return cfg_setnint32(cfg, name, value, 0);
+			if (!used[index[j] - 1] && !cfg_diff_titlecmp(osec->title, sec->title, nocase)) {
+				used[index[j] - 1] = 1;
+				nsec = sec;
+				break;
+			}
+		}
+
+		if (cfg_diff_section(df, oopt, nopt, osec, nsec, 0))
+			goto done;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (used[i])
+			continue;
+		if (cfg_diff_section(df, oopt, nopt, NULL, nopt->values[first + i]->section, 0))
+			goto done;
+	}
+	rc = 0;
+
+done:
+	free(index);
+	free(used);
+
+	return rc;
 }
 
-DLLIMPORT int cfg_opt_setnuint8(cfg_opt_t *opt, uint8_t value, unsigned int index)
+/* Untitled sections are matched by position */
+static int cfg_diff_sections(struct cfg_differ *df, cfg_opt_t *oopt, cfg_opt_t *nopt)
 {
-	cfg_value_t *val;
+	unsigned int i;
 
-	if (!opt || opt->type != CFGT_UINT8) {
-		errno = EINVAL;
-		return CFG_FAIL;
-	}
+	if (is_set(CFGF_MULTI | CFGF_TITLE, oopt->flags))
+		return cfg_diff_titled(df, oopt, nopt);
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
+	for (i = 0; i < oopt->nvalues || i < nopt->nvalues; i++) {
+		cfg_t *osec = i < oopt->nvalues ? oopt->values[i]->section : NULL;
+		cfg_t *nsec = i < nopt->nvalues ? nopt->values[i]->section : NULL;
 
-	val->u8 = value;
-	opt->flags |= CFGF_MODIFIED;
+		if (cfg_diff_section(df, oopt, nopt, osec, nsec, i))
+			return -1;
+	}
 
-	return CFG_SUCCESS;
+	return 0;
 }
 
-DLLIMPORT int cfg_setnuint8(cfg_t *cfg, const char *name, uint8_t value, unsigned int index)
+static int cfg_diff_opt(struct cfg_differ *df, cfg_opt_t *oopt, cfg_opt_t *nopt)
 {
-	cfg_opt_t *opt;
+	size_t len = df->len;
+	int rc = 0;
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)&value) != 0)
-		return CFG_FAIL;
+	if (cfg_diff_name(df, oopt ? oopt->name : nopt->name))
+		return -1;
 
-	return cfg_opt_setnuint8(opt, value, index);
+	if (!oopt || !nopt)
+		rc = cfg_diff_report(df, oopt ? CFG_DIFF_REMOVED : CFG_DIFF_ADDED, oopt, nopt, NULL, NULL);
+	else if (oopt->type != nopt->type)
+		rc = cfg_diff_report(df, CFG_DIFF_MODIFIED, oopt, nopt, NULL, NULL);
+	else if (oopt->type == CFGT_SEC || oopt->type == CFGT_RAWSEC)
+		rc = cfg_diff_sections(df, oopt, nopt);
+	else if (cfg_diff_values(oopt, nopt)) {
+		cfg_diff_kind_t kind = CFG_DIFF_MODIFIED;
+
+		if (!oopt->simple_value.ptr && !oopt->nvalues)
+			kind = CFG_DIFF_ADDED;
+		else if (!nopt->simple_value.ptr && !nopt->nvalues)
+			kind = CFG_DIFF_REMOVED;
+		rc = cfg_diff_report(df, kind, oopt, nopt, NULL, NULL);
+	}
+	df->path[df->len = len] = 0;
+
+	return rc;
 }
 
-DLLIMPORT int cfg_setuint8(cfg_t *cfg, const char *name, uint8_t value)
+static int cfg_diff_skip(cfg_opt_t *opt)
 {
-	return cfg_setnuint8(cfg, name, value, 0);
+	return opt->type == CFGT_NONE || opt->type == CFGT_FUNC ||
+		opt->type == CFGT_PTR || opt->type == CFGT_COMMENT;
 }
 
-DLLIMPORT int cfg_opt_setnuint16(cfg_opt_t *opt, uint16_t value, unsigned int index)
+static int cfg_diff_sec(struct cfg_differ *df, cfg_t *osec, cfg_t *nsec)
 {
-	cfg_value_t *val;
+	struct cfg_lazyopt olo, nlo;
+	unsigned int i, onum, nnum;
 
-	if (!opt || opt->type != CFGT_UINT16) {
-		errno = EINVAL;
-		return CFG_FAIL;
+	onum = cfg_num(osec);
+	nnum = cfg_num(nsec);
+
+	/* Same schema, same order, unless options were added at runtime */
+	for (i = 0; i < onum; i++) {
+		cfg_opt_t *oopt = &osec->opts[i];
+		cfg_opt_t *nopt = NULL;
+
+		if (cfg_diff_skip(oopt))
+			continue;
+
+		if (i < nnum && !strcmp(oopt->name, nsec->opts[i].name))
+			nopt = &nsec->opts[i];
+		else
+			nopt = cfg_getopt_leafn(nsec, oopt->name, strlen(oopt->name));
+		if (cfg_diff_opt(df, cfg_opt_default(oopt, &olo), cfg_opt_default(nopt, &nlo)))
+			return -1;
 	}
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
+	for (i = 0; i < nnum; i++) {
+		cfg_opt_t *nopt = &nsec->opts[i];
 
-	val->u16 = value;
-	opt->flags |= CFGF_MODIFIED;
+		if (cfg_diff_skip(nopt))
+			continue;
+		if (i < onum && !strcmp(osec->opts[i].name, nopt->name))
+			continue;
+		if (cfg_getopt_leafn(osec, nopt->name, strlen(nopt->name)))
+			continue;
+		if (cfg_diff_opt(df, NULL, cfg_opt_default(nopt, &nlo)))
+			return -1;
+	}
 
-	return CFG_SUCCESS;
+	return 0;
 }
 
-DLLIMPORT int cfg_setnuint16(cfg_t *cfg, const char *name, uint16_t value, unsigned int index)
+DLLIMPORT int cfg_diff(cfg_t *oldcfg, cfg_t *newcfg, cfg_diff_func_t cb, void *arg)
 {
-	cfg_opt_t *opt;
+	struct cfg_differ df;
+	cfg_fingerprint_t ofp, nfp;
+	int rc;
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)&value) != 0)
+	if (!oldcfg || !newcfg || !cb ||
+	    cfg_overlay_nosec(oldcfg) || cfg_overlay_nosec(newcfg)) {
+		errno = EINVAL;
 		return CFG_FAIL;
+	}
 
-	return cfg_opt_setnuint16(opt, value, index);
-}
+	ofp = cfg_fingerprint(oldcfg);
+	nfp = cfg_fingerprint(newcfg);
+	if (ofp.hi == nfp.hi && ofp.lo == nfp.lo)
+		return CFG_SUCCESS;
 
-DLLIMPORT int cfg_setuint16(cfg_t *cfg, const char *name, uint16_t value)
-{
-	return cfg_setnuint16(cfg, name, value, 0);
+	memset(&df, 0, sizeof(df));
+	df.cb = cb;
+	df.arg = arg;
+	if (cfg_diff_append(&df, "", 0))
+		return CFG_FAIL;
+
+	rc = cfg_diff_sec(&df, oldcfg, newcfg);
+	free(df.path);
+
+	return rc ? CFG_FAIL : CFG_SUCCESS;
 }
 
-DLLIMPORT int cfg_opt_setnfloat(cfg_opt_t *opt, double value, unsigned int index)
+DLLIMPORT int cfg_opt_stats(cfg_opt_t *opt, cfg_opt_stats_t *stats)
 {
-	cfg_value_t *val;
+	cfg_opt_stats_t *st;
 
-	if (!opt || opt->type != CFGT_FLOAT) {
+	if (!opt || !stats) {
 		errno = EINVAL;
 		return CFG_FAIL;
 	}
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
-
-	val->fpnumber = value;
-	opt->flags |= CFGF_MODIFIED;
+	st = cfg_stats_of(opt);
+	if (st)
+		*stats = *st;
+	else
+		memset(stats, 0, sizeof(*stats));
 
 	return CFG_SUCCESS;
 }
 
-DLLIMPORT int cfg_setnfloat(cfg_t *cfg, const char *name, double value, unsigned int index)
+static void cfg_stats_reset_sec(cfg_t *sec)
 {
-	cfg_opt_t *opt;
+	unsigned int i, j;
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)&value) != 0)
-		return CFG_FAIL;
+	if (sec->stats) {
+		struct cfg_unknown *u;
 
-	return cfg_opt_setnfloat(opt, value, index);
-}
+		memset(sec->stats->opt, 0, (sec->stats->nopts + 1) * sizeof(sec->stats->opt[0]));
+		if (!is_set(CFGF_FROZEN, sec->flags))
+			cfg_stats_unknown_free(sec);
+		for (u = sec->stats->unknown; u; u = u->next)
+			u->lookups = 0;	/* frozen, readers may walk the list */
+	}
 
-DLLIMPORT int cfg_setfloat(cfg_t *cfg, const char *name, double value)
-{
-	return cfg_setnfloat(cfg, name, value, 0);
+	for (i = 0; sec->opts[i].name; i++) {
+		cfg_opt_t *opt = &sec->opts[i];
+
+		if (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC)
+			continue;
+		for (j = 0; j < opt->nvalues; j++) {
+			if (!cfg_shared(opt, opt->values[j]->section))
+				cfg_stats_reset_sec(opt->values[j]->section);
+		}
+	}
 }
 
-DLLIMPORT int cfg_opt_setnbool(cfg_opt_t *opt, cfg_bool_t value, unsigned int index)
+DLLIMPORT int cfg_stats_reset(cfg_t *cfg)
 {
-	cfg_value_t *val;
-
-	if (!opt || opt->type != CFGT_BOOL) {
+	if (!cfg) {
 		errno = EINVAL;
 		return CFG_FAIL;
 	}
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
-
-	val->boolean = value;
-	opt->flags |= CFGF_MODIFIED;
+	cfg_stats_reset_sec(cfg);
 
 	return CFG_SUCCESS;
 }
 
-DLLIMPORT int cfg_setnbool(cfg_t *cfg, const char *name, cfg_bool_t value, unsigned int index)
-{
-	return cfg_opt_setnbool(cfg_getopt(cfg, name), value, index);
-}
+/*
+ * cfg_stats_dump() collects one entry per counted option or unknown
+ * name, with its path built the same way as by cfg_diff(), sorts them
+ * and then prints them.
+ */
+struct cfg_stats_entry {
+	char            *path;
+	cfg_opt_stats_t  st;
+	int              unknown;
+};
 
-DLLIMPORT int cfg_setbool(cfg_t *cfg, const char *name, cfg_bool_t value)
+struct cfg_stats_dumper {
+	struct cfg_differ       df;	/* Only the path is used */
+	struct cfg_stats_entry *entry;
+	size_t                  num;
+	size_t                  size;
+};
+
+static int cfg_stats_add(struct cfg_stats_dumper *sd, const char *name, cfg_opt_stats_t *st, uint64_t unknown)
 {
-	return cfg_setnbool(cfg, name, value, 0);
+	struct cfg_stats_entry *e;
+	size_t len = sd->df.len;
+
+	if (sd->num == sd->size) {
+		size_t size = sd->size ? sd->size * 2 : 32;
+
+		e = reallocarray(sd->entry, size, sizeof(*e));
+		if (!e)
+			return -1;
+		sd->entry = e;
+		sd->size = size;
+	}
+
+	if (cfg_diff_name(&sd->df, name))
+		return -1;
+
+	e = &sd->entry[sd->num];
+	memset(e, 0, sizeof(*e));
+	e->path = strdup(sd->df.path);
+	sd->df.path[sd->df.len = len] = 0;
+	if (!e->path)
+		return -1;
+
+	if (st) {
+		e->st = *st;
+	} else {
+		e->st.lookups = unknown;
+		e->unknown = 1;
+	}
+	sd->num++;
+
+	return 0;
 }
 
-DLLIMPORT int cfg_opt_setnstr(cfg_opt_t *opt, const char *value, unsigned int index)
+static int cfg_stats_collect(struct cfg_stats_dumper *sd, cfg_t *sec)
 {
-	char *newstr, *oldstr = NULL;
-	cfg_value_t *val;
+	struct cfg_stats *st = sec->stats;
+	struct cfg_unknown *u;
+	unsigned int i, j;
 
-	if (!opt || opt->type != CFGT_STR) {
-		errno = EINVAL;
-		return CFG_FAIL;
+	for (i = 0; st && i < st->nopts; i++) {
+		if (!st->opt[i].lookups && !st->opt[i].reads)
+			continue;
+		if (cfg_stats_add(sd, sec->opts[i].name, &st->opt[i], 0))
+			return -1;
+	}
+	for (u = st ? st->unknown : NULL; u; u = u->next) {
+		if (u->lookups && cfg_stats_add(sd, u->name, NULL, u->lookups))
+			return -1;
 	}
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
-		return CFG_FAIL;
+	for (i = 0; sec->opts[i].name; i++) {
+		cfg_opt_t *opt = &sec->opts[i];
+		size_t len = sd->df.len;
 
-	if (val->string)
-		oldstr = val->string;
+		if (opt->type != CFGT_SEC && opt->type != CFGT_RAWSEC)
+			continue;
 
-	if (value) {
-		newstr = strdup(value);
-		if (!newstr)
-			return CFG_FAIL;
-		val->string = newstr;
-	} else {
-		val->string = NULL;
-	}
+		for (j = 0; j < opt->nvalues; j++) {
+			cfg_t *sub = opt->values[j]->section;
+			int rc = cfg_diff_name(&sd->df, opt->name);
 
-	if (oldstr)
-		free(oldstr);
-	opt->flags |= CFGF_MODIFIED;
+			if (!rc && is_set(CFGF_MULTI, opt->flags)) {
+				if (!is_set(CFGF_TITLE, opt->flags))
+					rc = cfg_diff_index(&sd->df, j);
+				else if (sub->title)
+					rc = cfg_diff_title(&sd->df, sub->title);
+			}
+			if (!rc)
+				rc = cfg_stats_collect(sd, sub);
+			sd->df.path[sd->df.len = len] = 0;
+			if (rc)
+				return -1;
+		}
+	}
 
-	return CFG_SUCCESS;
+	return 0;
 }
 
-DLLIMPORT int cfg_setnstr(cfg_t *cfg, const char *name, const char *value, unsigned int index)
+/* Options before unknown names, most used first, then by path */
+static int cfg_stats_cmp(const void *a, const void *b)
 {
-	cfg_opt_t *opt;
+	const struct cfg_stats_entry *ea = a, *eb = b;
+	uint64_t na = ea->st.lookups + ea->st.reads;
+	uint64_t nb = eb->st.lookups + eb->st.reads;
 
-	opt = cfg_getopt(cfg, name);
-	if (opt && opt->validcb2 && (*opt->validcb2)(cfg, opt, (void *)value) != 0)
-		return CFG_FAIL;
+	if (ea->unknown != eb->unknown)
+		return ea->unknown - eb->unknown;
+	if (na != nb)
+		return na > nb ? -1 : 1;
 
-	return cfg_opt_setnstr(opt, value, index);
+	return strcmp(ea->path, eb->path);
 }
 
-DLLIMPORT int cfg_setstr(cfg_t *cfg, const char *name, const char *value)
+static void cfg_pr_stat(cfg_printer_t *pr, cfg_stats_format_t format, const char *name, uint64_t val)
 {
-	return cfg_setnstr(cfg, name, value, 0);
+	if (format == CFG_STATS_JSON) {
+		cfg_pr_puts(pr, ",\"");
+		cfg_pr_puts(pr, name);
+		cfg_pr_puts(pr, "\":");
+	} else {
+		cfg_pr_putc(pr, ' ');
+		cfg_pr_puts(pr, name);
+		cfg_pr_putc(pr, '=');
+	}
+	cfg_pr_uint(pr, val, 0);
 }
 
-static int cfg_addlist_internal(cfg_opt_t *opt, unsigned int nvalues, va_list ap)
+static void cfg_pr_stats(cfg_printer_t *pr, struct cfg_stats_dumper *sd, cfg_stats_format_t format)
 {
-	int result = CFG_FAIL;
-	unsigned int i;
-
-	for (i = 0; i < nvalues; i++) {
-		switch (opt->type) {
-		case CFGT_INT:
-			result = cfg_opt_setnint(opt, va_arg(ap, int), opt->nvalues);
-			break;
-
-		case CFGT_INT8:
-			result = cfg_opt_setnint8(opt, (int8_t)va_arg(ap, int), opt->nvalues);
-			break;
-
-		case CFGT_INT16:
-			result = cfg_opt_setnint16(opt, (int16_t)va_arg(ap, int), opt->nvalues);
-			break;
-
-		case CFGT_INT32:
-			result = cfg_opt_setnint32(opt, va_arg(ap, int32_t), opt->nvalues);
-			break;
-
-		case CFGT_INT64:
-			result = cfg_opt_setnint64(opt, va_arg(ap, int64_t), opt->nvalues);
-			break;
-
-		case CFGT_UINT8:
-			result = cfg_opt_setnuint8(opt, (uint8_t)va_arg(ap, int), opt->nvalues);
-			break;
-
-		case CFGT_UINT16:
-			result = cfg_opt_setnuint16(opt, (uint16_t)va_arg(ap, int), opt->nvalues);
-			break;
+	size_t i;
+	int unknown = 0;
 
-		case CFGT_UINT32:
-			result = cfg_opt_setnuint32(opt, va_arg(ap, uint32_t), opt->nvalues);
-			break;
+	if (format == CFG_STATS_JSON)
+		cfg_pr_puts(pr, "{\"options\":[");
 
-		case CFGT_UINT64:
-			result = cfg_opt_setnuint64(opt, va_arg(ap, uint64_t), opt->nvalues);
-			break;
+	for (i = 0; i < sd->num; i++) {
+		struct cfg_stats_entry *e = &sd->entry[i];
 
-		case CFGT_FLOAT:
-			result = cfg_opt_setnfloat(opt, va_arg(ap, double), opt->nvalues);
-			break;
+		if (format == CFG_STATS_TEXT) {
+			cfg_pr_puts(pr, e->path);
+			if (e->unknown) {
+				cfg_pr_stat(pr, format, "unknown", e->st.lookups);
+				cfg_pr_putc(pr, '\n');
+				continue;
+			}
+		} else {
+			if (e->unknown && !unknown) {
+				cfg_pr_puts(pr, "],\"unknown\":[");
+				unknown = 1;
+			} else if (i) {
+				cfg_pr_putc(pr, ',');
+			}
+			cfg_pr_puts(pr, "{\"path\":");
+			cfg_pr_json(pr, e->path, strlen(e->path));
+			if (e->unknown) {
+				cfg_pr_stat(pr, format, "lookups", e->st.lookups);
+				cfg_pr_putc(pr, '}');
+				continue;
+			}
+		}
 
-		case CFGT_BOOL:
-			result = cfg_opt_setnbool(opt, va_arg(ap, cfg_bool_t), opt->nvalues);
-			break;
+		cfg_pr_stat(pr, format, "lookups", e->st.lookups);
+		cfg_pr_stat(pr, format, "reads", e->st.reads);
+		cfg_pr_stat(pr, format, "misses", e->st.misses);
+		cfg_pr_stat(pr, format, "errors", e->st.errors);
+		cfg_pr_stat(pr, format, "nsec", e->st.nsec);
+		cfg_pr_putc(pr, format == CFG_STATS_JSON ? '}' : '\n');
+	}
 
-		case CFGT_STR:
-			result = cfg_opt_setnstr(opt, va_arg(ap, char *), opt->nvalues);
-			break;
+	if (format == CFG_STATS_JSON) {
+		if (!unknown)
+			cfg_pr_puts(pr, "],\"unknown\":[");
+		cfg_pr_puts(pr, "]}\n");
+	}
+}
 
-		case CFGT_FUNC:
-		case CFGT_SEC:
-		default:
-			result = CFG_SUCCESS;
-			break;
-		}
+static int cfg_stats_print(cfg_t *cfg, cfg_stats_format_t format, cfg_write_func_t cb, void *arg, FILE *fp)
+{
+	struct cfg_stats_dumper sd;
+	char buf[CFG_PRINTBUF_SIZE];
+	cfg_printer_t pr;
+	int rc;
+	size_t i;
+
+	memset(&sd, 0, sizeof(sd));
+	rc = cfg_diff_append(&sd.df, "", 0) || cfg_stats_collect(&sd, cfg);
+	if (!rc) {
+		if (sd.num)
+			qsort(sd.entry, sd.num, sizeof(sd.entry[0]), cfg_stats_cmp);
+		cfg_pr_init(&pr, buf, sizeof(buf), cb, arg, fp);
+		cfg_pr_stats(&pr, &sd, format);
+		rc = cfg_pr_done(&pr);
+	} else {
+		errno = ENOMEM;
 	}
 
-	return result;
+	for (i = 0; i < sd.num; i++)
+		free(sd.entry[i].path);
+	free(sd.entry);
+	free(sd.df.path);
+
+	return rc ? CFG_FAIL : CFG_SUCCESS;
 }
 
-DLLIMPORT int cfg_setlist(cfg_t *cfg, const char *name, unsigned int nvalues, ...)
+DLLIMPORT int cfg_stats_dump(cfg_t *cfg, FILE *fp, cfg_stats_format_t format)
 {
-	va_list ap;
-	cfg_opt_t *opt = cfg_getopt(cfg, name);
-
-	if (!opt || !is_set(CFGF_LIST, opt->flags)) {
+	if (!cfg || !fp || (format != CFG_STATS_TEXT && format != CFG_STATS_JSON)) {
 		errno = EINVAL;
 		return CFG_FAIL;
 	}
 
-	cfg_free_value(opt);
-	va_start(ap, nvalues);
-	cfg_addlist_internal(opt, nvalues, ap);
-	va_end(ap);
-
-	return CFG_SUCCESS;
+	return cfg_stats_print(cfg, format, cfg_pr_fwrite, fp, fp);
 }
 
-DLLIMPORT int cfg_addlist(cfg_t *cfg, const char *name, unsigned int nvalues, ...)
+DLLIMPORT int cfg_stats_dump_cb(cfg_t *cfg, cfg_stats_format_t format, cfg_write_func_t cb, void *arg)
 {
-	va_list ap;
-	cfg_opt_t *opt = cfg_getopt(cfg, name);
-
-	if (!opt || !is_set(CFGF_LIST, opt->flags)) {
+	if (!cfg || !cb || (format != CFG_STATS_TEXT && format != CFG_STATS_JSON)) {
 		errno = EINVAL;
 		return CFG_FAIL;
 	}
 
-	opt->flags &= ~CFGF_RESET;
-	va_start(ap, nvalues);
-	cfg_addlist_internal(opt, nvalues, ap);
-	va_end(ap);
-
-	return CFG_SUCCESS;
+	return cfg_stats_print(cfg, format, cb, arg, NULL);
 }
 
-DLLIMPORT cfg_t *cfg_addtsec(cfg_t *cfg, const char *name, const char *title)
+static const char *const cfg_profile_phases[CFG_PROFILE_PHASES] = {
+	"parse", "lex", "setopt", "callback", "include", "defaults"
+};
+
+DLLIMPORT int cfg_profile_get(cfg_t *cfg, unsigned int index, cfg_profile_t *profile)
 {
-	cfg_t *sec;
-	cfg_opt_t *opt;
-	cfg_value_t *val;
+	struct cfg_profiler *p;
 
-	sec = cfg_gettsec(cfg, name, title);
-	if (sec)
-		return sec;
+	if (!cfg || !profile) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
 
-	opt = cfg_getopt(cfg, name);
-	if (!opt) {
-		cfg_error(cfg, _("no such option '%s'"), name);
-		return NULL;
+	p = cfg_profile_of(cfg);
+	if (!p || index >= p->num) {
+		errno = ENOENT;
+		return CFG_FAIL;
 	}
-	val = cfg_setopt(cfg, opt, title);
-	if (!val)
-		return NULL;
 
-	val->section->path = cfg->path; /* Remember global search path. */
-	val->section->line = 1;
-	val->section->errfunc = cfg->errfunc;
+	*profile = p->rec[index].prof;
 
-	return val->section;
+	return CFG_SUCCESS;
 }
 
-DLLIMPORT int cfg_opt_rmnsec(cfg_opt_t *opt, unsigned int index)
+DLLIMPORT int cfg_profile_reset(cfg_t *cfg)
 {
-	unsigned int n;
-	cfg_value_t *val;
+	struct cfg_profiler *p;
 
-	if (!opt || opt->type != CFGT_SEC) {
+	if (!cfg) {
 		errno = EINVAL;
 		return CFG_FAIL;
 	}
 
-	n = cfg_opt_size(opt);
-	if (index >= n)
-		return CFG_FAIL;
+	p = cfg_profile_of(cfg);
+	if (!p)
+		return CFG_SUCCESS;
 
-	val = cfg_opt_getval(opt, index);
-	if (!val)
+	/* Not from a callback while parsing */
+	if (p->cur >= 0) {
+		errno = EBUSY;
 		return CFG_FAIL;
-
-	if (index + 1 != n) {
-		/* not removing last, move the tail */
-		memmove(&opt->values[index], &opt->values[index + 1], sizeof(opt->values[index]) * (n - index - 1));
 	}
-	--opt->nvalues;
 
-	cfg_free(val->section);
-	free(val);
+	cfg_profile_clear(p);
 
 	return CFG_SUCCESS;
 }
 
-DLLIMPORT int cfg_rmnsec(cfg_t *cfg, const char *name, unsigned int index)
-{
-	return cfg_opt_rmnsec(cfg_getopt(cfg, name), index);
-}
-
-DLLIMPORT int cfg_rmsec(cfg_t *cfg, const char *name)
+static void cfg_pr_profile(cfg_printer_t *pr, cfg_stats_format_t format, cfg_profile_t *prof, int total)
 {
-	cfg_opt_t *opt;
-	unsigned int index;
+	int i;
 
-	opt = cfg_getopt_secidx(cfg, name, &index);
-	return cfg_opt_rmnsec(opt, index);
+	if (!total)
+		cfg_pr_stat(pr, format, "depth", prof->depth);
+	cfg_pr_stat(pr, format, "bytes", prof->bytes);
+	cfg_pr_stat(pr, format, "tokens", prof->tokens);
+	cfg_pr_stat(pr, format, "options", prof->options);
+	cfg_pr_stat(pr, format, "sections", prof->sections);
+	for (i = 0; i < CFG_PROFILE_PHASES; i++)
+		cfg_pr_stat(pr, format, cfg_profile_phases[i], prof->nsec[i]);
+	cfg_pr_stat(pr, format, "wall", prof->wall);
 }
 
-DLLIMPORT int cfg_opt_rmtsec(cfg_opt_t *opt, const char *title)
+static void cfg_pr_profiles(cfg_printer_t *pr, struct cfg_profiler *p, cfg_stats_format_t format)
 {
-	unsigned int i, n;
-
-	if (!opt || !title) {
-		errno = EINVAL;
-		return CFG_FAIL;
-	}
-
-	if (!is_set(CFGF_TITLE, opt->flags))
-		return CFG_FAIL;
-
-	n = cfg_opt_size(opt);
-	for (i = 0; i < n; i++) {
-		cfg_t *sec = cfg_opt_getnsec(opt, i);
-
-		if (!sec || !sec->title)
-			return CFG_FAIL;
-
-		if (is_set(CFGF_NOCASE, opt->flags)) {
-			if (strcasecmp(title, sec->title) == 0)
-				break;
+	cfg_profile_t total;
+	unsigned int i;
+	int j;
+
+	memset(&total, 0, sizeof(total));
+	if (format == CFG_STATS_JSON)
+		cfg_pr_puts(pr, "{\"files\":[");
+
+	for (i = 0; p && i < p->num; i++) {
+		cfg_profile_t *prof = &p->rec[i].prof;
+
+		total.bytes += prof->bytes;
+		total.tokens += prof->tokens;
+		total.options += prof->options;
+		total.sections += prof->sections;
+		for (j = 0; j < CFG_PROFILE_PHASES; j++)
+			total.nsec[j] += prof->nsec[j];
+		if (!prof->depth)
+			total.wall += prof->wall;
+
+		if (format == CFG_STATS_JSON) {
+			if (i)
+				cfg_pr_putc(pr, ',');
+			cfg_pr_puts(pr, "{\"file\":");
+			cfg_pr_json(pr, prof->filename, strlen(prof->filename));
+			cfg_pr_profile(pr, format, prof, 0);
+			cfg_pr_putc(pr, '}');
 		} else {
-			if (strcmp(title, sec->title) == 0)
-				break;
+			cfg_pr_indent(pr, prof->depth);
+			cfg_pr_puts(pr, prof->filename);
+			cfg_pr_profile(pr, format, prof, 0);
+			cfg_pr_putc(pr, '\n');
 		}
 	}
-	if (i == n)
-		return CFG_FAIL;
 
-	return cfg_opt_rmnsec(opt, i);
+	if (format == CFG_STATS_JSON) {
+		cfg_pr_puts(pr, "],\"total\":{\"files\":");
+		cfg_pr_uint(pr, p ? p->num : 0, 0);
+		cfg_pr_profile(pr, format, &total, 1);
+		cfg_pr_puts(pr, "}}\n");
+	} else {
+		cfg_pr_puts(pr, "total files=");
+		cfg_pr_uint(pr, p ? p->num : 0, 0);
+		cfg_pr_profile(pr, format, &total, 1);
+		cfg_pr_putc(pr, '\n');
+	}
 }
 
-DLLIMPORT int cfg_rmtsec(cfg_t *cfg, const char *name, const char *title)
+static int cfg_profile_print(cfg_t *cfg, cfg_stats_format_t format, cfg_write_func_t cb, void *arg, FILE *fp)
 {
-	return cfg_opt_rmtsec(cfg_getopt(cfg, name), title);
+	char buf[CFG_PRINTBUF_SIZE];
+	cfg_printer_t pr;
+
+	cfg_pr_init(&pr, buf, sizeof(buf), cb, arg, fp);
+	cfg_pr_profiles(&pr, cfg_profile_of(cfg), format);
+
+	return cfg_pr_done(&pr);
 }
 
-DLLIMPORT int cfg_opt_nprint_var(cfg_opt_t *opt, unsigned int index, FILE *fp)
+DLLIMPORT int cfg_profile_dump(cfg_t *cfg, FILE *fp, cfg_stats_format_t format)
 {
-	const char *str;
+	if (!cfg || !fp || (format != CFG_STATS_TEXT && format != CFG_STATS_JSON)) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
 
-	if (!opt || !fp) {
+	return cfg_profile_print(cfg, format, cfg_pr_fwrite, fp, fp);
+}
+
+DLLIMPORT int cfg_profile_dump_cb(cfg_t *cfg, cfg_stats_format_t format, cfg_write_func_t cb, void *arg)
+{
+	if (!cfg || !cb || (format != CFG_STATS_TEXT && format != CFG_STATS_JSON)) {
 		errno = EINVAL;
 		return CFG_FAIL;
 	}
 
-	switch (opt->type) {
-	case CFGT_INT:
-		fprintf(fp, "%ld", cfg_opt_getnint(opt, index));
-		break;
+	return cfg_profile_print(cfg, format, cb, arg, NULL);
+}
 
-	case CFGT_INT8:
-		fprintf(fp, "%" PRId8, cfg_opt_getnint8(opt, index));
-		break;
+/*
+ * Every file that took part in a parse, the main file and all include()
+ * targets, is recorded in the root section.  cfg_watch_fd() watches the
+ * directories they live in with inotify, so files replaced by rename(),
+ * as most editors and deployment tools do, are noticed too.  Without
+ * inotify, or when out of inotify instances, a timerfd ticks at a fixed
+ * interval and cfg_watch_dispatch() compares stat() results instead.
+ *
+ * The debounce does not block: with inotify, a change arms a one-shot
+ * timerfd, and the callback is called when it expires with no change
+ * since.  The two descriptors are joined in an epoll descriptor for the
+ * caller.  When polling, the polls speed up to the debounce after a
+ * change, until the files have been quiet for long enough.  Only
+ * without a timerfd, or without a descriptor at all, does
+ * cfg_watch_dispatch() wait for the files to calm down itself.
+ */
+#define CFG_WATCH_INTERVAL 1	/* Seconds between stat() polls */
+
+struct cfg_watch_file {
+	char *name;		/* As opened by the parser */
+	char *dir;		/* Directory watched for it */
+	const char *base;	/* File name in dir, points into name */
+	int wd;			/* inotify watch descriptor of dir */
+	int exists;
+#ifdef HAVE_SYS_STAT_H
+	struct stat st;
+#endif
+};
 
-	case CFGT_INT16:
-		fprintf(fp, "%" PRId16, cfg_opt_getnint16(opt, index));
-		break;
+struct cfg_watch {
+	struct cfg_watch_file *files;
+	unsigned int nfiles;
+	int fd;			/* Returned by cfg_watch_fd(), one of the below */
+	int ifd;		/* inotify, or -1 */
+	int tfd;		/* timerfd, debounce or stat() polls, or -1 */
+	int efd;		/* epoll of ifd and tfd, or -1 */
+	int pending;		/* Changed, waiting for the debounce */
+	unsigned int period;	/* Of the stat() polls, in ms */
+	unsigned int quiet;	/* Since the last change, in ms */
+};
 
-	case CFGT_INT32:
-		fprintf(fp, "%" PRId32, cfg_opt_getnint32(opt, index));
-		break;
+/* Returns 1 if the file has changed since the last call */
+static int cfg_watch_stat(struct cfg_watch_file *file)
+{
+#ifdef HAVE_SYS_STAT_H
+	struct stat st;
+	int exists;
 
-	case CFGT_INT64:
-		fprintf(fp, "%" PRId64, cfg_opt_getnint64(opt, index));
-		break;
+	memset(&st, 0, sizeof(st));
+	exists = stat(file->name, &st) == 0;
+	if (exists == file->exists && (!exists ||
+	    (st.st_dev == file->st.st_dev && st.st_ino == file->st.st_ino &&
+	     st.st_size == file->st.st_size && st.st_mtime == file->st.st_mtime)))
+		return 0;
 
-	case CFGT_UINT8:
-		fprintf(fp, "%" PRIu8, cfg_opt_getnuint8(opt, index));
-		break;
+	file->exists = exists;
+	file->st = st;
 
-	case CFGT_UINT16:
-		fprintf(fp, "%" PRIu16, cfg_opt_getnuint16(opt, index));
-		break;
+	return 1;
+#else
+	(void)file;
+	return 0;
+#endif
+}
 
-	case CFGT_UINT32:
-		fprintf(fp, "%" PRIu32, cfg_opt_getnuint32(opt, index));
-		break;
+/* Fire once after ms, or every ms with repeat, or never if ms is 0 */
+static int cfg_watch_arm(struct cfg_watch *w, unsigned int ms, int repeat)
+{
+#ifdef HAVE_SYS_TIMERFD_H
+	struct itimerspec its;
 
-	case CFGT_UINT64:
-		fprintf(fp, "%" PRIu64, cfg_opt_getnuint64(opt, index));
-		break;
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = ms / 1000;
+	its.it_value.tv_nsec = (long)(ms % 1000) * 1000000;
+	if (repeat)
+		its.it_interval = its.it_value;
+
+	return timerfd_settime(w->tfd, 0, &its, NULL);
+#else
+	(void)w;
+	(void)ms;
+	(void)repeat;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+static int cfg_watch_add_wd(struct cfg_watch *w, struct cfg_watch_file *file)
+{
+	file->wd = inotify_add_watch(w->ifd, file->dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+				     IN_CREATE | IN_DELETE | IN_ATTRIB);
 
-	case CFGT_FLOAT:
-		fprintf(fp, "%f", cfg_opt_getnfloat(opt, index));
-		break;
+	return file->wd < 0 ? -1 : 0;
+}
+#endif
 
-	case CFGT_STR:
-		str = cfg_opt_getnstr(opt, index);
-		fprintf(fp, "\"");
-		while (str && *str) {
-			if (*str == '"')
-				fprintf(fp, "\\\"");
-			else if (*str == '\\')
-				fprintf(fp, "\\\\");
-			else
-				fprintf(fp, "%c", *str);
-			str++;
-		}
-		fprintf(fp, "\"");
-		break;
+static void cfg_watch_add(cfg_t *cfg, const char *filename)
+{
+	struct cfg_watch_file *file;
+	struct cfg_watch *w;
+	const char *slash;
+	unsigned int i;
 
-	case CFGT_BOOL:
-		fprintf(fp, "%s", cfg_opt_getnbool(opt, index) ? "true" : "false");
-		break;
+	while (cfg->parent)
+		cfg = cfg->parent;
+
+	w = cfg->watch;
+	if (!w) {
+		w = calloc(1, sizeof(*w));
+		if (!w)
+			return;
+		w->fd = w->ifd = w->tfd = w->efd = -1;
+		cfg->watch = w;
+		cfg_mem_count(cfg, CFG_MEMORY_PATHS, 1, sizeof(*w));
+	}
 
-	case CFGT_NONE:
-	case CFGT_SEC:
-	case CFGT_RAWSEC:
-	case CFGT_FUNC:
-	case CFGT_PTR:
-	case CFGT_COMMENT:
-		break;
+	for (i = 0; i < w->nfiles; i++) {
+		if (!strcmp(w->files[i].name, filename))
+			return;
 	}
 
-	return CFG_SUCCESS;
+	file = reallocarray(w->files, w->nfiles + 1, sizeof(*file));
+	if (!file)
+		return;
+	w->files = file;
+	file = &w->files[w->nfiles];
+	memset(file, 0, sizeof(*file));
+
+	file->name = strdup(filename);
+	slash = file->name ? strrchr(file->name, '/') : NULL;
+	if (slash)
+		file->dir = strndup(file->name, slash == file->name ? 1 : slash - file->name);
+	else
+		file->dir = strdup(".");
+	if (!file->name || !file->dir) {
+		free(file->name);
+		free(file->dir);
+		return;
+	}
+	file->base = slash ? slash + 1 : file->name;
+	file->wd = -1;
+	cfg_watch_stat(file);
+	w->nfiles++;
+
+	/* Counted by nfiles, a larger array from a failed call is not */
+	if (w->nfiles > 1)
+		cfg_mem_count(cfg, CFG_MEMORY_PATHS, -1, (w->nfiles - 1) * sizeof(*file));
+	cfg_mem_count(cfg, CFG_MEMORY_PATHS, 1, w->nfiles * sizeof(*file));
+	cfg_mem_str(cfg, CFG_MEMORY_PATHS, 1, file->name);
+	cfg_mem_str(cfg, CFG_MEMORY_PATHS, 1, file->dir);
+
+#ifdef HAVE_SYS_INOTIFY_H
+	/* Included after cfg_watch_fd(), e.g. by a second cfg_parse() */
+	if (w->ifd >= 0)
+		cfg_watch_add_wd(w, file);
+#endif
 }
 
-static void cfg_indent(FILE *fp, int indent)
+static void cfg_watch_free(cfg_t *cfg)
 {
-	while (indent--)
-		fprintf(fp, "  ");
+	struct cfg_watch *w = cfg->watch;
+	unsigned int i;
+
+	for (i = 0; i < w->nfiles; i++) {
+		cfg_mem_str(cfg, CFG_MEMORY_PATHS, -1, w->files[i].name);
+		cfg_mem_str(cfg, CFG_MEMORY_PATHS, -1, w->files[i].dir);
+		free(w->files[i].name);
+		free(w->files[i].dir);
+	}
+	if (w->nfiles)
+		cfg_mem_count(cfg, CFG_MEMORY_PATHS, -1, w->nfiles * sizeof(w->files[0]));
+	cfg_mem_count(cfg, CFG_MEMORY_PATHS, -1, sizeof(*w));
+	free(w->files);
+#ifdef HAVE_UNISTD_H
+	if (w->efd >= 0)
+		close(w->efd);
+	if (w->ifd >= 0)
+		close(w->ifd);
+	if (w->tfd >= 0)
+		close(w->tfd);
+#endif
+	free(w);
 }
 
-static int cfg_opt_print_pff_indent(cfg_opt_t *opt, FILE *fp,
-				    cfg_print_filter_func_t pff, int indent)
+DLLIMPORT int cfg_watch_fd(cfg_t *cfg)
 {
-	if (!opt || !fp) {
+	struct cfg_watch *w;
+
+	if (!cfg) {
 		errno = EINVAL;
-		return CFG_FAIL;
+		return -1;
 	}
 
-	if (is_set(CFGF_COMMENTS, opt->flags) && opt->comment) {
-		cfg_indent(fp, indent);
-		fprintf(fp, "/* %s */\n", opt->comment);
+	while (cfg->parent)
+		cfg = cfg->parent;
+
+	w = cfg->watch;
+	if (!w || !w->nfiles) {
+		errno = ENOENT;
+		return -1;
 	}
 
-	if (opt->type == CFGT_SEC) {
-		cfg_t *sec;
+	if (w->fd >= 0)
+		return w->fd;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	w->ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (w->ifd >= 0) {
 		unsigned int i;
 
-		for (i = 0; i < cfg_opt_size(opt); i++) {
-			sec = cfg_opt_getnsec(opt, i);
-			cfg_indent(fp, indent);
-			if (is_set(CFGF_TITLE, opt->flags))
-				fprintf(fp, "%s \"%s\" {\n", opt->name, cfg_title(sec));
-			else
-				fprintf(fp, "%s {\n", opt->name);
-			cfg_print_pff_indent(sec, fp, pff, indent + 1);
-			cfg_indent(fp, indent);
-			fprintf(fp, "}\n");
+		for (i = 0; i < w->nfiles; i++) {
+			if (cfg_watch_add_wd(w, &w->files[i]))
+				break;
 		}
-	} else if (opt->type == CFGT_RAWSEC) {
-		cfg_t *sec;
-		unsigned int i;
+		if (i < w->nfiles) {
+			close(w->ifd);
+			w->ifd = -1;
+		}
+	}
+#endif
 
-		for (i = 0; i < cfg_opt_size(opt); i++) {
-			sec = cfg_opt_getnsec(opt, i);
-			cfg_indent(fp, indent);
-			if (is_set(CFGF_TITLE, opt->flags))
-				fprintf(fp, "%s \"%s\" {%s}\n", opt->name, cfg_title(sec), sec->raw ? sec->raw : "");
-			else
-				fprintf(fp, "%s {%s}\n", opt->name, sec->raw ? sec->raw : "");
+#ifdef HAVE_SYS_TIMERFD_H
+	w->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	w->period = CFG_WATCH_INTERVAL * 1000;
+	if (w->tfd >= 0 && w->ifd < 0 && cfg_watch_arm(w, w->period, 1)) {
+		close(w->tfd);
+		w->tfd = -1;
+	}
+#endif
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (w->ifd >= 0 && w->tfd >= 0) {
+		struct epoll_event ev;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		w->efd = epoll_create1(EPOLL_CLOEXEC);
+		if (w->efd >= 0 &&
+		    (epoll_ctl(w->efd, EPOLL_CTL_ADD, w->ifd, &ev) ||
+		     epoll_ctl(w->efd, EPOLL_CTL_ADD, w->tfd, &ev))) {
+			close(w->efd);
+			w->efd = -1;
 		}
-	} else if (opt->type != CFGT_FUNC && opt->type != CFGT_NONE) {
-		if (is_set(CFGF_LIST, opt->flags)) {
-			cfg_indent(fp, indent);
-			fprintf(fp, "%s = {", opt->name);
+	}
+#endif
 
-			if (opt->nvalues) {
-				unsigned int i;
+	/* With inotify, the timer is only of use through epoll */
+	if (w->ifd >= 0 && w->efd < 0 && w->tfd >= 0) {
+		close(w->tfd);
+		w->tfd = -1;
+	}
 
-				if (opt->pf)
-					opt->pf(opt, 0, fp);
-				else
-					cfg_opt_nprint_var(opt, 0, fp);
-				for (i = 1; i < opt->nvalues; i++) {
-					fprintf(fp, ", ");
-					if (opt->pf)
-						opt->pf(opt, i, fp);
-					else
-						cfg_opt_nprint_var(opt, i, fp);
-				}
-			}
+	if (w->efd >= 0)
+		w->fd = w->efd;
+	else if (w->ifd >= 0)
+		w->fd = w->ifd;
+	else if (w->tfd >= 0)
+		w->fd = w->tfd;
+	else
+		errno = ENOSYS;
 
-			fprintf(fp, "}");
-		} else {
-			cfg_indent(fp, indent);
-			/* comment out the option if is not set */
-			if (cfg_opt_size(opt) == 0 ||
-			    (opt->type == CFGT_STR && !cfg_opt_getnstr(opt, 0)))
-				fprintf(fp, "# ");
-			fprintf(fp, "%s=", opt->name);
-			if (opt->pf)
-				opt->pf(opt, 0, fp);
-			else
-				cfg_opt_nprint_var(opt, 0, fp);
-		}
+	return w->fd;
+}
 
-		fprintf(fp, "\n");
-	} else if (opt->pf) {
-		cfg_indent(fp, indent);
-		opt->pf(opt, 0, fp);
-		fprintf(fp, "\n");
+/* Read pending inotify events, returns 1 if any of them concerns our files */
+static int cfg_watch_events(struct cfg_watch *w)
+{
+	int changed = 0;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	union {
+		struct inotify_event ev;
+		char buf[4096];
+	} u;
+	unsigned int i;
+	ssize_t len;
+
+	if (w->ifd < 0)
+		return 0;
+
+	while ((len = read(w->ifd, u.buf, sizeof(u.buf))) > 0) {
+		char *ptr;
+
+		for (ptr = u.buf; ptr < u.buf + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event *)ptr)->len) {
+			struct inotify_event *ev = (struct inotify_event *)ptr;
+
+			if (ev->mask & IN_Q_OVERFLOW)
+				changed = 1;
+			for (i = 0; !changed && ev->len && i < w->nfiles; i++) {
+				if (w->files[i].wd == ev->wd && !strcmp(w->files[i].base, ev->name))
+					changed = 1;
+			}
+		}
 	}
+#else
+	(void)w;
+#endif
 
-	return CFG_SUCCESS;
+	return changed;
 }
 
-DLLIMPORT int cfg_opt_print_indent(cfg_opt_t *opt, FILE *fp, int indent)
+/* Times the timer has expired since the last call, up to 1000, -1 on error */
+static int cfg_watch_expired(struct cfg_watch *w)
 {
-	return cfg_opt_print_pff_indent(opt, fp, NULL, indent);
+#ifdef HAVE_SYS_TIMERFD_H
+	uint64_t ticks = 0;
+
+	if (w->tfd < 0)
+		return 0;
+	if (read(w->tfd, &ticks, sizeof(ticks)) < 0)
+		return errno == EAGAIN ? 0 : -1;
+
+	return ticks > 1000 ? 1000 : (int)ticks;
+#else
+	(void)w;
+	return 0;
+#endif
 }
 
-DLLIMPORT int cfg_opt_print(cfg_opt_t *opt, FILE *fp)
+/* Returns 1 if any of the files has changed since the last call */
+static int cfg_watch_changed(struct cfg_watch *w)
 {
-	return cfg_opt_print_pff_indent(opt, fp, NULL, 0);
+	unsigned int i;
+	int changed = 0;
+
+	for (i = 0; i < w->nfiles; i++)
+		changed |= cfg_watch_stat(&w->files[i]);
+
+	return changed;
 }
 
-static int cfg_print_pff_indent(cfg_t *cfg, FILE *fp,
-				cfg_print_filter_func_t fb_pff, int indent)
+/* Sleep, or with inotify wait for more events, for up to ms */
+static int cfg_watch_wait(struct cfg_watch *w, unsigned int ms)
 {
-	int i, result = CFG_SUCCESS;
+#ifdef HAVE_POLL_H
+	struct pollfd pfd;
 
-	for (i = 0; cfg->opts[i].name; i++) {
-		cfg_print_filter_func_t pff = cfg->pff ? cfg->pff : fb_pff;
-		if (pff && pff(cfg, &cfg->opts[i]))
-			continue;
-		result += cfg_opt_print_pff_indent(&cfg->opts[i], fp, pff, indent);
-	}
+	pfd.fd = w->ifd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
 
-	return result;
+	return poll(&pfd, 1, (int)ms) > 0;
+#else
+	(void)w;
+	(void)ms;
+	return 0;
+#endif
 }
 
-DLLIMPORT int cfg_print_indent(cfg_t *cfg, FILE *fp, int indent)
+/* The old way, for when there is no timer to debounce with */
+static int cfg_watch_settle(struct cfg_watch *w, unsigned int debounce_ms)
 {
-	return cfg_print_pff_indent(cfg, fp, NULL, indent);
+	int changed;
+
+	changed = w->ifd >= 0 ? cfg_watch_events(w) : cfg_watch_changed(w);
+	if (!changed)
+		return 0;
+
+	/* Wait for the writer to finish, i.e., until things calm down */
+	if (w->ifd >= 0) {
+		while (cfg_watch_wait(w, debounce_ms))
+			cfg_watch_events(w);
+	} else {
+		do
+			cfg_watch_wait(w, debounce_ms);
+		while (cfg_watch_changed(w));
+	}
+
+	return 1;
 }
 
-DLLIMPORT int cfg_print(cfg_t *cfg, FILE *fp)
+/* With inotify, wait for a pause of debounce_ms after the last event */
+static int cfg_watch_debounce(struct cfg_watch *w, unsigned int debounce_ms, int expired)
 {
-	return cfg_print_pff_indent(cfg, fp, NULL, 0);
+	if (cfg_watch_events(w)) {
+		if (!debounce_ms)
+			return 1;
+		if (cfg_watch_arm(w, debounce_ms, 0))
+			return -1;
+		w->pending = 1;
+		return 0;
+	}
+	if (!w->pending || !expired)
+		return 0;
+
+	w->pending = 0;
+	return 1;
 }
 
-DLLIMPORT cfg_print_func_t cfg_opt_set_print_func(cfg_opt_t *opt, cfg_print_func_t pf)
+/* Without, poll every debounce_ms after a change, until as long quiet */
+static int cfg_watch_poll(struct cfg_watch *w, unsigned int debounce_ms, int expired)
 {
-	cfg_print_func_t oldpf;
+	unsigned int period;
 
-	if (!opt) {
-		errno = EINVAL;
-		return NULL;
+	if (!expired)
+		return 0;
+
+	if (cfg_watch_changed(w)) {
+		if (!debounce_ms)
+			return 1;
+
+		period = debounce_ms < CFG_WATCH_INTERVAL * 1000 ? debounce_ms : CFG_WATCH_INTERVAL * 1000;
+		if (period != w->period && cfg_watch_arm(w, period, 1))
+			return -1;
+		w->period = period;
+		w->pending = 1;
+		w->quiet = 0;
+		return 0;
 	}
+	if (!w->pending)
+		return 0;
 
-	oldpf = opt->pf;
-	opt->pf = pf;
+	w->quiet += (unsigned int)expired * w->period;
+	if (w->quiet < debounce_ms)
+		return 0;
 
-	return oldpf;
-}
+	w->pending = 0;
+	if (w->period != CFG_WATCH_INTERVAL * 1000) {
+		w->period = CFG_WATCH_INTERVAL * 1000;
+		if (cfg_watch_arm(w, w->period, 1))
+			return -1;
+	}
 
-DLLIMPORT cfg_print_func_t cfg_set_print_func(cfg_t *cfg, const char *name, cfg_print_func_t pf)
-{
-	return cfg_opt_set_print_func(cfg_getopt(cfg, name), pf);
+	return 1;
 }
 
-static cfg_opt_t *cfg_getopt_array(cfg_opt_t *rootopts, int cfg_flags, const char *name)
+DLLIMPORT int cfg_watch_dispatch(cfg_t *cfg, unsigned int debounce_ms, cfg_watch_func_t cb, void *arg)
 {
-	unsigned int i;
-	cfg_opt_t *opts = rootopts;
+	struct cfg_watch *w;
+	int changed, expired;
 
-	if (!rootopts || !name) {
+	if (!cfg || !cb) {
 		errno = EINVAL;
-		return NULL;
+		return CFG_FAIL;
 	}
 
-	while (name && *name) {
-		cfg_t *seccfg;
-		char *secname;
-		size_t len = strcspn(name, "|");
+	while (cfg->parent)
+		cfg = cfg->parent;
 
-		if (name[len] == 0 /*len == strlen(name) */ )
-			/* no more subsections */
-			break;
+	w = cfg->watch;
+	if (!w)
+		return 0;
 
-		if (len) {
-			cfg_opt_t *secopt;
+	if (w->tfd < 0) {
+		changed = cfg_watch_settle(w, debounce_ms);
+	} else {
+		expired = cfg_watch_expired(w);
+		if (expired < 0)
+			return CFG_FAIL;
 
-			secname = strndup(name, len);
-			if (!secname)
-				return NULL;
+		if (w->ifd >= 0)
+			changed = cfg_watch_debounce(w, debounce_ms, expired);
+		else
+			changed = cfg_watch_poll(w, debounce_ms, expired);
+	}
+	if (changed <= 0)
+		return changed;
+
+	cfg_watch_changed(w);
+	cb(cfg, arg);
+
+	return 1;
+}
+
+static size_t cfg_bind_typesize(cfg_type_t type)
+{
+	switch (type) {
+	case CFGT_INT:    return sizeof(long int);
+	case CFGT_INT8:   return sizeof(int8_t);
+	case CFGT_INT16:  return sizeof(int16_t);
+	case CFGT_INT32:  return sizeof(int32_t);
+	case CFGT_INT64:  return sizeof(int64_t);
+	case CFGT_UINT8:  return sizeof(uint8_t);
+	case CFGT_UINT16: return sizeof(uint16_t);
+	case CFGT_UINT32: return sizeof(uint32_t);
+	case CFGT_UINT64: return sizeof(uint64_t);
+	case CFGT_FLOAT:  return sizeof(double);
+	case CFGT_BOOL:   return sizeof(cfg_bool_t);
+	case CFGT_STR:    return sizeof(char *);
+	case CFGT_PTR:    return sizeof(void *);
+	default:          return 0;
+	}
+}
 
-			secopt = cfg_getopt_array(opts, cfg_flags, secname);
-			free(secname);
-			if (!secopt) {
-				/*fprintf(stderr, "section not found\n"); */
-				return NULL;
-			}
-			if (secopt->type != CFGT_SEC) {
-				/*fprintf(stderr, "not a section!\n"); */
-				return NULL;
-			}
+static void cfg_bind_value(cfg_type_t type, cfg_value_t *val, void *field)
+{
+	switch (type) {
+	case CFGT_INT:    *(long int *)field = val->number;     break;
+	case CFGT_INT8:   *(int8_t *)field = val->i8;           break;
+	case CFGT_INT16:  *(int16_t *)field = val->i16;         break;
+	case CFGT_INT32:  *(int32_t *)field = val->i32;         break;
+	case CFGT_INT64:  *(int64_t *)field = val->i64;         break;
+	case CFGT_UINT8:  *(uint8_t *)field = val->u8;          break;
+	case CFGT_UINT16: *(uint16_t *)field = val->u16;        break;
+	case CFGT_UINT32: *(uint32_t *)field = val->u32;        break;
+	case CFGT_UINT64: *(uint64_t *)field = val->u64;        break;
+	case CFGT_FLOAT:  *(double *)field = val->fpnumber;     break;
+	case CFGT_BOOL:   *(cfg_bool_t *)field = val->boolean;  break;
+	case CFGT_STR:    *(char **)field = val->string;        break;
+	case CFGT_PTR:    *(void **)field = val->ptr;           break;
+	default:                                                break;
+	}
+}
 
-			if (!is_set(CFGF_MULTI, secopt->flags) && (seccfg = cfg_opt_getnsec(secopt, 0)) != NULL)
-				opts = seccfg->opts;
-			else
-				opts = secopt->subopts;
+static int cfg_bind_sec(cfg_t *cfg, const cfg_bind_t *binds, char *base)
+{
+	const cfg_bind_t *b;
 
-			if (!opts) {
-				/*fprintf(stderr, "section have no subopts!?\n"); */
-				return NULL;
+	for (b = binds; b->name; b++) {
+		char *field = base + b->offset;
+		struct cfg_lazyopt lo;
+		unsigned int i, n;
+		cfg_opt_t *opt;
+		char *array;
+
+		if (!*b->name) {
+			*(const char **)field = cfg->title;
+			continue;
+		}
+
+		opt = cfg_getopt_leafn(cfg, b->name, strlen(b->name));
+		if (!opt) {
+			cfg_error(cfg, _("no such option '%s'"), b->name);
+			errno = ENOENT;
+			return CFG_FAIL;
+		}
+
+		if ((opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC) != !!b->sub ||
+		    (b->size && !b->sub && b->size != cfg_bind_typesize(opt->type)) ||
+		    (!b->sub && !cfg_bind_typesize(opt->type))) {
+			cfg_error(cfg, _("cannot bind option '%s'"), b->name);
+			errno = EINVAL;
+			return CFG_FAIL;
+		}
+
+		opt = cfg_opt_default(opt, &lo);
+		if (opt->simple_value.ptr) {
+			cfg_value_t *val = (cfg_value_t *)opt->simple_value.ptr;
+
+			if (b->size) {
+				array = calloc(1, b->size);
+				if (!array)
+					return CFG_FAIL;
+				*(void **)field = array;
+				*(unsigned int *)(base + b->count) = 1;
+				field = array;
 			}
+			cfg_bind_value(opt->type, val, field);
+			continue;
 		}
-		name += len;
-		name += strspn(name, "|");
-	}
 
-	for (i = 0; opts[i].name; i++) {
-		if (is_set(CFGF_NOCASE, cfg_flags)) {
-			if (strcasecmp(opts[i].name, name) == 0)
-				return &opts[i];
-		} else {
-			if (strcmp(opts[i].name, name) == 0)
-				return &opts[i];
+		n = opt->nvalues;
+		if (!b->size) {
+			if (!n)
+				continue;
+			if (!b->sub) {
+				cfg_bind_value(opt->type, opt->values[0], field);
+				continue;
+			}
+			if (cfg_bind_sec(opt->values[0]->section, b->sub, field))
+				return CFG_FAIL;
+			continue;
+		}
+
+		array = n ? calloc(n, b->size) : NULL;
+		if (n && !array)
+			return CFG_FAIL;
+		*(void **)field = array;
+		*(unsigned int *)(base + b->count) = n;
+
+		for (i = 0; i < n; i++) {
+			if (!b->sub)
+				cfg_bind_value(opt->type, opt->values[i], array + i * b->size);
+			else if (cfg_bind_sec(opt->values[i]->section, b->sub, array + i * b->size))
+				return CFG_FAIL;
 		}
 	}
 
-	return NULL;
+	return CFG_SUCCESS;
 }
 
-DLLIMPORT cfg_validate_callback_t cfg_set_validate_func(cfg_t *cfg, const char *name, cfg_validate_callback_t vf)
+static void cfg_unbind_sec(const cfg_bind_t *binds, char *base)
 {
-	cfg_opt_t *opt;
-	cfg_validate_callback_t oldvf;
+	const cfg_bind_t *b;
 
-	opt = cfg_getopt_array(cfg->opts, cfg->flags, name);
-	if (!opt)
-		return NULL;
+	for (b = binds; b->name; b++) {
+		char *field = base + b->offset;
+		unsigned int i, n;
+		char *array;
 
-	oldvf = opt->validcb;
-	opt->validcb = vf;
+		if (!b->size) {
+			if (b->sub)
+				cfg_unbind_sec(b->sub, field);
+			continue;
+		}
 
-	return oldvf;
+		array = *(char **)field;
+		n = *(unsigned int *)(base + b->count);
+		for (i = 0; array && b->sub && i < n; i++)
+			cfg_unbind_sec(b->sub, array + i * b->size);
+
+		free(array);
+		*(void **)field = NULL;
+		*(unsigned int *)(base + b->count) = 0;
+	}
 }
 
-DLLIMPORT cfg_validate_callback2_t cfg_set_validate_func2(cfg_t *cfg, const char *name, cfg_validate_callback2_t vf)
+DLLIMPORT int cfg_bind(cfg_t *cfg, const cfg_bind_t *binds, void *base)
 {
-	cfg_opt_t *opt;
-	cfg_validate_callback2_t oldvf;
+	if (!cfg || !binds || !base) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
 
-	opt = cfg_getopt_array(cfg->opts, cfg->flags, name);
-	if (!opt)
-		return NULL;
+	if (cfg_bind_sec(cfg, binds, base)) {
+		cfg_unbind_sec(binds, base);
+		return CFG_FAIL;
+	}
 
-	oldvf = opt->validcb2;
-	opt->validcb2 = vf;
+	return CFG_SUCCESS;
+}
 
-	return oldvf;
+DLLIMPORT int cfg_unbind(const cfg_bind_t *binds, void *base)
+{
+	if (!binds || !base) {
+		errno = EINVAL;
+		return CFG_FAIL;
+	}
+
+	cfg_unbind_sec(binds, base);
+
+	return CFG_SUCCESS;
 }
 
 /**
@@ -28,6 +28,7 @@ extern "C" {
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #if defined(_WIN32) && !defined(__GNUC__)
@@ -97,6 +98,13 @@ typedef enum cfg_type_t cfg_type_t;	/**< A fundamental option type, one of the C
 #define CFGF_MODIFIED       (1 << 12) /**< option has been changed from its default value */
 #define CFGF_KEYSTRVAL      (1 << 13) /**< section has free-form key=value string options created when parsing file */
 #define CFGF_USE_INCLUDE_FUNCTION (1 << 14) /**< add an include() function to the section's options */
+#define CFGF_FROZEN         (1 << 15) /**< used internally, the section is read-only, see cfg_freeze() */
+#define CFGF_INTERN         (1 << 16) /**< equal string values and titles share memory, see cfg_intern_stats() */
+#define CFGF_STATS          (1 << 17) /**< count lookups and reads of options, see cfg_stats_dump() */
+#define CFGF_PROFILE        (1 << 18) /**< time the phases of parsing, see cfg_profile_dump() */
+#define CFGF_LAZY           (1 << 19) /**< default values are read from the schema, or set on first use, see cfg_init() */
+#define CFGF_LAZYDEF        (1 << 20) /**< used internally, the default value is yet to be set, see CFGF_LAZY */
+#define CFGF_SHARED         (1 << 21) /**< used internally, the values belong to the tree a copy was made from, see cfg_dup() */
 
 /* Return codes from cfg_parse(), cfg_parse_boolean(), and cfg_set*() functions. */
 #define CFG_SUCCESS     0  /**< Success, all OK (POSIX '0') */
@@ -228,6 +236,94 @@ typedef void (*cfg_free_func_t)(void *value);
 /** Boolean values. */
 typedef enum { cfg_false, cfg_true } cfg_bool_t;
 
+/** A 128-bit hash of a configuration tree, see cfg_fingerprint() */
+typedef struct cfg_fingerprint_t {
+	uint64_t hi;
+	uint64_t lo;
+} cfg_fingerprint_t;
+
+/** Shared string statistics, see cfg_intern_stats() */
+typedef struct cfg_intern_stats_t {
+	size_t strings;		/**< Number of distinct strings */
+	size_t refs;		/**< Number of values and titles using them */
+	size_t bytes;		/**< Memory of the distinct strings, in bytes */
+	size_t saved;		/**< Memory saved by sharing, in bytes */
+} cfg_intern_stats_t;
+
+/** Kinds of memory held by a configuration, see cfg_memory_stats() */
+typedef enum {
+	CFG_MEMORY_SECTIONS,	/**< Section structures, names and file names */
+	CFG_MEMORY_OPTIONS,	/**< Option arrays copied from cfg_init() and
+				 * CFG_SEC(), their names and defaults,
+				 * option name hash tables, and CFGF_STATS
+				 * counters */
+	CFG_MEMORY_VALUES,	/**< Value cells and the arrays of them */
+	CFG_MEMORY_STRINGS,	/**< String values, and with CFGF_INTERN all
+				 * shared strings and their table */
+	CFG_MEMORY_TITLES,	/**< Section titles, unless shared */
+	CFG_MEMORY_COMMENTS,	/**< Option comments */
+	CFG_MEMORY_RAW,		/**< Verbatim bodies of CFGT_RAWSEC sections */
+	CFG_MEMORY_PATHS,	/**< Search paths, watched files and
+				 * CFGF_PROFILE records */
+	CFG_MEMORY_CATEGORIES	/**< Number of categories */
+} cfg_memory_category_t;
+
+/** Memory of one category, see cfg_memory_stats() */
+typedef struct cfg_memory_count_t {
+	size_t bytes;		/**< Bytes requested from malloc(3) */
+	size_t allocs;		/**< Number of allocations */
+} cfg_memory_count_t;
+
+/** Memory statistics, see cfg_memory_stats() */
+typedef struct cfg_memory_stats_t {
+	cfg_memory_count_t category[CFG_MEMORY_CATEGORIES]; /**< Indexed by cfg_memory_category_t */
+	cfg_memory_count_t total; /**< Sum of all categories */
+} cfg_memory_stats_t;
+
+/** Lookup statistics of an option, see cfg_opt_stats() */
+typedef struct cfg_opt_stats_t {
+	uint64_t lookups;	/**< Lookups by name that found the option */
+	uint64_t reads;		/**< Values read by a getter, by name or not */
+	uint64_t misses;	/**< Reads that found no value at the index,
+				 * or an unset string */
+	uint64_t errors;	/**< Reads with a getter of the wrong type */
+	uint64_t nsec;		/**< Time spent in the lookups, in nanoseconds */
+} cfg_opt_stats_t;
+
+/** Output formats of cfg_stats_dump() */
+typedef enum {
+	CFG_STATS_TEXT,		/**< One line per option */
+	CFG_STATS_JSON		/**< A JSON object */
+} cfg_stats_format_t;
+
+/** Phases of parsing timed with CFGF_PROFILE, see cfg_profile_get() */
+typedef enum {
+	CFG_PROFILE_PARSE,	/**< The parser itself, anything not below */
+	CFG_PROFILE_LEX,	/**< Reading the input and splitting it into tokens */
+	CFG_PROFILE_SETOPT,	/**< Converting and storing values, creating sections */
+	CFG_PROFILE_CALLBACK,	/**< Validation callbacks and CFGT_FUNC functions */
+	CFG_PROFILE_INCLUDE,	/**< Finding and opening include() files */
+	CFG_PROFILE_DEFAULTS,	/**< Setting default values, parsing them included */
+	CFG_PROFILE_PHASES	/**< Number of phases */
+} cfg_profile_phase_t;
+
+/** Profile of one parsed file, buffer or include(), see cfg_profile_get() */
+typedef struct cfg_profile_t {
+	const char  *filename;	/**< As in error messages, "[init]" for the
+				 * defaults set by cfg_init() */
+	unsigned int depth;	/**< 0 for cfg_init() and cfg_parse(), 1 for
+				 * a file included by it, and so on */
+	uint64_t     bytes;	/**< Size of the input, 0 if not known */
+	uint64_t     tokens;	/**< Tokens read, not counting defaults */
+	uint64_t     options;	/**< Values set from the input */
+	uint64_t     sections;	/**< Sections created, also by defaults */
+	uint64_t     nsec[CFG_PROFILE_PHASES]; /**< Time spent in each phase on
+						 * this file, not on files it
+						 * includes, in nanoseconds */
+	uint64_t     wall;	/**< Time from start to end of the file,
+				 * files it includes included */
+} cfg_profile_t;
+
 /** Error reporting function. */
 typedef void (*cfg_errfunc_t)(cfg_t *cfg, const char *fmt, va_list ap);
 
@@ -242,6 +338,59 @@ typedef void (*cfg_errfunc_t)(cfg_t *cfg, const char *fmt, va_list ap);
  */
 typedef int (*cfg_print_filter_func_t)(cfg_t *cfg, cfg_opt_t *opt);
 
+/** Output function for cfg_print_cb().
+ *
+ * Called with chunks of the printed configuration as they are ready,
+ * the buffer is not NUL terminated.
+ *
+ * @param arg The argument given to cfg_print_cb().
+ * @param buf The data to write.
+ * @param len Number of bytes in buf.
+ * @return Zero on success, non-zero to signal a write error.
+ *
+ * @see cfg_print_cb()
+ */
+typedef int (*cfg_write_func_t)(void *arg, const char *buf, size_t len);
+
+/** Kind of change reported by cfg_diff() */
+typedef enum {
+	CFG_DIFF_ADDED,		/**< Only in the new configuration */
+	CFG_DIFF_REMOVED,	/**< Only in the old configuration */
+	CFG_DIFF_MODIFIED	/**< In both, but with different values */
+} cfg_diff_kind_t;
+
+/** Callback for cfg_diff(), called once for each difference.
+ *
+ * Paths use the same syntax as cfg_getopt(), e.g. "backend=web|port"
+ * for titled sections, or "server=1|port" for untitled multi-sections,
+ * so they can be looked up in either configuration.
+ *
+ * @param arg The argument given to cfg_diff().
+ * @param kind What changed.
+ * @param path The option or section that changed.
+ * @param oldopt The option in the old configuration, NULL if added.
+ * @param newopt The option in the new configuration, NULL if removed.
+ * @param oldsec For sections, the old section, NULL if added.
+ * @param newsec For sections, the new section, NULL if removed.
+ * @return Zero to continue, non-zero to stop the diff.
+ *
+ * @see cfg_diff()
+ */
+typedef int (*cfg_diff_func_t)(void *arg, cfg_diff_kind_t kind, const char *path,
+			       cfg_opt_t *oldopt, cfg_opt_t *newopt,
+			       cfg_t *oldsec, cfg_t *newsec);
+
+/** Reload callback for cfg_watch_dispatch().
+ *
+ * @param cfg The configuration whose files have changed.  The callback
+ * may free it, e.g., after parsing a new one.
+ * @param arg The argument given to cfg_watch_dispatch().
+ */
+typedef void (*cfg_watch_func_t)(cfg_t *cfg, void *arg);
+
+/** An atomically replaceable configuration, see cfg_handle_init() */
+typedef struct cfg_handle_t cfg_handle_t;
+
 /** Data structure holding information about a "section". Sections can
  * be nested. A section has a list of options (strings, numbers,
  * booleans or other sections) grouped together.
@@ -263,6 +412,28 @@ struct cfg_t {
 	cfg_searchpath_t *path;	/**< Linked list of directories to search */
 	cfg_print_filter_func_t pff; /**< Printing filter function */
 	char *raw;		/**< Verbatim body, set for CFGT_RAWSEC sections */
+	cfg_t *parent;		/**< The section containing this one, NULL
+				 * for the root section */
+	cfg_fingerprint_t fingerprint; /**< Cached cfg_fingerprint() */
+	int fpvalid;		/**< Set while fingerprint is up to date */
+	long refcount;		/**< References to the root section, see
+				 * cfg_acquire() */
+	struct cfg_watch *watch; /**< Files the root section was read
+				  * from, see cfg_watch_fd() */
+	struct cfg_index *index; /**< Option name hash table, see
+				  * cfg_gethopt() */
+	struct cfg_intern *intern; /**< Shared strings of the root
+				    * section, see CFGF_INTERN */
+	struct cfg_memtype *memtype; /**< Memory counters of sections with
+				      * this name, see cfg_memory_stats() */
+	struct cfg_stats *stats; /**< Lookup counters of the options, see
+				  * CFGF_STATS */
+	struct cfg_profiler *profile; /**< Parse profile of the root section,
+				       * see CFGF_PROFILE */
+	struct cfg_overlay *overlay; /**< Layers of an overlay, see
+				      * cfg_overlay() */
+	cfg_t *source;		/**< The tree a copy shares values with,
+				 * see cfg_dup() */
 };
 
 /** Data structure holding the value of a fundamental option value.
@@ -338,6 +509,8 @@ struct cfg_opt_t {
 	cfg_validate_callback2_t validcb2; /**< Value validating set callback function */
 	cfg_print_func_t pf;	/**< print callback function */
 	cfg_free_func_t freecb;	/**< user-defined memory release function */
+	cfg_t *sec;		/**< The section this option belongs to, set
+				 * for the options of a cfg_init() tree */
 };
 
 extern const char __export confuse_copyright[]; /**< libConfuse copyright string */
@@ -858,6 +1031,70 @@ extern const char __export confuse_author[];    /**< libConfuse author string */
   { .type = CFGT_NONE, }
 
 
+/** Binds an option to a field of a C struct, see cfg_bind().
+ */
+typedef struct cfg_bind_t {
+	const char *name;	/**< Option name, "" for the section title,
+				 * NULL terminates the list */
+	size_t offset;		/**< offsetof() the field */
+	size_t size;		/**< Element size for lists and multi-sections,
+				 * 0 for a single value or section */
+	size_t count;		/**< offsetof() an unsigned int field for the
+				 * number of elements, if size is set */
+	const struct cfg_bind_t *sub; /**< Bindings for the options of a section */
+} cfg_bind_t;
+
+/** Bind a single value.  The field must have the C type of the option:
+ * long int for CFG_INT, int8_t for CFG_INT8, ..., double for CFG_FLOAT,
+ * cfg_bool_t for CFG_BOOL, char * for CFG_STR and void * for CFG_PTR.
+ */
+#define CFG_BIND(_name, _type, _field) { \
+	.name = _name, \
+	.offset = offsetof(_type, _field), \
+}
+
+/** Bind a list to a pointer field and an unsigned int count field.
+ * The array is allocated by cfg_bind() and freed by cfg_unbind().
+ */
+#define CFG_BIND_LIST(_name, _type, _field, _count) { \
+	.name = _name, \
+	.offset = offsetof(_type, _field), \
+	.size = sizeof(*((_type *)0)->_field), \
+	.count = offsetof(_type, _count), \
+}
+
+/** Bind a section to an embedded struct, using the bindings in _sub.
+ */
+#define CFG_BIND_SEC(_name, _type, _field, _sub) { \
+	.name = _name, \
+	.offset = offsetof(_type, _field), \
+	.sub = _sub, \
+}
+
+/** Bind a multi-section to a pointer to an array of structs, and an
+ * unsigned int count field, using the bindings in _sub for each.
+ */
+#define CFG_BIND_MULTISEC(_name, _type, _field, _count, _sub) { \
+	.name = _name, \
+	.offset = offsetof(_type, _field), \
+	.size = sizeof(*((_type *)0)->_field), \
+	.count = offsetof(_type, _count), \
+	.sub = _sub, \
+}
+
+/** Bind the title of a section to a const char * field.
+ */
+#define CFG_BIND_TITLE(_type, _field) { \
+	.name = "", \
+	.offset = offsetof(_type, _field), \
+}
+
+/** Terminate a list of bindings.
+ */
+#define CFG_BIND_END() \
+  { .name = NULL, }
+
+
 
 /** Create and initialize a cfg_t structure. This should be the first function
  * called when setting up the parsing of a configuration file. The options
@@ -878,16 +1115,221 @@ extern const char __export confuse_author[];    /**< libConfuse author string */
  *     setlocale(LC_MESSAGES, "");
  *     setlocale(LC_CTYPE, "");
  * </pre>
+ *
+ * With CFGF_LAZY, default values are not set up front for every
+ * option of every section, including whole trees of subsections.  A
+ * single number, boolean or string is read from the schema by the
+ * cfg_get*(), cfg_opt_get*() and cfg_tryget*() functions, printing and
+ * comparing, until the option is set; opt->values stays empty until
+ * then.  Lists and sections are set when first used: looked up, read,
+ * set, or frozen with their section.  Values, output and CFGF_MODIFIED
+ * are the same, what is never used is never built.  Since reading a
+ * list or section may then write to the tree, call cfg_freeze() before
+ * reading it from several threads.  With CFGF_INTERN too, a string read
+ * from the schema is not shared, see cfg_intern_stats().
+ *
  * @param opts An array of options
  * @param flags One or more flags (bitwise or'ed together). Currently only
- * CFGF_NOCASE and CFGF_IGNORE_UNKNOWN are available. Use 0 if no flags are
- * needed.
+ * CFGF_NOCASE, CFGF_IGNORE_UNKNOWN, CFGF_INTERN, CFGF_STATS,
+ * CFGF_PROFILE and CFGF_LAZY are available. Use 0 if no flags are needed.
  *
  * @return A configuration context structure. This pointer is passed
  * to almost all other functions as the first parameter.
  */
 DLLIMPORT cfg_t *__export cfg_init(cfg_opt_t *opts, cfg_flag_t flags);
 
+/** Get statistics of the shared strings of a configuration.
+ *
+ * With the CFGF_INTERN flag given to cfg_init(), equal string values
+ * and section titles anywhere in the tree share one allocation, so
+ * they can also be compared by address.  Values of CFG_SIMPLE_STR
+ * options are not shared, nor with CFGF_LAZY are strings left at their
+ * default: those are read from the copy of the schema in each section,
+ * so compare them by content.  Without the flag all counts are zero.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ * @param stats Filled in with the statistics.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_intern_stats(cfg_t *cfg, cfg_intern_stats_t *stats);
+
+/** Get the memory used by a configuration.
+ *
+ * Memory is counted as it is allocated and freed, so this is cheap.
+ * The bytes are those requested, without the overhead of malloc(3).
+ * Values of CFG_SIMPLE_STR options belong to the application and are
+ * not counted.  With CFGF_INTERN, shared titles count as strings of
+ * the root section.
+ *
+ * When the root section is freed all counts are back at zero, which
+ * is asserted unless the library is built with NDEBUG.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ * @param stats Filled in with the memory of the whole tree.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_memory_stats_type()
+ */
+DLLIMPORT int __export cfg_memory_stats(cfg_t *cfg, cfg_memory_stats_t *stats);
+
+/** Get the memory used by one type of section.
+ *
+ * Like cfg_memory_stats(), but only counts the memory held by sections
+ * of the given name, e.g. "host" for all sections of a
+ * CFG_SEC("host", ...) option anywhere in the tree, or "root" for the
+ * root section.  The memory of a section includes its options and
+ * values, but not its subsections.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ * @param name The section name.
+ * @param stats Filled in with the memory of those sections, all zero
+ * if there are none.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_memory_stats_type(cfg_t *cfg, const char *name, cfg_memory_stats_t *stats);
+
+/** Get the lookup statistics of an option.
+ *
+ * With the CFGF_STATS flag given to cfg_init(), every lookup of an
+ * option by name, e.g. with cfg_getopt() or cfg_getint(), is counted
+ * and timed, and every read of a value with a getter is counted.  This
+ * shows which options are worth a cached cfg_opt_t, or a schema from
+ * confuse.hpp.  The counters are not updated atomically, so they may
+ * be off when several threads read the configuration at once.
+ *
+ * Names that do not exist are counted per section, see
+ * cfg_stats_dump().  A frozen configuration, which threads may read at
+ * once, only counts the names that were already looked up before
+ * cfg_freeze(): it records no new ones, since that would allocate, and
+ * cfg_stats_reset() only clears their counters.  So do not share an
+ * unfrozen configuration with CFGF_STATS between threads.
+ *
+ * @param opt An option of a configuration, e.g. from cfg_getopt().
+ * @param stats Filled in with the statistics, all zero without
+ * CFGF_STATS.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_stats_dump()
+ */
+DLLIMPORT int __export cfg_opt_stats(cfg_opt_t *opt, cfg_opt_stats_t *stats);
+
+/** Reset the lookup statistics of a section and its subsections.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_stats_reset(cfg_t *cfg);
+
+/** Write the lookup statistics of a section and its subsections.
+ *
+ * Options are listed by their path from cfg, as given to cfg_getopt(),
+ * most used first.  Options never looked up or read are left out.
+ * Lookups of names that do not exist are listed after them, per path.
+ *
+ * The text format is one line per option, e.g.
+ * <pre>
+ *     backend=db|port lookups=12 reads=12 misses=0 errors=0 nsec=3120
+ *     backend=db|prot unknown=2
+ * </pre>
+ * The JSON format is one object,
+ * <pre>
+ *     {"options":[{"path":"backend=db|port","lookups":12,"reads":12,
+ *       "misses":0,"errors":0,"nsec":3120}],
+ *      "unknown":[{"path":"backend=db|prot","lookups":2}]}
+ * </pre>
+ *
+ * @param cfg The configuration file context, or any section of it.
+ * @param fp File to write to.
+ * @param format CFG_STATS_TEXT or CFG_STATS_JSON.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_opt_stats(), cfg_stats_dump_cb()
+ */
+DLLIMPORT int __export cfg_stats_dump(cfg_t *cfg, FILE *fp, cfg_stats_format_t format);
+
+/** Like cfg_stats_dump(), but writes through a callback.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ * @param format CFG_STATS_TEXT or CFG_STATS_JSON.
+ * @param cb Output function, see cfg_write_func_t.
+ * @param arg Argument passed to cb.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_stats_dump_cb(cfg_t *cfg, cfg_stats_format_t format, cfg_write_func_t cb, void *arg);
+
+/** Get the profile of a parsed file.
+ *
+ * With the CFGF_PROFILE flag given to cfg_init(), default
+ * initialization in cfg_init() and every cfg_parse(), cfg_parse_fp()
+ * and cfg_parse_buf() of the configuration, and every file they
+ * include(), add a profile.  It tells how much input was read, what
+ * came of it, and where the time went.  Each moment is charged to one
+ * phase of one file only, so the times add up to the total.
+ *
+ * Profiles are numbered in the order the files were started, a file
+ * included comes right after the line that includes it.  They are
+ * kept until cfg_profile_reset() or cfg_free().
+ *
+ * @param cfg The configuration file context, or any section of it.
+ * @param index Number of the profile, from 0.
+ * @param profile Filled in with the profile.  The file name stays valid
+ * until the profiles are reset.
+ *
+ * @return POSIX OK(0), or non-zero with errno set to ENOENT when there
+ * is no such profile, e.g. without CFGF_PROFILE.
+ * @see cfg_profile_dump()
+ */
+DLLIMPORT int __export cfg_profile_get(cfg_t *cfg, unsigned int index, cfg_profile_t *profile);
+
+/** Forget all parse profiles of a configuration.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_profile_reset(cfg_t *cfg);
+
+/** Write the parse profiles of a configuration.
+ *
+ * The text format is one line per file, indented by include depth,
+ * followed by the sum of all files, e.g.
+ * <pre>
+ *     [init] depth=0 bytes=0 tokens=0 options=0 sections=1 parse=0 lex=0 setopt=210 callback=0 include=0 defaults=5120 wall=5330
+ *     main.conf depth=0 bytes=812 tokens=140 options=38 sections=4 parse=2100 ... wall=91020
+ *       tls.conf depth=1 bytes=96 tokens=12 options=3 sections=0 parse=310 ... wall=8800
+ *     total files=3 bytes=908 tokens=152 options=41 sections=5 parse=2410 ... wall=96350
+ * </pre>
+ * Times are in nanoseconds, the total wall time is that of the files at
+ * depth 0.  The JSON format is one object with the same fields,
+ * <pre>
+ *     {"files":[{"file":"[init]","depth":0,"bytes":0,...,"wall":5330},...],
+ *      "total":{"files":3,"bytes":908,...,"wall":96350}}
+ * </pre>
+ *
+ * @param cfg The configuration file context, or any section of it.
+ * @param fp File to write to.
+ * @param format CFG_STATS_TEXT or CFG_STATS_JSON.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_profile_get(), cfg_profile_dump_cb()
+ */
+DLLIMPORT int __export cfg_profile_dump(cfg_t *cfg, FILE *fp, cfg_stats_format_t format);
+
+/** Like cfg_profile_dump(), but writes through a callback.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ * @param format CFG_STATS_TEXT or CFG_STATS_JSON.
+ * @param cb Output function, see cfg_write_func_t.
+ * @param arg Argument passed to cb.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_profile_dump_cb(cfg_t *cfg, cfg_stats_format_t format, cfg_write_func_t cb, void *arg);
+
 /** Add a searchpath directory to the configuration context, the
  * const char* argument will be duplicated and then freed as part
  * of the usual context takedown.
@@ -960,6 +1402,34 @@ DLLIMPORT int __export cfg_parse_fp(cfg_t *cfg, FILE *fp);
  */
 DLLIMPORT int __export cfg_parse_buf(cfg_t *cfg, const char *buf);
 
+/** Parse JSON with the same options as cfg_parse(), e.g. the output
+ * of cfg_print_json().
+ *
+ * The top level is one object of options.  Strings, numbers and
+ * booleans set plain options, arrays set all values of a list, and
+ * null leaves an option as it is.  Sections are objects, multi
+ * sections an array of objects, titled sections an object keyed by
+ * title, and raw sections the string of their body.  A function is
+ * called with a string, or an array of strings, as its arguments,
+ * except include(), which is not supported.
+ *
+ * Values are checked as by cfg_parse() and its validation callbacks,
+ * with the same error messages, and integers and floats are set
+ * without going through a string, unless the option has a parse
+ * callback.  The input is read once and need not be zero-terminated.
+ *
+ * @param cfg The configuration file context as returned from cfg_init().
+ * @param buf JSON text, NULL is the same as empty.
+ * @param len Length of buf, in bytes.
+ *
+ * @see cfg_parse(), cfg_print_json()
+ *
+ * @return On success, CFG_SUCCESS is returned.  On errors,
+ * CFG_PARSE_ERROR is returned and cfg_error() was called with a
+ * descriptive error message, with the line in the input.
+ */
+DLLIMPORT int __export cfg_parse_json(cfg_t *cfg, const char *buf, size_t len);
+
 /** Free the memory allocated for the values of a given option. Only
  * the values are freed, not the option itself (it is freed by cfg_free()).
  *
@@ -972,10 +1442,276 @@ DLLIMPORT int __export cfg_free_value(cfg_opt_t *opt);
 /** Free a cfg_t context. All memory allocated by the cfg_t context
  * structure are freed, and can't be used in any further cfg_* calls.
  *
+ * If others still hold a reference to it, see cfg_acquire(), e.g. a
+ * copy from cfg_dup() or an overlay, only the reference of the caller
+ * is dropped, like with cfg_release(), and the tree is freed with the
+ * last one.
+ *
  * @return POSIX OK(0), or non-zero on failure.
  */
 DLLIMPORT int __export cfg_free(cfg_t *cfg);
 
+/** Take a reference to a configuration.
+ *
+ * A configuration returned from cfg_init() holds one reference.  The
+ * reference is to the whole tree, so cfg may also be a section, and
+ * cfg_acquire() and cfg_release() can be called from any thread.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ *
+ * @return cfg, or NULL if cfg is NULL.
+ *
+ * @see cfg_release(), cfg_handle_acquire()
+ */
+DLLIMPORT cfg_t *__export cfg_acquire(cfg_t *cfg);
+
+/** Drop a reference to a configuration.
+ *
+ * When the last reference is dropped the whole tree is freed, like
+ * with cfg_free().  Unlike cfg_free(), this leaves the state of the
+ * lexer alone, so it is safe while another thread parses a new tree.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_release(cfg_t *cfg);
+
+/** Create a read-only view of configurations layered on top of each
+ * other, e.g. defaults, site and host.
+ *
+ * Lookups through the overlay, with any of the cfg_get*(),
+ * cfg_tryget*(), cfg_size(), cfg_exists() and cfg_getopt() functions,
+ * try the layers from the top down.  The first layer where the option
+ * was set, see CFGF_MODIFIED, answers.  If no layer sets it, the
+ * bottom-most layer that has it answers with its default.  Paths like
+ * "server|port" are looked up in each layer, so an option can come
+ * from a lower layer even when the section is set in a layer above.
+ * Lists and multi-sections are not merged, the top-most layer that
+ * sets them wins.  Options returned belong to a layer.
+ *
+ * The overlay has no sections of its own, and a layer's section would
+ * not show the values of the layers below it, so cfg_getsec(),
+ * cfg_getnsec(), cfg_gettsec() and their cfg_tryget*() versions fail
+ * on it with EINVAL, read sections through paths instead.  So do the
+ * functions that walk the whole tree: cfg_print() and its variants,
+ * cfg_print_json(), cfg_fingerprint() and cfg_diff().
+ *
+ * No layer is copied.  The overlay takes a reference to each with
+ * cfg_acquire(), dropped when the overlay is freed with cfg_free() or
+ * cfg_release(), so an owner that is done with a layer should use
+ * cfg_release().  Setting values and parsing through the overlay
+ * fails, use the layers for that.
+ * An overlay can be a layer of another overlay.
+ *
+ * @param base The bottom layer, its defaults apply when no layer
+ * sets an option.
+ * @param top The next layer, followed by any more layers, bottom to
+ * top, terminated by NULL.
+ *
+ * @return A new overlay, or NULL on error.
+ *
+ * @see cfg_release()
+ */
+DLLIMPORT cfg_t *__export cfg_overlay(cfg_t *base, cfg_t *top, ...);
+
+/** Create a copy of a configuration that can be changed on its own.
+ *
+ * The copy shares the values and sections of cfg until they change:
+ * an option gets its own values when it is first set, and a section is
+ * copied, without the sections below it, when it is first changed or
+ * returned by cfg_getsec(), cfg_getnsec(), cfg_gettsec() and
+ * cfg_opt_getnsec().  Making the copy takes the same time for any size
+ * of tree, and a change copies only the sections on the path to it.
+ * So a change can be tried on a copy, checked, and then installed with
+ * cfg_handle_swap() or dropped with cfg_free().
+ *
+ * As the values are shared, cfg must not change any more: it must be
+ * frozen with cfg_freeze() first, and the copy holds a reference to
+ * it, see cfg_acquire(), until it is freed.  Freeze the copy to read it
+ * without copying any more sections, or to copy it again; sections
+ * returned then may belong to cfg.  Options looked up with cfg_getopt()
+ * through a path of sections not copied yet belong to cfg too, and
+ * cannot be changed.
+ *
+ * CFG_SIMPLE_* options keep the variables of the user, which the copy
+ * then shares with cfg.  Values of CFGT_PTR options are shared too, the
+ * free function is only called by the tree that set them.
+ *
+ * @param cfg The configuration to copy, the frozen root section.
+ *
+ * @return A new configuration, or NULL on error, with errno set to
+ * EINVAL if cfg is not a frozen root section.  Free it with cfg_free()
+ * or cfg_release().
+ */
+DLLIMPORT cfg_t *__export cfg_dup(cfg_t *cfg);
+
+/** Create a handle for hot-reloading a configuration.
+ *
+ * Reader threads get the current configuration from the handle with
+ * cfg_handle_acquire(), and drop it with cfg_release() when done.  A
+ * control thread installs a newly parsed configuration with
+ * cfg_handle_swap(); the old one is freed when its last reader lets go
+ * of it, so readers never see a tree change or disappear under them.
+ *
+ * @param cfg The initial configuration, may be NULL.  The handle takes
+ * over the reference of the caller.
+ *
+ * @return A new handle, or NULL on error.
+ */
+DLLIMPORT cfg_handle_t *__export cfg_handle_init(cfg_t *cfg);
+
+/** Get a reference to the current configuration of a handle.
+ *
+ * Lock-free, safe to call from any number of threads concurrently with
+ * cfg_handle_swap().  Drop the reference with cfg_release().
+ *
+ * @param handle The handle, as returned from cfg_handle_init().
+ *
+ * @return The current configuration, or NULL if there is none.
+ */
+DLLIMPORT cfg_t *__export cfg_handle_acquire(cfg_handle_t *handle);
+
+/** Atomically replace the configuration of a handle.
+ *
+ * The handle takes over the reference of the caller to cfg, and drops
+ * its reference to the old configuration, once no reader can still be
+ * in the middle of cfg_handle_acquire() on it.
+ *
+ * @param handle The handle, as returned from cfg_handle_init().
+ * @param cfg The new configuration, may be NULL.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_handle_swap(cfg_handle_t *handle, cfg_t *cfg);
+
+/** Free a handle, and drop its reference to the current configuration.
+ *
+ * @param handle The handle, as returned from cfg_handle_init().
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_handle_free(cfg_handle_t *handle);
+
+/** Make a configuration read-only.
+ *
+ * After this, all functions that change values or sections fail with
+ * errno set to EPERM, including cfg_parse*(), while cfg_free() and
+ * cfg_release() still work.  The fingerprint cache is filled up front,
+ * and so are the default lists and sections left for their first use
+ * by CFGF_LAZY, other defaults are still read from the schema.
+ *
+ * Reading a frozen tree is safe from any number of threads without
+ * locking: cfg_get*(), cfg_tryget*(), cfg_opt_get*(), cfg_size(),
+ * cfg_getnsec(), cfg_gettsec(), cfg_gethopt(), cfg_title(), cfg_getraw(),
+ * cfg_print*(), cfg_fingerprint() and cfg_diff() do not write to the tree.  Lookups
+ * of options that do not exist call the error function, which must
+ * then be thread-safe too; the default one only writes to stderr.
+ *
+ * @param cfg The configuration file context, or a section of it, in
+ * which case only that section and the ones below it are frozen.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_freeze(cfg_t *cfg);
+
+/** Get a file descriptor that becomes readable when the files of a
+ * configuration change.
+ *
+ * All files read by cfg_parse(), including those pulled in with
+ * include(), are watched.  The descriptor can go into a select(),
+ * poll() or epoll loop; call cfg_watch_dispatch() when it is readable.
+ * It is owned by cfg and closed by cfg_free().
+ *
+ * On Linux this is an epoll descriptor joining a timer for the
+ * debounce and an inotify descriptor watching the directories of the
+ * files, so also files replaced with rename() are caught.  If inotify is
+ * not available, e.g. because the per-user limit of instances is
+ * reached, a timer descriptor that fires every second is returned
+ * instead, and cfg_watch_dispatch() compares stat(2) of each file.
+ *
+ * @param cfg The configuration file context.
+ *
+ * @return A file descriptor, or -1 on error, with errno set to ENOENT
+ * if no file has been parsed, or ENOSYS if the platform has neither
+ * inotify nor timerfd.  In the latter case cfg_watch_dispatch() can
+ * still be called at regular intervals to poll the files.
+ */
+DLLIMPORT int __export cfg_watch_fd(cfg_t *cfg);
+
+/** Check for changes to the files of a configuration, and call a
+ * reload callback if there were any.
+ *
+ * A burst of changes, like an editor writing a file in several steps
+ * or a deployment updating several files, results in a single call of
+ * the callback, once the files have been quiet for debounce_ms
+ * milliseconds.  This does not block: a change starts the timer of the
+ * descriptor from cfg_watch_fd(), which becomes readable again when it
+ * expires, and the callback is called from that later call.  Only on
+ * platforms without a timer descriptor, or when cfg_watch_fd() was not
+ * used, does this function wait for the files to calm down itself.
+ *
+ * @param cfg The configuration file context.
+ * @param debounce_ms How long the files must be left alone before the
+ * callback is called, in milliseconds.
+ * @param cb The reload callback.
+ * @param arg Passed as the second argument to the callback.
+ *
+ * @return 1 if the callback was called, 0 if it was not (yet), or
+ * CFG_FAIL on error.
+ */
+DLLIMPORT int __export cfg_watch_dispatch(cfg_t *cfg, unsigned int debounce_ms, cfg_watch_func_t cb, void *arg);
+
+/** Copy the values of a configuration into a C struct.
+ *
+ * Walks the configuration once, following the bindings, so that the
+ * program can then read plain struct fields instead of looking each
+ * option up by name:
+ *
+ * <pre>
+ * struct backend { const char *name; long int port; };
+ * struct conf { char *host; long int *ports; unsigned int nports;
+ *               struct backend *backends; unsigned int nbackends; };
+ *
+ * static cfg_bind_t backend_binds[] = {
+ *     CFG_BIND_TITLE(struct backend, name),
+ *     CFG_BIND("port", struct backend, port),
+ *     CFG_BIND_END()
+ * };
+ * static cfg_bind_t binds[] = {
+ *     CFG_BIND("host", struct conf, host),
+ *     CFG_BIND_LIST("ports", struct conf, ports, nports),
+ *     CFG_BIND_MULTISEC("backend", struct conf, backends, nbackends, backend_binds),
+ *     CFG_BIND_END()
+ * };
+ * </pre>
+ *
+ * Options that are not bound are skipped, options without a value
+ * leave their field alone.  Strings and titles point into cfg, so they
+ * are valid until cfg is freed or changed.
+ *
+ * @param cfg The configuration file context, or a section of it.
+ * @param binds The bindings, terminated with CFG_BIND_END().
+ * @param base The struct to fill in.  Pointers to lists and multi-
+ * sections must be NULL, e.g. from a zeroed struct or cfg_unbind().
+ *
+ * @return POSIX OK(0), or non-zero on failure, e.g. if an option does
+ * not exist or the element size of a list does not match its type, in
+ * which case all arrays are freed again.
+ *
+ * @see cfg_unbind()
+ */
+DLLIMPORT int __export cfg_bind(cfg_t *cfg, const cfg_bind_t *binds, void *base);
+
+/** Free the arrays allocated by cfg_bind().
+ *
+ * @param binds The bindings given to cfg_bind().
+ * @param base The struct given to cfg_bind().
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_unbind(const cfg_bind_t *binds, void *base);
+
 /** Install a user-defined error reporting function.
  * @return The old error reporting function is returned.
  */
@@ -1251,6 +1987,35 @@ DLLIMPORT char *__export cfg_getnstr(cfg_t *cfg, const char *name, unsigned int
  */
 DLLIMPORT char *__export cfg_getstr(cfg_t *cfg, const char *name);
 
+/** Returns a value of a string option and its length, given a cfg_opt_t pointer.
+ *
+ * Strings may contain NUL bytes, e.g. from "\x00" escapes in quoted
+ * strings, the length is that of the whole value.  The string is also
+ * NUL terminated, at the given length.
+ *
+ * @param opt The option structure (eg, as returned from cfg_getopt())
+ * @param index Index of the value to get. Zero based.
+ * @param len Set to the length of the string, or zero if there is
+ * no value.  May be NULL.
+ * @see cfg_opt_getnstr
+ */
+DLLIMPORT char *__export cfg_opt_getnstr_len(cfg_opt_t *opt, unsigned int index, size_t *len);
+
+/** Indexed version of cfg_getstr_len(), used for lists.
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get. Zero based.
+ * @param len Set to the length of the string, see cfg_opt_getnstr_len()
+ */
+DLLIMPORT char *__export cfg_getnstr_len(cfg_t *cfg, const char *name, unsigned int index, size_t *len);
+
+/** Returns the value of a string option and its length.
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param len Set to the length of the string, see cfg_opt_getnstr_len()
+ */
+DLLIMPORT char *__export cfg_getstr_len(cfg_t *cfg, const char *name, size_t *len);
+
 /** Returns the value of a boolean option, given a cfg_opt_t pointer.
  * @param opt The option structure (eg, as returned from cfg_getopt())
  * @param index Index of the value to get. Zero based.
@@ -1456,6 +2221,288 @@ DLLIMPORT cfg_opt_t *cfg_getnopt(cfg_t *cfg, unsigned int index);
  */
 DLLIMPORT cfg_opt_t *__export cfg_getopt(cfg_t *cfg, const char *name);
 
+/** Hash an option name, for use with cfg_gethopt().
+ *
+ * The hash is 32-bit FNV-1a over the bytes of the name, with ASCII
+ * letters folded to lower case and all bytes from 0x80 up replaced by
+ * 0x80.  It is stable, so it can be computed at compile time.
+ *
+ * @param name The option name, need not be NUL terminated.
+ * @param len Length of name.
+ */
+DLLIMPORT uint32_t __export cfg_hash(const char *name, size_t len);
+
+/** Return an option in a section given its name and name hash.
+ *
+ * Unlike cfg_getopt() the name is not a path, only options of the
+ * given section are searched, and a miss is not reported as an error.
+ * Sections with many options keep a table of name hashes, so with a
+ * precomputed hash no pass is made over the name or the options.
+ *
+ * @param cfg The configuration file context, or a section.
+ * @param name The name of the option, need not be NUL terminated.
+ * @param len Length of name.
+ * @param hash cfg_hash() of name.
+ *
+ * @return The option, or NULL if there is none by that name.
+ */
+DLLIMPORT cfg_opt_t *__export cfg_gethopt(cfg_t *cfg, const char *name, size_t len, uint32_t hash);
+
+/** Check if an option or section exists, without side effects.
+ *
+ * Unlike cfg_getopt() and friends this never calls the error
+ * function, never allocates memory and leaves errno untouched, so it
+ * is cheap enough to use for probing optional settings in hot paths.
+ * The name uses the same syntax as cfg_getopt(), and may also refer to
+ * a single section, e.g. "section=title" or "section=2".
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option or section.
+ *
+ * @return Returns cfg_true if the option is declared and has a value,
+ * or if the section exists, otherwise cfg_false.
+ */
+DLLIMPORT cfg_bool_t __export cfg_exists(cfg_t *cfg, const char *name);
+
+/** Probe for an option, like cfg_getopt() but without side effects.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param opt Where to store the option pointer, may be NULL.
+ *
+ * @return POSIX OK(0), or non-zero if the option is not declared.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetopt(cfg_t *cfg, const char *name, cfg_opt_t **opt);
+
+/** Probe the value of a CFGT_INT option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnint(cfg_t *cfg, const char *name, unsigned int index, long int *value);
+/** Probe the value of a CFGT_INT option, like cfg_trygetnint() with index 0. */
+DLLIMPORT int __export cfg_trygetint(cfg_t *cfg, const char *name, long int *value);
+
+/** Probe the value of a CFGT_INT8 (8-bit signed) option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnint8(cfg_t *cfg, const char *name, unsigned int index, int8_t *value);
+/** Probe the value of a CFGT_INT8 (8-bit signed) option, like cfg_trygetnint8() with index 0. */
+DLLIMPORT int __export cfg_trygetint8(cfg_t *cfg, const char *name, int8_t *value);
+
+/** Probe the value of a CFGT_INT16 (16-bit signed) option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnint16(cfg_t *cfg, const char *name, unsigned int index, int16_t *value);
+/** Probe the value of a CFGT_INT16 (16-bit signed) option, like cfg_trygetnint16() with index 0. */
+DLLIMPORT int __export cfg_trygetint16(cfg_t *cfg, const char *name, int16_t *value);
+
+/** Probe the value of a CFGT_INT32 (32-bit signed) option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnint32(cfg_t *cfg, const char *name, unsigned int index, int32_t *value);
+/** Probe the value of a CFGT_INT32 (32-bit signed) option, like cfg_trygetnint32() with index 0. */
+DLLIMPORT int __export cfg_trygetint32(cfg_t *cfg, const char *name, int32_t *value);
+
+/** Probe the value of a CFGT_INT64 (64-bit signed) option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnint64(cfg_t *cfg, const char *name, unsigned int index, int64_t *value);
+/** Probe the value of a CFGT_INT64 (64-bit signed) option, like cfg_trygetnint64() with index 0. */
+DLLIMPORT int __export cfg_trygetint64(cfg_t *cfg, const char *name, int64_t *value);
+
+/** Probe the value of a CFGT_UINT8 (8-bit unsigned) option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnuint8(cfg_t *cfg, const char *name, unsigned int index, uint8_t *value);
+/** Probe the value of a CFGT_UINT8 (8-bit unsigned) option, like cfg_trygetnuint8() with index 0. */
+DLLIMPORT int __export cfg_trygetuint8(cfg_t *cfg, const char *name, uint8_t *value);
+
+/** Probe the value of a CFGT_UINT16 (16-bit unsigned) option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnuint16(cfg_t *cfg, const char *name, unsigned int index, uint16_t *value);
+/** Probe the value of a CFGT_UINT16 (16-bit unsigned) option, like cfg_trygetnuint16() with index 0. */
+DLLIMPORT int __export cfg_trygetuint16(cfg_t *cfg, const char *name, uint16_t *value);
+
+/** Probe the value of a CFGT_UINT32 (32-bit unsigned) option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnuint32(cfg_t *cfg, const char *name, unsigned int index, uint32_t *value);
+/** Probe the value of a CFGT_UINT32 (32-bit unsigned) option, like cfg_trygetnuint32() with index 0. */
+DLLIMPORT int __export cfg_trygetuint32(cfg_t *cfg, const char *name, uint32_t *value);
+
+/** Probe the value of a CFGT_UINT64 (64-bit unsigned) option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnuint64(cfg_t *cfg, const char *name, unsigned int index, uint64_t *value);
+/** Probe the value of a CFGT_UINT64 (64-bit unsigned) option, like cfg_trygetnuint64() with index 0. */
+DLLIMPORT int __export cfg_trygetuint64(cfg_t *cfg, const char *name, uint64_t *value);
+
+/** Probe the value of a CFGT_FLOAT option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnfloat(cfg_t *cfg, const char *name, unsigned int index, double *value);
+/** Probe the value of a CFGT_FLOAT option, like cfg_trygetnfloat() with index 0. */
+DLLIMPORT int __export cfg_trygetfloat(cfg_t *cfg, const char *name, double *value);
+
+/** Probe the value of a CFGT_BOOL option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnbool(cfg_t *cfg, const char *name, unsigned int index, cfg_bool_t *value);
+/** Probe the value of a CFGT_BOOL option, like cfg_trygetnbool() with index 0. */
+DLLIMPORT int __export cfg_trygetbool(cfg_t *cfg, const char *name, cfg_bool_t *value);
+
+/** Probe the value of a CFGT_STR option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ * An unset (NULL) string also counts as failure.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnstr(cfg_t *cfg, const char *name, unsigned int index, char **value);
+/** Probe the value of a CFGT_STR option, like cfg_trygetnstr() with index 0. */
+DLLIMPORT int __export cfg_trygetstr(cfg_t *cfg, const char *name, char **value);
+
+/** Probe the value of a CFGT_PTR option, without side effects.
+ *
+ * Returns CFG_FAIL instead of printing an error when the option is not
+ * declared, is of another type or has no value at the given index.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param index Index of the value to get.
+ * @param value Where to store the value, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnptr(cfg_t *cfg, const char *name, unsigned int index, void **value);
+/** Probe the value of a CFGT_PTR option, like cfg_trygetnptr() with index 0. */
+DLLIMPORT int __export cfg_trygetptr(cfg_t *cfg, const char *name, void **value);
+
+/** Probe for a section, like cfg_getnsec() but without side effects.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the section option.
+ * @param index Index of the section to get.
+ * @param sec Where to store the section, may be NULL.
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_exists
+ */
+DLLIMPORT int __export cfg_trygetnsec(cfg_t *cfg, const char *name, unsigned int index, cfg_t **sec);
+/** Probe for a section, like cfg_getsec() but without side effects.
+ *
+ * The name may select a single section of a multi-section, e.g.
+ * "section=title" or "section=2".
+ */
+DLLIMPORT int __export cfg_trygetsec(cfg_t *cfg, const char *name, cfg_t **sec);
+/** Probe for a section by title, like cfg_gettsec() but without side effects. */
+DLLIMPORT int __export cfg_trygettsec(cfg_t *cfg, const char *name, const char *title, cfg_t **sec);
+
 /** Set an option (create an instance of an option).
  *
  * @param cfg The configuration file context.
@@ -1799,6 +2846,37 @@ DLLIMPORT int __export cfg_setnbool(cfg_t *cfg, const char *name, cfg_bool_t val
  */
 DLLIMPORT int __export cfg_opt_setnstr(cfg_opt_t *opt, const char *value, unsigned int index);
 
+/** Set a value of a string option, which may contain NUL bytes.
+ *
+ * @param opt The option structure (eg, as returned from cfg_getopt())
+ * @param value The value to set, len bytes are copied and terminated
+ * with a NUL byte.  Any previous string value is freed.
+ * @param len The length of the value.
+ * @param index The index in the option value array that should be
+ * modified, see cfg_opt_setnstr().
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_opt_setnstr_len(cfg_opt_t *opt, const char *value, size_t len, unsigned int index);
+
+/** Set a value of a string option, taking ownership of the string.
+ *
+ * Large values built by the application are adopted as they are,
+ * without the copy made by cfg_opt_setnstr().  In configurations with
+ * CFGF_INTERN the shared string is used instead, and value is freed.
+ *
+ * @param opt The option structure (eg, as returned from cfg_getopt())
+ * @param value The value to set, allocated with malloc() and NUL
+ * terminated at len.  It is freed by the configuration, also when
+ * this function fails.  Any previous string value is freed.
+ * @param len The length of the value, which may contain NUL bytes.
+ * @param index The index in the option value array that should be
+ * modified, see cfg_opt_setnstr().
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_opt_setnstr_take(cfg_opt_t *opt, char *value, size_t len, unsigned int index);
+
 /** Set the value of a string option given its name.
  *
  * @param cfg The configuration file context.
@@ -1825,6 +2903,30 @@ DLLIMPORT int __export cfg_setstr(cfg_t *cfg, const char *name, const char *valu
  */
 DLLIMPORT int __export cfg_setnstr(cfg_t *cfg, const char *name, const char *value, unsigned int index);
 
+/** Set the value of a string option given its name, taking ownership.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param value The NUL terminated value to set, allocated with malloc().
+ * It is freed by the configuration, also when this function fails.
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ * @see cfg_opt_setnstr_take
+ */
+DLLIMPORT int __export cfg_setstr_take(cfg_t *cfg, const char *name, char *value);
+
+/** Indexed version of cfg_setstr_take(), used for lists.
+ *
+ * @param cfg The configuration file context.
+ * @param name The name of the option.
+ * @param value The NUL terminated value to set, see cfg_setstr_take().
+ * @param index The index in the option value array that should be
+ * modified, see cfg_setnstr().
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_setnstr_take(cfg_t *cfg, const char *name, char *value, unsigned int index);
+
 /** Set values for a list option. All existing values are replaced
  * with the new ones.
  *
@@ -2019,6 +3121,65 @@ DLLIMPORT int __export cfg_print_indent(cfg_t *cfg, FILE *fp, int indent);
  */
 DLLIMPORT int __export cfg_print(cfg_t *cfg, FILE *fp);
 
+/** Print the options and values through a write callback.
+ *
+ * Same output as cfg_print(), but buffered internally and handed to
+ * the callback in large chunks instead of one stdio call at a time.
+ *
+ * @param cfg The configuration file context.
+ * @param cb Write callback, called for each chunk of output.
+ * @param arg Passed as the first argument to the callback.
+ *
+ * @see cfg_write_func_t, cfg_print
+ *
+ * @return POSIX OK(0), or non-zero on failure, e.g. if the callback
+ * returned non-zero.
+ */
+DLLIMPORT int __export cfg_print_cb(cfg_t *cfg, cfg_write_func_t cb, void *arg);
+
+/** Print the options and values to a memory buffer.
+ *
+ * Same output as cfg_print(), but collected in a buffer allocated by
+ * this function.  The buffer is NUL terminated and must be released by
+ * the caller with free().
+ *
+ * @param cfg The configuration file context.
+ * @param buf Where to store a pointer to the allocated buffer.
+ * @param len Where to store the length of the output, excluding the
+ * terminating NUL, may be NULL.
+ *
+ * @see cfg_print
+ *
+ * @return POSIX OK(0), or non-zero on failure.
+ */
+DLLIMPORT int __export cfg_print_to_buffer(cfg_t *cfg, char **buf, size_t *len);
+
+/** Print the options and values as JSON through a write callback.
+ *
+ * The tree is written as one JSON object, in a single pass and
+ * buffered like cfg_print_cb(), followed by a newline.  Values keep
+ * their types: numbers, booleans and strings, with lists as arrays.
+ * Titled sections become an object keyed by title, other multi
+ * sections an array of objects, and raw sections the string of their
+ * body.  Unset values are null, as are floats that are not a number
+ * or infinite.  Strings are written as UTF-8; a byte that is not part
+ * of valid UTF-8 is escaped as the code point of the same value, e.g.
+ * 0xff as "\u00ff", so the output is always valid JSON.
+ *
+ * Functions, pointers and comments are left out, and print functions
+ * set with cfg_set_print_func() are not used.  Print filters are.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ * @param cb Write callback, called for each chunk of output.
+ * @param arg Passed as the first argument to the callback.
+ *
+ * @see cfg_write_func_t, cfg_print_cb()
+ *
+ * @return POSIX OK(0), or non-zero on failure, e.g. if the callback
+ * returned non-zero.
+ */
+DLLIMPORT int __export cfg_print_json(cfg_t *cfg, cfg_write_func_t cb, void *arg);
+
 /** Set a print callback function for an option.
  *
  * @param opt The option structure (eg, as returned from cfg_getopt())
@@ -2078,6 +3239,48 @@ DLLIMPORT cfg_validate_callback_t __export cfg_set_validate_func(cfg_t *cfg, con
  */
 DLLIMPORT cfg_validate_callback2_t __export cfg_set_validate_func2(cfg_t *cfg, const char *name, cfg_validate_callback2_t vf);
 
+/** Compute a fingerprint of a configuration tree.
+ *
+ * The fingerprint is a 128-bit hash of all option values, in schema
+ * order, including section titles and nested sections.  It does not
+ * depend on comments, or on how the configuration was read, so two
+ * trees with the same schema and the same values have the same
+ * fingerprint, also on different platforms.  Values of CFGT_PTR
+ * options are not included.
+ *
+ * Each section caches its fingerprint until it, or any section below
+ * it, is changed with one of the cfg_set*(), cfg_add*() or cfg_rm*()
+ * functions, so computing it again after a small change is cheap.
+ * Sections with CFG_SIMPLE_* options are not cached, since their
+ * variables can change behind the back of libConfuse.
+ *
+ * @param cfg The configuration file context, or any section of it.
+ *
+ * @return The fingerprint, all zero if cfg is NULL.
+ */
+DLLIMPORT cfg_fingerprint_t __export cfg_fingerprint(cfg_t *cfg);
+
+/** Compare two configurations built from the same schema.
+ *
+ * Titled multi-sections are matched by title, so reordering them is not
+ * a change, other multi-sections by position.  A section that differs
+ * is first reported as CFG_DIFF_MODIFIED, then the differences inside
+ * it; sections with equal cfg_fingerprint() are skipped without being
+ * walked.  Added and removed sections are reported once, not per
+ * option.  CFGT_PTR options are not compared.
+ *
+ * @param oldcfg The old configuration.
+ * @param newcfg The new configuration.
+ * @param cb Callback, called for each difference.
+ * @param arg Passed as the first argument to the callback.
+ *
+ * @return CFG_SUCCESS, or CFG_FAIL on error or if the callback stopped
+ * the diff.
+ *
+ * @see cfg_diff_func_t
+ */
+DLLIMPORT int __export cfg_diff(cfg_t *oldcfg, cfg_t *newcfg, cfg_diff_func_t cb, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,1090 @@
+/*
+ * Copyright (c) 2002-2017  Martin Hedenfalk <martin@bzero.se>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/** A header-only C++17 interface to libConfuse.
+ *
+ * @file confuse.hpp
+ *
+ * The C API is used as is, this header only adds ownership and typing:
+ *
+ *   confuse::config cfg(opts);
+ *   cfg.parse("app.conf");
+ *   long port = cfg.get<long>("server|port");
+ *   for (confuse::section be : cfg.sections("backend"))
+ *           std::string_view host = be.get<std::string_view>("host");
+ *
+ * Paths are split and their names hashed when a confuse::path is
+ * constructed, at compile time for string literals, and resolved with
+ * cfg_gethopt().  A lookup does not allocate, and strings are returned
+ * as views of the values held by the configuration.
+ *
+ * Option tables can also be declared as a confuse::schema, checked at
+ * compile time, and read with typed accessors at fixed positions:
+ *
+ *   inline constexpr confuse::option<long> port("port", 80);
+ *   inline constexpr confuse::option<std::string_view> host("host", "localhost");
+ *   inline constexpr confuse::schema server(port, host);
+ *
+ *   confuse::config cfg(confuse::table<server>.data());
+ *   long p = confuse::get<server, port>(cfg);
+ */
+
+#ifndef CONFUSE_HPP_
+#define CONFUSE_HPP_
+
+#include "confuse.h"
+
+#include <array>
+#include <cassert>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace confuse {
+
+/** Compile time version of cfg_hash(). */
+constexpr std::uint32_t hash(std::string_view name) noexcept
+{
+	std::uint32_t h = 2166136261u;
+
+	for (char ch : name) {
+		unsigned char c = static_cast<unsigned char>(ch);
+
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		else if (c >= 0x80)
+			c = 0x80;
+		h = (h ^ c) * 16777619u;
+	}
+
+	return h;
+}
+
+/** A path to an option, like "server|port" or "backend=db|port".
+ *
+ * The syntax is the same as for cfg_getopt().  Up to max_depth levels
+ * are supported, longer or malformed paths are not valid() and find
+ * nothing.  The path only refers to the string it is made from.
+ */
+class path {
+public:
+	static constexpr std::size_t max_depth = 8;
+
+	struct part {
+		std::string_view name;
+		std::string_view title;	/**< Title or index after '=', may be quoted */
+		std::uint32_t hash = 0;
+		long index = -1;	/**< title as a number, or -1 */
+		bool has_title = false;
+	};
+
+	constexpr path(const char *str) noexcept : path(std::string_view(str)) {}
+
+	constexpr path(std::string_view str) noexcept
+	{
+		std::size_t pos = 0;
+
+		while (pos < str.size()) {
+			std::size_t end = pos;
+
+			if (depth_ == max_depth)
+				return;
+
+			while (end < str.size() && str[end] != '|' && str[end] != '=')
+				end++;
+			if (end == pos)
+				return;
+
+			part &p = parts_[depth_++];
+			p.name = str.substr(pos, end - pos);
+			p.hash = confuse::hash(p.name);
+			pos = end;
+
+			if (pos < str.size() && str[pos] == '=') {
+				end = title_end(str, ++pos);
+				if (end == pos)
+					return;
+				p.title = str.substr(pos, end - pos);
+				p.index = number(p.title);
+				p.has_title = true;
+				pos = end;
+			}
+
+			while (pos < str.size() && str[pos] == '|')
+				pos++;
+		}
+
+		valid_ = depth_ > 0;
+	}
+
+	constexpr bool valid() const noexcept { return valid_; }
+	constexpr std::size_t depth() const noexcept { return depth_; }
+	constexpr const part &operator[](std::size_t i) const noexcept { return parts_[i]; }
+
+private:
+	/* End of the title starting at pos, or pos if malformed */
+	static constexpr std::size_t title_end(std::string_view str, std::size_t pos) noexcept
+	{
+		std::size_t i = pos;
+
+		if (pos >= str.size() || str[pos] != '\'') {
+			for (i = pos; i < str.size() && str[i] != '|'; i++)
+				;
+			return i;
+		}
+
+		for (i = pos + 1; i < str.size(); i++) {
+			if (str[i] == '\'')
+				return i + 1;
+			if (str[i] == '\\') {
+				if (i + 1 == str.size() || (str[i + 1] != '\'' && str[i + 1] != '\\'))
+					return pos;
+				i++;
+			}
+		}
+
+		return pos;
+	}
+
+	/* Section index, parsed like strtoul() with base 0 */
+	static constexpr long number(std::string_view str) noexcept
+	{
+		unsigned long val = 0;
+		unsigned int base = 10;
+		std::size_t i = 0, len = str.size();
+
+		if (len && str[0] == '\'') {
+			i++;
+			len--;
+		}
+		if (i >= len)
+			return -1;
+
+		if (str[i] == '0' && i + 1 < len) {
+			base = 8;
+			i++;
+			if (str[i] == 'x' || str[i] == 'X') {
+				base = 16;
+				if (++i >= len)
+					return -1;
+			}
+		}
+
+		for (; i < len; i++) {
+			unsigned int d = 0;
+			char c = str[i];
+
+			if (c >= '0' && c <= '9')
+				d = c - '0';
+			else if (c >= 'a' && c <= 'f')
+				d = c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				d = c - 'A' + 10;
+			else
+				return -1;
+
+			if (d >= base)
+				return -1;
+			val = val * base + d;
+			if (val > 0xffffffffUL)
+				return -1;
+		}
+
+		return static_cast<long>(val);
+	}
+
+	part parts_[max_depth] = {};
+	std::size_t depth_ = 0;
+	bool valid_ = false;
+};
+
+class section;
+
+/** Maps a C++ type to the option types it can be read from.
+ *
+ * Specialized for bool, cfg_bool_t, all integer and floating point
+ * types, std::string_view, const char *, void * and section.  Integers
+ * can be read from any of the CFGT_INT* option types, with the usual
+ * C++ conversion.
+ */
+template <typename T, typename Enable = void>
+struct value_traits {
+	static_assert(sizeof(T) == 0, "type cannot be read from a configuration");
+};
+
+template <typename T>
+struct value_traits<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+	static bool accepts(cfg_type_t type) noexcept
+	{
+		switch (type) {
+		case CFGT_INT:
+		case CFGT_INT8:
+		case CFGT_INT16:
+		case CFGT_INT32:
+		case CFGT_INT64:
+		case CFGT_UINT8:
+		case CFGT_UINT16:
+		case CFGT_UINT32:
+		case CFGT_UINT64:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static T get(cfg_opt_t *opt, unsigned int index) noexcept
+	{
+		switch (opt->type) {
+		case CFGT_INT:    return static_cast<T>(cfg_opt_getnint(opt, index));
+		case CFGT_INT8:   return static_cast<T>(cfg_opt_getnint8(opt, index));
+		case CFGT_INT16:  return static_cast<T>(cfg_opt_getnint16(opt, index));
+		case CFGT_INT32:  return static_cast<T>(cfg_opt_getnint32(opt, index));
+		case CFGT_INT64:  return static_cast<T>(cfg_opt_getnint64(opt, index));
+		case CFGT_UINT8:  return static_cast<T>(cfg_opt_getnuint8(opt, index));
+		case CFGT_UINT16: return static_cast<T>(cfg_opt_getnuint16(opt, index));
+		case CFGT_UINT32: return static_cast<T>(cfg_opt_getnuint32(opt, index));
+		case CFGT_UINT64: return static_cast<T>(cfg_opt_getnuint64(opt, index));
+		default:          return T();
+		}
+	}
+};
+
+template <typename T>
+struct value_traits<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+	static bool accepts(cfg_type_t type) noexcept { return type == CFGT_FLOAT; }
+	static T get(cfg_opt_t *opt, unsigned int index) noexcept
+	{
+		return static_cast<T>(cfg_opt_getnfloat(opt, index));
+	}
+};
+
+template <>
+struct value_traits<bool> {
+	static bool accepts(cfg_type_t type) noexcept { return type == CFGT_BOOL; }
+	static bool get(cfg_opt_t *opt, unsigned int index) noexcept
+	{
+		return cfg_opt_getnbool(opt, index) != cfg_false;
+	}
+};
+
+template <>
+struct value_traits<cfg_bool_t> {
+	static bool accepts(cfg_type_t type) noexcept { return type == CFGT_BOOL; }
+	static cfg_bool_t get(cfg_opt_t *opt, unsigned int index) noexcept
+	{
+		return cfg_opt_getnbool(opt, index);
+	}
+};
+
+template <>
+struct value_traits<std::string_view> {
+	static bool accepts(cfg_type_t type) noexcept { return type == CFGT_STR; }
+	static std::string_view get(cfg_opt_t *opt, unsigned int index) noexcept
+	{
+		std::size_t len = 0;
+		const char *str = cfg_opt_getnstr_len(opt, index, &len);
+
+		return str ? std::string_view(str, len) : std::string_view();
+	}
+};
+
+template <>
+struct value_traits<const char *> {
+	static bool accepts(cfg_type_t type) noexcept { return type == CFGT_STR; }
+	static const char *get(cfg_opt_t *opt, unsigned int index) noexcept
+	{
+		return cfg_opt_getnstr(opt, index);
+	}
+};
+
+template <>
+struct value_traits<void *> {
+	static bool accepts(cfg_type_t type) noexcept { return type == CFGT_PTR; }
+	static void *get(cfg_opt_t *opt, unsigned int index) noexcept
+	{
+		return cfg_opt_getnptr(opt, index);
+	}
+};
+
+namespace detail {
+
+/* Same as the C library does for titles in paths */
+inline bool title_matches(const char *title, std::string_view raw, bool nocase) noexcept
+{
+	std::size_t i = 0, end = raw.size();
+	bool quoted = end && raw[0] == '\'';
+
+	if (quoted) {
+		i++;
+		end--;
+	}
+
+	while (i < end) {
+		int c = static_cast<unsigned char>(raw[i++]);
+		int t = static_cast<unsigned char>(*title);
+
+		if (quoted && c == '\\')
+			c = static_cast<unsigned char>(raw[i++]);
+		if (nocase ? std::tolower(c) != std::tolower(t) : c != t)
+			return false;
+		title++;
+	}
+
+	return *title == 0;
+}
+
+inline bool is_section(cfg_opt_t *opt) noexcept
+{
+	return opt->type == CFGT_SEC || opt->type == CFGT_RAWSEC;
+}
+
+/*
+ * Section at index of opt, or nullptr.  cfg_opt_size() first sets a
+ * default left unset by CFGF_LAZY, like the getters do.
+ */
+inline cfg_t *section_at(cfg_opt_t *opt, unsigned long index) noexcept
+{
+	if (!is_section(opt) || index >= cfg_opt_size(opt))
+		return nullptr;
+	return opt->values[index]->section;
+}
+
+/* Index of the section selected by a "name=title" part, or -1 */
+inline long section_index(cfg_opt_t *opt, const path::part &p) noexcept
+{
+	if (!p.has_title)
+		return 0;
+	if (!is_section(opt) || !(opt->flags & CFGF_MULTI))
+		return -1;
+	if (!(opt->flags & CFGF_TITLE))
+		return p.index;
+
+	for (unsigned int i = 0, n = cfg_opt_size(opt); i < n; i++) {
+		cfg_t *sec = opt->values[i]->section;
+
+		if (!sec || !sec->title)
+			return -1;
+		if (title_matches(sec->title, p.title, opt->flags & CFGF_NOCASE))
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Walk a path to its option.  If the last part selects a section by
+ * title or index, that index is returned in *index, otherwise *index
+ * is left alone.
+ */
+inline cfg_opt_t *resolve(cfg_t *sec, const path &key, unsigned int *index) noexcept
+{
+	if (!sec || !key.valid())
+		return nullptr;
+
+	for (std::size_t i = 0;; i++) {
+		const path::part &p = key[i];
+		cfg_opt_t *opt;
+		long idx;
+
+		opt = cfg_gethopt(sec, p.name.data(), p.name.size(), p.hash);
+		if (!opt)
+			return nullptr;
+
+		idx = section_index(opt, p);
+		if (idx < 0)
+			return nullptr;
+
+		if (i + 1 == key.depth()) {
+			if (p.has_title)
+				*index = static_cast<unsigned int>(idx);
+			return opt;
+		}
+
+		sec = section_at(opt, static_cast<unsigned long>(idx));
+		if (!sec)
+			return nullptr;
+	}
+}
+
+/*
+ * Same test as cfg_tryget*(): is there a value, also a default left
+ * unset by CFGF_LAZY, or a CFG_SIMPLE_* variable
+ */
+inline bool has_value(cfg_opt_t *opt, unsigned int index) noexcept
+{
+	if (index < cfg_opt_size(opt))
+		return true;
+	return opt->simple_value.ptr && index == 0;
+}
+
+} // namespace detail
+
+/** A range over the values of a list option or a multi-section. */
+template <typename T>
+class range {
+public:
+	class iterator {
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = T;
+
+		iterator() noexcept = default;
+		iterator(cfg_opt_t *opt, unsigned int index) noexcept : opt_(opt), index_(index) {}
+
+		T operator*() const noexcept { return value_traits<T>::get(opt_, index_); }
+		iterator &operator++() noexcept { index_++; return *this; }
+		iterator operator++(int) noexcept { iterator it = *this; index_++; return it; }
+		bool operator==(const iterator &rhs) const noexcept { return index_ == rhs.index_; }
+		bool operator!=(const iterator &rhs) const noexcept { return index_ != rhs.index_; }
+
+	private:
+		cfg_opt_t *opt_ = nullptr;
+		unsigned int index_ = 0;
+	};
+
+	range() noexcept = default;
+	explicit range(cfg_opt_t *opt) noexcept : opt_(opt)
+	{
+		if (opt && value_traits<T>::accepts(opt->type))
+			size_ = cfg_opt_size(opt);
+	}
+
+	iterator begin() const noexcept { return iterator(opt_, 0); }
+	iterator end() const noexcept { return iterator(opt_, size_); }
+	unsigned int size() const noexcept { return size_; }
+	bool empty() const noexcept { return size_ == 0; }
+	T operator[](unsigned int index) const noexcept { return value_traits<T>::get(opt_, index); }
+
+private:
+	cfg_opt_t *opt_ = nullptr;
+	unsigned int size_ = 0;
+};
+
+/** A non-owning view of a configuration or one of its sections. */
+class section {
+public:
+	constexpr section() noexcept = default;
+	constexpr explicit section(cfg_t *cfg) noexcept : cfg_(cfg) {}
+
+	/** The underlying C section, for use with the C API. */
+	cfg_t *cfg() const noexcept { return cfg_; }
+	explicit operator bool() const noexcept { return cfg_ != nullptr; }
+
+	std::string_view name() const noexcept
+	{
+		return cfg_ && cfg_->name ? std::string_view(cfg_->name) : std::string_view();
+	}
+
+	std::string_view title() const noexcept
+	{
+		const char *title = cfg_title(cfg_);
+
+		return title ? std::string_view(title) : std::string_view();
+	}
+
+	/** The option at key, or nullptr. */
+	cfg_opt_t *opt(const path &key) const noexcept
+	{
+		unsigned int index = 0;
+
+		return detail::resolve(cfg_, key, &index);
+	}
+
+	/** Read a value, like the cfg_getn*() functions.
+	 *
+	 * Returns T() if there is no such option, or if it has a type T
+	 * cannot be read from.  If the last part of key selects a section
+	 * by title or number, index is ignored.
+	 */
+	template <typename T>
+	T get(const path &key, unsigned int index = 0) const noexcept
+	{
+		cfg_opt_t *opt = detail::resolve(cfg_, key, &index);
+
+		if (!opt || !value_traits<T>::accepts(opt->type))
+			return T();
+		return value_traits<T>::get(opt, index);
+	}
+
+	/** Read a value, like the cfg_tryget*() functions.
+	 *
+	 * Returns std::nullopt if there is no such option or value, or if
+	 * the option has a type T cannot be read from.
+	 */
+	template <typename T>
+	std::optional<T> try_get(const path &key, unsigned int index = 0) const noexcept
+	{
+		cfg_opt_t *opt = detail::resolve(cfg_, key, &index);
+
+		if (!opt || !value_traits<T>::accepts(opt->type) || !detail::has_value(opt, index))
+			return std::nullopt;
+		return value_traits<T>::get(opt, index);
+	}
+
+	/** Number of values of an option, like cfg_size(). */
+	unsigned int size(const path &key) const noexcept
+	{
+		return cfg_opt_size(opt(key));
+	}
+
+	/** The values of a list option. */
+	template <typename T>
+	range<T> list(const path &key) const noexcept
+	{
+		return range<T>(opt(key));
+	}
+
+	/** The instances of a multi-section. */
+	range<section> sections(const path &key) const noexcept;
+
+protected:
+	cfg_t *cfg_ = nullptr;
+};
+
+template <>
+struct value_traits<section> {
+	static bool accepts(cfg_type_t type) noexcept
+	{
+		return type == CFGT_SEC || type == CFGT_RAWSEC;
+	}
+
+	static section get(cfg_opt_t *opt, unsigned int index) noexcept
+	{
+		return section(detail::section_at(opt, index));
+	}
+};
+
+inline range<section> section::sections(const path &key) const noexcept
+{
+	return range<section>(opt(key));
+}
+
+namespace detail {
+
+/* Owns one reference to a configuration, see cfg_acquire() */
+class reference : public section {
+public:
+	reference(const reference &) = delete;
+	reference &operator=(const reference &) = delete;
+
+	/** Give up ownership, the caller must cfg_release() the result. */
+	cfg_t *release() noexcept { return std::exchange(cfg_, nullptr); }
+
+	/** Drop the current reference and take over cfg. */
+	void reset(cfg_t *cfg = nullptr) noexcept
+	{
+		cfg_t *old = std::exchange(cfg_, cfg);
+
+		if (old)
+			cfg_release(old);
+	}
+
+protected:
+	reference() noexcept = default;
+	explicit reference(cfg_t *cfg) noexcept : section(cfg) {}
+	reference(reference &&rhs) noexcept : section(rhs.release()) {}
+	reference &operator=(reference &&rhs) noexcept
+	{
+		if (this != &rhs)
+			reset(rhs.release());
+		return *this;
+	}
+	~reference() { reset(); }
+};
+
+} // namespace detail
+
+/** Owner of a configuration created by cfg_init(). */
+class config : public detail::reference {
+public:
+	config() noexcept = default;
+
+	/** Create a configuration, throws std::bad_alloc on failure. */
+	explicit config(cfg_opt_t *opts, cfg_flag_t flags = CFGF_NONE)
+		: reference(cfg_init(opts, flags))
+	{
+		if (!cfg_)
+			throw std::bad_alloc();
+	}
+
+	/** Take over the reference of the caller to cfg. */
+	static config adopt(cfg_t *cfg) noexcept
+	{
+		config c;
+
+		c.cfg_ = cfg;
+		return c;
+	}
+
+	config(config &&) noexcept = default;
+	config &operator=(config &&) noexcept = default;
+
+	/** See cfg_parse(). */
+	int parse(const char *filename) noexcept { return cfg_parse(cfg_, filename); }
+
+	/** See cfg_parse_buf(). */
+	int parse_buf(const char *buf) noexcept { return cfg_parse_buf(cfg_, buf); }
+
+	/** See cfg_freeze(). */
+	int freeze() noexcept { return cfg_freeze(cfg_); }
+};
+
+/** A reference to a configuration that keeps it alive.
+ *
+ * Snapshots can be moved but not copied, and release their reference
+ * with cfg_release() when destroyed.
+ */
+class snapshot : public detail::reference {
+public:
+	snapshot() noexcept = default;
+
+	/** Take a new reference to the tree sec belongs to. */
+	explicit snapshot(section sec) noexcept : reference(cfg_acquire(sec.cfg())) {}
+
+	/** Take over the reference of the caller to cfg. */
+	static snapshot adopt(cfg_t *cfg) noexcept
+	{
+		snapshot s;
+
+		s.cfg_ = cfg;
+		return s;
+	}
+
+	snapshot(snapshot &&) noexcept = default;
+	snapshot &operator=(snapshot &&) noexcept = default;
+};
+
+/** Owner of a cfg_handle_t, for hot-reloading a configuration. */
+class handle {
+public:
+	/** Create a handle, throws std::bad_alloc on failure. */
+	explicit handle(config &&cfg = config())
+		: handle_(cfg_handle_init(cfg.cfg()))
+	{
+		if (!handle_)
+			throw std::bad_alloc();
+		cfg.release();
+	}
+
+	handle(handle &&rhs) noexcept : handle_(std::exchange(rhs.handle_, nullptr)) {}
+	handle &operator=(handle &&rhs) noexcept
+	{
+		if (this != &rhs) {
+			if (handle_)
+				cfg_handle_free(handle_);
+			handle_ = std::exchange(rhs.handle_, nullptr);
+		}
+		return *this;
+	}
+	handle(const handle &) = delete;
+	handle &operator=(const handle &) = delete;
+
+	~handle()
+	{
+		if (handle_)
+			cfg_handle_free(handle_);
+	}
+
+	/** The current configuration, see cfg_handle_acquire(). */
+	snapshot acquire() const noexcept
+	{
+		return snapshot::adopt(cfg_handle_acquire(handle_));
+	}
+
+	/** Install a new configuration, see cfg_handle_swap(). */
+	int swap(config &&cfg) noexcept
+	{
+		int rc = cfg_handle_swap(handle_, cfg.cfg());
+
+		if (!rc)
+			cfg.release();
+		return rc;
+	}
+
+	cfg_handle_t *get() const noexcept { return handle_; }
+
+private:
+	cfg_handle_t *handle_ = nullptr;
+};
+
+/** The option type used for values of type T in a schema.
+ *
+ * long is CFGT_INT, other integers map to the CFGT_INT* or CFGT_UINT*
+ * type of their width, so on platforms where int64_t is long, it is
+ * CFGT_INT too.
+ */
+template <typename T>
+constexpr cfg_type_t option_type() noexcept
+{
+	if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, cfg_bool_t>)
+		return CFGT_BOOL;
+	else if constexpr (std::is_same_v<T, long>)
+		return CFGT_INT;
+	else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+		return sizeof(T) == 1 ? CFGT_INT8 : sizeof(T) == 2 ? CFGT_INT16 :
+		       sizeof(T) == 4 ? CFGT_INT32 : CFGT_INT64;
+	else if constexpr (std::is_integral_v<T>)
+		return sizeof(T) == 1 ? CFGT_UINT8 : sizeof(T) == 2 ? CFGT_UINT16 :
+		       sizeof(T) == 4 ? CFGT_UINT32 : CFGT_UINT64;
+	else if constexpr (std::is_floating_point_v<T>)
+		return CFGT_FLOAT;
+	else if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, const char *>)
+		return CFGT_STR;
+	else
+		static_assert(sizeof(T) == 0, "type cannot be used in a schema");
+}
+
+/** A single value option in a schema, like CFG_INT() and friends. */
+template <typename T>
+struct option {
+	using value_type = T;
+	using default_type = std::conditional_t<option_type<T>() == CFGT_STR, const char *, T>;
+
+	const char *name;
+	default_type def;
+	cfg_flag_t flags;
+
+	constexpr option(const char *name, default_type def = default_type(), cfg_flag_t flags = CFGF_NONE) noexcept
+		: name(name), def(def), flags(flags) {}
+
+	constexpr cfg_opt_t entry() const noexcept
+	{
+		cfg_opt_t opt{};
+
+		opt.name = name;
+		opt.type = option_type<T>();
+		opt.flags = flags;
+		if constexpr (option_type<T>() == CFGT_STR)
+			opt.def.string = def;
+		else if constexpr (option_type<T>() == CFGT_BOOL)
+			opt.def.boolean = def ? cfg_true : cfg_false;
+		else if constexpr (option_type<T>() == CFGT_FLOAT)
+			opt.def.fpnumber = def;
+		else
+			opt.def.number = static_cast<long>(def);
+
+		return opt;
+	}
+};
+
+/** A list option in a schema, the default is parsed like "{1, 2}". */
+template <typename T>
+struct list_option {
+	using value_type = T;
+
+	const char *name;
+	const char *def;
+	cfg_flag_t flags;
+
+	constexpr list_option(const char *name, const char *def = nullptr, cfg_flag_t flags = CFGF_NONE) noexcept
+		: name(name), def(def), flags(flags) {}
+
+	constexpr cfg_opt_t entry() const noexcept
+	{
+		cfg_opt_t opt{};
+
+		opt.name = name;
+		opt.type = option_type<T>();
+		opt.flags = flags | CFGF_LIST;
+		opt.def.parsed = const_cast<char *>(def);
+
+		return opt;
+	}
+};
+
+/** The static, CFG_END() terminated option table of schema S, for cfg_init(). */
+template <const auto &S>
+inline auto table = S.table();
+
+/** A section in a schema, with the options of schema S. */
+template <const auto &S>
+struct section_option {
+	using value_type = section;
+
+	const char *name;
+	cfg_flag_t flags;
+
+	constexpr section_option(const char *name, cfg_flag_t flags = CFGF_NONE) noexcept
+		: name(name), flags(flags) {}
+
+	constexpr cfg_opt_t entry() const noexcept
+	{
+		cfg_opt_t opt{};
+
+		opt.name = name;
+		opt.type = CFGT_SEC;
+		opt.flags = flags;
+		opt.subopts = &table<S>[0];
+
+		return opt;
+	}
+};
+
+/** A table of options, checked and hashed at compile time.
+ *
+ * Declare schemas constexpr, then duplicate names fail to compile, and
+ * a perfect hash of the names is computed by the compiler.  With it,
+ * find() maps a name to its position in table<S> without a runtime
+ * index, and the typed accessors get(), size() and values() resolve
+ * their option at compile time.
+ */
+template <typename... Opts>
+class schema {
+public:
+	static constexpr std::size_t size = sizeof...(Opts);
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+	constexpr schema(Opts... opts)
+		: opts_(opts...), names_{ { opts.name... } }, hashes_{ { confuse::hash(opts.name)... } }
+	{
+		for (std::size_t i = 0; i < size; i++) {
+			for (std::size_t j = 0; j < i; j++) {
+				if (std::string_view(names_[i]) == names_[j])
+					throw std::logic_error("duplicate option name in schema");
+				if (hashes_[i] == hashes_[j])
+					throw std::logic_error("option names in schema differ only in case");
+			}
+		}
+
+		if (!perfect_hash())
+			throw std::logic_error("no perfect hash found for schema");
+	}
+
+	/** Position of an option in table<S>, or npos.
+	 *
+	 * With nocase, ASCII letters match in either case, like
+	 * cfg_getopt() in a section with CFGF_NOCASE.
+	 */
+	constexpr std::size_t find(std::string_view name, bool nocase = false) const noexcept
+	{
+		std::uint32_t h = confuse::hash(name);
+		std::size_t pos = 0;
+
+		if (!size)
+			return npos;
+
+		pos = slots_[slot(h, mult_, bits_)];
+		if (!pos || hashes_[pos - 1] != h || !name_matches(names_[pos - 1], name, nocase))
+			return npos;
+
+		return pos - 1;
+	}
+
+	/** Name of the option at pos in table<S>. */
+	constexpr const char *name(std::size_t pos) const noexcept
+	{
+		return names_[pos];
+	}
+
+	/** Same as find(), but fails to compile for unknown names. */
+	constexpr std::size_t position(std::string_view name) const
+	{
+		std::size_t pos = find(name);
+
+		if (pos == npos)
+			throw std::logic_error("no such option in schema");
+		return pos;
+	}
+
+	/** The options as CFG_END() terminated array, see table<S>. */
+	constexpr std::array<cfg_opt_t, size + 1> table() const noexcept
+	{
+		return std::apply([](const auto &...opt) {
+			return std::array<cfg_opt_t, size + 1>{ { opt.entry()..., cfg_opt_t{} } };
+		}, opts_);
+	}
+
+private:
+	static constexpr bool name_matches(std::string_view ours, std::string_view name, bool nocase) noexcept
+	{
+		if (ours.size() != name.size())
+			return false;
+
+		for (std::size_t i = 0; i < ours.size(); i++) {
+			char a = ours[i], b = name[i];
+
+			if (nocase) {
+				if (a >= 'A' && a <= 'Z')
+					a += 'a' - 'A';
+				if (b >= 'A' && b <= 'Z')
+					b += 'a' - 'A';
+			}
+			if (a != b)
+				return false;
+		}
+
+		return true;
+	}
+
+	/* Up to four slots per option, at least one */
+	static constexpr std::size_t capacity()
+	{
+		std::size_t n = 1;
+
+		while (n < size)
+			n <<= 1;
+		return n * 4;
+	}
+
+	static constexpr std::size_t slot(std::uint32_t h, std::uint32_t mult, unsigned int bits) noexcept
+	{
+		return bits ? static_cast<std::uint32_t>(h * mult) >> (32 - bits) : 0;
+	}
+
+	/* Search multiplicative hashes of growing table size for one without collisions */
+	constexpr bool perfect_hash()
+	{
+		unsigned int min = 0;
+
+		while ((std::size_t(1) << min) < size)
+			min++;
+
+		for (unsigned int bits = min; bits <= min + 2; bits++) {
+			for (std::uint32_t k = 0; k < 1024; k++) {
+				std::uint32_t mult = 0x9e3779b1u + 2 * k;
+				bool ok = true;
+
+				for (auto &s : slots_)
+					s = 0;
+				for (std::size_t i = 0; ok && i < size; i++) {
+					std::size_t s = slot(hashes_[i], mult, bits);
+
+					if (slots_[s])
+						ok = false;
+					else
+						slots_[s] = static_cast<std::uint16_t>(i + 1);
+				}
+
+				if (ok) {
+					mult_ = mult;
+					bits_ = bits;
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	std::tuple<Opts...> opts_;
+	std::array<const char *, size> names_;
+	std::array<std::uint32_t, size> hashes_;
+	std::array<std::uint16_t, capacity()> slots_ = {};
+	std::uint32_t mult_ = 0;
+	unsigned int bits_ = 0;
+};
+
+namespace detail {
+
+/* Position of option K in schema S, checked to be the same option */
+template <const auto &S, const auto &K>
+constexpr std::size_t position() noexcept
+{
+	constexpr std::size_t pos = S.position(K.name);
+	constexpr cfg_opt_t ours = K.entry();
+	constexpr cfg_opt_t theirs = S.table()[pos];
+
+	static_assert(ours.type == theirs.type && ours.flags == theirs.flags,
+		      "option does not match its declaration in the schema");
+	return pos;
+}
+
+/* Option at pos of a section created from schema S, or nullptr */
+template <const auto &S>
+cfg_opt_t *schema_at(cfg_t *cfg, std::size_t pos) noexcept
+{
+	if (!cfg || pos == S.npos)
+		return nullptr;
+
+	/* The section must be created from table<S> */
+	assert(!std::strcmp(cfg->opts[pos].name, S.name(pos)));
+	return &cfg->opts[pos];
+}
+
+template <const auto &S, const auto &K>
+cfg_opt_t *schema_opt(section sec) noexcept
+{
+	return schema_at<S>(sec.cfg(), position<S, K>());
+}
+
+} // namespace detail
+
+/** Read option K of a section created from schema S.
+ *
+ * Fails to compile unless K is an option of S, with the same type and
+ * flags.  The option is found at its fixed position in the section,
+ * and read with the getter for its type.
+ */
+template <const auto &S, const auto &K>
+typename std::decay_t<decltype(K)>::value_type get(section sec, unsigned int index = 0) noexcept
+{
+	using T = typename std::decay_t<decltype(K)>::value_type;
+	cfg_opt_t *opt = detail::schema_opt<S, K>(sec);
+
+	return opt ? value_traits<T>::get(opt, index) : T();
+}
+
+/** Number of values of option K of a section created from schema S. */
+template <const auto &S, const auto &K>
+unsigned int size(section sec) noexcept
+{
+	return cfg_opt_size(detail::schema_opt<S, K>(sec));
+}
+
+/** The values of option K of a section created from schema S. */
+template <const auto &S, const auto &K>
+range<typename std::decay_t<decltype(K)>::value_type> values(section sec) noexcept
+{
+	return range<typename std::decay_t<decltype(K)>::value_type>(detail::schema_opt<S, K>(sec));
+}
+
+/** Option of a section created from schema S by name, using the perfect hash.
+ *
+ * Names are matched in either case if the section has CFGF_NOCASE,
+ * the same as by cfg_getopt().
+ */
+template <const auto &S>
+cfg_opt_t *find(section sec, std::string_view name) noexcept
+{
+	cfg_t *cfg = sec.cfg();
+
+	if (!cfg)
+		return nullptr;
+	return detail::schema_at<S>(cfg, S.find(name, cfg->flags & CFGF_NOCASE));
+}
+
+} // namespace confuse
+
+#endif /* CONFUSE_HPP_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,175 @@
+#include "check_confuse.h"
+#include <errno.h>
+#include <string.h>
+
+/*
+ * cfg_bind(): scalars, lists, sections and titled multi-sections are
+ * copied into a struct tree in one walk, and cfg_unbind() frees it.
+ */
+
+struct listen {
+	long int port;
+	cfg_bool_t tls;
+};
+
+struct backend {
+	const char *name;
+	char *host;
+	uint16_t port;
+	double weight;
+	char **tags;
+	unsigned int ntags;
+};
+
+struct conf {
+	char *name;
+	int64_t limit;
+	long int *ports;
+	unsigned int nports;
+	struct listen listen;
+	struct backend *backends;
+	unsigned int nbackends;
+	long int simple;
+};
+
+static cfg_bind_t listen_binds[] = {
+	CFG_BIND("port", struct listen, port),
+	CFG_BIND("tls", struct listen, tls),
+	CFG_BIND_END()
+};
+
+static cfg_bind_t backend_binds[] = {
+	CFG_BIND_TITLE(struct backend, name),
+	CFG_BIND("host", struct backend, host),
+	CFG_BIND("port", struct backend, port),
+	CFG_BIND("weight", struct backend, weight),
+	CFG_BIND_LIST("tags", struct backend, tags, ntags),
+	CFG_BIND_END()
+};
+
+static cfg_bind_t binds[] = {
+	CFG_BIND("name", struct conf, name),
+	CFG_BIND("limit", struct conf, limit),
+	CFG_BIND_LIST("ports", struct conf, ports, nports),
+	CFG_BIND_SEC("listen", struct conf, listen, listen_binds),
+	CFG_BIND_MULTISEC("backend", struct conf, backends, nbackends, backend_binds),
+	CFG_BIND("simple", struct conf, simple),
+	CFG_BIND_END()
+};
+
+int main(void)
+{
+	long int simple = 42;
+	cfg_opt_t listen_opts[] = {
+		CFG_INT("port", 80, CFGF_NONE),
+		CFG_BOOL("tls", cfg_false, CFGF_NONE),
+		CFG_END()
+	};
+	cfg_opt_t backend_opts[] = {
+		CFG_STR("host", NULL, CFGF_NONE),
+		CFG_UINT16("port", 8080, CFGF_NONE),
+		CFG_FLOAT("weight", 1.0, CFGF_NONE),
+		CFG_STR_LIST("tags", NULL, CFGF_NONE),
+		CFG_END()
+	};
+	cfg_opt_t opts[] = {
+		CFG_STR("name", "default", CFGF_NONE),
+		CFG_INT64("limit", 0, CFGF_NONE),
+		CFG_INT_LIST("ports", "{1, 2}", CFGF_NONE),
+		CFG_SEC("listen", listen_opts, CFGF_NONE),
+		CFG_SEC("backend", backend_opts, CFGF_MULTI | CFGF_TITLE),
+		CFG_SIMPLE_INT("simple", &simple),
+		CFG_STR("unbound", NULL, CFGF_NONE),
+		CFG_END()
+	};
+	cfg_bind_t bad_size[] = {
+		{ .name = "ports", .offset = offsetof(struct conf, ports), .size = 1,
+		  .count = offsetof(struct conf, nports) },
+		CFG_BIND_END()
+	};
+	cfg_bind_t bad_sec[] = {
+		CFG_BIND("listen", struct conf, name),
+		CFG_BIND_END()
+	};
+	cfg_bind_t missing[] = {
+		CFG_BIND_LIST("ports", struct conf, ports, nports),
+		CFG_BIND("nonexistent", struct conf, name),
+		CFG_BIND_END()
+	};
+	struct conf conf;
+	cfg_t *cfg;
+	int i;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg_parse_buf(cfg,
+				  "name = lb limit = 0x100000000\n"
+				  "ports = {80, 443, 8443}\n"
+				  "listen { tls = true }\n"
+				  "backend web { host = a tags = {x, y} }\n"
+				  "backend api { host = b port = 9000 weight = 0.5 }\n") == CFG_SUCCESS);
+
+	memset(&conf, 0, sizeof(conf));
+	fail_unless(cfg_bind(cfg, binds, &conf) == CFG_SUCCESS);
+
+	fail_unless(!strcmp(conf.name, "lb"));
+	fail_unless(conf.limit == INT64_C(0x100000000));
+	fail_unless(conf.nports == 3);
+	fail_unless(conf.ports[0] == 80 && conf.ports[1] == 443 && conf.ports[2] == 8443);
+	fail_unless(conf.listen.port == 80);
+	fail_unless(conf.listen.tls == cfg_true);
+	fail_unless(conf.simple == 42);
+
+	fail_unless(conf.nbackends == 2);
+	fail_unless(!strcmp(conf.backends[0].name, "web"));
+	fail_unless(!strcmp(conf.backends[0].host, "a"));
+	fail_unless(conf.backends[0].port == 8080);
+	fail_unless(conf.backends[0].weight == 1.0);
+	fail_unless(conf.backends[0].ntags == 2);
+	fail_unless(!strcmp(conf.backends[0].tags[1], "y"));
+	fail_unless(!strcmp(conf.backends[1].name, "api"));
+	fail_unless(conf.backends[1].port == 9000);
+	fail_unless(conf.backends[1].weight == 0.5);
+	fail_unless(conf.backends[1].ntags == 0 && conf.backends[1].tags == NULL);
+
+	fail_unless(cfg_unbind(binds, &conf) == CFG_SUCCESS);
+	fail_unless(conf.ports == NULL && conf.nports == 0);
+	fail_unless(conf.backends == NULL && conf.nbackends == 0);
+
+	/* Errors leave nothing allocated behind */
+	errno = 0;
+	fail_unless(cfg_bind(cfg, bad_size, &conf) == CFG_FAIL && errno == EINVAL);
+	fail_unless(cfg_bind(cfg, bad_sec, &conf) == CFG_FAIL && errno == EINVAL);
+	fail_unless(cfg_bind(cfg, missing, &conf) == CFG_FAIL && errno == ENOENT);
+	fail_unless(conf.ports == NULL && conf.nports == 0);
+	fail_unless(cfg_bind(NULL, binds, &conf) == CFG_FAIL);
+
+	cfg_free(cfg);
+
+	/* Defaults left unset by CFGF_LAZY are bound too, also when frozen */
+	cfg = cfg_init(opts, CFGF_LAZY);
+	fail_unless(cfg_parse_buf(cfg, "backend web {}") == CFG_SUCCESS);
+	for (i = 0; i < 2; i++) {
+		memset(&conf, 0, sizeof(conf));
+		fail_unless(cfg_bind(cfg, binds, &conf) == CFG_SUCCESS);
+		fail_unless(!strcmp(conf.name, "default"));
+		fail_unless(conf.limit == 0);
+		fail_unless(conf.nports == 2 && conf.ports[1] == 2);
+		fail_unless(conf.listen.port == 80 && conf.listen.tls == cfg_false);
+		fail_unless(conf.nbackends == 1);
+		fail_unless(conf.backends[0].host == NULL);
+		fail_unless(conf.backends[0].port == 8080);
+		fail_unless(conf.backends[0].weight == 1.0);
+		fail_unless(cfg_unbind(binds, &conf) == CFG_SUCCESS);
+		fail_unless(cfg_freeze(cfg) == CFG_SUCCESS);
+	}
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,90 @@
+#include "check_confuse.h"
+#include <string.h>
+#include "codegen_schema.h"
+
+/*
+ * The header and tables are generated from codegen.schema at build time
+ * by tools/confuse-gen, the accessors must agree with the by-name API.
+ */
+
+static const char *conf =
+	"name = service\n"
+	"ports = {22, 8443}\n"
+	"log { level = -2 }\n"
+	"backend db { host = db.local port = 5432 check { paths = {/ping} } }\n"
+	"backend cache { weight = 0.5 }\n";
+
+int main(void)
+{
+	cfg_t *cfg;
+	app_t app;
+	app_backend_t be;
+	app_backend_check_t chk;
+
+	cfg = cfg_init(app_opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+	app = app_root(cfg);
+
+	/* Every position constant names the option at that position */
+	fail_unless(strcmp(cfg->opts[APP_NAME_IDX].name, "name") == 0);
+	fail_unless(strcmp(cfg->opts[APP_PORTS_IDX].name, "ports") == 0);
+	fail_unless(strcmp(cfg->opts[APP_BACKEND_IDX].name, "backend") == 0);
+	fail_unless(cfg->opts[APP_NOPTS].name == NULL);
+
+	/* Defaults */
+	fail_unless(strcmp(app_name(app), "demo") == 0);
+	fail_unless(app_verbose(app) == cfg_true);
+	fail_unless(app_ratio(app) == 0.1);
+	fail_unless(app_offset(app) == INT64_MIN);
+	fail_unless(app_ports_count(app) == 2);
+	fail_unless(app_ports(app, 0) == 80);
+	fail_unless(app_ports(app, 1) == 443);
+	fail_unless(app_log_level(app_log(app)) == 3);
+	fail_unless(app_log_file(app_log(app)) == NULL);
+	fail_unless(strcmp(app_log_tag(app_log(app)), "app?\?/log") == 0);
+	fail_unless(app_log_rate(app_log(app)) == 1e-320);
+	fail_unless(app_backend_count(app) == 0);
+
+	fail_unless(cfg_parse_buf(cfg, conf) == CFG_SUCCESS);
+
+	fail_unless(strcmp(app_name(app), "service") == 0);
+	fail_unless(app_ports_count(app) == 2);
+	fail_unless(app_ports(app, 1) == 8443);
+	fail_unless(app_log_level(app_log(app)) == -2);
+	fail_unless(app_log(app).cfg == cfg_getsec(cfg, "log"));
+
+	fail_unless(app_backend_count(app) == 2);
+	be = app_backend(app, 0);
+	fail_unless(be.cfg == cfg_gettsec(cfg, "backend", "db"));
+	fail_unless(strcmp(app_backend_title(be), "db") == 0);
+	fail_unless(strcmp(app_backend_host(be), "db.local") == 0);
+	fail_unless(app_backend_port(be) == 5432);
+	fail_unless(app_backend_weight(be) == 1.0);
+
+	chk = app_backend_check(be);
+	fail_unless(app_backend_check_interval(chk) == 16);
+	fail_unless(app_backend_check_paths_count(chk) == 1);
+	fail_unless(strcmp(app_backend_check_paths(chk, 0), "/ping") == 0);
+	fail_unless(app_backend_check_paths(chk, 1) == NULL);
+
+	be = app_backend(app, 1);
+	fail_unless(strcmp(app_backend_title(be), "cache") == 0);
+	fail_unless(strcmp(app_backend_host(be), "localhost") == 0);
+	fail_unless(app_backend_port(be) == 8080);
+	fail_unless(app_backend_weight(be) == 0.5);
+	fail_unless(app_backend_check_paths_count(app_backend_check(be)) == 0);
+
+	/* Out of range section index, like cfg_getnsec() */
+	fail_unless(app_backend(app, 2).cfg == NULL);
+
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,174 @@
+#include "check_confuse.h"
+#include "../src/confuse.hpp"
+#include <cstring>
+#include <string_view>
+
+/*
+ * confuse.hpp: typed getters through hashed paths, ranges over lists
+ * and multi-sections, and ownership of configurations and snapshots.
+ */
+
+using namespace std::literals;
+
+/* Paths are split and hashed at compile time */
+static constexpr confuse::path port_path("backend='a|b'|port");
+static_assert(port_path.valid());
+static_assert(port_path.depth() == 2);
+static_assert(port_path[0].name == "backend"sv);
+static_assert(port_path[0].title == "'a|b'"sv);
+static_assert(port_path[1].hash == confuse::hash("PORT"));
+static_assert(confuse::path("multi=0x10|n")[0].index == 16);
+static_assert(!confuse::path("").valid());
+static_assert(!confuse::path("a=|b").valid());
+static_assert(!confuse::path("a|b|c|d|e|f|g|h|i").valid());
+
+static cfg_opt_t backend_opts[] = {
+	CFG_STR("host", "localhost", CFGF_NONE),
+	CFG_UINT16("port", 80, CFGF_NONE),
+	CFG_BOOL("tls", cfg_false, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t multi_opts[] = {
+	CFG_INT("n", 0, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_STR("name", NULL, CFGF_NONE),
+	CFG_INT("count", 3, CFGF_NONE),
+	CFG_INT64("big", 0, CFGF_NONE),
+	CFG_FLOAT("ratio", 0.25, CFGF_NONE),
+	CFG_INT_LIST("ports", NULL, CFGF_NONE),
+	CFG_STR_LIST("tags", NULL, CFGF_NONE),
+	CFG_SEC("backend", backend_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_SEC("multi", multi_opts, CFGF_MULTI),
+	CFG_END()
+};
+
+static const char *conf =
+	"name = demo\n"
+	"big = 8589934592\n"
+	"ports = {1, 2, 3}\n"
+	"tags = {x, y}\n"
+	"backend db { port = 5432 tls = true }\n"
+	"backend 'a|b' { host = example.com }\n"
+	"multi { n = 1 }\n"
+	"multi { n = 2 }\n";
+
+static void check(cfg_flag_t flags)
+{
+	confuse::config cfg(opts, flags);
+	long sum = 0;
+	unsigned int n = 0;
+
+	fail_unless(cfg.parse_buf(conf) == CFG_SUCCESS);
+
+	/* Scalars, read through the matching C getter */
+	fail_unless(cfg.get<std::string_view>("name") == "demo"sv);
+	fail_unless(std::strcmp(cfg.get<const char *>("name"), "demo") == 0);
+	fail_unless(cfg.get<long>("count") == 3);
+	fail_unless(cfg.get<int>("count") == 3);
+	fail_unless(cfg.get<std::int64_t>("big") == 8589934592LL);
+	fail_unless(cfg.get<double>("ratio") == 0.25);
+	fail_unless(cfg.get<float>("ratio") == 0.25f);
+
+	/* The string is the one held by the configuration, not a copy */
+	fail_unless(cfg.get<std::string_view>("name").data() == cfg_getstr(cfg.cfg(), "name"));
+
+	/* Missing options and type mismatches */
+	fail_unless(cfg.get<long>("nonexistent") == 0);
+	fail_unless(cfg.get<long>("name") == 0);
+	fail_unless(cfg.get<std::string_view>("count").empty());
+	fail_unless(!cfg.try_get<long>("nonexistent"));
+	fail_unless(!cfg.try_get<double>("count"));
+	fail_unless(!cfg.try_get<long>("ports", 3));
+	fail_unless(cfg.try_get<long>("ports", 2) == 3L);
+	fail_unless(!cfg.try_get<long>("a|b|c|d|e|f|g|h|i"));
+	fail_unless(cfg.try_get<long>("count") == 3L);
+	fail_unless(cfg.try_get<std::string_view>("backend=db|host") == "localhost"sv);
+
+	/* Paths into titled and numbered sections */
+	fail_unless(cfg.get<unsigned>("backend=db|port") == 5432);
+	fail_unless(cfg.get<bool>("backend=db|tls"));
+	fail_unless(cfg.get<cfg_bool_t>("backend=db|tls") == cfg_true);
+	fail_unless(cfg.get<std::string_view>("backend=db|host") == "localhost"sv);
+	fail_unless(cfg.get<std::string_view>("backend='a|b'|host") == "example.com"sv);
+	fail_unless(cfg.get<long>(port_path) == 80);
+	fail_unless(cfg.get<long>("multi=1|n") == 2);
+	fail_unless(!cfg.try_get<long>("multi=2|n"));
+	fail_unless(!cfg.try_get<long>("backend=nope|port"));
+
+	/* Sections */
+	confuse::section db = cfg.get<confuse::section>("backend=db");
+	fail_unless(db && db.title() == "db"sv);
+	fail_unless(db.cfg() == cfg_gettsec(cfg.cfg(), "backend", "db"));
+	fail_unless(cfg.get<confuse::section>("backend", 1).title() == "a|b"sv);
+	fail_unless(!cfg.get<confuse::section>("backend", 2));
+	fail_unless(cfg.size("backend") == 2);
+
+	/* Ranges */
+	for (long port : cfg.list<long>("ports"))
+		sum += port;
+	fail_unless(sum == 6);
+	fail_unless(cfg.list<std::string_view>("tags").size() == 2);
+	fail_unless(cfg.list<std::string_view>("tags")[1] == "y"sv);
+	fail_unless(cfg.list<std::string_view>("ports").empty());
+
+	for (confuse::section be : cfg.sections("backend")) {
+		fail_unless(be.name() == "backend"sv);
+		n += be.get<unsigned>("port");
+	}
+	fail_unless(n == 5432 + 80);
+
+	sum = 0;
+	for (confuse::section m : cfg.sections("multi"))
+		sum += m.get<long>("n");
+	fail_unless(sum == 3);
+
+	/* Snapshots keep the tree alive, and move but do not copy */
+	confuse::snapshot snap(db);
+	fail_unless(snap.cfg() == db.cfg());
+
+	confuse::config moved(std::move(cfg));
+	fail_unless(cfg.cfg() == nullptr);
+	fail_unless(moved.get<long>("count") == 3);
+	moved.reset();
+
+	fail_unless(snap.get<unsigned>("port") == 5432);
+	confuse::snapshot other(std::move(snap));
+	fail_unless(!snap && other);
+	other.reset();
+
+	/* A handle hands out snapshots of whatever is current */
+	confuse::config first(opts, flags);
+	fail_unless(first.parse_buf("count = 1") == CFG_SUCCESS);
+	confuse::handle h(std::move(first));
+	fail_unless(!first);
+
+	confuse::snapshot cur = h.acquire();
+	fail_unless(cur.get<long>("count") == 1);
+
+	confuse::config second(opts, flags);
+	fail_unless(second.parse_buf("count = 2") == CFG_SUCCESS);
+	fail_unless(h.swap(std::move(second)) == CFG_SUCCESS);
+	fail_unless(!second);
+
+	fail_unless(cur.get<long>("count") == 1);
+	fail_unless(h.acquire().get<long>("count") == 2);
+}
+
+int main(void)
+{
+	check(CFGF_NONE);
+	check(CFGF_LAZY);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
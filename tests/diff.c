@@ -0,0 +1,146 @@
+#include "check_confuse.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * cfg_diff(): titled sections are matched by title, identical subtrees
+ * are skipped, and paths can be looked up with cfg_getopt().
+ */
+
+static cfg_opt_t backend_opts[] = {
+	CFG_STR("host", NULL, CFGF_NONE),
+	CFG_INT("port", 80, CFGF_NONE),
+	CFG_INT_LIST("weights", NULL, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t listen_opts[] = {
+	CFG_INT("port", 0, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_STR("name", NULL, CFGF_NONE),
+	CFG_FLOAT("timeout", 1.5, CFGF_NONE),
+	CFG_STR("optional", NULL, CFGF_NODEFAULT),
+	CFG_SEC("backend", backend_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_SEC("listen", listen_opts, CFGF_MULTI),
+	CFG_END()
+};
+
+struct result {
+	char buf[1024];
+	cfg_t *oldcfg;
+	cfg_t *newcfg;
+	int stop;
+};
+
+static int collect(void *arg, cfg_diff_kind_t kind, const char *path,
+		   cfg_opt_t *oldopt, cfg_opt_t *newopt, cfg_t *oldsec, cfg_t *newsec)
+{
+	struct result *res = arg;
+	size_t len = strlen(res->buf);
+
+	snprintf(res->buf + len, sizeof(res->buf) - len, "%c%s\n",
+		 kind == CFG_DIFF_ADDED ? '+' : kind == CFG_DIFF_REMOVED ? '-' : '~', path);
+
+	/* Paths resolve in the tree(s) they exist in */
+	if (oldsec || (!newsec && oldopt && kind != CFG_DIFF_ADDED))
+		fail_unless(cfg_exists(res->oldcfg, path));
+	if (newsec || (!oldsec && newopt && kind != CFG_DIFF_REMOVED))
+		fail_unless(cfg_exists(res->newcfg, path));
+	fail_unless(kind != CFG_DIFF_ADDED || !oldsec);
+	fail_unless(kind != CFG_DIFF_REMOVED || !newsec);
+
+	return res->stop;
+}
+
+static const char *diffx(const char *oldbuf, const char *newbuf, int stop, cfg_flag_t flags)
+{
+	static struct result res;
+	int rc;
+
+	memset(&res, 0, sizeof(res));
+	res.stop = stop;
+	res.oldcfg = cfg_init(opts, flags);
+	res.newcfg = cfg_init(opts, flags);
+	fail_unless(cfg_parse_buf(res.oldcfg, oldbuf) == CFG_SUCCESS);
+	fail_unless(cfg_parse_buf(res.newcfg, newbuf) == CFG_SUCCESS);
+
+	rc = cfg_diff(res.oldcfg, res.newcfg, collect, &res);
+	fail_unless(rc == (stop && res.buf[0] ? CFG_FAIL : CFG_SUCCESS));
+
+	cfg_free(res.oldcfg);
+	cfg_free(res.newcfg);
+
+	return res.buf;
+}
+
+static const char *diff(const char *oldbuf, const char *newbuf, int stop)
+{
+	return diffx(oldbuf, newbuf, stop, CFGF_NONE);
+}
+
+static const char *base =
+	"name = lb\n"
+	"backend web { host = \"10.0.0.1\" weights = {1, 2} }\n"
+	"backend api { host = \"10.0.0.2\" port = 8080 }\n"
+	"backend 'a|b' { host = \"10.0.0.3\" }\n"
+	"listen { port = 80 }\n";
+
+int main(void)
+{
+	cfg_t *cfg;
+
+	/* Nothing changed, or only the order of titled sections */
+	fail_unless(!strcmp(diff(base, base, 0), ""));
+	fail_unless(!strcmp(diff(base,
+				 "name = lb\n"
+				 "backend 'a|b' { host = \"10.0.0.3\" }\n"
+				 "backend api { host = \"10.0.0.2\" port = 8080 }\n"
+				 "backend web { host = \"10.0.0.1\" weights = {1, 2} }\n"
+				 "listen { port = 80 }\n", 0), ""));
+
+	/* Values, lists and defaults */
+	fail_unless(!strcmp(diff(base,
+				 "name = lb2 timeout = 2 optional = yes\n"
+				 "backend web { host = \"10.0.0.1\" weights = {1, 3} }\n"
+				 "backend api { host = \"10.0.0.2\" port = 8080 }\n"
+				 "backend 'a|b' { host = \"10.0.0.3\" }\n"
+				 "listen { port = 80 }\n", 0),
+			    "~name\n~timeout\n+optional\n~backend=web\n~backend=web|weights\n"));
+
+	/* Sections added, removed and modified, also out of order */
+	fail_unless(!strcmp(diff(base,
+				 "name = lb\n"
+				 "backend db { host = \"10.0.0.4\" }\n"
+				 "backend 'a|b' { host = \"10.0.0.5\" }\n"
+				 "backend web { host = \"10.0.0.1\" weights = {1, 2} }\n"
+				 "listen { port = 80 }\n"
+				 "listen { port = 443 }\n", 0),
+			    "-backend=api\n~backend='a|b'\n~backend='a|b'|host\n+backend=db\n+listen=1\n"));
+
+	/* Titles only differing in case are the same section with CFGF_NOCASE */
+	fail_unless(!strcmp(diffx("backend Web { port = 1 }\n",
+				  "backend wEB { port = 1 }\n", 0, CFGF_NOCASE), ""));
+	fail_unless(!strcmp(diffx("backend Web { port = 1 }\n",
+				  "backend web { port = 2 }\n", 0, CFGF_NOCASE),
+			    "~backend=Web\n~backend=Web|port\n"));
+
+	/* The callback can stop the diff */
+	fail_unless(!strcmp(diff(base, "name = other\nbackend x {}\n", 1), "~name\n"));
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg_diff(cfg, NULL, collect, NULL) == CFG_FAIL);
+	fail_unless(cfg_diff(cfg, cfg, NULL, NULL) == CFG_FAIL);
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
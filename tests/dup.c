@@ -0,0 +1,184 @@
+#include "check_confuse.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * cfg_dup(): a copy shares the values and sections of the frozen
+ * original until they change, changes stay in the copy.
+ */
+
+static cfg_opt_t node_opts[] = {
+	CFG_INT("port", 80, CFGF_NONE),
+	CFG_STR("host", "localhost", CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_STR("name", "none", CFGF_NONE),
+	CFG_INT_LIST("ports", "{1, 2}", CFGF_NONE),
+	CFG_SEC("log", node_opts, CFGF_NONE),
+	CFG_SEC("node", node_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+static void same(cfg_t *a, cfg_t *b)
+{
+	cfg_fingerprint_t fa = cfg_fingerprint(a), fb = cfg_fingerprint(b);
+
+	fail_unless(fa.hi == fb.hi && fa.lo == fb.lo);
+}
+
+static void check(cfg_flag_t flags)
+{
+	cfg_t *orig, *cfg, *copy, *sec;
+
+	orig = cfg_init(opts, flags);
+	fail_unless(orig != NULL);
+	fail_unless(cfg_parse_buf(orig, "name = base ports = {3, 4}\n"
+				  "log { host = syslog }\n"
+				  "node a { port = 8000 } node b { host = b.example.com }") == CFG_SUCCESS);
+
+	/* Only a frozen original can be copied */
+	fail_unless(cfg_dup(orig) == NULL && errno == EINVAL);
+	fail_unless(cfg_freeze(orig) == CFG_SUCCESS);
+	cfg = cfg_dup(orig);
+	fail_unless(cfg != NULL);
+	same(orig, cfg);
+	fail_unless(cfg_setint(orig, "log|port", 1) == CFG_FAIL && errno == EPERM);
+
+	/* Set through a path, only the copy changes */
+	fail_unless(cfg_setint(cfg, "node=b|port", 9000) == CFG_SUCCESS);
+	fail_unless(cfg_getint(cfg, "node=b|port") == 9000);
+	fail_unless(cfg_getint(orig, "node=b|port") == 80);
+	fail_unless(strcmp(cfg_getstr(cfg, "node=b|host"), "b.example.com") == 0);
+
+	fail_unless(cfg_setstr(cfg, "name", "copy") == CFG_SUCCESS);
+	fail_unless(cfg_addlist(cfg, "ports", 1, 5) == CFG_SUCCESS);
+	fail_unless(strcmp(cfg_getstr(orig, "name"), "base") == 0);
+	fail_unless(cfg_size(orig, "ports") == 2 && cfg_size(cfg, "ports") == 3);
+	fail_unless(cfg_getnint(cfg, "ports", 2) == 5);
+
+	/* Sections returned can be changed */
+	sec = cfg_getsec(cfg, "log");
+	fail_unless(sec != NULL && sec != cfg_getsec(orig, "log"));
+	fail_unless(cfg_setstr(sec, "host", "loghost") == CFG_SUCCESS);
+	fail_unless(strcmp(cfg_getstr(orig, "log|host"), "syslog") == 0);
+
+	fail_unless(cfg_parse_buf(cfg, "node c { port = 1 }") == CFG_SUCCESS);
+	fail_unless(cfg_size(cfg, "node") == 3 && cfg_size(orig, "node") == 2);
+
+	/* A copy of the copy, frozen, reads the sections of both */
+	fail_unless(cfg_freeze(cfg) == CFG_SUCCESS);
+	copy = cfg_dup(cfg);
+	fail_unless(copy != NULL);
+	fail_unless(cfg_freeze(copy) == CFG_SUCCESS);
+	same(cfg, copy);
+	fail_unless(cfg_gettsec(copy, "node", "a") == cfg_gettsec(orig, "node", "a"));
+	fail_unless(cfg_gettsec(copy, "node", "b") == cfg_gettsec(cfg, "node", "b"));
+	fail_unless(cfg_setint(cfg, "node=a|port", 1) == CFG_FAIL && errno == EPERM);
+	cfg_release(cfg);
+
+	/* Removing a shared section leaves it to the original */
+	cfg = cfg_dup(copy);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_parse_buf(cfg, "log { host = \"l\" }") == CFG_SUCCESS);
+	fail_unless(strcmp(cfg_getstr(cfg, "log|host"), "l") == 0);
+	fail_unless(strcmp(cfg_getstr(copy, "log|host"), "loghost") == 0);
+	fail_unless(cfg_rmtsec(cfg, "node", "a") == CFG_SUCCESS);
+	fail_unless(cfg_size(cfg, "node") == 2 && cfg_getint(orig, "node=a|port") == 8000);
+	fail_unless(cfg_parse_buf(cfg, "node b { port = 7 }") == CFG_SUCCESS);
+	fail_unless(cfg_getint(cfg, "node=b|port") == 7 && cfg_getint(copy, "node=b|port") == 9000);
+	fail_unless(cfg_opt_setnstr(cfg_getopt(cfg, "name"), "again", 0) == CFG_SUCCESS);
+	fail_unless(strcmp(cfg_getstr(copy, "name"), "copy") == 0);
+
+	/* Each copy keeps what it shares, cfg_free() only drops a reference */
+	cfg_free(orig);
+	cfg_release(copy);
+	fail_unless(cfg_getint(cfg, "node=b|port") == 7);
+	fail_unless(cfg_getint(cfg, "log|port") == 80);
+	fail_unless(cfg_freeze(cfg) == CFG_SUCCESS);
+	copy = cfg_dup(cfg);
+	fail_unless(copy != NULL);
+	cfg_free(cfg);
+	fail_unless(cfg_getint(copy, "node=b|port") == 7);
+	fail_unless(strcmp(cfg_getstr(copy, "log|host"), "l") == 0);
+	fail_unless(cfg_getint(copy, "log|port") == 80);
+	cfg_free(copy);
+}
+
+static int ptrs;
+
+static int parse_ptr(cfg_t *cfg, cfg_opt_t *opt, const char *value, void *result)
+{
+	char *ptr = strdup(value);
+
+	if (!ptr)
+		return -1;
+	*(void **)result = ptr;
+	ptrs++;
+
+	return 0;
+}
+
+static void free_ptr(void *ptr)
+{
+	ptrs--;
+	free(ptr);
+}
+
+/* Pointers with a free function are freed by the tree that set them */
+static void check_ptr(void)
+{
+	cfg_opt_t opts[] = {
+		CFG_PTR_CB("data", NULL, CFGF_NONE, parse_ptr, free_ptr),
+		CFG_PTR_LIST_CB("list", NULL, CFGF_NONE, parse_ptr, free_ptr),
+		CFG_END()
+	};
+	cfg_t *orig, *cfg;
+
+	orig = cfg_init(opts, CFGF_NONE);
+	fail_unless(orig != NULL);
+	fail_unless(cfg_parse_buf(orig, "data = a list = {b, c}") == CFG_SUCCESS);
+	fail_unless(cfg_freeze(orig) == CFG_SUCCESS);
+
+	cfg = cfg_dup(orig);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_parse_buf(cfg, "data = x list += {d}") == CFG_SUCCESS);
+	fail_unless(strcmp(cfg_getptr(cfg, "data"), "x") == 0);
+	fail_unless(strcmp(cfg_getptr(orig, "data"), "a") == 0);
+	fail_unless(cfg_getnptr(cfg, "list", 0) == cfg_getnptr(orig, "list", 0));
+	fail_unless(cfg_size(cfg, "list") == 3 && cfg_size(orig, "list") == 2);
+	fail_unless(ptrs == 5);
+
+	cfg_free(orig);
+	fail_unless(ptrs == 5);
+	fail_unless(strcmp(cfg_getnptr(cfg, "list", 1), "c") == 0);
+	cfg_free(cfg);
+	fail_unless(ptrs == 0);
+}
+
+int main(void)
+{
+	cfg_t *cfg;
+
+	check(CFGF_NONE);
+	check(CFGF_INTERN | CFGF_STATS);
+	check(CFGF_LAZY);
+	check_ptr();
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_dup(NULL) == NULL && errno == EINVAL);
+	fail_unless(cfg_dup(cfg_getsec(cfg, "log")) == NULL && errno == EINVAL);
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
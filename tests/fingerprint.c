@@ -0,0 +1,138 @@
+#include "check_confuse.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * cfg_fingerprint(): equal trees hash equal, any change is seen, also
+ * deep down in a cached subtree, and a print/parse round trip is stable.
+ */
+
+static cfg_opt_t sub_opts[] = {
+	CFG_INT("port", 0, CFGF_NONE),
+	CFG_STR_LIST("hosts", NULL, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_STR("name", "default", CFGF_NONE),
+	CFG_FLOAT("ratio", 0.5, CFGF_NONE),
+	CFG_BOOL("enabled", cfg_false, CFGF_NONE),
+	CFG_SEC("sub", sub_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+static const char *config =
+	"name = \"server\"\n"
+	"ratio = 0.25\n"
+	"sub a { port = 80 hosts = {\"x\", \"y\"} }\n"
+	"sub b { port = 443 }\n";
+
+static cfg_t *create(const char *buf)
+{
+	cfg_t *cfg = cfg_init(opts, CFGF_NONE);
+
+	fail_unless(cfg);
+	fail_unless(cfg_parse_buf(cfg, buf) == CFG_SUCCESS);
+
+	return cfg;
+}
+
+static int equal(cfg_fingerprint_t a, cfg_fingerprint_t b)
+{
+	return a.hi == b.hi && a.lo == b.lo;
+}
+
+int main(void)
+{
+	cfg_fingerprint_t fp, fp2;
+	cfg_t *cfg, *cfg2;
+	char *buf;
+	size_t len;
+	long int simple = 1;
+	cfg_opt_t simple_opts[] = {
+		CFG_SIMPLE_INT("simple", &simple),
+		CFG_END()
+	};
+
+	fp = cfg_fingerprint(NULL);
+	fail_unless(fp.hi == 0 && fp.lo == 0);
+	fail_unless(errno == EINVAL);
+
+	/* The defaults hash the same on every platform */
+	cfg = create("");
+	fp = cfg_fingerprint(cfg);
+	fail_unless(fp.hi == UINT64_C(0xa0a102ae08079d03));
+	fail_unless(fp.lo == UINT64_C(0x2351136f6b204095));
+	cfg_free(cfg);
+
+	cfg = create(config);
+	cfg2 = create(config);
+	fp = cfg_fingerprint(cfg);
+	fail_unless(fp.hi != 0 || fp.lo != 0);
+	fail_unless(equal(fp, cfg_fingerprint(cfg2)));
+	fail_unless(equal(fp, cfg_fingerprint(cfg)));
+
+	/* A change deep down invalidates all cached sections above it */
+	fail_unless(cfg_setint(cfg_gettsec(cfg2, "sub", "b"), "port", 8443) == CFG_SUCCESS);
+	fp2 = cfg_fingerprint(cfg2);
+	fail_unless(!equal(fp, fp2));
+	fail_unless(cfg_setint(cfg_gettsec(cfg2, "sub", "b"), "port", 443) == CFG_SUCCESS);
+	fail_unless(equal(fp, cfg_fingerprint(cfg2)));
+
+	fail_unless(cfg_addlist(cfg_gettsec(cfg2, "sub", "a"), "hosts", 1, "z") == CFG_SUCCESS);
+	fail_unless(!equal(fp, cfg_fingerprint(cfg2)));
+	fail_unless(cfg_rmtsec(cfg2, "sub", "a") == CFG_SUCCESS);
+	fp2 = cfg_fingerprint(cfg2);
+	fail_unless(!equal(fp, fp2));
+	fail_unless(cfg_addtsec(cfg2, "sub", "c") != NULL);
+	fail_unless(!equal(fp2, cfg_fingerprint(cfg2)));
+	cfg_free(cfg2);
+
+	/* Subsections hash the same as on their own */
+	cfg2 = create(config);
+	fail_unless(equal(cfg_fingerprint(cfg_gettsec(cfg, "sub", "a")),
+			  cfg_fingerprint(cfg_gettsec(cfg2, "sub", "a"))));
+	fail_unless(!equal(cfg_fingerprint(cfg_gettsec(cfg, "sub", "a")),
+			   cfg_fingerprint(cfg_gettsec(cfg, "sub", "b"))));
+
+	/* Titles and the order of sections matter, values are not confused */
+	cfg_free(cfg2);
+	cfg2 = create("name = \"server\"\nratio = 0.25\n"
+		      "sub b { port = 443 }\n"
+		      "sub a { port = 80 hosts = {\"x\", \"y\"} }\n");
+	fail_unless(!equal(fp, cfg_fingerprint(cfg2)));
+	cfg_free(cfg2);
+	cfg2 = create("name = \"server\"\nratio = 0.25\n"
+		      "sub a { port = 80 hosts = {\"xy\", \"\"} }\n"
+		      "sub b { port = 443 }\n");
+	fail_unless(!equal(fp, cfg_fingerprint(cfg2)));
+	cfg_free(cfg2);
+
+	/* Printing and parsing back gives the same tree */
+	fail_unless(cfg_print_to_buffer(cfg, &buf, &len) == CFG_SUCCESS);
+	cfg2 = create(buf);
+	fail_unless(equal(fp, cfg_fingerprint(cfg2)));
+	free(buf);
+	cfg_free(cfg2);
+	cfg_free(cfg);
+
+	/* CFG_SIMPLE_* variables are read every time */
+	cfg = cfg_init(simple_opts, CFGF_NONE);
+	fp = cfg_fingerprint(cfg);
+	simple = 2;
+	fail_unless(!equal(fp, cfg_fingerprint(cfg)));
+	simple = 1;
+	fail_unless(equal(fp, cfg_fingerprint(cfg)));
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
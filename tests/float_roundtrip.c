@@ -0,0 +1,155 @@
+#include "check_confuse.h"
+#include <locale.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_RANDOM 20000
+
+static uint64_t xorshift(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+
+	return *state = x;
+}
+
+static double from_bits(uint64_t bits)
+{
+	double d;
+
+	memcpy(&d, &bits, sizeof(d));
+	return d;
+}
+
+static uint64_t to_bits(double d)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &d, sizeof(bits));
+	return bits;
+}
+
+/* Print a single float option and check the exact text */
+static void check_print(cfg_t *cfg, double value, const char *expect)
+{
+	char *buf;
+	size_t len;
+
+	fail_unless(cfg_setfloat(cfg, "f", value) == CFG_SUCCESS);
+	fail_unless(cfg_print_to_buffer(cfg, &buf, &len) == CFG_SUCCESS);
+	if (strncmp(buf, "f=", 2) || strncmp(buf + 2, expect, strlen(expect)) || buf[2 + strlen(expect)] != '\n') {
+		fprintf(stderr, "expected f=%s, got %s", expect, buf);
+		fail_unless(0);
+	}
+	free(buf);
+}
+
+static void check_parse(cfg_t *cfg, const char *value, double expect)
+{
+	char conf[64];
+
+	snprintf(conf, sizeof(conf), "f = %s", value);
+	fail_unless(cfg_parse_buf(cfg, conf) == CFG_SUCCESS);
+	fail_unless(to_bits(cfg_getfloat(cfg, "f")) == to_bits(expect));
+}
+
+int main(void)
+{
+	cfg_opt_t opts[] = {
+		CFG_FLOAT("f", 0, CFGF_NONE),
+		CFG_FLOAT_LIST("list", NULL, CFGF_NONE),
+		CFG_END()
+	};
+	uint64_t state = 88172645463325252ULL;
+	cfg_t *cfg, *copy;
+	char *buf;
+	int i;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg);
+
+	check_print(cfg, 1e-9, "1e-9");
+	check_print(cfg, 0.1, "0.1");
+	check_print(cfg, 3, "3.0");
+	check_print(cfg, -2.5, "-2.5");
+	check_print(cfg, 0, "0.0");
+	check_print(cfg, 1234.5678, "1234.5678");
+	check_print(cfg, 0.001, "0.001");
+	check_print(cfg, 1e17, "1e17");
+	check_print(cfg, 1.5e300, "1.5e300");
+	check_print(cfg, 5e-324, "5e-324");
+	check_print(cfg, 1.7976931348623157e308, "1.7976931348623157e308");
+	check_print(cfg, 2.2250738585072014e-308, "2.2250738585072014e-308");
+	check_print(cfg, 0.30000000000000004, "0.30000000000000004");
+	/* Grisu2 is not always shortest, but still reads back the same */
+	check_print(cfg, 1e23, "9.999999999999999e22");
+	check_parse(cfg, "9.999999999999999e22", 1e23);
+
+	check_parse(cfg, "1e-9", 1e-9);
+	check_parse(cfg, "0.1", 0.1);
+	check_parse(cfg, "-.5", -0.5);
+	check_parse(cfg, "1.", 1.0);
+	check_parse(cfg, "12345678901234567890123", 12345678901234567890123.0);
+	check_parse(cfg, "0.000000000000000000000000000001", 1e-30);
+	check_parse(cfg, "9007199254740993", 9007199254740992.0);
+	check_parse(cfg, "2.2250738585072011e-308", 2.2250738585072011e-308);
+	check_parse(cfg, "4.9e-324", 5e-324);
+	check_parse(cfg, "1e23", 1e23);
+	check_parse(cfg, "0x10", 16.0);
+	check_parse(cfg, "0e50", 0.0);
+	check_parse(cfg, "-0e-400", -0.0);
+	check_parse(cfg, "0e2000000000", 0.0);
+	check_parse(cfg, "0.000e-2000000000", 0.0);
+	fail_unless(cfg_parse_json(cfg, "{\"f\": -0e2000000000}", 20) == CFG_SUCCESS);
+	fail_unless(to_bits(cfg_getfloat(cfg, "f")) == to_bits(-0.0));
+	fail_unless(cfg_parse_buf(cfg, "f = 1.5x") == CFG_PARSE_ERROR);
+	fail_unless(cfg_parse_buf(cfg, "f = 1e999") == CFG_PARSE_ERROR);
+
+	/* Random bit patterns must survive print and parse unchanged */
+	for (i = 0; i < NUM_RANDOM; i++) {
+		double d;
+
+		do
+			d = from_bits(xorshift(&state));
+		while (d != d || d - d != 0);	/* skip nan and inf */
+
+		fail_unless(cfg_setnfloat(cfg, "list", d, i) == CFG_SUCCESS);
+	}
+	fail_unless(cfg_print_to_buffer(cfg, &buf, NULL) == CFG_SUCCESS);
+
+	copy = cfg_init(opts, CFGF_NONE);
+	fail_unless(copy);
+	fail_unless(cfg_parse_buf(copy, buf) == CFG_SUCCESS);
+	fail_unless(cfg_size(copy, "list") == NUM_RANDOM);
+	for (i = 0; i < NUM_RANDOM; i++)
+		fail_unless(to_bits(cfg_getnfloat(copy, "list", i)) == to_bits(cfg_getnfloat(cfg, "list", i)));
+
+	/* Neither printing nor parsing may depend on the locale */
+	if (setlocale(LC_NUMERIC, "de_DE.UTF-8") || setlocale(LC_NUMERIC, "fr_FR.UTF-8")) {
+		char *buf2;
+
+		check_parse(cfg, "2.5", 2.5);
+		check_parse(cfg, "0.1234567890123456789", 0.1234567890123456789);
+		fail_unless(cfg_print_to_buffer(cfg, &buf2, NULL) == CFG_SUCCESS);
+		fail_unless(strncmp(buf2, "f=0.12345678901234568\n", 22) == 0);
+		fail_unless(strcmp(strchr(buf, '\n'), strchr(buf2, '\n')) == 0);
+		free(buf2);
+		setlocale(LC_NUMERIC, "C");
+	}
+
+	free(buf);
+	cfg_free(copy);
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
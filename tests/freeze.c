@@ -0,0 +1,84 @@
+#include "check_confuse.h"
+#include <errno.h>
+#include <string.h>
+
+/*
+ * cfg_freeze(): every way of changing a frozen tree fails with EPERM
+ * and leaves it untouched, while reading and freeing it still works.
+ */
+
+static cfg_opt_t sub_opts[] = {
+	CFG_INT("port", 80, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_STR("name", "default", CFGF_NONE),
+	CFG_INT_LIST("list", "{1, 2}", CFGF_NONE),
+	CFG_SEC("sub", sub_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+#define frozen(expr) do { errno = 0; fail_unless(expr); fail_unless(errno == EPERM); } while (0)
+
+int main(void)
+{
+	cfg_fingerprint_t fp, fp2;
+	char *values[] = { "3", "4" };
+	char *buf;
+	size_t len;
+	cfg_t *cfg, *sub;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg);
+	fail_unless(cfg_parse_buf(cfg, "name = x sub a { port = 1 } sub b {}") == CFG_SUCCESS);
+	fail_unless(cfg_freeze(cfg) == CFG_SUCCESS);
+	fp = cfg_fingerprint(cfg);
+	sub = cfg_gettsec(cfg, "sub", "a");
+
+	frozen(cfg_setstr(cfg, "name", "y") == CFG_FAIL);
+	frozen(cfg_setnint(cfg, "list", 5, 2) == CFG_FAIL);
+	frozen(cfg_setint(sub, "port", 2) == CFG_FAIL);
+	frozen(cfg_setlist(cfg, "list", 1, 7) == CFG_FAIL);
+	frozen(cfg_addlist(cfg, "list", 1, 7) == CFG_FAIL);
+	frozen(cfg_setmulti(cfg, "list", 2, values) == CFG_FAIL);
+	frozen(cfg_setcomment(cfg, "name", "comment") == CFG_FAIL);
+	frozen(cfg_addtsec(cfg, "sub", "c") == NULL);
+	frozen(cfg_rmtsec(cfg, "sub", "b") == CFG_FAIL);
+	frozen(cfg_free_value(cfg_getopt(cfg, "name")) == CFG_FAIL);
+	frozen(cfg_parse_buf(cfg, "name = z") == CFG_FAIL);
+
+	fail_unless(!strcmp(cfg_getstr(cfg, "name"), "x"));
+	fail_unless(cfg_size(cfg, "list") == 2);
+	fail_unless(cfg_size(cfg, "sub") == 2);
+	fail_unless(cfg_getint(sub, "port") == 1);
+	fail_unless(!strcmp(cfg_title(sub), "a"));
+	fail_unless(cfg_getint(cfg, "sub=b|port") == 80);
+	fp2 = cfg_fingerprint(cfg);
+	fail_unless(fp.hi == fp2.hi && fp.lo == fp2.lo);
+	fail_unless(cfg_print_to_buffer(cfg, &buf, &len) == CFG_SUCCESS);
+	free(buf);
+
+	fail_unless(cfg_free(cfg) == CFG_SUCCESS);
+
+	/* Freezing a section leaves the rest of the tree writable */
+	cfg = cfg_init(opts, CFGF_NONE);
+	sub = cfg_addtsec(cfg, "sub", "a");
+	fail_unless(cfg_freeze(sub) == CFG_SUCCESS);
+	frozen(cfg_setint(sub, "port", 2) == CFG_FAIL);
+	fail_unless(cfg_setstr(cfg, "name", "y") == CFG_SUCCESS);
+	fail_unless(cfg_addtsec(cfg, "sub", "b") != NULL);
+	fail_unless(cfg_rmtsec(cfg, "sub", "a") == CFG_SUCCESS);
+	cfg_free(cfg);
+
+	fail_unless(cfg_freeze(NULL) == CFG_FAIL);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,112 @@
+#include "check_confuse.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Option lookup through the name hash table of large sections: with
+ * cfg_gethopt(), through paths, with CFGF_NOCASE, and while options are
+ * appended by the parser for CFGF_KEYSTRVAL sections.
+ */
+
+static cfg_opt_t wide_opts[] = {
+	CFG_INT("o0", 0, CFGF_NONE),
+	CFG_INT("o1", 1, CFGF_NONE),
+	CFG_INT("o2", 2, CFGF_NONE),
+	CFG_INT("o3", 3, CFGF_NONE),
+	CFG_INT("o4", 4, CFGF_NONE),
+	CFG_INT("o5", 5, CFGF_NONE),
+	CFG_INT("o6", 6, CFGF_NONE),
+	CFG_INT("o7", 7, CFGF_NONE),
+	CFG_INT("o8", 8, CFGF_NONE),
+	CFG_INT("o9", 9, CFGF_NONE),
+	CFG_STR("MixedCase", "mc", CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_SEC("wide", wide_opts, CFGF_NONE),
+	CFG_SEC("env", NULL, CFGF_KEYSTRVAL),
+	CFG_INT("narrow", 42, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t *hopt(cfg_t *cfg, const char *name)
+{
+	return cfg_gethopt(cfg, name, strlen(name), cfg_hash(name, strlen(name)));
+}
+
+int main(void)
+{
+	char buf[256];
+	cfg_t *cfg, *wide, *env;
+	cfg_opt_t *opt;
+	int i;
+
+	/* FNV-1a test vector, and folding of ASCII case only */
+	fail_unless(cfg_hash("abc", 3) == 0x1a47e90b);
+	fail_unless(cfg_hash("ABC", 3) == 0x1a47e90b);
+	fail_unless(cfg_hash("", 0) == 2166136261u);
+	fail_unless(cfg_hash("abcd", 3) == 0x1a47e90b);
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+	wide = cfg_getsec(cfg, "wide");
+	fail_unless(wide != NULL);
+
+	for (i = 0; i < 10; i++) {
+		snprintf(buf, sizeof(buf), "o%d", i);
+		opt = hopt(wide, buf);
+		fail_unless(opt != NULL);
+		fail_unless(opt == cfg_getopt(wide, buf));
+		fail_unless(cfg_opt_getnint(opt, 0) == i);
+	}
+	fail_unless(cfg_getint(cfg, "wide|o9") == 9);
+	fail_unless(hopt(wide, "o10") == NULL);
+	fail_unless(hopt(wide, "mixedcase") == NULL);
+	fail_unless(hopt(wide, "MixedCase") != NULL);
+
+	/* Name need not be NUL terminated */
+	opt = cfg_gethopt(wide, "o3 trailing", 2, cfg_hash("o3", 2));
+	fail_unless(opt != NULL && cfg_opt_getnint(opt, 0) == 3);
+
+	/* Small sections are scanned, the hash is not needed to match */
+	opt = cfg_gethopt(cfg, "narrow", 6, 0);
+	fail_unless(opt != NULL && cfg_opt_getnint(opt, 0) == 42);
+
+	fail_unless(cfg_gethopt(NULL, "narrow", 6, 0) == NULL);
+
+	/* Many options appended by the parser, the table grows as they come */
+	fail_unless(cfg_parse_buf(cfg, "env { k0 = v0 k1 = v1 k2 = v2 k3 = v3 k4 = v4 k5 = v5 k6 = v6 k7 = v7 k8 = v8 k9 = v9 k10 = v10 k11 = v11 k12 = v12 k13 = v13 k14 = v14 k15 = v15 k16 = v16 k17 = v17 k18 = v18 k19 = v19 }") == CFG_SUCCESS);
+	env = cfg_getsec(cfg, "env");
+	fail_unless(env != NULL);
+	fail_unless(cfg_num(env) == 20);
+	for (i = 0; i < 20; i++) {
+		char val[16];
+
+		snprintf(buf, sizeof(buf), "k%d", i);
+		snprintf(val, sizeof(val), "v%d", i);
+		opt = hopt(env, buf);
+		fail_unless(opt != NULL);
+		fail_unless(strcmp(cfg_opt_getnstr(opt, 0), val) == 0);
+	}
+	cfg_free(cfg);
+
+	/* Case insensitive configurations match any case */
+	cfg = cfg_init(opts, CFGF_NOCASE);
+	fail_unless(cfg != NULL);
+	wide = cfg_getsec(cfg, "WIDE");
+	fail_unless(wide != NULL);
+	fail_unless(hopt(wide, "mixedcase") != NULL);
+	fail_unless(hopt(wide, "MIXEDCASE") == hopt(wide, "MixedCase"));
+	fail_unless(strcmp(cfg_getstr(cfg, "Wide|mixedCASE"), "mc") == 0);
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
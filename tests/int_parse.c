@@ -0,0 +1,144 @@
+#include "check_confuse.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Integer parsing in cfg_setopt(): all radixes with sign, the exact
+ * limits of each type, malformed input, and lists set in one batch.
+ */
+
+static cfg_opt_t opts[] = {
+	CFG_INT   ("int", 0, CFGF_NONE),
+	CFG_INT8  ("i8",  0, CFGF_NONE),
+	CFG_INT16 ("i16", 0, CFGF_NONE),
+	CFG_INT32 ("i32", 0, CFGF_NONE),
+	CFG_INT64 ("i64", 0, CFGF_NONE),
+	CFG_UINT8 ("u8",  0, CFGF_NONE),
+	CFG_UINT16("u16", 0, CFGF_NONE),
+	CFG_UINT32("u32", 0, CFGF_NONE),
+	CFG_UINT64("u64", 0, CFGF_NONE),
+	CFG_INT_LIST("list", 0, CFGF_NONE),
+	CFG_END()
+};
+
+static int parse(cfg_t *cfg, const char *name, const char *value)
+{
+	char buf[128];
+
+	snprintf(buf, sizeof(buf), "%s = %s", name, value);
+	return cfg_parse_buf(cfg, buf);
+}
+
+#define ok(name, value)  fail_unless(parse(cfg, name, value) == CFG_SUCCESS)
+#define bad(name, value) fail_unless(parse(cfg, name, value) == CFG_PARSE_ERROR)
+
+int main(void)
+{
+	char *values[1000], buf[16];
+	cfg_t *cfg;
+	int i;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg);
+
+	ok("int", "12345");
+	fail_unless(cfg_getint(cfg, "int") == 12345);
+	ok("int", "-0x7f");
+	fail_unless(cfg_getint(cfg, "int") == -127);
+	ok("int", "0X1F");
+	fail_unless(cfg_getint(cfg, "int") == 31);
+	ok("int", "0755");
+	fail_unless(cfg_getint(cfg, "int") == 493);
+	ok("int", "0b1010");
+	fail_unless(cfg_getint(cfg, "int") == 10);
+	ok("int", "-0b11");
+	fail_unless(cfg_getint(cfg, "int") == -3);
+	ok("int", "+7");
+	fail_unless(cfg_getint(cfg, "int") == 7);
+	ok("int", "0");
+	fail_unless(cfg_getint(cfg, "int") == 0);
+	bad("int", "0x");
+	bad("int", "0b");
+	bad("int", "08");
+	bad("int", "0b2");
+	bad("int", "12a");
+	bad("int", "-");
+	bad("int", "0xfg");
+
+	ok("i8", "127");
+	ok("i8", "-128");
+	fail_unless(cfg_getint8(cfg, "i8") == INT8_MIN);
+	bad("i8", "128");
+	bad("i8", "-129");
+	ok("i8", "-0x80");
+	bad("i8", "0x80");
+
+	ok("i16", "32767");
+	ok("i16", "-32768");
+	bad("i16", "32768");
+	bad("i16", "-32769");
+
+	ok("i32", "2147483647");
+	ok("i32", "-2147483648");
+	fail_unless(cfg_getint32(cfg, "i32") == INT32_MIN);
+	bad("i32", "2147483648");
+	bad("i32", "-2147483649");
+
+	ok("i64", "9223372036854775807");
+	ok("i64", "-9223372036854775808");
+	fail_unless(cfg_getint64(cfg, "i64") == INT64_MIN);
+	bad("i64", "9223372036854775808");
+	bad("i64", "-9223372036854775809");
+	bad("i64", "99999999999999999999999");
+
+	ok("u8", "255");
+	bad("u8", "256");
+	bad("u8", "-1");
+	ok("u16", "0xffff");
+	bad("u16", "0x10000");
+	ok("u32", "4294967295");
+	bad("u32", "4294967296");
+	ok("u64", "18446744073709551615");
+	fail_unless(cfg_getuint64(cfg, "u64") == UINT64_MAX);
+	ok("u64", "0xffffffffffffffff");
+	bad("u64", "18446744073709551616");
+	bad("u64", "0x10000000000000000");
+	bad("u64", "-0");
+
+	/* Numeric lists, in one batch and from the parser */
+	for (i = 0; i < 1000; i++) {
+		snprintf(buf, sizeof(buf), i % 2 ? "%d" : "0x%x", i * 3);
+		values[i] = strdup(buf);
+		fail_unless(values[i]);
+	}
+	fail_unless(cfg_setmulti(cfg, "list", 1000, values) == CFG_SUCCESS);
+	fail_unless(cfg_size(cfg, "list") == 1000);
+	for (i = 0; i < 1000; i++)
+		fail_unless(cfg_getnint(cfg, "list", i) == i * 3);
+
+	/* A bad value anywhere leaves the old list in place */
+	strcpy(values[999], "x");
+	fail_unless(cfg_setmulti(cfg, "list", 1000, values) == CFG_FAIL);
+	fail_unless(cfg_size(cfg, "list") == 1000);
+	fail_unless(cfg_getnint(cfg, "list", 999) == 2997);
+	for (i = 0; i < 1000; i++)
+		free(values[i]);
+
+	ok("list", "{1, -0x2, 0b11, 04}");
+	fail_unless(cfg_size(cfg, "list") == 4);
+	fail_unless(cfg_getnint(cfg, "list", 1) == -2);
+	fail_unless(cfg_getnint(cfg, "list", 3) == 4);
+	bad("list", "{1, 2, three}");
+
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,123 @@
+#include "check_confuse.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * CFGF_INTERN: equal strings anywhere in the tree share one allocation,
+ * counted by cfg_intern_stats(), and released with the last user.
+ */
+
+static cfg_opt_t host_opts[] = {
+	CFG_STR("region", "eu-west", CFGF_NONE),
+	CFG_STR("state", "enabled", CFGF_NONE),
+	CFG_STR_LIST("tags", NULL, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_STR("state", "enabled", CFGF_NONE),
+	CFG_SEC("host", host_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+static const char *conf =
+	"host a { tags = {web, eu-west} }\n"
+	"host b { tags = {web} state = disabled }\n"
+	"host c { region = \"x\\x00y\" }\n"
+	"host d { region = \"x\\x00z\" }\n"
+	"host eu-west {}\n";
+
+int main(void)
+{
+	cfg_intern_stats_t st;
+	cfg_t *cfg, *a, *b, *c, *d;
+	size_t len;
+
+	/* Without the flag nothing is shared */
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_parse_buf(cfg, conf) == CFG_SUCCESS);
+	fail_unless(cfg_intern_stats(cfg, &st) == CFG_SUCCESS);
+	fail_unless(st.strings == 0 && st.refs == 0 && st.saved == 0);
+	a = cfg_getnsec(cfg, "host", 0);
+	b = cfg_getnsec(cfg, "host", 1);
+	fail_unless(cfg_getstr(a, "region") != cfg_getstr(b, "region"));
+	cfg_free(cfg);
+
+	cfg = cfg_init(opts, CFGF_INTERN);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_intern_stats(cfg, &st) == CFG_SUCCESS);
+	fail_unless(st.strings == 1 && st.refs == 1 && st.saved == 0);
+	fail_unless(cfg_parse_buf(cfg, conf) == CFG_SUCCESS);
+
+	a = cfg_gettsec(cfg, "host", "a");
+	b = cfg_gettsec(cfg, "host", "b");
+	c = cfg_gettsec(cfg, "host", "c");
+	d = cfg_gettsec(cfg, "host", "d");
+
+	/* Equal values, titles and list items are the same string */
+	fail_unless(cfg_getstr(a, "region") == cfg_getstr(b, "region"));
+	fail_unless(cfg_getstr(a, "state") == cfg_getstr(cfg, "state"));
+	fail_unless(cfg_getnstr(a, "tags", 0) == cfg_getnstr(b, "tags", 0));
+	fail_unless(cfg_getnstr(a, "tags", 1) == cfg_getstr(a, "region"));
+	fail_unless(cfg_title(cfg_gettsec(cfg, "host", "eu-west")) == cfg_getstr(a, "region"));
+	fail_unless(cfg_getstr(b, "state") != cfg_getstr(a, "state"));
+
+	/* Compared over the whole length */
+	fail_unless(cfg_getstr(c, "region") != cfg_getstr(d, "region"));
+	fail_unless(cfg_getstr_len(c, "region", &len) != NULL && len == 3);
+
+	/*
+	 * Distinct: enabled, eu-west, web, disabled, x\0y, x\0z, and the
+	 * titles a, b, c, d.  Used: enabled 5 times, eu-west 5 times (three
+	 * regions, a tag and a title), web twice.
+	 */
+	fail_unless(cfg_intern_stats(a, &st) == CFG_SUCCESS);
+	fail_unless(st.strings == 10);
+	fail_unless(st.refs == 5 + 5 + 2 + 1 + 1 + 1 + 4);
+	fail_unless(st.bytes == 8 + 8 + 4 + 9 + 4 + 4 + 4 * 2);
+	fail_unless(st.saved == 4 * 8 + 4 * 8 + 1 * 4);
+
+	/* Setting values moves references */
+	fail_unless(cfg_setstr(a, "state", "disabled") == CFG_SUCCESS);
+	fail_unless(cfg_getstr(a, "state") == cfg_getstr(b, "state"));
+	fail_unless(cfg_setstr_take(c, "state", strdup("disabled")) == CFG_SUCCESS);
+	fail_unless(cfg_getstr(c, "state") == cfg_getstr(b, "state"));
+	fail_unless(cfg_setstr_take(d, "region", strdup("x")) == CFG_SUCCESS);
+	fail_unless(cfg_intern_stats(cfg, &st) == CFG_SUCCESS);
+	fail_unless(st.strings == 10);
+	fail_unless(st.saved == 2 * 8 + 4 * 8 + 1 * 4 + 2 * 9);
+
+	/* Removing a section releases its strings */
+	fail_unless(cfg_rmtsec(cfg, "host", "c") == CFG_SUCCESS);
+	fail_unless(cfg_intern_stats(cfg, &st) == CFG_SUCCESS);
+	fail_unless(st.strings == 8);
+	fail_unless(st.saved == 2 * 8 + 4 * 8 + 1 * 4 + 1 * 9);
+
+	cfg_free(cfg);
+
+	/* With CFGF_LAZY, strings left at their default are not shared */
+	cfg = cfg_init(opts, CFGF_INTERN | CFGF_LAZY);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_parse_buf(cfg, conf) == CFG_SUCCESS);
+	a = cfg_gettsec(cfg, "host", "a");
+	b = cfg_gettsec(cfg, "host", "b");
+	fail_unless(cfg_getstr(a, "region") != cfg_getstr(b, "region"));
+	fail_unless(strcmp(cfg_getstr(a, "region"), cfg_getstr(b, "region")) == 0);
+	fail_unless(cfg_getstr(a, "state") != cfg_getstr(cfg, "state"));
+	fail_unless(cfg_getnstr(a, "tags", 1) != cfg_getstr(a, "region"));
+	fail_unless(cfg_setstr(a, "region", "eu-west") == CFG_SUCCESS);
+	fail_unless(cfg_getnstr(a, "tags", 1) == cfg_getstr(a, "region"));
+	cfg_free(cfg);
+
+	fail_unless(cfg_intern_stats(NULL, &st) == CFG_FAIL);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
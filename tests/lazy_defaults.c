@@ -0,0 +1,155 @@
+#include "check_confuse.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * CFGF_LAZY: defaults are read from the schema until the option is
+ * set, lists and sections are set when first used, with the same
+ * values, output, fingerprint and CFGF_MODIFIED as without it.
+ */
+
+static cfg_opt_t inner_opts[] = {
+	CFG_INT("depth", 2, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t sub_opts[] = {
+	CFG_STR("mode", "auto", CFGF_NONE),
+	CFG_SEC("inner", inner_opts, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t node_opts[] = {
+	CFG_INT("port", 80, CFGF_NONE),
+	CFG_STR_LIST("tags", "{web, eu}", CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_STR("name", "none", CFGF_NONE),
+	CFG_FLOAT("ratio", 0.5, CFGF_NONE),
+	CFG_BOOL("debug", cfg_false, CFGF_NONE),
+	CFG_INT_LIST("ports", "{1, 2}", CFGF_NONE),
+	CFG_STR_LIST("empty", NULL, CFGF_NONE),
+	CFG_SEC("sub", sub_opts, CFGF_NONE),
+	CFG_SEC("node", node_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+static const char *conf = "name = x ports += {3} node a { port = 8080 } node b {}";
+
+static cfg_t *init(int flags)
+{
+	cfg_t *cfg;
+
+	cfg = cfg_init(opts, flags);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_parse_buf(cfg, conf) == CFG_SUCCESS);
+
+	return cfg;
+}
+
+static int count(void *arg, cfg_diff_kind_t kind, const char *path,
+		 cfg_opt_t *oldopt, cfg_opt_t *newopt, cfg_t *oldsec, cfg_t *newsec)
+{
+	(*(int *)arg)++;
+	return 0;
+}
+
+static char *print(cfg_t *cfg)
+{
+	char *buf;
+	size_t len;
+
+	fail_unless(cfg_print_to_buffer(cfg, &buf, &len) == CFG_SUCCESS);
+
+	return buf;
+}
+
+int main(void)
+{
+	cfg_fingerprint_t fp1, fp2;
+	cfg_memory_stats_t st1, st2;
+	cfg_t *eager, *lazy;
+	char *out1, *out2;
+	cfg_opt_t *opt;
+	double ratio;
+	int diffs = 0;
+
+	eager = init(CFGF_NONE);
+	lazy = init(CFGF_LAZY);
+
+	/* Sections and defaults nobody used are not there yet */
+	fail_unless(cfg_memory_stats(eager, &st1) == CFG_SUCCESS);
+	fail_unless(cfg_memory_stats(lazy, &st2) == CFG_SUCCESS);
+	fail_unless(st2.total.bytes < st1.total.bytes);
+	fail_unless(st2.total.allocs < st1.total.allocs);
+
+	/* Plain defaults are read, nothing is set for them */
+	fail_unless(cfg_memory_stats(lazy, &st1) == CFG_SUCCESS);
+	fail_unless(cfg_getfloat(lazy, "ratio") == 0.5);
+	fail_unless(cfg_trygetfloat(lazy, "ratio", &ratio) == CFG_SUCCESS && ratio == 0.5);
+	fail_unless(cfg_exists(lazy, "debug") && cfg_size(lazy, "debug") == 1);
+	fail_unless(cfg_memory_stats(lazy, &st2) == CFG_SUCCESS);
+	fail_unless(st1.total.allocs == st2.total.allocs);
+	fail_unless(cfg_getopt(lazy, "ratio")->nvalues == 0);
+
+	/* Lists and sections are set on first use, and not modified */
+	fail_unless(strcmp(cfg_getstr(lazy, "name"), "x") == 0);
+	fail_unless(cfg_getfloat(lazy, "ratio") == 0.5);
+	fail_unless(cfg_size(lazy, "ports") == 3 && cfg_getnint(lazy, "ports", 2) == 3);
+	fail_unless(cfg_size(lazy, "empty") == 0);
+	fail_unless(cfg_getint(lazy, "sub|inner|depth") == 2);
+	fail_unless(strcmp(cfg_getnstr(lazy, "node=b|tags", 1), "eu") == 0);
+	opt = cfg_getopt(lazy, "debug");
+	fail_unless(opt && !(opt->flags & CFGF_MODIFIED) && cfg_opt_getnbool(opt, 0) == cfg_false);
+
+	/* Options reached without a lookup */
+	opt = &cfg_getsec(lazy, "sub")->opts[0];
+	fail_unless(cfg_opt_size(opt) == 1 && strcmp(cfg_opt_getnstr(opt, 0), "auto") == 0);
+	opt = &cfg_gettsec(lazy, "node", "a")->opts[1];
+	fail_unless(cfg_free_value(opt) == CFG_SUCCESS && cfg_size(lazy, "node=a|tags") == 0);
+	cfg_free(lazy);
+
+	/* The same output, fingerprint and no differences, whatever was used */
+	lazy = init(CFGF_LAZY);
+	fail_unless(cfg_setint(lazy, "sub|inner|depth", 3) == CFG_SUCCESS);
+	fail_unless(cfg_setint(eager, "sub|inner|depth", 3) == CFG_SUCCESS);
+	fp1 = cfg_fingerprint(eager);
+	fp2 = cfg_fingerprint(lazy);
+	fail_unless(memcmp(&fp1, &fp2, sizeof(fp1)) == 0);
+	fail_unless(cfg_diff(eager, lazy, count, &diffs) == CFG_SUCCESS && diffs == 0);
+
+	out1 = print(eager);
+	out2 = print(lazy);
+	fail_unless(strcmp(out1, out2) == 0);
+	free(out1);
+	free(out2);
+	cfg_free(lazy);
+
+	/* Freezing sets lists and sections only, after that reads change nothing */
+	lazy = init(CFGF_LAZY);
+	fail_unless(cfg_freeze(lazy) == CFG_SUCCESS);
+	fail_unless(cfg_memory_stats(eager, &st2) == CFG_SUCCESS);
+	fail_unless(cfg_memory_stats(lazy, &st1) == CFG_SUCCESS);
+	fail_unless(st1.total.allocs < st2.total.allocs);
+	fail_unless(cfg_getint(lazy, "sub|inner|depth") == 2);
+	fail_unless(strcmp(cfg_getstr(lazy, "sub|mode"), "auto") == 0);
+	fail_unless(cfg_trygetfloat(lazy, "ratio", &ratio) == CFG_SUCCESS && ratio == 0.5);
+	fail_unless(cfg_exists(lazy, "node=b|port") && cfg_size(lazy, "node=b|tags") == 2);
+	out1 = print(lazy);
+	free(out1);
+	fail_unless(cfg_memory_stats(lazy, &st2) == CFG_SUCCESS);
+	fail_unless(st1.total.bytes == st2.total.bytes);
+	cfg_free(lazy);
+	cfg_free(eager);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
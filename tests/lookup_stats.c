@@ -0,0 +1,179 @@
+#include "check_confuse.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * CFGF_STATS: lookups by name and reads with getters counted per
+ * option, unknown names per section, and the dump of both.
+ */
+
+static cfg_opt_t backend_opts[] = {
+	CFG_INT("port", 80, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_INT("port", 8080, CFGF_NONE),
+	CFG_STR("name", NULL, CFGF_NONE),
+	CFG_INT_LIST("ports", "{1, 2}", CFGF_NONE),
+	CFG_SEC("backend", backend_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+static int collect(void *arg, const char *buf, size_t len)
+{
+	char **out = arg;
+	size_t pos = *out ? strlen(*out) : 0;
+
+	*out = realloc(*out, pos + len + 1);
+	fail_unless(*out);
+	memcpy(*out + pos, buf, len);
+	(*out)[pos + len] = 0;
+
+	return 0;
+}
+
+static char *dump(cfg_t *cfg, cfg_stats_format_t format)
+{
+	char *out = NULL;
+
+	fail_unless(cfg_stats_dump_cb(cfg, format, collect, &out) == CFG_SUCCESS);
+
+	return out ? out : strdup("");
+}
+
+int main(void)
+{
+	cfg_memory_stats_t before, after;
+	cfg_opt_stats_t st;
+	cfg_t *cfg, *db;
+	const char *head;
+	char *text, *json, *out = NULL;
+	int i;
+
+	cfg = cfg_init(opts, CFGF_STATS);
+	fail_unless(cfg != NULL);
+
+	/* Parsing is not counted */
+	fail_unless(cfg_parse_buf(cfg, "port = 1 backend db { port = 5432 } backend 'a|b' {}") == CFG_SUCCESS);
+	fail_unless(cfg_opt_stats(cfg_getnopt(cfg, 0), &st) == CFG_SUCCESS);
+	fail_unless(st.lookups == 0 && st.reads == 0);
+
+	for (i = 0; i < 3; i++)
+		fail_unless(cfg_getint(cfg, "port") == 1);
+	fail_unless(cfg_opt_stats(cfg_getopt(cfg, "port"), &st) == CFG_SUCCESS);
+	fail_unless(st.lookups == 4 && st.reads == 3);
+	fail_unless(st.misses == 0 && st.errors == 0);
+
+	/* Reads without a value, or with a getter of the wrong type */
+	fail_unless(cfg_getnint(cfg, "ports", 5) == 0);
+	fail_unless(cfg_getstr(cfg, "name") == NULL);
+	fail_unless(cfg_getstr(cfg, "port") == NULL);
+	fail_unless(cfg_opt_stats(cfg_getopt(cfg, "ports"), &st) == CFG_SUCCESS);
+	fail_unless(st.reads == 1 && st.misses == 1);
+	fail_unless(cfg_opt_stats(cfg_getopt(cfg, "name"), &st) == CFG_SUCCESS);
+	fail_unless(st.reads == 1 && st.misses == 1);
+	fail_unless(cfg_opt_stats(cfg_getopt(cfg, "port"), &st) == CFG_SUCCESS);
+	fail_unless(st.lookups == 6 && st.reads == 4 && st.errors == 1);
+
+	/* Lookups through sections count in the section they end up in */
+	db = cfg_gettsec(cfg, "backend", "db");
+	fail_unless(cfg_getint(cfg, "backend=db|port") == 5432);
+	fail_unless(cfg_getint(db, "port") == 5432);
+	fail_unless(cfg_opt_stats(cfg_getnopt(db, 0), &st) == CFG_SUCCESS);
+	fail_unless(st.lookups == 2 && st.reads == 2);
+	fail_unless(cfg_getint(cfg_gettsec(cfg, "backend", "a|b"), "port") == 80);
+	fail_unless(cfg_getint(cfg, "nonexistent") == 0);
+	fail_unless(cfg_exists(cfg, "nonexistent") == cfg_false);
+	fail_unless(cfg_getint(cfg, "backend=db|prot") == 0);
+
+	/* Printing reads every value without counting */
+	text = dump(cfg, CFG_STATS_TEXT);
+	fail_unless(cfg_print_cb(cfg, collect, &out) == CFG_SUCCESS);
+	free(out);
+	json = dump(cfg, CFG_STATS_TEXT);
+	fail_unless(strcmp(text, json) == 0);
+	free(json);
+
+	/* Most used first, unknown names last */
+	head = "port lookups=6 reads=4 misses=0 errors=1 nsec=";
+	fail_unless(strncmp(text, head, strlen(head)) == 0);
+	fail_unless(strstr(text, "\nbackend=db|port lookups=2 reads=2 misses=0 errors=0 nsec=") != NULL);
+	fail_unless(strstr(text, "\nbackend='a|b'|port lookups=1 reads=1 ") != NULL);
+	fail_unless(strstr(text, "\nname lookups=2 reads=1 misses=1 errors=0 ") != NULL);
+	fail_unless(strstr(text, "ports lookups=2 reads=1 misses=1 ") != NULL);
+	fail_unless(strstr(text, "\nnonexistent unknown=2\n") != NULL);
+	fail_unless(strstr(text, "\nbackend=db|prot unknown=1\n") != NULL);
+	fail_unless(strstr(text, "nonexistent") > strstr(text, "ports"));
+	free(text);
+
+	json = dump(cfg, CFG_STATS_JSON);
+	head = "{\"options\":[{\"path\":\"port\",\"lookups\":6,\"reads\":4,\"misses\":0,\"errors\":1,\"nsec\":";
+	fail_unless(strncmp(json, head, strlen(head)) == 0);
+	fail_unless(strstr(json, "{\"path\":\"backend='a|b'|port\",\"lookups\":1,") != NULL);
+	fail_unless(strstr(json, "],\"unknown\":[{\"path\":\"nonexistent\",\"lookups\":2},"
+			   "{\"path\":\"backend=db|prot\",\"lookups\":1}]}\n") != NULL);
+	free(json);
+
+	/* Reset clears the counters and unknown names of all sections */
+	fail_unless(cfg_stats_reset(cfg) == CFG_SUCCESS);
+	fail_unless(cfg_opt_stats(cfg_getnopt(db, 0), &st) == CFG_SUCCESS);
+	fail_unless(st.lookups == 0 && st.reads == 0 && st.nsec == 0);
+	text = dump(cfg, CFG_STATS_TEXT);
+	fail_unless(strcmp(text, "") == 0);
+	free(text);
+	json = dump(cfg, CFG_STATS_JSON);
+	fail_unless(strcmp(json, "{\"options\":[],\"unknown\":[]}\n") == 0);
+	free(json);
+
+	fail_unless(cfg_getint(cfg, "nonexistent") == 0);
+	json = dump(cfg, CFG_STATS_JSON);
+	fail_unless(strcmp(json, "{\"options\":[],\"unknown\":[{\"path\":\"nonexistent\",\"lookups\":1}]}\n") == 0);
+	free(json);
+
+	/* A frozen tree only counts the unknown names it already has */
+	fail_unless(cfg_freeze(cfg) == CFG_SUCCESS);
+	fail_unless(cfg_memory_stats(cfg, &before) == CFG_SUCCESS);
+	fail_unless(cfg_getint(cfg, "nonexistent") == 0);
+	fail_unless(cfg_getint(cfg, "missing") == 0);
+	fail_unless(cfg_getint(cfg, "backend=db|missing") == 0);
+	fail_unless(cfg_memory_stats(cfg, &after) == CFG_SUCCESS);
+	fail_unless(before.total.allocs == after.total.allocs && before.total.bytes == after.total.bytes);
+	json = dump(cfg, CFG_STATS_JSON);
+	fail_unless(strcmp(json, "{\"options\":[],\"unknown\":[{\"path\":\"nonexistent\",\"lookups\":2}]}\n") == 0);
+	free(json);
+	fail_unless(cfg_stats_reset(cfg) == CFG_SUCCESS);
+	json = dump(cfg, CFG_STATS_JSON);
+	fail_unless(strcmp(json, "{\"options\":[],\"unknown\":[]}\n") == 0);
+	free(json);
+	fail_unless(cfg_getint(cfg, "nonexistent") == 0);
+	json = dump(cfg, CFG_STATS_JSON);
+	fail_unless(strcmp(json, "{\"options\":[],\"unknown\":[{\"path\":\"nonexistent\",\"lookups\":1}]}\n") == 0);
+	free(json);
+	cfg_free(cfg);
+
+	/* Without the flag nothing is counted */
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_getint(cfg, "port") == 8080);
+	fail_unless(cfg_opt_stats(cfg_getopt(cfg, "port"), &st) == CFG_SUCCESS);
+	fail_unless(st.lookups == 0 && st.reads == 0);
+	json = dump(cfg, CFG_STATS_JSON);
+	fail_unless(strcmp(json, "{\"options\":[],\"unknown\":[]}\n") == 0);
+	free(json);
+
+	fail_unless(cfg_stats_dump(cfg, stdout, 2) == CFG_FAIL);
+	fail_unless(cfg_stats_dump(NULL, stdout, CFG_STATS_TEXT) == CFG_FAIL);
+	fail_unless(cfg_opt_stats(NULL, &st) == CFG_FAIL);
+	fail_unless(cfg_stats_reset(NULL) == CFG_FAIL);
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
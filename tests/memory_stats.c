@@ -0,0 +1,172 @@
+#include "check_confuse.h"
+#include <string.h>
+
+/*
+ * cfg_memory_stats(): memory counted by category as it is allocated,
+ * per section type and for the whole tree.
+ */
+
+static cfg_opt_t host_opts[] = {
+	CFG_STR("region", "eu-west", CFGF_NONE),
+	CFG_INT("port", 80, CFGF_NONE),
+	CFG_STR_LIST("tags", NULL, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_SEC("host", host_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+/* The memory of one host section without tags, titled a */
+static void host_a(cfg_memory_stats_t *st)
+{
+	memset(st, 0, sizeof(*st));
+	st->category[CFG_MEMORY_SECTIONS].bytes  = sizeof(cfg_t) + sizeof("host") + sizeof("[buf]");
+	st->category[CFG_MEMORY_SECTIONS].allocs = 3;
+	st->category[CFG_MEMORY_OPTIONS].bytes   = 4 * sizeof(cfg_opt_t) + sizeof("region") +
+		sizeof("port") + sizeof("tags") + sizeof("eu-west");
+	st->category[CFG_MEMORY_OPTIONS].allocs  = 5;
+	st->category[CFG_MEMORY_VALUES].bytes    = sizeof(cfg_value_t) + sizeof(size_t) +
+		sizeof(cfg_value_t) + 2 * sizeof(cfg_value_t *);
+	st->category[CFG_MEMORY_VALUES].allocs   = 4;
+	st->category[CFG_MEMORY_STRINGS].bytes   = sizeof("eu-west");
+	st->category[CFG_MEMORY_STRINGS].allocs  = 1;
+	st->category[CFG_MEMORY_TITLES].bytes    = sizeof("a");
+	st->category[CFG_MEMORY_TITLES].allocs   = 1;
+	st->total.bytes  = st->category[CFG_MEMORY_SECTIONS].bytes + st->category[CFG_MEMORY_OPTIONS].bytes +
+		st->category[CFG_MEMORY_VALUES].bytes + st->category[CFG_MEMORY_STRINGS].bytes +
+		st->category[CFG_MEMORY_TITLES].bytes;
+	st->total.allocs = 3 + 5 + 4 + 1 + 1;
+}
+
+static int stats_eq(cfg_memory_stats_t *a, cfg_memory_stats_t *b)
+{
+	return !memcmp(a, b, sizeof(*a));
+}
+
+/* Sum of the categories, and of all section types */
+static void check_sums(cfg_t *cfg)
+{
+	static const char *types[] = { "root", "host" };
+	cfg_memory_stats_t tree, st;
+	size_t bytes = 0, allocs = 0;
+	unsigned int i;
+
+	fail_unless(cfg_memory_stats(cfg, &tree) == CFG_SUCCESS);
+	for (i = 0; i < CFG_MEMORY_CATEGORIES; i++) {
+		bytes += tree.category[i].bytes;
+		allocs += tree.category[i].allocs;
+	}
+	fail_unless(bytes == tree.total.bytes && allocs == tree.total.allocs);
+
+	bytes = allocs = 0;
+	for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+		fail_unless(cfg_memory_stats_type(cfg, types[i], &st) == CFG_SUCCESS);
+		bytes += st.total.bytes;
+		allocs += st.total.allocs;
+	}
+	fail_unless(bytes == tree.total.bytes && allocs == tree.total.allocs);
+}
+
+int main(void)
+{
+	cfg_memory_stats_t st, root, expect;
+	cfg_t *cfg, *a;
+	char name[8];
+	int i;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+
+	/* A new tree is the root section and its options */
+	fail_unless(cfg_memory_stats(cfg, &st) == CFG_SUCCESS);
+	fail_unless(st.category[CFG_MEMORY_SECTIONS].bytes == sizeof(cfg_t) + sizeof("root"));
+	fail_unless(st.category[CFG_MEMORY_SECTIONS].allocs == 2);
+	fail_unless(st.category[CFG_MEMORY_VALUES].allocs == 0);
+	fail_unless(st.category[CFG_MEMORY_TITLES].allocs == 0);
+	fail_unless(cfg_memory_stats_type(cfg, "root", &root) == CFG_SUCCESS);
+	fail_unless(stats_eq(&st, &root));
+	fail_unless(cfg_memory_stats_type(cfg, "host", &st) == CFG_SUCCESS);
+	fail_unless(st.total.bytes == 0 && st.total.allocs == 0);
+
+	fail_unless(cfg_parse_buf(cfg, "host a {}") == CFG_SUCCESS);
+	host_a(&expect);
+	fail_unless(cfg_memory_stats_type(cfg, "host", &st) == CFG_SUCCESS);
+	fail_unless(stats_eq(&st, &expect));
+	check_sums(cfg);
+
+	/* List values, and the array of them grown in powers of two */
+	a = cfg_gettsec(cfg, "host", "a");
+	fail_unless(cfg_parse_buf(a, "tags = {x, yy, z}") == CFG_SUCCESS);
+	fail_unless(cfg_memory_stats_type(cfg, "host", &st) == CFG_SUCCESS);
+	fail_unless(st.category[CFG_MEMORY_STRINGS].bytes == expect.category[CFG_MEMORY_STRINGS].bytes + 2 + 3 + 2);
+	fail_unless(st.category[CFG_MEMORY_VALUES].bytes == expect.category[CFG_MEMORY_VALUES].bytes +
+		    3 * (sizeof(cfg_value_t) + sizeof(size_t)) + 4 * sizeof(cfg_value_t *));
+	fail_unless(st.category[CFG_MEMORY_VALUES].allocs == expect.category[CFG_MEMORY_VALUES].allocs + 4);
+	fail_unless(cfg_setnstr(a, "tags", NULL, 1) == CFG_SUCCESS);
+	fail_unless(cfg_memory_stats_type(cfg, "host", &st) == CFG_SUCCESS);
+	fail_unless(st.category[CFG_MEMORY_STRINGS].bytes == expect.category[CFG_MEMORY_STRINGS].bytes + 2 + 2);
+	fail_unless(cfg_free_value(cfg_getopt(a, "tags")) == CFG_SUCCESS);
+
+	/* Comments */
+	fail_unless(cfg_setcomment(a, "port", "http") == CFG_SUCCESS);
+	fail_unless(cfg_setcomment(a, "port", "https") == CFG_SUCCESS);
+	fail_unless(cfg_memory_stats_type(cfg, "host", &st) == CFG_SUCCESS);
+	fail_unless(st.category[CFG_MEMORY_COMMENTS].bytes == sizeof("https"));
+	fail_unless(st.category[CFG_MEMORY_COMMENTS].allocs == 1);
+	expect.category[CFG_MEMORY_COMMENTS].bytes = sizeof("https");
+	expect.category[CFG_MEMORY_COMMENTS].allocs = 1;
+	expect.total.bytes += sizeof("https");
+	expect.total.allocs++;
+	fail_unless(stats_eq(&st, &expect));
+
+	/* More sections, then removing them returns to the same numbers */
+	fail_unless(cfg_memory_stats(cfg, &root) == CFG_SUCCESS);
+	for (i = 0; i < 20; i++) {
+		snprintf(name, sizeof(name), "h%d", i);
+		fail_unless(cfg_addtsec(cfg, "host", name) != NULL);
+	}
+	fail_unless(cfg_memory_stats_type(cfg, "host", &st) == CFG_SUCCESS);
+	fail_unless(st.category[CFG_MEMORY_SECTIONS].allocs == 21 * 3);
+	check_sums(cfg);
+	for (i = 19; i >= 0; i--) {
+		snprintf(name, sizeof(name), "h%d", i);
+		fail_unless(cfg_rmtsec(cfg, "host", name) == CFG_SUCCESS);
+	}
+	fail_unless(cfg_memory_stats(cfg, &st) == CFG_SUCCESS);
+	fail_unless(stats_eq(&st, &root));
+
+	/* Search paths */
+	fail_unless(cfg_add_searchpath(cfg, "/tmp") == CFG_SUCCESS);
+	fail_unless(cfg_memory_stats_type(cfg, "root", &st) == CFG_SUCCESS);
+	fail_unless(st.category[CFG_MEMORY_PATHS].allocs == 2);
+	fail_unless(st.category[CFG_MEMORY_PATHS].bytes > sizeof("/tmp"));
+
+	check_sums(cfg);
+	cfg_free(cfg);
+
+	/* Shared strings count as strings of the root section */
+	cfg = cfg_init(opts, CFGF_INTERN);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_parse_buf(cfg, "host a {} host b {}") == CFG_SUCCESS);
+	fail_unless(cfg_memory_stats_type(cfg, "host", &st) == CFG_SUCCESS);
+	fail_unless(st.category[CFG_MEMORY_STRINGS].allocs == 0);
+	fail_unless(st.category[CFG_MEMORY_TITLES].allocs == 0);
+	fail_unless(cfg_memory_stats_type(cfg, "root", &st) == CFG_SUCCESS);
+	fail_unless(st.category[CFG_MEMORY_STRINGS].allocs == 2 + 3);
+	check_sums(cfg);
+	cfg_free(cfg);
+
+	fail_unless(cfg_memory_stats(NULL, &st) == CFG_FAIL);
+	fail_unless(cfg_memory_stats_type(NULL, "root", &st) == CFG_FAIL);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,128 @@
+#include "check_confuse.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * cfg_overlay(): lookups through layers, the top-most layer that sets
+ * an option wins, otherwise the defaults of the bottom one.
+ */
+
+static cfg_opt_t node_opts[] = {
+	CFG_INT("port", 80, CFGF_NONE),
+	CFG_STR("host", "localhost", CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_STR("name", "none", CFGF_NONE),
+	CFG_INT("count", 1, CFGF_NONE),
+	CFG_BOOL("debug", cfg_false, CFGF_NONE),
+	CFG_INT_LIST("ports", "{1, 2}", CFGF_NONE),
+	CFG_SEC("log", node_opts, CFGF_NONE),
+	CFG_SEC("node", node_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+static cfg_t *layer(const char *buf)
+{
+	cfg_t *cfg;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_parse_buf(cfg, buf) == CFG_SUCCESS);
+
+	return cfg;
+}
+
+static int write_nothing(void *arg, const char *buf, size_t len)
+{
+	return 0;
+}
+
+static int diff_nothing(void *arg, cfg_diff_kind_t kind, const char *path,
+			cfg_opt_t *oldopt, cfg_opt_t *newopt, cfg_t *oldsec, cfg_t *newsec)
+{
+	return 0;
+}
+
+int main(void)
+{
+	cfg_t *base, *site, *host, *tenant, *cfg, *top;
+	cfg_fingerprint_t fp;
+	long int value;
+	char *buf;
+
+	base = layer("name = base count = 2 ports = {3} log { host = syslog }\n"
+		     "node a { port = 8000 } node b {}");
+	site = layer("count = 3 log { port = 514 }");
+	host = layer("name = host debug = true node c {}");
+
+	cfg = cfg_overlay(base, site, host, NULL);
+	fail_unless(cfg != NULL);
+
+	/* Top-most that sets it, or the default of the bottom layer */
+	fail_unless(strcmp(cfg_getstr(cfg, "name"), "host") == 0);
+	fail_unless(cfg_getint(cfg, "count") == 3);
+	fail_unless(cfg_getbool(cfg, "debug") == cfg_true);
+	fail_unless(cfg_size(cfg, "ports") == 1 && cfg_getnint(cfg, "ports", 0) == 3);
+
+	/* Paths in each layer, the section set above leaves host alone */
+	fail_unless(cfg_getint(cfg, "log|port") == 514);
+	fail_unless(strcmp(cfg_getstr(cfg, "log|host"), "syslog") == 0);
+
+	/* Multi-sections are not merged, but paths still find a and b */
+	fail_unless(cfg_size(cfg, "node") == 1);
+	fail_unless(cfg_exists(cfg, "node=c"));
+	fail_unless(cfg_getint(cfg, "node=a|port") == 8000);
+	fail_unless(cfg_getint(cfg, "node=c|port") == 80);
+
+	/* Lookups that miss */
+	fail_unless(cfg_exists(cfg, "node=x") == cfg_false);
+	fail_unless(cfg_getopt(cfg, "nope") == NULL);
+	fail_unless(cfg_trygetint(cfg, "count", &value) == CFG_SUCCESS && value == 3);
+
+	/* No sections of its own, a layer's would show the wrong values */
+	fail_unless(cfg_getsec(cfg, "log") == NULL && errno == EINVAL);
+	fail_unless(cfg_gettsec(cfg, "node", "c") == NULL && errno == EINVAL);
+	fail_unless(cfg_getnsec(cfg, "node", 0) == NULL && errno == EINVAL);
+	fail_unless(cfg_trygetsec(cfg, "log", NULL) == CFG_FAIL);
+	fail_unless(cfg_print(cfg, stdout) == CFG_FAIL && errno == EINVAL);
+	fail_unless(cfg_print_to_buffer(cfg, &buf, NULL) == CFG_FAIL && errno == EINVAL);
+	fail_unless(cfg_print_json(cfg, write_nothing, NULL) == CFG_FAIL && errno == EINVAL);
+	fp = cfg_fingerprint(cfg);
+	fail_unless(fp.hi == 0 && fp.lo == 0 && errno == EINVAL);
+	fail_unless(cfg_diff(cfg, base, diff_nothing, NULL) == CFG_FAIL && errno == EINVAL);
+
+	/* Read-only, the layers are changed instead and seen right away */
+	fail_unless(cfg_setint(cfg, "count", 4) == CFG_FAIL);
+	fail_unless(cfg_addtsec(cfg, "node", "d") == NULL && errno == EPERM);
+	fail_unless(cfg_parse_buf(cfg, "count = 4") != CFG_SUCCESS);
+	fail_unless(cfg_setint(host, "count", 5) == CFG_SUCCESS);
+	fail_unless(cfg_getint(cfg, "count") == 5);
+
+	/* Overlays of overlays, and layers kept until the overlay is freed */
+	tenant = layer("count = 6");
+	top = cfg_overlay(cfg, tenant, NULL);
+	fail_unless(top != NULL);
+	fail_unless(cfg_release(tenant) == CFG_SUCCESS);
+	fail_unless(cfg_getint(top, "count") == 6);
+	fail_unless(strcmp(cfg_getstr(top, "name"), "host") == 0);
+	fail_unless(cfg_release(cfg) == CFG_SUCCESS);
+	fail_unless(cfg_release(base) == CFG_SUCCESS);
+	fail_unless(cfg_getint(top, "node=a|port") == 8000);
+	cfg_free(top);
+
+	fail_unless(cfg_overlay(NULL, site, NULL) == NULL && errno == EINVAL);
+	cfg_free(site);
+	cfg_free(host);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
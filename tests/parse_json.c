@@ -0,0 +1,201 @@
+#include "check_confuse.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * cfg_parse_json(): the same schema read from JSON, typed values,
+ * lists, sections of all kinds, callbacks, and errors with the line.
+ */
+
+static char errbuf[256];
+
+static void errfunc(cfg_t *cfg, const char *fmt, va_list ap)
+{
+	int len;
+
+	len = snprintf(errbuf, sizeof(errbuf), "%d:", cfg->line);
+	vsnprintf(errbuf + len, sizeof(errbuf) - len, fmt, ap);
+}
+
+static int positive(cfg_t *cfg, cfg_opt_t *opt)
+{
+	if (cfg_opt_getnint(opt, cfg_opt_size(opt) - 1) < 0) {
+		cfg_error(cfg, "negative %s", opt->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int ncalls;
+
+static int func(cfg_t *cfg, cfg_opt_t *opt, int argc, const char **argv)
+{
+	ncalls++;
+	return argc == 2 && strcmp(argv[1], "b") == 0 ? 0 : -1;
+}
+
+static cfg_opt_t sub_opts[] = {
+	CFG_BOOL("on", cfg_false, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t node_opts[] = {
+	CFG_INT("port", 80, CFGF_NONE),
+	CFG_STR_LIST("tags", "{}", CFGF_NONE),
+	CFG_SEC("sub", sub_opts, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_STR("name", NULL, CFGF_NONE),
+	CFG_INT_CB("count", -3, CFGF_NONE, NULL),
+	CFG_INT8("small", 0, CFGF_NONE),
+	CFG_UINT64("big", 0, CFGF_NONE),
+	CFG_FLOAT("ratio", 0.25, CFGF_NONE),
+	CFG_FLOAT_LIST("nums", "{1.5, 1e100}", CFGF_NONE),
+	CFG_BOOL("debug", cfg_true, CFGF_NONE),
+	CFG_INT_LIST("ports", "{1, 2}", CFGF_NONE),
+	CFG_SEC("node", node_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_SEC("anon", sub_opts, CFGF_MULTI),
+	CFG_RAWSEC("mod", CFGF_TITLE | CFGF_MULTI),
+	CFG_FUNC("func", func),
+	CFG_FUNC("include", cfg_include),
+	CFG_END()
+};
+
+static int collect(void *arg, const char *buf, size_t len)
+{
+	char **out = arg;
+	size_t pos = *out ? strlen(*out) : 0;
+
+	*out = realloc(*out, pos + len + 1);
+	fail_unless(*out);
+	memcpy(*out + pos, buf, len);
+	(*out)[pos + len] = 0;
+
+	return 0;
+}
+
+static int parse(cfg_t *cfg, const char *json)
+{
+	errbuf[0] = 0;
+	return cfg_parse_json(cfg, json, strlen(json));
+}
+
+static void error(cfg_t *cfg, const char *json, const char *msg)
+{
+	fail_unless(parse(cfg, json) == CFG_PARSE_ERROR);
+	fail_unless(strcmp(errbuf, msg) == 0);
+}
+
+int main(void)
+{
+	char *out = NULL, *again = NULL;
+	const char *json;
+	cfg_t *cfg, *copy;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+	cfg_set_error_function(cfg, errfunc);
+	cfg_set_validate_func(cfg, "ports", positive);
+
+	json = "{ \"name\": \"a \\\"q\\\"\\n\\u00e9\\ud83d\\ude00\",\n"
+	       "  \"count\": -42, \"small\": -128, \"big\": 18446744073709551615,\n"
+	       "  \"ratio\": 2.5e-3, \"nums\": [], \"debug\": false, \"ports\": [3, 4, 5],\n"
+	       "  \"node\": { \"b\": { \"port\": 8080, \"tags\": [\"x\", \"y\"], \"sub\": { \"on\": true } },\n"
+	       "            \"a\": {} },\n"
+	       "  \"anon\": [ { \"on\": true }, {} ],\n"
+	       "  \"mod\": { \"m\": \"x = 1\" },\n"
+	       "  \"func\": [\"a\", \"b\"] }";
+	fail_unless(parse(cfg, json) == CFG_SUCCESS);
+
+	fail_unless(strcmp(cfg_getstr(cfg, "name"), "a \"q\"\n\xc3\xa9\xf0\x9f\x98\x80") == 0);
+	fail_unless(cfg_getint(cfg, "count") == -42);
+	fail_unless(cfg_getint8(cfg, "small") == -128);
+	fail_unless(cfg_getuint64(cfg, "big") == UINT64_MAX);
+	fail_unless(cfg_getfloat(cfg, "ratio") == 2.5e-3);
+	fail_unless(cfg_size(cfg, "nums") == 0);
+	fail_unless(cfg_getbool(cfg, "debug") == cfg_false);
+	fail_unless(cfg_size(cfg, "ports") == 3 && cfg_getnint(cfg, "ports", 2) == 5);
+	fail_unless(cfg_size(cfg, "node") == 2);
+	fail_unless(cfg_getint(cfg, "node=b|port") == 8080);
+	fail_unless(cfg_getbool(cfg, "node=b|sub|on") == cfg_true);
+	fail_unless(strcmp(cfg_getnstr(cfg, "node=b|tags", 1), "y") == 0);
+	fail_unless(cfg_getint(cfg, "node=a|port") == 80);
+	fail_unless(cfg_size(cfg, "anon") == 2);
+	fail_unless(cfg_getbool(cfg_getnsec(cfg, "anon", 0), "on") == cfg_true);
+	fail_unless(strcmp(cfg_getraw(cfg_gettsec(cfg, "mod", "m")), "x = 1") == 0);
+	fail_unless(ncalls == 1);
+
+	/* What is printed reads back the same */
+	fail_unless(cfg_print_json(cfg, collect, &out) == CFG_SUCCESS);
+	copy = cfg_init(opts, CFGF_NONE);
+	fail_unless(copy != NULL);
+	fail_unless(cfg_parse_json(copy, out, strlen(out)) == CFG_SUCCESS);
+	fail_unless(cfg_print_json(copy, collect, &again) == CFG_SUCCESS);
+	fail_unless(strcmp(out, again) == 0);
+	free(out);
+	free(again);
+	cfg_free(copy);
+
+	/* Same title replaces the section, null and missing options are left as they are */
+	fail_unless(parse(cfg, "{\"node\": {\"b\": {\"port\": 1}}, \"name\": null}") == CFG_SUCCESS);
+	fail_unless(cfg_size(cfg, "node") == 2 && cfg_getint(cfg, "node=b|port") == 1);
+	fail_unless(cfg_size(cfg, "node=b|tags") == 0);
+	fail_unless(cfg_getstr(cfg, "name") != NULL && cfg_getint(cfg, "count") == -42);
+
+	/* A number for a string is the number as written */
+	fail_unless(parse(cfg, "{\"name\": -1.50e3}") == CFG_SUCCESS);
+	fail_unless(strcmp(cfg_getstr(cfg, "name"), "-1.50e3") == 0);
+
+	/* Only white space, or nothing */
+	fail_unless(parse(cfg, " \n ") == CFG_SUCCESS);
+	fail_unless(cfg_parse_json(cfg, NULL, 0) == CFG_SUCCESS);
+
+	/* Errors, with the line */
+	error(cfg, "{\"small\": 128}", "1:integer value for option 'small' is out of range");
+	error(cfg, "{\"big\": -1}", "1:negative value for unsigned option 'big'");
+	error(cfg, "{\"big\": 18446744073709551616}", "1:integer value for option 'big' is out of range");
+	error(cfg, "{\"count\": 1.5}", "1:invalid integer value for option 'count'");
+	error(cfg, "{\"ratio\": 1e999}", "1:floating point value for option 'ratio' is out of range");
+	error(cfg, "{\n\"nope\": 1}", "2:no such option 'nope'");
+	error(cfg, "{\"ports\": [1,\n -1]}", "2:negative ports");
+	error(cfg, "{\"count\": [1]}", "1:array for non-list option 'count'");
+	error(cfg, "{\"count\": 1", "1:premature end of file");
+	error(cfg, "{\"count\": 1} x", "1:unexpected token 'x'");
+	error(cfg, "{\"count\": 01}", "1:unexpected token '1'");
+	error(cfg, "[]", "1:unexpected token '['");
+	error(cfg, "{\"name\": \"\\x\"}", "1:invalid escape sequence in string");
+	error(cfg, "{\"name\": \"\\udc00\"}", "1:invalid escape sequence in string");
+	error(cfg, "{\"include\": \"x.conf\"}", "1:include() is not supported in JSON");
+	error(cfg, "{\"func\": \"a\"}", "");
+
+	fail_unless(cfg_parse_json(NULL, "{}", 2) == CFG_PARSE_ERROR && errno == EINVAL);
+	cfg_free(cfg);
+
+	/* Unknown options skipped, or added as strings */
+	cfg = cfg_init(opts, CFGF_IGNORE_UNKNOWN);
+	fail_unless(cfg != NULL);
+	fail_unless(parse(cfg, "{\"x\": {\"y\": [1, true, null, {}]}, \"count\": 7}") == CFG_SUCCESS);
+	fail_unless(cfg_getint(cfg, "count") == 7);
+	cfg_free(cfg);
+
+	cfg = cfg_init(opts, CFGF_KEYSTRVAL);
+	fail_unless(cfg != NULL);
+	fail_unless(parse(cfg, "{\"key\": \"val\", \"count\": 7}") == CFG_SUCCESS);
+	fail_unless(strcmp(cfg_getstr(cfg, "key"), "val") == 0);
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,185 @@
+#include "check_confuse.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * CFGF_PROFILE: one profile per parsed file, buffer and include(),
+ * with what was read and the time per phase.
+ */
+
+static int validated;
+static int reset_rc, reset_errno;
+
+static int validate(cfg_t *cfg, cfg_opt_t *opt)
+{
+	validated++;
+
+	/* Profiles cannot be reset in the middle of a parse */
+	reset_rc = cfg_profile_reset(cfg);
+	reset_errno = errno;
+
+	return 0;
+}
+
+static cfg_opt_t sec_opts[] = {
+	CFG_INT("a", 1, CFGF_NONE),
+	CFG_INT("b", 2, CFGF_NONE),
+	CFG_STR_LIST("list", "{}", CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_INT_LIST("ports", "{1, 2}", CFGF_NONE),
+	CFG_SEC("sec", sec_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_FUNC("include", &cfg_include),
+	CFG_END()
+};
+
+static int collect(void *arg, const char *buf, size_t len)
+{
+	char **out = arg;
+	size_t pos = *out ? strlen(*out) : 0;
+
+	*out = realloc(*out, pos + len + 1);
+	fail_unless(*out);
+	memcpy(*out + pos, buf, len);
+	(*out)[pos + len] = 0;
+
+	return 0;
+}
+
+static uint64_t nsec(cfg_profile_t *prof)
+{
+	uint64_t sum = 0;
+	int i;
+
+	for (i = 0; i < CFG_PROFILE_PHASES; i++)
+		sum += prof->nsec[i];
+
+	return sum;
+}
+
+static int starts(const char *str, const char *prefix)
+{
+	return strncmp(str, prefix, strlen(prefix)) == 0;
+}
+
+static long fsize(const char *filename)
+{
+	FILE *fp = fopen(filename, "r");
+	long len;
+
+	fail_unless(fp != NULL);
+	fail_unless(fseek(fp, 0, SEEK_END) == 0);
+	len = ftell(fp);
+	fclose(fp);
+
+	return len;
+}
+
+int main(void)
+{
+	const char *buf =
+		"ports = {3, 4, 5}\n"
+		"sec x { a = 1 }\n"
+		"include(\"" SRC_DIR "/a.conf\")\n";
+	cfg_profile_t init, top, inc;
+	char *out = NULL, *p;
+	cfg_t *cfg;
+	int lines;
+
+	cfg = cfg_init(opts, CFGF_PROFILE);
+	fail_unless(cfg != NULL);
+	cfg_set_validate_func(cfg, "sec|a", validate);
+
+	/* Defaults set by cfg_init() */
+	fail_unless(cfg_profile_get(cfg, 0, &init) == CFG_SUCCESS);
+	fail_unless(strcmp(init.filename, "[init]") == 0);
+	fail_unless(init.depth == 0 && init.bytes == 0 && init.tokens == 0);
+	fail_unless(init.options == 0 && init.sections == 0);
+	fail_unless(init.nsec[CFG_PROFILE_PARSE] + init.nsec[CFG_PROFILE_DEFAULTS] == nsec(&init));
+	fail_unless(nsec(&init) == init.wall);
+
+	/* A buffer and the file it includes */
+	fail_unless(cfg_parse_buf(cfg, buf) == CFG_SUCCESS);
+	fail_unless(cfg_profile_get(cfg, 1, &top) == CFG_SUCCESS);
+	fail_unless(cfg_profile_get(cfg, 2, &inc) == CFG_SUCCESS);
+	fail_unless(cfg_profile_get(cfg, 3, &inc) == CFG_FAIL && errno == ENOENT);
+	fail_unless(cfg_profile_get(cfg, 2, &inc) == CFG_SUCCESS);
+
+	fail_unless(strcmp(top.filename, "[buf]") == 0);
+	fail_unless(top.depth == 0 && top.bytes == strlen(buf));
+	fail_unless(top.tokens == 10 + 6 + 4);
+	fail_unless(top.options == 3 + 1);
+	fail_unless(top.sections == 1);
+
+	fail_unless(strstr(inc.filename, "a.conf") != NULL);
+	fail_unless(inc.depth == 1 && inc.bytes == (uint64_t)fsize(inc.filename));
+	fail_unless(inc.tokens == 7 + 1);	/* And a comment */
+	fail_unless(inc.options == 1 && inc.sections == 1);
+	fail_unless(validated == 2);
+	fail_unless(reset_rc == CFG_FAIL && reset_errno == EBUSY);
+
+	/* Every moment is charged once, included files within the wall time */
+	fail_unless(nsec(&top) + nsec(&inc) == top.wall);
+	fail_unless(nsec(&inc) == inc.wall);
+
+	/* Files left by an error are ended too */
+	fail_unless(cfg_parse_buf(cfg, "include(\"" SRC_DIR "/a.conf\") }") == CFG_PARSE_ERROR);
+	fail_unless(cfg_profile_get(cfg, 4, &inc) == CFG_SUCCESS);
+	fail_unless(inc.depth == 1 && inc.tokens == 8);
+	fail_unless(cfg_parse(cfg, SRC_DIR "/b.conf") == CFG_SUCCESS);
+	fail_unless(cfg_profile_get(cfg, 5, &top) == CFG_SUCCESS);
+	fail_unless(top.depth == 0 && top.bytes == (uint64_t)fsize(SRC_DIR "/b.conf"));
+
+	/* One line per file, indented by depth, and the sum */
+	fail_unless(cfg_profile_dump_cb(cfg, CFG_STATS_TEXT, collect, &out) == CFG_SUCCESS);
+	fail_unless(starts(out, "[init] depth=0 bytes=0 tokens=0 options=0 sections=0 parse="));
+	fail_unless(strstr(out, "\n[buf] depth=0 bytes=") != NULL);
+	fail_unless(strstr(out, "a.conf depth=1 bytes=") != NULL);
+	fail_unless(strstr(out, "\n  " SRC_DIR "/a.conf depth=1") != NULL);
+	fail_unless(strstr(out, " callback=") && strstr(out, " include=") && strstr(out, " defaults="));
+	for (lines = 0, p = out; (p = strchr(p, '\n')) != NULL; p++)
+		lines++;
+	fail_unless(lines == 6 + 1);
+	p = strstr(out, "\ntotal files=6 bytes=");
+	fail_unless(p != NULL && p[strlen(p) - 1] == '\n' && !strchr(p + 1, '\n')[1]);
+	free(out);
+	out = NULL;
+
+	fail_unless(cfg_profile_dump_cb(cfg, CFG_STATS_JSON, collect, &out) == CFG_SUCCESS);
+	fail_unless(starts(out, "{\"files\":[{\"file\":\"[init]\",\"depth\":0,\"bytes\":0,"));
+	fail_unless(strstr(out, "},{\"file\":\"[buf]\",\"depth\":0,") != NULL);
+	fail_unless(strstr(out, "],\"total\":{\"files\":6,\"bytes\":") != NULL);
+	fail_unless(strcmp(out + strlen(out) - 3, "}}\n") == 0);
+	free(out);
+	out = NULL;
+
+	fail_unless(cfg_profile_reset(cfg) == CFG_SUCCESS);
+	fail_unless(cfg_profile_get(cfg, 0, &init) == CFG_FAIL);
+	fail_unless(cfg_profile_dump_cb(cfg, CFG_STATS_TEXT, collect, &out) == CFG_SUCCESS);
+	fail_unless(starts(out, "total files=0 bytes=0 tokens=0 "));
+	free(out);
+	cfg_free(cfg);
+
+	/* Without the flag there are no profiles */
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+	fail_unless(cfg_parse_buf(cfg, "ports = {1}") == CFG_SUCCESS);
+	fail_unless(cfg_profile_get(cfg, 0, &init) == CFG_FAIL && errno == ENOENT);
+	fail_unless(cfg_profile_reset(cfg) == CFG_SUCCESS);
+	fail_unless(cfg_profile_dump(cfg, stdout, 2) == CFG_FAIL);
+	fail_unless(cfg_profile_dump(NULL, stdout, CFG_STATS_TEXT) == CFG_FAIL);
+	fail_unless(cfg_profile_get(NULL, 0, &init) == CFG_FAIL);
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
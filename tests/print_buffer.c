@@ -0,0 +1,135 @@
+#include "check_confuse.h"
+#include <stdio.h>
+#include <string.h>
+
+static size_t chunks;
+
+static int collect(void *arg, const char *buf, size_t len)
+{
+	char **out = arg;
+	size_t pos = strlen(*out);
+
+	*out = realloc(*out, pos + len + 1);
+	fail_unless(*out);
+	memcpy(*out + pos, buf, len);
+	(*out)[pos + len] = 0;
+	chunks++;
+
+	return 0;
+}
+
+static int broken(void *arg, const char *buf, size_t len)
+{
+	return -1;
+}
+
+static void print_ip(cfg_opt_t *opt, unsigned int index, FILE *fp)
+{
+	long int ip = cfg_opt_getnint(opt, index);
+
+	fprintf(fp, "%ld.%ld.%ld.%ld", (ip >> 24) & 255, (ip >> 16) & 255, (ip >> 8) & 255, ip & 255);
+}
+
+/* Reference output, using the FILE based API */
+static char *print_file(cfg_t *cfg)
+{
+	FILE *fp;
+	char *buf;
+	long len;
+
+	fp = tmpfile();
+	fail_unless(fp);
+	fail_unless(cfg_print(cfg, fp) == CFG_SUCCESS);
+	len = ftell(fp);
+	rewind(fp);
+	buf = calloc(1, len + 1);
+	fail_unless(buf);
+	fail_unless(fread(buf, 1, len, fp) == (size_t)len);
+	fclose(fp);
+
+	return buf;
+}
+
+int main(void)
+{
+	static cfg_opt_t sub_opts[] = {
+		CFG_INT("int", -1, CFGF_NONE),
+		CFG_STR("str", "a \"quoted\" \\ string", CFGF_NONE),
+		CFG_END()
+	};
+
+	cfg_opt_t opts[] = {
+		CFG_INT("int", -42, CFGF_NONE),
+		CFG_INT64("int64", INT64_MIN, CFGF_NONE),
+		CFG_INT_LIST("ip", "{167772161, 3232235777}", CFGF_NONE),
+		CFG_UINT64("uint64", UINT64_MAX, CFGF_NONE),
+		CFG_INT8("int8", -128, CFGF_NONE),
+		CFG_BOOL("bool", cfg_false, CFGF_NONE),
+		CFG_STR("unset", NULL, CFGF_NONE),
+		CFG_STR("long", NULL, CFGF_NONE),
+		CFG_SEC("sub", sub_opts, CFGF_MULTI | CFGF_TITLE),
+		CFG_END()
+	};
+
+	char *ref, *buf, *out = NULL;
+	size_t len;
+	char *str;
+	int i;
+	cfg_t *cfg;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg);
+	fail_unless(cfg_set_print_func(cfg, "ip", print_ip) == NULL);
+
+	/* Long enough to span several internal buffers, with escapes at the edges */
+	str = malloc(20001);
+	fail_unless(str);
+	for (i = 0; i < 20000; i++)
+		str[i] = i % 4095 == 0 ? '"' : 'a' + i % 26;
+	str[20000] = 0;
+	fail_unless(cfg_setstr(cfg, "long", str) == CFG_SUCCESS);
+	free(str);
+
+	for (i = 0; i < 100; i++) {
+		char title[16];
+
+		snprintf(title, sizeof(title), "s%d", i);
+		fail_unless(cfg_addtsec(cfg, "sub", title));
+	}
+
+	ref = print_file(cfg);
+	fail_unless(strstr(ref, "int=-42\n"));
+	fail_unless(strstr(ref, "int64=-9223372036854775808\n"));
+	fail_unless(strstr(ref, "ip = {10.0.0.1, 192.168.1.1}\n"));
+	fail_unless(strstr(ref, "uint64=18446744073709551615\n"));
+	fail_unless(strstr(ref, "int8=-128\n"));
+	fail_unless(strstr(ref, "# unset=\"\"\n"));
+	fail_unless(strstr(ref, "  str=\"a \\\"quoted\\\" \\\\ string\"\n"));
+
+	fail_unless(cfg_print_to_buffer(cfg, &buf, &len) == CFG_SUCCESS);
+	fail_unless(len == strlen(ref));
+	fail_unless(strcmp(buf, ref) == 0);
+	free(buf);
+
+	out = calloc(1, 1);
+	fail_unless(cfg_print_cb(cfg, collect, &out) == CFG_SUCCESS);
+	fail_unless(strcmp(out, ref) == 0);
+	fail_unless(chunks > 1 && chunks < 100);
+	free(out);
+
+	fail_unless(cfg_print_cb(cfg, broken, NULL) == CFG_FAIL);
+	fail_unless(cfg_print_cb(cfg, NULL, NULL) == CFG_FAIL);
+	fail_unless(cfg_print_to_buffer(NULL, &buf, &len) == CFG_FAIL);
+
+	free(ref);
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
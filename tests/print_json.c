@@ -0,0 +1,135 @@
+#include "check_confuse.h"
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * cfg_print_json(): the whole tree as one JSON object, values with
+ * their types, titled sections keyed by title, lists as arrays.
+ */
+
+static cfg_opt_t sub_opts[] = {
+	CFG_BOOL("on", cfg_false, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t node_opts[] = {
+	CFG_INT("port", 80, CFGF_NONE),
+	CFG_STR_LIST("tags", "{}", CFGF_NONE),
+	CFG_SEC("sub", sub_opts, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_STR("name", NULL, CFGF_NONE),
+	CFG_INT("count", -3, CFGF_NONE),
+	CFG_UINT64("big", 0, CFGF_NONE),
+	CFG_FLOAT("ratio", 0.25, CFGF_NONE),
+	CFG_FLOAT_LIST("nums", "{1.5, 1e100}", CFGF_NONE),
+	CFG_BOOL("debug", cfg_true, CFGF_NONE),
+	CFG_INT_LIST("ports", "{1, 2}", CFGF_NONE),
+	CFG_SEC("node", node_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_SEC("anon", sub_opts, CFGF_MULTI),
+	CFG_RAWSEC("mod", CFGF_TITLE | CFGF_MULTI),
+	CFG_FUNC("include", cfg_include),
+	CFG_END()
+};
+
+static int collect(void *arg, const char *buf, size_t len)
+{
+	char **out = arg;
+	size_t pos = *out ? strlen(*out) : 0;
+
+	*out = realloc(*out, pos + len + 1);
+	fail_unless(*out);
+	memcpy(*out + pos, buf, len);
+	(*out)[pos + len] = 0;
+
+	return 0;
+}
+
+static int fail(void *arg, const char *buf, size_t len)
+{
+	return -1;
+}
+
+static int no_node(cfg_t *cfg, cfg_opt_t *opt)
+{
+	return strcmp(opt->name, "node") == 0;
+}
+
+static char *json(cfg_t *cfg)
+{
+	char *out = NULL;
+
+	fail_unless(cfg_print_json(cfg, collect, &out) == CFG_SUCCESS);
+
+	return out;
+}
+
+int main(void)
+{
+	cfg_t *cfg;
+	char *out;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+
+	/* Defaults, unset values are null */
+	out = json(cfg);
+	fail_unless(strcmp(out, "{\"name\":null,\"count\":-3,\"big\":0,\"ratio\":0.25,"
+			   "\"nums\":[1.5,1e100],\"debug\":true,\"ports\":[1,2],"
+			   "\"node\":{},\"anon\":[],\"mod\":{}}\n") == 0);
+	free(out);
+
+	fail_unless(cfg_parse_buf(cfg,
+				  "name = \"a \\\"q\\\"\\n\\ttab\\x01\"\n"
+				  "big = 18446744073709551615\n"
+				  "node b { port = 8080 tags = {x, y} sub { on = true } }\n"
+				  "node a {}\n"
+				  "anon { on = true } anon {}\n"
+				  "mod m { x = \"thing\" }\n") == CFG_SUCCESS);
+	fail_unless(cfg_setfloat(cfg, "ratio", NAN) == CFG_SUCCESS);
+
+	out = json(cfg);
+	fail_unless(strcmp(out, "{\"name\":\"a \\\"q\\\"\\n\\ttab\\u0001\",\"count\":-3,"
+			   "\"big\":18446744073709551615,\"ratio\":null,"
+			   "\"nums\":[1.5,1e100],\"debug\":true,\"ports\":[1,2],"
+			   "\"node\":{\"b\":{\"port\":8080,\"tags\":[\"x\",\"y\"],\"sub\":{\"on\":true}},"
+			   "\"a\":{\"port\":80,\"tags\":[],\"sub\":{\"on\":false}}},"
+			   "\"anon\":[{\"on\":true},{\"on\":false}],"
+			   "\"mod\":{\"m\":\" x = \\\"thing\\\" \"}}\n") == 0);
+	free(out);
+
+	/* Valid UTF-8 is kept, other bytes are escaped as code points */
+	fail_unless(cfg_parse_buf(cfg, "name = \"\\xff \xc3\xa9 \xf0\x9f\x98\x80 \xed\xa0\x80 \xe2\x82\"") == CFG_SUCCESS);
+	out = json(cfg);
+	fail_unless(strstr(out, "{\"name\":\"\\u00ff \xc3\xa9 \xf0\x9f\x98\x80 "
+			   "\\u00ed\\u00a0\\u0080 \\u00e2\\u0082\",") == out);
+	free(out);
+
+	/* Any section, and the filters of the tree */
+	out = json(cfg_gettsec(cfg, "node", "b"));
+	fail_unless(strcmp(out, "{\"port\":8080,\"tags\":[\"x\",\"y\"],\"sub\":{\"on\":true}}\n") == 0);
+	free(out);
+
+	cfg_set_print_filter_func(cfg, no_node);
+	out = json(cfg);
+	fail_unless(strstr(out, "\"node\"") == NULL && strstr(out, "\"anon\":[") != NULL);
+	free(out);
+
+	fail_unless(cfg_print_json(cfg, fail, NULL) == CFG_FAIL);
+	fail_unless(cfg_print_json(NULL, collect, &out) == CFG_FAIL && errno == EINVAL);
+	fail_unless(cfg_print_json(cfg, NULL, NULL) == CFG_FAIL);
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,131 @@
+#include "check_confuse.h"
+#include "../src/confuse.hpp"
+#include <cstring>
+#include <string_view>
+
+/*
+ * Schemas declared with confuse.hpp: tables built at compile time, the
+ * perfect hash of option names, and typed accessors at fixed positions.
+ */
+
+using namespace std::literals;
+
+namespace backend {
+inline constexpr confuse::option<std::string_view> host("host", "localhost");
+inline constexpr confuse::option<std::uint16_t> port("port", 8080);
+inline constexpr confuse::option<bool> tls("tls", true);
+inline constexpr confuse::list_option<std::string_view> paths("paths", "{/health}");
+inline constexpr confuse::schema schema(host, port, tls, paths);
+} // namespace backend
+
+inline constexpr confuse::option<std::string_view> name("name");
+inline constexpr confuse::option<long> count("count", 3);
+inline constexpr confuse::option<std::int64_t> offset("offset", -1);
+inline constexpr confuse::option<double> ratio("ratio", 0.25);
+inline constexpr confuse::list_option<long> ports("ports", "{80, 443}");
+inline constexpr confuse::section_option<backend::schema> backends("backend", CFGF_MULTI | CFGF_TITLE);
+inline constexpr confuse::section_option<backend::schema> primary("primary");
+inline constexpr confuse::schema app(name, count, offset, ratio, ports, backends, primary);
+
+static_assert(app.size == 7);
+static_assert(app.find("name") == 0);
+static_assert(app.find("backend") == 5);
+static_assert(app.find("nonexistent") == app.npos);
+static_assert(app.find("NAME") == app.npos);
+static_assert(app.find("NAME", true) == 0);
+static_assert(app.find("Backend", true) == 5);
+static_assert(backend::schema.position("paths") == 3);
+static_assert(app.table()[1].type == CFGT_INT);
+static_assert(app.table()[1].def.number == 3);
+static_assert(app.table()[4].flags == CFGF_LIST);
+static_assert(app.table()[7].name == nullptr);
+static_assert(std::is_same_v<decltype(confuse::get<app, count>(confuse::section())), long>);
+static_assert(confuse::option_type<std::uint16_t>() == CFGT_UINT16);
+static_assert(confuse::option_type<int>() == CFGT_INT32);
+
+static const char *conf =
+	"name = demo\n"
+	"offset = 8589934592\n"
+	"ports = {1, 2, 3}\n"
+	"backend db { port = 5432 tls = false }\n"
+	"backend web { host = example.com paths = {/a, /b} }\n";
+
+static void check(cfg_flag_t flags)
+{
+	confuse::config cfg(confuse::table<app>.data(), flags);
+	long sum = 0;
+
+	/* The table is static, sections point into the nested table */
+	fail_unless(confuse::table<app>[5].subopts == confuse::table<backend::schema>.data());
+	fail_unless(std::strcmp(confuse::table<backend::schema>[0].def.string, "localhost") == 0);
+
+	/* Defaults */
+	fail_unless((confuse::get<app, name>(cfg).empty()));
+	fail_unless((confuse::get<app, count>(cfg) == 3));
+	fail_unless((confuse::get<app, offset>(cfg) == -1));
+	fail_unless((confuse::get<app, ratio>(cfg) == 0.25));
+	fail_unless((confuse::size<app, ports>(cfg) == 2));
+	fail_unless((confuse::get<app, ports>(cfg, 1) == 443));
+	fail_unless((confuse::size<app, backends>(cfg) == 0));
+	fail_unless((confuse::get<backend::schema, backend::port>(confuse::get<app, primary>(cfg)) == 8080));
+	fail_unless((confuse::get<backend::schema, backend::host>(confuse::get<app, primary>(cfg)) == "localhost"sv));
+
+	fail_unless(cfg.parse_buf(conf) == CFG_SUCCESS);
+
+	/* Values agree with the by-name API */
+	fail_unless((confuse::get<app, name>(cfg) == "demo"sv));
+	fail_unless((confuse::get<app, name>(cfg).data() == cfg_getstr(cfg.cfg(), "name")));
+	fail_unless((confuse::get<app, offset>(cfg) == 8589934592LL));
+	for (long port : confuse::values<app, ports>(cfg))
+		sum += port;
+	fail_unless(sum == 6);
+	fail_unless((confuse::get<app, ports>(cfg, 3) == 0));
+
+	fail_unless((confuse::size<app, backends>(cfg) == 2));
+	confuse::section db = confuse::get<app, backends>(cfg, 0);
+	fail_unless(db.title() == "db"sv);
+	fail_unless((confuse::get<backend::schema, backend::host>(db) == "localhost"sv));
+	fail_unless((confuse::get<backend::schema, backend::port>(db) == 5432));
+	fail_unless((!confuse::get<backend::schema, backend::tls>(db)));
+	fail_unless((confuse::get<backend::schema, backend::paths>(db, 0) == "/health"sv));
+
+	sum = 0;
+	for (confuse::section be : confuse::values<app, backends>(cfg)) {
+		sum += confuse::get<backend::schema, backend::port>(be);
+		sum += confuse::size<backend::schema, backend::paths>(be);
+	}
+	fail_unless(sum == 5432 + 1 + 8080 + 2);
+
+	/* Names not known until run time use the perfect hash */
+	fail_unless(confuse::find<app>(cfg, "ratio") == cfg_getopt(cfg.cfg(), "ratio"));
+	fail_unless(confuse::find<app>(cfg, "backend") == cfg_getopt(cfg.cfg(), "backend"));
+	fail_unless(confuse::find<app>(cfg, "rati") == nullptr);
+	fail_unless(confuse::find<app>(confuse::section(), "ratio") == nullptr);
+	fail_unless(confuse::find<backend::schema>(db, "port") == cfg_getopt(db.cfg(), "port"));
+
+	/* Case is folded in sections with CFGF_NOCASE, like cfg_getopt() does */
+	fail_unless(confuse::find<app>(cfg, "RATIO") == cfg_getopt(cfg.cfg(), "RATIO"));
+	fail_unless((confuse::find<app>(cfg, "RATIO") != nullptr) == !!(flags & CFGF_NOCASE));
+	fail_unless(confuse::find<backend::schema>(db, "Port") == cfg_getopt(db.cfg(), "Port"));
+	fail_unless(confuse::find<app>(cfg, "RATIOS") == nullptr);
+
+	/* Accessors on an empty section */
+	fail_unless((confuse::get<app, count>(confuse::section()) == 0));
+	fail_unless((confuse::size<app, ports>(confuse::section()) == 0));
+}
+
+int main(void)
+{
+	check(CFGF_NONE);
+	check(CFGF_LAZY);
+	check(CFGF_NOCASE);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
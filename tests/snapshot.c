@@ -0,0 +1,160 @@
+#include "check_confuse.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Hot-reload: reader threads take snapshots from a handle while the
+ * main thread keeps swapping in newly parsed trees.  Each snapshot must
+ * stay consistent until released, and every tree must be freed.  The
+ * trees are frozen, so readers may also print and fingerprint them.
+ * Run under ThreadSanitizer to check for races.
+ */
+
+#define NUM_READERS 4
+#define NUM_RELOADS 200
+
+static cfg_opt_t sub_opts[] = {
+	CFG_INT("generation", 0, CFGF_NONE),
+	CFG_END()
+};
+
+static cfg_opt_t opts[] = {
+	CFG_INT("generation", 0, CFGF_NONE),
+	CFG_STR("name", NULL, CFGF_NONE),
+	CFG_SEC("sub", sub_opts, CFGF_MULTI | CFGF_TITLE),
+	CFG_END()
+};
+
+static cfg_handle_t *handle;
+static int done;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static cfg_t *create(long int generation)
+{
+	char buf[256], name[32];
+	cfg_t *cfg;
+
+	snprintf(name, sizeof(name), "gen%ld", generation);
+	snprintf(buf, sizeof(buf),
+		 "generation = %ld name = %s\n"
+		 "sub a { generation = %ld }\n"
+		 "sub b { generation = %ld }\n",
+		 generation, name, generation, generation);
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg);
+	fail_unless(cfg_parse_buf(cfg, buf) == CFG_SUCCESS);
+	fail_unless(cfg_freeze(cfg) == CFG_SUCCESS);
+
+	return cfg;
+}
+
+static int finished(void)
+{
+	int result;
+
+	pthread_mutex_lock(&lock);
+	result = done;
+	pthread_mutex_unlock(&lock);
+
+	return result;
+}
+
+static void *reader(void *arg)
+{
+	long int last = 0, *reads = arg;
+
+	do {
+		cfg_fingerprint_t fp;
+		char name[32], *buf;
+		cfg_t *cfg, *sub;
+		long int gen;
+		size_t len;
+
+		cfg = cfg_handle_acquire(handle);
+		fail_unless(cfg);
+
+		gen = cfg_getint(cfg, "generation");
+		fail_unless(gen >= last);
+		last = gen;
+
+		snprintf(name, sizeof(name), "gen%ld", gen);
+		fail_unless(!strcmp(cfg_getstr(cfg, "name"), name));
+		fail_unless(cfg_getint(cfg, "sub=a|generation") == gen);
+
+		fp = cfg_fingerprint(cfg);
+		fail_unless(fp.hi || fp.lo);
+		if (*reads % 16 == 0) {
+			fail_unless(cfg_print_to_buffer(cfg, &buf, &len) == CFG_SUCCESS);
+			fail_unless(strstr(buf, name) != NULL);
+			free(buf);
+		}
+
+		/* A section keeps the whole tree alive */
+		sub = cfg_acquire(cfg_gettsec(cfg, "sub", "b"));
+		fail_unless(cfg_release(cfg) == CFG_SUCCESS);
+		fail_unless(cfg_getint(sub, "generation") == gen);
+		fail_unless(cfg_getint(cfg_gettsec(sub->parent, "sub", "a"), "generation") == gen);
+		fail_unless(cfg_release(sub) == CFG_SUCCESS);
+
+		(*reads)++;
+	} while (!finished());
+
+	return NULL;
+}
+
+int main(void)
+{
+	pthread_t threads[NUM_READERS];
+	long int reads[NUM_READERS];
+	cfg_t *cfg;
+	int i;
+
+	/* Plain reference counting */
+	cfg = create(0);
+	fail_unless(cfg_setint(cfg, "generation", 1) == CFG_FAIL);
+	fail_unless(cfg_acquire(cfg) == cfg);
+	fail_unless(cfg_release(cfg) == CFG_SUCCESS);
+	fail_unless(cfg_getint(cfg, "generation") == 0);
+	fail_unless(cfg_release(cfg) == CFG_SUCCESS);
+	fail_unless(cfg_acquire(NULL) == NULL);
+	fail_unless(cfg_release(NULL) == CFG_FAIL);
+
+	handle = cfg_handle_init(create(0));
+	fail_unless(handle);
+
+	for (i = 0; i < NUM_READERS; i++) {
+		reads[i] = 0;
+		fail_unless(pthread_create(&threads[i], NULL, reader, &reads[i]) == 0);
+	}
+
+	for (i = 1; i <= NUM_RELOADS; i++)
+		fail_unless(cfg_handle_swap(handle, create(i)) == CFG_SUCCESS);
+
+	pthread_mutex_lock(&lock);
+	done = 1;
+	pthread_mutex_unlock(&lock);
+
+	for (i = 0; i < NUM_READERS; i++) {
+		fail_unless(pthread_join(threads[i], NULL) == 0);
+		fail_unless(reads[i] > 0);
+	}
+
+	cfg = cfg_handle_acquire(handle);
+	fail_unless(cfg_getint(cfg, "generation") == NUM_RELOADS);
+	cfg_release(cfg);
+
+	fail_unless(cfg_handle_swap(handle, NULL) == CFG_SUCCESS);
+	fail_unless(cfg_handle_acquire(handle) == NULL);
+	fail_unless(cfg_handle_free(handle) == CFG_SUCCESS);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
@@ -0,0 +1,131 @@
+#include "check_confuse.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * String values keep their length, so NUL bytes from "\x00" escapes
+ * survive parsing, printing and comparison, and strings built by the
+ * application can be handed over without a copy.
+ */
+
+static char *simple;
+
+static cfg_opt_t opts[] = {
+	CFG_STR("blob", "default", CFGF_NONE),
+	CFG_STR_LIST("list", NULL, CFGF_NONE),
+	CFG_SIMPLE_STR("simple", &simple),
+	CFG_END()
+};
+
+static int collect(void *arg, const char *buf, size_t len)
+{
+	char **out = arg;
+	size_t pos = *out ? strlen(*out) : 0;
+
+	*out = realloc(*out, pos + len + 1);
+	fail_unless(*out);
+	memcpy(*out + pos, buf, len);
+	(*out)[pos + len] = 0;
+
+	return 0;
+}
+
+static int count_diff(void *arg, cfg_diff_kind_t kind, const char *path,
+		      cfg_opt_t *oldopt, cfg_opt_t *newopt, cfg_t *oldsec, cfg_t *newsec)
+{
+	(*(int *)arg)++;
+	return 0;
+}
+
+int main(void)
+{
+	cfg_t *cfg, *copy;
+	char *str, *out = NULL;
+	size_t len;
+	int diffs = 0;
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg != NULL);
+
+	/* Defaults and unset values */
+	str = cfg_getstr_len(cfg, "blob", &len);
+	fail_unless(str && strcmp(str, "default") == 0 && len == 7);
+	fail_unless(cfg_getnstr_len(cfg, "list", 0, &len) == NULL && len == 0);
+	fail_unless(cfg_getstr_len(cfg, "nonexistent", &len) == NULL && len == 0);
+	fail_unless(cfg_getstr_len(cfg, "blob", NULL) != NULL);
+
+	fail_unless(cfg_parse_buf(cfg,
+				  "blob = \"a\\x00b\\0c\"\n"
+				  "list = {\"\\x00\", plain, \"\"}\n"
+				  "simple = \"s\\x00t\"\n") == CFG_SUCCESS);
+
+	str = cfg_getstr_len(cfg, "blob", &len);
+	fail_unless(len == 5);
+	fail_unless(memcmp(str, "a\0b\0c", 6) == 0);
+	fail_unless(strcmp(cfg_getstr(cfg, "blob"), "a") == 0);
+
+	str = cfg_getnstr_len(cfg, "list", 0, &len);
+	fail_unless(len == 1 && str[0] == 0);
+	str = cfg_getnstr_len(cfg, "list", 1, &len);
+	fail_unless(len == 5 && strcmp(str, "plain") == 0);
+	str = cfg_getnstr_len(cfg, "list", 2, &len);
+	fail_unless(len == 0 && str && !*str);
+
+	/* Values of CFG_SIMPLE_STR options are plain C strings */
+	str = cfg_getstr_len(cfg, "simple", &len);
+	fail_unless(str == simple && len == 1);
+
+	/* Printed with escapes, and parsed back the same */
+	fail_unless(cfg_print_cb(cfg, collect, &out) == CFG_SUCCESS);
+	fail_unless(strstr(out, "blob=\"a\\x00b\\x00c\"") != NULL);
+
+	copy = cfg_init(opts, CFGF_NONE);
+	fail_unless(copy != NULL);
+	fail_unless(cfg_parse_buf(copy, out) == CFG_SUCCESS);
+	str = cfg_getstr_len(copy, "blob", &len);
+	fail_unless(len == 5 && memcmp(str, "a\0b\0c", 6) == 0);
+	fail_unless(cfg_diff(cfg, copy, count_diff, &diffs) == CFG_SUCCESS);
+	fail_unless(diffs == 0);
+	free(out);
+
+	/* Bytes after a NUL still count */
+	fail_unless(cfg_opt_setnstr_len(cfg_getopt(copy, "blob"), "a\0b\0d", 5, 0) == CFG_SUCCESS);
+	fail_unless(cfg_diff(cfg, copy, count_diff, &diffs) == CFG_SUCCESS);
+	fail_unless(diffs > 0);
+	fail_unless(cfg_fingerprint(cfg).lo != cfg_fingerprint(copy).lo);
+	cfg_free(copy);
+
+	/* Taking ownership, the string is not copied */
+	str = strdup("adopted");
+	fail_unless(cfg_setstr_take(cfg, "blob", str) == CFG_SUCCESS);
+	fail_unless(cfg_getstr_len(cfg, "blob", &len) == str && len == 7);
+
+	str = malloc(4);
+	fail_unless(str != NULL);
+	memcpy(str, "x\0y", 4);
+	fail_unless(cfg_opt_setnstr_take(cfg_getopt(cfg, "list"), str, 3, 3) == CFG_SUCCESS);
+	fail_unless(cfg_size(cfg, "list") == 4);
+	fail_unless(cfg_getnstr_len(cfg, "list", 3, &len) == str && len == 3);
+
+	str = strdup("second");
+	fail_unless(cfg_setnstr_take(cfg, "list", str, 1) == CFG_SUCCESS);
+	fail_unless(cfg_getnstr(cfg, "list", 1) == str);
+
+	/* On failure the string is freed, checked by the leak sanitizer */
+	fail_unless(cfg_setstr_take(cfg, "nonexistent", strdup("lost")) == CFG_FAIL);
+	fail_unless(cfg_setnstr_take(cfg, "blob", strdup("lost"), 1) == CFG_FAIL);
+	fail_unless(cfg_setstr_take(cfg, "blob", NULL) == CFG_SUCCESS);
+	fail_unless(cfg_getstr_len(cfg, "blob", &len) == NULL && len == 0);
+
+	cfg_free(cfg);
+	free(simple);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
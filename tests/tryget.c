@@ -0,0 +1,131 @@
+#include "check_confuse.h"
+#include <errno.h>
+#include <string.h>
+
+static int errors;
+
+static void errfunc(cfg_t *cfg, const char *fmt, va_list ap)
+{
+	(void)cfg;
+	(void)fmt;
+	(void)ap;
+	errors++;
+}
+
+int main(void)
+{
+	static cfg_opt_t sub_opts[] = {
+		CFG_INT("int", 1, CFGF_NONE),
+		CFG_STR("str", NULL, CFGF_NONE),
+		CFG_END()
+	};
+
+	cfg_opt_t opts[] = {
+		CFG_INT("int", 0, CFGF_NONE),
+		CFG_INT_LIST("ints", "{1, 2, 3}", CFGF_NONE),
+		CFG_INT8("int8", -8, CFGF_NONE),
+		CFG_UINT64("uint64", 0, CFGF_NONE),
+		CFG_FLOAT("float", 1.5, CFGF_NONE),
+		CFG_BOOL("bool", cfg_true, CFGF_NONE),
+		CFG_STR("str", "hello", CFGF_NONE),
+		CFG_STR("unset", NULL, CFGF_NONE),
+		CFG_INT("nodefault", 0, CFGF_NODEFAULT),
+		CFG_SEC("single", sub_opts, CFGF_NONE),
+		CFG_SEC("multi", sub_opts, CFGF_MULTI),
+		CFG_SEC("title", sub_opts, CFGF_TITLE | CFGF_MULTI),
+		CFG_END()
+	};
+
+	const char *config_data =
+		"int = 42\n"
+		"uint64 = 18446744073709551615\n"
+		"single { int = 11 }\n"
+		"multi { int = 21 }\n"
+		"multi { int = 22 str = \"x\" }\n"
+		"title first { int = 31 }\n"
+		"title 'it\\'s' { int = 32 }\n";
+
+	long int i;
+	int8_t i8;
+	uint64_t u64;
+	double f;
+	cfg_bool_t b;
+	char *s;
+	cfg_opt_t *opt;
+	cfg_t *sec;
+	cfg_t *cfg = cfg_init(opts, CFGF_NONE);
+
+	fail_unless(cfg);
+	fail_unless(cfg_parse_buf(cfg, config_data) == CFG_SUCCESS);
+	cfg_set_error_function(cfg, errfunc);
+
+	fail_unless(cfg_trygetint(cfg, "int", &i) == CFG_SUCCESS && i == 42);
+	fail_unless(cfg_trygetnint(cfg, "ints", 2, &i) == CFG_SUCCESS && i == 3);
+	fail_unless(cfg_trygetnint(cfg, "ints", 3, &i) == CFG_FAIL);
+	fail_unless(cfg_trygetint8(cfg, "int8", &i8) == CFG_SUCCESS && i8 == -8);
+	fail_unless(cfg_trygetuint64(cfg, "uint64", &u64) == CFG_SUCCESS && u64 == UINT64_MAX);
+	fail_unless(cfg_trygetfloat(cfg, "float", &f) == CFG_SUCCESS && f == 1.5);
+	fail_unless(cfg_trygetbool(cfg, "bool", &b) == CFG_SUCCESS && b == cfg_true);
+	fail_unless(cfg_trygetstr(cfg, "str", &s) == CFG_SUCCESS && strcmp(s, "hello") == 0);
+	fail_unless(cfg_trygetint(cfg, "single|int", &i) == CFG_SUCCESS && i == 11);
+	fail_unless(cfg_trygetint(cfg, "multi=1|int", &i) == CFG_SUCCESS && i == 22);
+	fail_unless(cfg_trygetint(cfg, "multi=0x1|int", &i) == CFG_SUCCESS && i == 22);
+	fail_unless(cfg_trygetint(cfg, "title=first|int", &i) == CFG_SUCCESS && i == 31);
+	fail_unless(cfg_trygetint(cfg, "title='it\\'s'|int", &i) == CFG_SUCCESS && i == 32);
+	fail_unless(cfg_trygetint(cfg, "int", NULL) == CFG_SUCCESS);
+
+	fail_unless(cfg_trygetsec(cfg, "multi=1", &sec) == CFG_SUCCESS);
+	fail_unless(cfg_getint(sec, "int") == 22);
+	fail_unless(cfg_trygetnsec(cfg, "multi", 0, &sec) == CFG_SUCCESS);
+	fail_unless(cfg_getint(sec, "int") == 21);
+	fail_unless(cfg_trygettsec(cfg, "title", "it's", &sec) == CFG_SUCCESS);
+	fail_unless(cfg_getint(sec, "int") == 32);
+	fail_unless(cfg_trygetopt(cfg, "title=first|int", &opt) == CFG_SUCCESS);
+	fail_unless(cfg_opt_getnint(opt, 0) == 31);
+
+	fail_unless(cfg_exists(cfg, "int"));
+	fail_unless(cfg_exists(cfg, "str"));
+	fail_unless(!cfg_exists(cfg, "unset"));
+	fail_unless(!cfg_exists(cfg, "nodefault"));
+	fail_unless(cfg_exists(cfg, "single"));
+	fail_unless(cfg_exists(cfg, "multi=1|str"));
+	fail_unless(!cfg_exists(cfg, "multi=0|str"));
+	fail_unless(cfg_exists(cfg, "title=first"));
+	fail_unless(!cfg_exists(cfg, "title=second"));
+
+	/* Misses must be silent and leave errno alone */
+	errno = 0;
+	fail_unless(cfg_trygetint(cfg, "nonexistent", &i) == CFG_FAIL);
+	fail_unless(cfg_trygetint(cfg, "str", &i) == CFG_FAIL);
+	fail_unless(cfg_trygetstr(cfg, "unset", &s) == CFG_FAIL);
+	fail_unless(cfg_trygetint(cfg, "multi=2|int", &i) == CFG_FAIL);
+	fail_unless(cfg_trygetint(cfg, "multi=x|int", &i) == CFG_FAIL);
+	fail_unless(cfg_trygetint(cfg, "int=0|int", &i) == CFG_FAIL);
+	fail_unless(cfg_trygetint(cfg, "single=0|int", &i) == CFG_FAIL);
+	fail_unless(cfg_trygetint(cfg, "title='first|int", &i) == CFG_FAIL);
+	fail_unless(cfg_trygetint(cfg, "title=second|int", &i) == CFG_FAIL);
+	fail_unless(cfg_trygetint(cfg, "single|nonexistent", &i) == CFG_FAIL);
+	fail_unless(cfg_trygetsec(cfg, "int", &sec) == CFG_FAIL);
+	fail_unless(cfg_trygettsec(cfg, "multi", "first", &sec) == CFG_FAIL);
+	fail_unless(cfg_trygetint(NULL, "int", &i) == CFG_FAIL);
+	fail_unless(cfg_trygetint(cfg, NULL, &i) == CFG_FAIL);
+	fail_unless(!cfg_exists(cfg, "nonexistent"));
+	fail_unless(!cfg_exists(cfg, "single|nonexistent"));
+	fail_unless(errno == 0);
+	fail_unless(errors == 0);
+
+	/* The regular getters still complain */
+	cfg_getint(cfg, "nonexistent");
+	fail_unless(errors == 1);
+
+	cfg_free(cfg);
+
+	return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
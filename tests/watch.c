@@ -0,0 +1,149 @@
+#include "check_confuse.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * cfg_watch_fd() and cfg_watch_dispatch(): changes to the main file and
+ * to included files trigger exactly one reload per burst, also when a
+ * file is replaced with rename(), while other files are ignored.
+ */
+
+#ifdef _WIN32
+int main(void)
+{
+	return 77;		/* Skipped */
+}
+#else
+#include <poll.h>
+#include <unistd.h>
+
+static char dir[64], main_conf[128], inc_conf[128], other[128];
+static int reloads;
+
+static cfg_opt_t opts[] = {
+	CFG_INT("a", 0, CFGF_NONE),
+	CFG_INT("b", 0, CFGF_NONE),
+	CFG_FUNC("include", cfg_include),
+	CFG_END()
+};
+
+static void write_file(const char *path, const char *fmt, int value)
+{
+	FILE *fp = fopen(path, "w");
+
+	fail_unless(fp);
+	fprintf(fp, fmt, value, inc_conf);
+	fclose(fp);
+}
+
+static void reload(cfg_t *cfg, void *arg)
+{
+	fail_unless(cfg == arg);
+	reloads++;
+}
+
+/* Wait for the watch to fire, always ready when polling */
+static int ready(int fd)
+{
+	struct pollfd pfd = { fd, POLLIN, 0 };
+
+	return fd < 0 || poll(&pfd, 1, 2000) == 1;
+}
+
+/*
+ * The first change only arms the debounce, the reload comes after it.
+ * When polling with a timer, it takes a few more ticks.
+ */
+static int dispatch(cfg_t *cfg, int fd)
+{
+	int i, rc = 0;
+
+	for (i = 0; !rc && i < 4; i++) {
+		if (!ready(fd))
+			return 0;
+		rc = cfg_watch_dispatch(cfg, 50, reload, cfg);
+		if (fd < 0)
+			break;
+	}
+
+	return rc;
+}
+
+int main(void)
+{
+	cfg_t *cfg;
+	int fd, i;
+
+	strcpy(dir, "/tmp/confuse-watch-XXXXXX");
+	fail_unless(mkdtemp(dir));
+	snprintf(main_conf, sizeof(main_conf), "%s/main.conf", dir);
+	snprintf(inc_conf, sizeof(inc_conf), "%s/inc.conf", dir);
+	snprintf(other, sizeof(other), "%s/other.conf", dir);
+
+	write_file(main_conf, "a = %d\ninclude(\"%s\")\n", 1);
+	write_file(inc_conf, "b = %d\n", 2);
+
+	cfg = cfg_init(opts, CFGF_NONE);
+	fail_unless(cfg_watch_fd(cfg) == -1 && errno == ENOENT);
+	fail_unless(cfg_parse(cfg, main_conf) == CFG_SUCCESS);
+	fail_unless(cfg_getint(cfg, "b") == 2);
+
+	fd = cfg_watch_fd(cfg);
+	fail_unless(fd >= 0 || errno == ENOSYS);
+	fail_unless(cfg_watch_fd(cfg) == fd);
+	fail_unless(cfg_watch_dispatch(cfg, 0, reload, cfg) == 0);
+
+	/* Other files in the same directory are ignored */
+	write_file(other, "%d", 0);
+	fail_unless(dispatch(cfg, fd) == 0);
+	fail_unless(reloads == 0);
+
+	/* Included files are watched */
+	write_file(inc_conf, "b = %d\n", 20);
+	fail_unless(dispatch(cfg, fd) == 1);
+	fail_unless(reloads == 1);
+
+	/* A burst of writes is one reload */
+	for (i = 0; i < 5; i++)
+		write_file(main_conf, "a = %d\ninclude(\"%s\")\n", 100 + i);
+	fail_unless(dispatch(cfg, fd) == 1);
+	fail_unless(reloads == 2);
+	fail_unless(cfg_watch_dispatch(cfg, 0, reload, cfg) == 0);
+
+#ifdef __linux__
+	/* The debounce does not block, a later change restarts it */
+	write_file(main_conf, "a = %d\ninclude(\"%s\")\n", 2);
+	fail_unless(fd >= 0 && ready(fd));
+	fail_unless(cfg_watch_dispatch(cfg, 3600 * 1000, reload, cfg) == 0);
+	fail_unless(reloads == 2);
+	write_file(main_conf, "a = %d\ninclude(\"%s\")\n", 3);
+	fail_unless(dispatch(cfg, fd) == 1);
+	fail_unless(reloads == 3);
+#endif
+
+	/* Replaced by rename(), like editors and deployment tools do */
+	write_file(other, "a = %d\ninclude(\"%s\")\n", 12345);
+	i = reloads;
+	fail_unless(rename(other, main_conf) == 0);
+	fail_unless(dispatch(cfg, fd) == 1);
+	fail_unless(reloads == i + 1);
+
+	fail_unless(cfg_watch_dispatch(NULL, 0, reload, NULL) == CFG_FAIL);
+	fail_unless(cfg_watch_dispatch(cfg, 0, NULL, NULL) == CFG_FAIL);
+	cfg_free(cfg);
+
+	unlink(main_conf);
+	unlink(inc_conf);
+	rmdir(dir);
+
+	return 0;
+}
+#endif
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */
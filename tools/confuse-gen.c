@@ -0,0 +1,780 @@
+/*
+ * Copyright (c) 2002-2017  Martin Hedenfalk <martin@bzero.se>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * confuse-gen - generate typed accessors from a schema description
+ *
+ * The schema is itself a libConfuse file:
+ *
+ *     option name    { type = str  default = "demo" }
+ *     option ports   { type = uint16  list = true  default = "{80, 443}" }
+ *     section backend {
+ *         multi = true
+ *         title = true
+ *         option host { type = str }
+ *         option port { type = uint16  default = 8080 }
+ *     }
+ *
+ * From this a source file with the cfg_opt_t tables is generated, and a
+ * header with one wrapper struct per section type and static inline
+ * accessors.  The accessors index straight into cfg->opts[] by position,
+ * which is valid because cfg_init() and section instantiation keep the
+ * order of the cfg_opt_t array they are given.  Only options added at
+ * runtime, by CFGF_IGNORE_UNKNOWN or cfg_addopt(), are appended after
+ * the generated ones, so the positions never move.
+ *
+ * In the generated tables all options of a section come before its
+ * subsections, in schema order.  Sections can be nested GEN_DEPTH deep.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#include "confuse.h"
+
+enum gen_kind {
+	GEN_SIGNED,
+	GEN_UNSIGNED,
+	GEN_FLOAT,
+	GEN_BOOL,
+	GEN_STR,
+};
+
+struct gen_type {
+	const char     *name;	/* Name used in the schema */
+	const char     *macro;	/* CFG_<macro>() and CFG_<macro>_LIST() */
+	const char     *ctype;	/* C type returned by the accessor */
+	const char     *getter;	/* cfg_opt_getn<getter>() */
+	enum gen_kind   kind;
+	long long       min;
+	unsigned long long max;
+	const char     *suffix;	/* Integer literal suffix */
+};
+
+static const struct gen_type gen_types[] = {
+	{ "int",    "INT",    "long int", "int",    GEN_SIGNED,   LONG_MIN,  LONG_MAX,   "L"   },
+	{ "int8",   "INT8",   "int8_t",   "int8",   GEN_SIGNED,   INT8_MIN,  INT8_MAX,   ""    },
+	{ "int16",  "INT16",  "int16_t",  "int16",  GEN_SIGNED,   INT16_MIN, INT16_MAX,  ""    },
+	{ "int32",  "INT32",  "int32_t",  "int32",  GEN_SIGNED,   INT32_MIN, INT32_MAX,  "L"   },
+	{ "int64",  "INT64",  "int64_t",  "int64",  GEN_SIGNED,   INT64_MIN, INT64_MAX,  "LL"  },
+	{ "uint8",  "UINT8",  "uint8_t",  "uint8",  GEN_UNSIGNED, 0,         UINT8_MAX,  "U"   },
+	{ "uint16", "UINT16", "uint16_t", "uint16", GEN_UNSIGNED, 0,         UINT16_MAX, "U"   },
+	{ "uint32", "UINT32", "uint32_t", "uint32", GEN_UNSIGNED, 0,         UINT32_MAX, "UL"  },
+	{ "uint64", "UINT64", "uint64_t", "uint64", GEN_UNSIGNED, 0,         UINT64_MAX, "ULL" },
+	{ "float",  "FLOAT",  "double",   "float",  GEN_FLOAT,    0,         0,          ""    },
+	{ "bool",   "BOOL",   "cfg_bool_t", "bool", GEN_BOOL,     0,         0,          ""    },
+	{ "str",    "STR",    "const char *", "str", GEN_STR,     0,         0,          ""    },
+};
+
+struct gen {
+	const char *schema;
+	const char *prefix;
+	const char *header;
+	FILE       *h;
+	FILE       *c;
+	char      **idents;	/* Every generated identifier, to catch clashes */
+	size_t      nidents;
+	int         errors;
+};
+
+static cfg_opt_t option_opts[] = {
+	CFG_STR("type", "str", CFGF_NONE),
+	CFG_STR("default", NULL, CFGF_NODEFAULT),
+	CFG_BOOL("list", cfg_false, CFGF_NONE),
+	CFG_BOOL("nodefault", cfg_false, CFGF_NONE),
+	CFG_STR("comment", NULL, CFGF_NODEFAULT),
+	CFG_END()
+};
+
+/*
+ * cfg_init() copies nested option tables up front, so a section table
+ * cannot refer to itself.  Instead there is one table per nesting
+ * level, chained together by gen_schema(), and the innermost level has
+ * no "section" option.
+ */
+#define GEN_DEPTH 8
+
+static cfg_opt_t section_opts[GEN_DEPTH][7];
+
+static cfg_opt_t schema_opts[] = {
+	CFG_SEC("option", option_opts, CFGF_MULTI | CFGF_TITLE | CFGF_NO_TITLE_DUPES),
+	CFG_SEC("section", section_opts[0], CFGF_MULTI | CFGF_TITLE | CFGF_NO_TITLE_DUPES),
+	CFG_END()
+};
+
+static void gen_schema(void)
+{
+	int i;
+
+	for (i = 0; i < GEN_DEPTH; i++) {
+		cfg_opt_t level[] = {
+			CFG_BOOL("multi", cfg_false, CFGF_NONE),
+			CFG_BOOL("title", cfg_false, CFGF_NONE),
+			CFG_BOOL("nodefault", cfg_false, CFGF_NONE),
+			CFG_STR("comment", NULL, CFGF_NODEFAULT),
+			CFG_SEC("option", option_opts, CFGF_MULTI | CFGF_TITLE | CFGF_NO_TITLE_DUPES),
+			CFG_SEC("section", NULL, CFGF_MULTI | CFGF_TITLE | CFGF_NO_TITLE_DUPES),
+			CFG_END()
+		};
+
+		if (i + 1 < GEN_DEPTH)
+			level[5].subopts = section_opts[i + 1];
+		else
+			memset(&level[5], 0, sizeof(level[5]));
+		memcpy(section_opts[i], level, sizeof(level));
+	}
+}
+
+static void gen_error(struct gen *gen, const char *fmt, const char *arg)
+{
+	fprintf(stderr, "confuse-gen: %s: ", gen->schema);
+	fprintf(stderr, fmt, arg);
+	fputc('\n', stderr);
+	gen->errors++;
+}
+
+static const struct gen_type *gen_type(cfg_t *opt)
+{
+	const char *type = cfg_getstr(opt, "type");
+	size_t i;
+
+	for (i = 0; i < sizeof(gen_types) / sizeof(gen_types[0]); i++) {
+		if (!strcmp(type, gen_types[i].name))
+			return &gen_types[i];
+	}
+
+	return NULL;
+}
+
+/* Map a name to a C identifier, or NULL if that is not possible */
+static char *gen_ident(const char *prefix, const char *name, int upper)
+{
+	size_t len = strlen(prefix) + strlen(name) + 2;
+	char *id, *p;
+
+	if (!*name || isdigit((unsigned char)*name))
+		return NULL;
+
+	id = malloc(len);
+	if (!id)
+		return NULL;
+
+	if (*prefix)
+		snprintf(id, len, "%s_%s", prefix, name);
+	else
+		snprintf(id, len, "%s", name);
+
+	for (p = id; *p; p++) {
+		if (*p == '-' || *p == '.')
+			*p = '_';
+		else if (!isalnum((unsigned char)*p) && *p != '_') {
+			free(id);
+			return NULL;
+		}
+		if (upper)
+			*p = toupper((unsigned char)*p);
+	}
+
+	return id;
+}
+
+static int gen_invalid(const char *name)
+{
+	char *id = gen_ident("", name, 0);
+
+	free(id);
+	return id == NULL;
+}
+
+/* Record a generated function or type name, complain if already taken */
+static void gen_claim(struct gen *gen, const char *id, const char *suffix)
+{
+	size_t len = strlen(id) + strlen(suffix) + 1;
+	char **arr, *name;
+	size_t i;
+
+	name = malloc(len);
+	if (!name) {
+		gen->errors++;
+		return;
+	}
+	snprintf(name, len, "%s%s", id, suffix);
+
+	for (i = 0; i < gen->nidents; i++) {
+		if (!strcmp(gen->idents[i], name)) {
+			gen_error(gen, "generated name '%s' is ambiguous", name);
+			free(name);
+			return;
+		}
+	}
+
+	arr = realloc(gen->idents, (gen->nidents + 1) * sizeof(char *));
+	if (!arr) {
+		free(name);
+		gen->errors++;
+		return;
+	}
+	gen->idents = arr;
+	gen->idents[gen->nidents++] = name;
+}
+
+/* Index constants are upper case, so they may clash when names do not */
+static void gen_claim_idx(struct gen *gen, const char *id)
+{
+	char *ID = gen_ident("", id, 1);
+
+	if (!ID) {
+		gen->errors++;
+		return;
+	}
+	gen_claim(gen, ID, "_IDX");
+	free(ID);
+}
+
+static void gen_string(FILE *fp, const char *str)
+{
+	if (!str) {
+		fputs("NULL", fp);
+		return;
+	}
+
+	fputc('"', fp);
+	for (; *str; str++) {
+		unsigned char ch = *str;
+
+		/* Also '?', or "??/" would be a trigraph with -trigraphs */
+		if (ch == '"' || ch == '\\' || ch == '?')
+			fprintf(fp, "\\%c", ch);
+		else if (ch == '\n')
+			fputs("\\n", fp);
+		else if (ch == '\t')
+			fputs("\\t", fp);
+		else if (ch < 0x20 || ch == 0x7f)
+			fprintf(fp, "\\%03o", ch);
+		else
+			fputc(ch, fp);
+	}
+	fputc('"', fp);
+}
+
+/* Comments are emitted inside C comments, keep them from ending early */
+static void gen_comment(FILE *fp, const char *indent, const char *comment)
+{
+	const char *p;
+
+	if (!comment)
+		return;
+
+	fprintf(fp, "%s/* ", indent);
+	for (p = comment; *p; p++) {
+		if (*p == '*' && p[1] == '/')
+			fputs("* ", fp);
+		else if (*p == '\n')
+			fprintf(fp, "\n%s * ", indent);
+		else
+			fputc(*p, fp);
+	}
+	fputs(" */\n", fp);
+}
+
+/*
+ * Format the default value of an option as a C initializer, fp may be
+ * NULL to only validate it.  List defaults are kept as strings, they
+ * are parsed by cfg_init() like they are for hand written tables.
+ */
+static int gen_default(struct gen *gen, const struct gen_type *type, cfg_t *opt, FILE *fp)
+{
+	const char *def = cfg_getstr(opt, "default");
+	char buf[64], *end;
+
+	if (cfg_getbool(opt, "list") || type->kind == GEN_STR) {
+		if (fp)
+			gen_string(fp, def);
+		return 0;
+	}
+
+	if (!def)
+		def = type->kind == GEN_BOOL ? "false" : "0";
+
+	errno = 0;
+	switch (type->kind) {
+	case GEN_SIGNED: {
+		long long val = strtoll(def, &end, 0);
+
+		if (errno || *end || end == def || val < type->min || val > (long long)type->max)
+			goto invalid;
+		if (val == LLONG_MIN)
+			snprintf(buf, sizeof(buf), "(%lld%s - 1)", val + 1, type->suffix);
+		else
+			snprintf(buf, sizeof(buf), "%lld%s", val, type->suffix);
+		break;
+	}
+
+	case GEN_UNSIGNED: {
+		unsigned long long val;
+
+		while (isspace((unsigned char)*def))
+			def++;
+		if (*def == '-')
+			goto invalid;
+		val = strtoull(def, &end, 0);
+		if (errno || *end || end == def || val > type->max)
+			goto invalid;
+		snprintf(buf, sizeof(buf), "%llu%s", val, type->suffix);
+		break;
+	}
+
+	case GEN_FLOAT: {
+		double val = strtod(def, &end);
+
+		/* ERANGE also flags subnormals, only reject what underflows to 0 */
+		if (errno == ERANGE && val != 0)
+			errno = 0;
+		if (errno || *end || end == def || !isfinite(val))
+			goto invalid;
+
+		/* Shortest form that reads back as the same double */
+		snprintf(buf, sizeof(buf), "%.15g", val);
+		if (strtod(buf, NULL) != val)
+			snprintf(buf, sizeof(buf), "%.17g", val);
+		break;
+	}
+
+	case GEN_BOOL:
+		switch (cfg_parse_boolean(def)) {
+		case 1:
+			snprintf(buf, sizeof(buf), "cfg_true");
+			break;
+		case 0:
+			snprintf(buf, sizeof(buf), "cfg_false");
+			break;
+		default:
+			goto invalid;
+		}
+		break;
+
+	default:
+		goto invalid;
+	}
+
+	if (fp)
+		fputs(buf, fp);
+	return 0;
+
+invalid:
+	gen_error(gen, "invalid default value for option '%s'", cfg_title(opt));
+	return -1;
+}
+
+/*
+ * Emit the cfg_opt_t table of a section, nested tables first.  The
+ * root table is global, the rest are only reachable through it.
+ */
+static void gen_table(struct gen *gen, cfg_t *sec, const char *id, int root)
+{
+	unsigned int i, n;
+
+	n = cfg_size(sec, "section");
+	for (i = 0; i < n; i++) {
+		cfg_t *sub = cfg_getnsec(sec, "section", i);
+		char *subid = gen_ident(id, cfg_title(sub), 0);
+
+		if (!subid)
+			continue;
+		gen_table(gen, sub, subid, 0);
+		free(subid);
+	}
+
+	fprintf(gen->c, "%scfg_opt_t %s_opts[] = {\n", root ? "" : "static ", id);
+
+	n = cfg_size(sec, "option");
+	for (i = 0; i < n; i++) {
+		cfg_t *opt = cfg_getnsec(sec, "option", i);
+		const struct gen_type *type = gen_type(opt);
+		int list = cfg_getbool(opt, "list");
+
+		gen_comment(gen->c, "\t", cfg_getstr(opt, "comment"));
+		fprintf(gen->c, "\tCFG_%s%s(", type->macro, list ? "_LIST" : "");
+		gen_string(gen->c, cfg_title(opt));
+		fputs(", ", gen->c);
+		gen_default(gen, type, opt, gen->c);
+		fprintf(gen->c, ", %s),\n", cfg_getbool(opt, "nodefault") ? "CFGF_NODEFAULT" : "CFGF_NONE");
+	}
+
+	n = cfg_size(sec, "section");
+	for (i = 0; i < n; i++) {
+		cfg_t *sub = cfg_getnsec(sec, "section", i);
+		char *subid = gen_ident(id, cfg_title(sub), 0);
+		int flags = 0;
+
+		if (!subid)
+			continue;
+
+		gen_comment(gen->c, "\t", cfg_getstr(sub, "comment"));
+		fputs("\tCFG_SEC(", gen->c);
+		gen_string(gen->c, cfg_title(sub));
+		fprintf(gen->c, ", %s_opts, ", subid);
+		if (cfg_getbool(sub, "multi")) {
+			fputs("CFGF_MULTI", gen->c);
+			flags++;
+		}
+		if (cfg_getbool(sub, "title")) {
+			fputs(flags++ ? " | CFGF_TITLE" : "CFGF_TITLE", gen->c);
+			fputs(" | CFGF_NO_TITLE_DUPES", gen->c);
+		}
+		if (cfg_getbool(sub, "nodefault"))
+			fputs(flags++ ? " | CFGF_NODEFAULT" : "CFGF_NODEFAULT", gen->c);
+		if (!flags)
+			fputs("CFGF_NONE", gen->c);
+		fputs("),\n", gen->c);
+		free(subid);
+	}
+
+	fputs("\tCFG_END()\n};\n\n", gen->c);
+}
+
+/* Emit one typedef per section type, checking all names on the way */
+static void gen_types_decl(struct gen *gen, cfg_t *sec, const char *id)
+{
+	unsigned int i, n;
+
+	gen_claim(gen, id, "_t");
+	fprintf(gen->h, "typedef struct %s { cfg_t *cfg; } %s_t;\n", id, id);
+
+	n = cfg_size(sec, "option");
+	for (i = 0; i < n; i++) {
+		cfg_t *opt = cfg_getnsec(sec, "option", i);
+		const struct gen_type *type = gen_type(opt);
+		char *optid = gen_ident(id, cfg_title(opt), 0);
+
+		if (!optid) {
+			gen_error(gen, "option '%s' is not a valid C identifier", cfg_title(opt));
+			continue;
+		}
+		if (cfg_gettsec(sec, "section", cfg_title(opt)))
+			gen_error(gen, "'%s' is both an option and a section", cfg_title(opt));
+		if (!type)
+			gen_error(gen, "unknown type for option '%s'", cfg_title(opt));
+		else
+			gen_default(gen, type, opt, NULL);
+		gen_claim_idx(gen, optid);
+		gen_claim(gen, optid, "");
+		if (cfg_getbool(opt, "list"))
+			gen_claim(gen, optid, "_count");
+		free(optid);
+	}
+
+	n = cfg_size(sec, "section");
+	for (i = 0; i < n; i++) {
+		cfg_t *sub = cfg_getnsec(sec, "section", i);
+		char *subid = gen_ident(id, cfg_title(sub), 0);
+
+		if (!subid) {
+			gen_error(gen, "section '%s' is not a valid C identifier", cfg_title(sub));
+			continue;
+		}
+		gen_claim_idx(gen, subid);
+		gen_claim(gen, subid, "");
+		if (cfg_getbool(sub, "multi"))
+			gen_claim(gen, subid, "_count");
+		if (cfg_getbool(sub, "title"))
+			gen_claim(gen, subid, "_title");
+		gen_types_decl(gen, sub, subid);
+		free(subid);
+	}
+}
+
+static void gen_accessors(struct gen *gen, cfg_t *sec, const char *id)
+{
+	unsigned int i, nopts, nsecs;
+	char *ID = gen_ident("", id, 1);
+
+	nopts = cfg_size(sec, "option");
+	nsecs = cfg_size(sec, "section");
+
+	fprintf(gen->h, "\n/* Positions in %s_opts[] */\nenum {\n", id);
+	for (i = 0; i < nopts + nsecs; i++) {
+		cfg_t *ent = i < nopts ? cfg_getnsec(sec, "option", i) : cfg_getnsec(sec, "section", i - nopts);
+		char *entid = gen_ident(ID, cfg_title(ent), 1);
+
+		fprintf(gen->h, "\t%s_IDX = %u,\n", entid, i);
+		free(entid);
+	}
+	fprintf(gen->h, "\t%s_NOPTS = %u\n};\n", ID, nopts + nsecs);
+
+	for (i = 0; i < nopts; i++) {
+		cfg_t *opt = cfg_getnsec(sec, "option", i);
+		const struct gen_type *type = gen_type(opt);
+		char *optid = gen_ident(id, cfg_title(opt), 0);
+		char *OPTID = gen_ident(ID, cfg_title(opt), 1);
+		const char *sp = strchr(type->ctype, '*') ? "" : " ";
+
+		fputc('\n', gen->h);
+		gen_comment(gen->h, "", cfg_getstr(opt, "comment"));
+		if (cfg_getbool(opt, "list")) {
+			fprintf(gen->h,
+				"static inline unsigned int %s_count(%s_t sec)\n"
+				"{\n\treturn cfg_opt_size(&sec.cfg->opts[%s_IDX]);\n}\n\n",
+				optid, id, OPTID);
+			fprintf(gen->h,
+				"static inline %s%s%s(%s_t sec, unsigned int index)\n"
+				"{\n\treturn cfg_opt_getn%s(&sec.cfg->opts[%s_IDX], index);\n}\n",
+				type->ctype, sp, optid, id, type->getter, OPTID);
+		} else {
+			fprintf(gen->h,
+				"static inline %s%s%s(%s_t sec)\n"
+				"{\n\treturn cfg_opt_getn%s(&sec.cfg->opts[%s_IDX], 0);\n}\n",
+				type->ctype, sp, optid, id, type->getter, OPTID);
+		}
+		free(OPTID);
+		free(optid);
+	}
+
+	for (i = 0; i < nsecs; i++) {
+		cfg_t *sub = cfg_getnsec(sec, "section", i);
+		char *subid = gen_ident(id, cfg_title(sub), 0);
+		char *SUBID = gen_ident(ID, cfg_title(sub), 1);
+
+		fputc('\n', gen->h);
+		gen_comment(gen->h, "", cfg_getstr(sub, "comment"));
+		if (cfg_getbool(sub, "multi")) {
+			fprintf(gen->h,
+				"static inline unsigned int %s_count(%s_t sec)\n"
+				"{\n\treturn cfg_opt_size(&sec.cfg->opts[%s_IDX]);\n}\n\n",
+				subid, id, SUBID);
+			fprintf(gen->h,
+				"static inline %s_t %s(%s_t sec, unsigned int index)\n"
+				"{\n\t%s_t sub = { cfg_opt_getnsec(&sec.cfg->opts[%s_IDX], index) };\n\n"
+				"\treturn sub;\n}\n",
+				subid, subid, id, subid, SUBID);
+		} else {
+			fprintf(gen->h,
+				"static inline %s_t %s(%s_t sec)\n"
+				"{\n\t%s_t sub = { cfg_opt_getnsec(&sec.cfg->opts[%s_IDX], 0) };\n\n"
+				"\treturn sub;\n}\n",
+				subid, subid, id, subid, SUBID);
+		}
+		if (cfg_getbool(sub, "title"))
+			fprintf(gen->h,
+				"\nstatic inline const char *%s_title(%s_t sec)\n"
+				"{\n\treturn cfg_title(sec.cfg);\n}\n",
+				subid, subid);
+		free(SUBID);
+		free(subid);
+	}
+
+	for (i = 0; i < nsecs; i++) {
+		cfg_t *sub = cfg_getnsec(sec, "section", i);
+		char *subid = gen_ident(id, cfg_title(sub), 0);
+
+		gen_accessors(gen, sub, subid);
+		free(subid);
+	}
+
+	free(ID);
+}
+
+static void gen_header(struct gen *gen, cfg_t *cfg)
+{
+	char *guard;
+	const char *base;
+
+	base = strrchr(gen->header, '/');
+	base = base ? base + 1 : gen->header;
+	guard = gen_ident("", base, 1);
+	if (!guard)
+		guard = gen_ident(gen->prefix, "H", 1);
+
+	fprintf(gen->h,
+		"/* Generated by confuse-gen from %s, do not edit */\n"
+		"#ifndef %s_\n#define %s_\n\n"
+		"#include <confuse.h>\n\n"
+		"#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n"
+		"extern cfg_opt_t %s_opts[];\n\n",
+		gen->schema, guard, guard, gen->prefix);
+
+	gen_types_decl(gen, cfg, gen->prefix);
+	if (gen->errors) {
+		free(guard);
+		return;
+	}
+
+	fprintf(gen->h,
+		"\n/* Wrap a cfg_t created by cfg_init(%s_opts, flags) */\n"
+		"static inline %s_t %s_root(cfg_t *cfg)\n"
+		"{\n\t%s_t sec = { cfg };\n\n\treturn sec;\n}\n",
+		gen->prefix, gen->prefix, gen->prefix, gen->prefix);
+
+	gen_accessors(gen, cfg, gen->prefix);
+
+	fprintf(gen->h,
+		"\n#ifdef __cplusplus\n}\n#endif\n\n"
+		"#endif /* %s_ */\n", guard);
+	free(guard);
+}
+
+static void gen_source(struct gen *gen, cfg_t *cfg)
+{
+	const char *base;
+
+	base = strrchr(gen->header, '/');
+	base = base ? base + 1 : gen->header;
+
+	fprintf(gen->c,
+		"/* Generated by confuse-gen from %s, do not edit */\n"
+		"#include \"%s\"\n\n", gen->schema, base);
+
+	gen_table(gen, cfg, gen->prefix, 1);
+}
+
+static int usage(int rc)
+{
+	fprintf(rc ? stderr : stdout,
+		"Usage: confuse-gen [-p PREFIX] -o HEADER -c SOURCE SCHEMA\n"
+		"\n"
+		"  -c SOURCE  Write the cfg_opt_t tables to SOURCE\n"
+		"  -h         Show this help text\n"
+		"  -o HEADER  Write the types and accessors to HEADER\n"
+		"  -p PREFIX  Prefix for all generated names, default: schema file name\n");
+
+	return rc;
+}
+
+int main(int argc, char *argv[])
+{
+	struct gen gen = { 0 };
+	const char *source = NULL;
+	char *prefix = NULL;
+	cfg_t *cfg;
+	size_t i;
+	int c, rc = 1;
+
+	while ((c = getopt(argc, argv, "c:ho:p:")) != EOF) {
+		switch (c) {
+		case 'c':
+			source = optarg;
+			break;
+
+		case 'h':
+			return usage(0);
+
+		case 'o':
+			gen.header = optarg;
+			break;
+
+		case 'p':
+			gen.prefix = optarg;
+			break;
+
+		default:
+			return usage(1);
+		}
+	}
+
+	if (optind + 1 != argc || !gen.header || !source)
+		return usage(1);
+	gen.schema = argv[optind];
+
+	if (!gen.prefix) {
+		const char *base = strrchr(gen.schema, '/');
+		char *dot;
+
+		prefix = strdup(base ? base + 1 : gen.schema);
+		if (!prefix)
+			return 1;
+		dot = strchr(prefix, '.');
+		if (dot)
+			*dot = 0;
+		gen.prefix = prefix;
+	}
+
+	if (gen_invalid(gen.prefix)) {
+		fprintf(stderr, "confuse-gen: prefix '%s' is not a valid C identifier\n", gen.prefix);
+		free(prefix);
+		return 1;
+	}
+
+	gen_schema();
+	cfg = cfg_init(schema_opts, CFGF_NONE);
+	if (!cfg) {
+		perror("confuse-gen");
+		free(prefix);
+		return 1;
+	}
+
+	switch (cfg_parse(cfg, gen.schema)) {
+	case CFG_FILE_ERROR:
+		fprintf(stderr, "confuse-gen: %s: %s\n", gen.schema, strerror(errno));
+		goto done;
+
+	case CFG_PARSE_ERROR:
+		goto done;
+	}
+
+	gen.h = fopen(gen.header, "w");
+	gen.c = fopen(source, "w");
+	if (!gen.h || !gen.c) {
+		perror("confuse-gen");
+		goto done;
+	}
+
+	gen_header(&gen, cfg);
+	if (!gen.errors)
+		gen_source(&gen, cfg);
+
+	if (ferror(gen.h) || ferror(gen.c))
+		gen.errors++;
+	if (!gen.errors)
+		rc = 0;
+done:
+	if (gen.h && fclose(gen.h))
+		rc = 1;
+	if (gen.c && fclose(gen.c))
+		rc = 1;
+	if (rc) {
+		if (gen.h)
+			remove(gen.header);
+		if (gen.c)
+			remove(source);
+	}
+
+	for (i = 0; i < gen.nidents; i++)
+		free(gen.idents[i]);
+	free(gen.idents);
+	cfg_free(cfg);
+	free(prefix);
+
+	return rc;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: t
+ *  c-file-style: "linux"
+ * End:
+ */